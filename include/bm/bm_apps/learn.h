@@ -28,6 +28,9 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <vector>
+
+#include "nn_msg_dispatcher.h"
 
 namespace bm_runtime {
 namespace standard {
@@ -57,11 +60,27 @@ class LearnListener {
   typedef std::function<void(const MsgInfo &msg_info,
                              const char *, void *)> LearnCb;
 
+  // a learning notification; data points to the samples, in the nanomsg
+  // buffer in which the notification was received and which is owned by msg
+  struct Msg {
+    MsgInfo info;
+    const char *data;
+    NnMsg msg;
+  };
+
+  // receives consecutive notifications in one call, and takes ownership of
+  // them
+  typedef std::function<void(std::vector<Msg> &&msgs, void *)> LearnBatchCb;
+
  public:
+  // With nb_workers > 0, the callbacks are invoked by nb_workers threads
+  // instead of by the receiving thread, and need to be thread-safe. Up to
+  // max_batch notifications are passed to each LearnBatchCb call.
   LearnListener(
     const std::string &learn_socket = "ipc:///tmp/bmv2-0-notifications.ipc",
     const std::string &thrift_addr = "localhost",
-    const int thrift_port = 9090);
+    const int thrift_port = 9090,
+    size_t nb_workers = 0, size_t max_batch = 1);
 
   ~LearnListener();
 
@@ -69,6 +88,8 @@ class LearnListener {
 
   void register_cb(const LearnCb &cb, void *cookie);
 
+  void register_batch_cb(const LearnBatchCb &cb, void *cookie);
+
   void ack_buffer(cxt_id_t cxt_id, list_id_t list_id, buffer_id_t buffer_id);
 
   boost::shared_ptr<bm_runtime::standard::StandardClient> get_client() {
@@ -78,11 +99,16 @@ class LearnListener {
  private:
   void listen_loop();
 
+  void handle_batch(NnMsgDispatcher::Batch batch);
+
  private:
   std::string socket_name{};
   std::string thrift_addr{};
   int thrift_port{};
+  size_t nb_workers{};
+  size_t max_batch{};
   LearnCb cb_fn{};
+  LearnBatchCb batch_cb_fn{};
   void *cb_cookie{nullptr};
   std::thread listen_thread{};
   bool stop_listen_thread{false};
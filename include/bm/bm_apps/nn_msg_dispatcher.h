@@ -0,0 +1,143 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef BM_BM_APPS_NN_MSG_DISPATCHER_H_
+#define BM_BM_APPS_NN_MSG_DISPATCHER_H_
+
+#include <nanomsg/nn.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace bm_apps {
+
+struct NnMsgDeleter {
+  void operator()(char *msg) const { nn_freemsg(msg); }
+};
+
+// a message received from a nanomsg socket, still in the buffer allocated by
+// nanomsg (no copy), which is released when the NnMsg is destroyed
+struct NnMsg {
+  std::unique_ptr<char, NnMsgDeleter> buffer;
+  size_t size;
+};
+
+// Receives the messages published on a nanomsg socket without copying them and
+// hands them off, by batches of consecutive messages, to a handler. When
+// several messages are waiting in the socket (e.g. during a burst of learning
+// notifications), up to max_batch of them are handed off in a single
+// call. The handler is called on the receiving thread if nb_workers is 0,
+// otherwise on one of nb_workers threads, so that a slow handler does not
+// delay the reception of the next messages; in that case, different batches
+// can be handled concurrently and in any order.
+// Header-only, so that it can be used by libraries which do not link with
+// bm_apps (e.g. the PD).
+class NnMsgDispatcher {
+ public:
+  typedef std::vector<NnMsg> Batch;
+  typedef std::function<void(Batch &&batch)> Handler;
+
+  NnMsgDispatcher(size_t nb_workers, size_t max_batch, Handler handler)
+      : max_batch(std::max<size_t>(max_batch, 1)),
+        handler(std::move(handler)) {
+    for (size_t i = 0; i < nb_workers; i++)
+      workers.emplace_back(&NnMsgDispatcher::worker_loop, this);
+  }
+
+  // the batches which were already received are handled before the workers
+  // exit
+  ~NnMsgDispatcher() {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    for (auto &worker : workers) worker.join();
+  }
+
+  // Receives messages from socket s until stop_fn() returns true. s needs to
+  // have a receive timeout, stop_fn is only called when it expires.
+  template <typename Socket, typename StopFn>
+  void receive_loop(Socket *s, const StopFn &stop_fn) {
+    while (true) {
+      Batch batch;
+      if (!receive(s, 0, &batch)) {
+        if (stop_fn()) return;
+        continue;
+      }
+      while (batch.size() < max_batch && receive(s, NN_DONTWAIT, &batch)) { }
+      dispatch(std::move(batch));
+    }
+  }
+
+  NnMsgDispatcher(const NnMsgDispatcher &other) = delete;
+  NnMsgDispatcher &operator=(const NnMsgDispatcher &other) = delete;
+
+ private:
+  template <typename Socket>
+  static bool receive(Socket *s, int flags, Batch *batch) {
+    char *buffer = nullptr;
+    int rc = s->recv(&buffer, NN_MSG, flags);
+    if (rc < 0) return false;
+    batch->push_back(
+        {std::unique_ptr<char, NnMsgDeleter>(buffer), static_cast<size_t>(rc)});
+    return true;
+  }
+
+  void dispatch(Batch &&batch) {
+    if (workers.empty()) {
+      handler(std::move(batch));
+      return;
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      batches.push_back(std::move(batch));
+    }
+    cv.notify_one();
+  }
+
+  void worker_loop() {
+    while (true) {
+      Batch batch;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return stop || !batches.empty(); });
+        if (batches.empty()) return;
+        batch = std::move(batches.front());
+        batches.pop_front();
+      }
+      handler(std::move(batch));
+    }
+  }
+
+  size_t max_batch;
+  Handler handler;
+  std::mutex mutex{};
+  std::condition_variable cv{};
+  std::deque<Batch> batches{};
+  bool stop{false};
+  std::vector<std::thread> workers{};
+};
+
+}  // namespace bm_apps
+
+#endif  // BM_BM_APPS_NN_MSG_DISPATCHER_H_
@@ -21,6 +21,8 @@
 #ifndef BM_BM_SIM_P4OBJECTS_H_
 #define BM_BM_SIM_P4OBJECTS_H_
 
+#include <boost/functional/hash.hpp>
+
 #include <istream>
 #include <ostream>
 #include <vector>
@@ -174,6 +176,8 @@ class P4Objects {
     return calculations.at(name).get();
   }
 
+  NamedCalculation *get_named_calculation_rt(const std::string &name) const;
+
   FieldList *get_field_list(const p4object_id_t field_list_id) const {
     return field_lists.at(field_list_id).get();
   }
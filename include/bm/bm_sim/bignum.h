@@ -21,40 +21,85 @@
 #ifndef BM_BM_SIM_BIGNUM_H_
 #define BM_BM_SIM_BIGNUM_H_
 
-// will need to implement this ourselves if we do not use Boost
-#include <boost/multiprecision/gmp.hpp>
+#include <boost/multiprecision/cpp_int.hpp>
 
-#include <gmp.h>
+#include <algorithm>
+#include <climits>
+#include <memory>
 
 namespace bm {
 
 namespace bignum {
 
-  using boost::multiprecision::gmp_int;
+  using boost::multiprecision::cpp_int_backend;
   using boost::multiprecision::number;
+  using boost::multiprecision::limb_type;
+  using boost::multiprecision::signed_magnitude;
+  using boost::multiprecision::unchecked;
 
-  typedef number<gmp_int> Bignum;
+  // Values which fit in inline_bits bits (which covers IPv6 addresses and most
+  // match keys) are stored inside the Bignum object itself, so constructing,
+  // copying and operating on them does not require any heap memory
+  // allocation. Larger values are still supported, but their storage is
+  // allocated dynamically.
+  constexpr unsigned inline_bits = 128u;
 
+  typedef number<cpp_int_backend<inline_bits, 0, signed_magnitude, unchecked,
+                                 std::allocator<limb_type> > > Bignum;
+
+  constexpr size_t limb_bytes = sizeof(limb_type);
+
+  // Writes the absolute value of src to dst, as a big-endian number of exactly
+  // size bytes; src needs to fit. Nothing is written if src is 0, in which case
+  // 0 is returned (1 otherwise).
   inline size_t export_bytes(char *dst, size_t size, const Bignum &src) {
-    size_t count;
-    mpz_export(dst, &count, 1, size, 1, 0, src.backend().data());
-    return count;
+    if (src.is_zero()) return 0;
+    const auto &backend = src.backend();
+    const limb_type *limbs = backend.limbs();
+    const size_t nlimbs = backend.size();
+    for (size_t i = 0; i < size; i++) {
+      const size_t limb_index = i / limb_bytes;
+      dst[size - 1 - i] = (limb_index < nlimbs) ?
+          static_cast<char>(limbs[limb_index] >> (8 * (i % limb_bytes))) : 0;
+    }
+    return 1;
   }
 
+  // Number of bytes needed to represent the absolute value of src (1 for 0).
   inline size_t export_size_in_bytes(const Bignum &src) {
-    return (mpz_sizeinbase(src.backend().data(), 2) + 7) / 8;
+    const auto &backend = src.backend();
+    const size_t nlimbs = backend.size();
+    const limb_type top = backend.limbs()[nlimbs - 1];
+    size_t top_bits = 0;
+    for (limb_type v = top; v; v >>= 1) top_bits++;
+    const size_t nbits = (nlimbs - 1) * limb_bytes * CHAR_BIT + top_bits;
+    return std::max<size_t>((nbits + 7) / 8, 1);
   }
 
+  // Sets dst to the (non-negative) value of the size bytes at src, interpreted
+  // as a big-endian number.
   inline void import_bytes(Bignum *dst, const char *src, size_t size) {
-    mpz_import(dst->backend().data(), 1, 1, size, 1, 0, src);
+    auto &backend = dst->backend();
+    const unsigned nlimbs = std::max<unsigned>(
+        static_cast<unsigned>((size + limb_bytes - 1) / limb_bytes), 1u);
+    backend.resize(nlimbs, nlimbs);
+    limb_type *limbs = backend.limbs();
+    std::fill(limbs, limbs + nlimbs, 0);
+    for (size_t i = 0; i < size; i++) {
+      const auto byte = static_cast<unsigned char>(src[size - 1 - i]);
+      limbs[i / limb_bytes] |=
+          static_cast<limb_type>(byte) << (8 * (i % limb_bytes));
+    }
+    backend.sign(false);
+    backend.normalize();
   }
 
   inline int test_bit(const Bignum &v, size_t index) {
-    return mpz_tstbit(v.backend().data(), index);
+    return boost::multiprecision::bit_test(v, index);
   }
 
   inline void clear_bit(Bignum *v, size_t index) {
-    return mpz_clrbit(v->backend().data(), index);
+    boost::multiprecision::bit_unset(*v, index);
   }
 
 }  // namespace bignum
@@ -23,50 +23,52 @@
 #ifndef BM_BM_SIM_BYTECONTAINER_H_
 #define BM_BM_SIM_BYTECONTAINER_H_
 
-#include <boost/functional/hash.hpp>
-
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <iterator>
 #include <string>
 #include <iomanip>
 
-#include "short_alloc.h"
-
 namespace bm {
 
 //! This class is used everytime a vector of bytes is needed in bmv2. It is most
 //! notably used by the Field class (to store the byte representation of a
 //! field) as well as to store match keys in tables.
+//!
+//! Up to 32 bytes are stored inline, in the object itself, which covers most
+//! fields and match keys (e.g. an IPv6 address and a couple of ports), so that
+//! building a key for each packet does not involve any memory
+//! allocation. Larger containers use a heap-allocated buffer.
 class ByteContainer {
-  static constexpr size_t S = 16u;
-  static_assert(sizeof(char) == 1, "");
-  static_assert(alignof(char) == 1, "");
-  using _vector = std::vector<char, detail::short_alloc<char, S, 1> >;
+  static constexpr size_t S = 32u;
 
  public:
-  typedef _vector::iterator iterator;
-  typedef _vector::const_iterator const_iterator;
-  typedef _vector::reference reference;
-  typedef _vector::const_reference const_reference;
+  typedef char *iterator;
+  typedef const char *const_iterator;
+  typedef char &reference;
+  typedef const char &const_reference;
   typedef size_t size_type;
 
  public:
-  ByteContainer()
-      : bytes(_a) {
-    bytes.reserve(S);
-  }
+  ByteContainer() { }
 
   //! Constructs the container with \p nbytes copies of elements with value \p c
-  explicit ByteContainer(const size_t nbytes, const char c = '\x00')
-      : bytes(nbytes, c, _a) { }
+  explicit ByteContainer(const size_t nbytes, const char c = '\x00') {
+    resize(nbytes, c);
+  }
 
   //! Constructs the container by copying the bytes in vector \p bytes
-  explicit ByteContainer(const std::vector<char> &bytes)
-      : bytes(bytes.begin(), bytes.end(), _a) { }
+  explicit ByteContainer(const std::vector<char> &bytes) {
+    append(bytes.data(), bytes.size());
+  }
 
   //! Constructs the container by copying the bytes in this byte array
-  ByteContainer(const char *bytes, size_t nbytes)
-      : bytes(bytes, bytes + nbytes, _a) { }
+  ByteContainer(const char *bytes, size_t nbytes) {
+    append(bytes, nbytes);
+  }
 
   static char char2digit(char c) {
     if (c >= '0' && c <= '9')
@@ -81,9 +83,7 @@ class ByteContainer {
 
   //! Constructs the container from a hexadecimal string. Parameter \p hexstring
   //! can optionally include the `0x` prefix.
-  explicit ByteContainer(const std::string &hexstring)
-      : bytes(_a) {
-    bytes.reserve(S);
+  explicit ByteContainer(const std::string &hexstring) {
     size_t idx = 0;
 
     assert(hexstring[idx] != '-');
@@ -94,145 +94,158 @@ class ByteContainer {
     size_t size = hexstring.size();
     assert((size - idx) > 0);
 
+    reserve((size - idx + 1) / 2);
+
     if ((size - idx) % 2 != 0) {
       char c = char2digit(hexstring[idx++]);
-      bytes.push_back(c);
+      push_back(c);
     }
 
     for (; idx < size; ) {
       char c = char2digit(hexstring[idx++]) << 4;
       c += char2digit(hexstring[idx++]);
-      bytes.push_back(c);
+      push_back(c);
     }
   }
 
-  ByteContainer(const ByteContainer &other)
-      : bytes(other.bytes, _a) { }
+  ByteContainer(const ByteContainer &other) {
+    append(other.data(), other.size());
+  }
+
+  ByteContainer(ByteContainer &&other) noexcept {
+    steal(&other);
+  }
 
   ByteContainer &operator=(const ByteContainer &other) {
-    bytes.assign(other.begin(), other.end());
+    if (this != &other) {
+      clear();
+      append(other.data(), other.size());
+    }
     return *this;
   }
 
+  ByteContainer &operator=(ByteContainer &&other) noexcept {
+    if (this != &other) {
+      release();
+      steal(&other);
+    }
+    return *this;
+  }
+
+  ~ByteContainer() {
+    release();
+  }
+
   //! Returns the number of bytes in the container
-  size_type size() const noexcept { return bytes.size(); }
+  size_type size() const noexcept { return sz; }
 
   //! Clears the contents of the container
-  void clear() { return bytes.clear(); }
+  void clear() { sz = 0; }
 
   // iterators
 
   //! NC
-  iterator begin() { return bytes.begin(); }
+  iterator begin() { return ptr; }
 
   //! NC
-  const_iterator begin() const { return bytes.begin(); }
+  const_iterator begin() const { return ptr; }
 
   //! NC
-  iterator end() { return bytes.end(); }
+  iterator end() { return ptr + sz; }
 
   //! NC
-  const_iterator end() const { return bytes.end(); }
-
-  // reverse_iterator rbegin() { return bytes.rbegin(); }
-
-  // const_reverse_iterator rbegin() const { return bytes.rbegin(); }
-
-  // reverse_iterator rend() { return bytes.rend(); }
-
-  // const_reverse_iterator rend() const { return bytes.rend(); }
-
-  // const_iterator cbegin() const { return bytes.cbegin(); }
-
-  // const_iterator cend() const { return bytes.cend(); }
-
-  // const_reverse_iterator crbegin() const { return bytes.crbegin(); }
-
-  // const_reverse_iterator crend() const { return bytes.crend(); }
+  const_iterator end() const { return ptr + sz; }
 
   //! Appends another ByteContainer to this container. \p other has to be
   //! different from `*this`.
   ByteContainer &append(const ByteContainer &other) {
-    bytes.insert(end(), other.begin(), other.end());
-    return *this;
+    return append(other.data(), other.size());
   }
 
-  //! Appends a byte array to this container
+  //! Appends a byte array to this container. \p byte_array cannot point to the
+  //! contents of this container.
   ByteContainer &append(const char *byte_array, size_t nbytes) {
-    bytes.insert(end(), byte_array, byte_array + nbytes);
+    if (nbytes == 0) return *this;
+    grow(sz + nbytes);
+    std::memcpy(ptr + sz, byte_array, nbytes);
+    sz += nbytes;
     return *this;
   }
 
   //! Appends a binary string to this container
   ByteContainer &append(const std::string &other) {
-    bytes.insert(end(), other.begin(), other.end());
-    return *this;
+    return append(other.data(), other.size());
   }
 
-  //! Inserts another ByteContainer object into this container, before \p pos
-  // issue with g++-4.8, insert has a non-conforming signature, fixed in g++-4.9
-  // and g++-5.0. However, this signature works for "all" versions
-  // iterator insert(const_iterator pos, const ByteContainer& other) {
+  //! Inserts another ByteContainer object into this container, before \p pos.
+  //! \p other has to be different from `*this`.
   void insert(iterator pos, const ByteContainer& other) {
-    // return bytes.insert(pos, other.begin(), other.end());
-    bytes.insert(pos, other.begin(), other.end());
+    assert(pos >= begin() && pos <= end());
+    const size_t offset = pos - ptr;
+    const size_t n = other.size();
+    if (n == 0) return;
+    grow(sz + n);
+    std::memmove(ptr + offset + n, ptr + offset, sz - offset);
+    std::memcpy(ptr + offset, other.data(), n);
+    sz += n;
   }
 
   //! Appends a character at the end of the container
   void push_back(char c) {
-    bytes.push_back(c);
+    if (sz == cap) grow(sz + 1);
+    ptr[sz++] = c;
   }
 
   //! Access the character at position \p n. Will assert if n \p is greater or
   //! equal than the number of elements in the container.
   reference operator[](size_type n) {
     assert(n < size());
-    return bytes[n];
+    return ptr[n];
   }
 
   //! @copydoc operator[]
   const_reference operator[](size_type n) const {
     assert(n < size());
-    return bytes[n];
+    return ptr[n];
   }
 
   //! Access the last byte of the container. Undefined if the container is
   //! empty.
   reference back() {
-    return bytes.back();
+    return ptr[sz - 1];
   }
 
   //! @copydoc back
   const_reference back() const {
-    return bytes.back();
+    return ptr[sz - 1];
   }
 
   //! Access the first byte of the container. Undefined if the container is
   //! empty.
   reference front() {
-    return bytes.front();
+    return ptr[0];
   }
 
   //! @copydoc front()
   const_reference front() const {
-    return bytes.front();
+    return ptr[0];
   }
 
   //! Returns pointer to the underlying array serving as element storage. The
   //! pointer is such that range `[data(); data() + size())` is always a valid
   //! range, even if the container is empty.
   char* data() noexcept {
-    return bytes.data();
+    return ptr;
   }
 
   //! @copydoc data()
   const char* data() const noexcept {
-    return bytes.data();
+    return ptr;
   }
 
   //! Returns true is the contents of the containers are equal
   bool operator==(const ByteContainer& other) const {
-    return bytes == other.bytes;
+    return (sz == other.sz) && (std::memcmp(ptr, other.ptr, sz) == 0);
   }
 
   //! Returns true is the contents of the containers are not equal
@@ -242,18 +255,20 @@ class ByteContainer {
 
   //! Increase the capacity of the container
   void reserve(size_t n) {
-    bytes.reserve(n);
+    grow(n);
   }
 
   //! Resizes the container to contain \p bytes
   void resize(size_t n) {
-    bytes.resize(n);
+    resize(n, '\x00');
   }
 
   //! Resizes the container to contain \p bytes, initializing the new bytes to
   //! \p c
   void resize(size_t n, char c) {
-    bytes.resize(n, c);
+    grow(n);
+    if (n > sz) std::memset(ptr + sz, c, n - sz);
+    sz = n;
   }
 
   //! Perform a byte-by-byte masking of the container.
@@ -261,7 +276,7 @@ class ByteContainer {
   void apply_mask(const ByteContainer &mask) {
     assert(size() == mask.size());
     for (size_t i = 0; i < size(); i++)
-      bytes[i] &= mask[i];
+      ptr[i] &= mask.ptr[i];
   }
 
   //! Returns the hexadecimal representation of the bytes with a position in the
@@ -274,14 +289,110 @@ class ByteContainer {
   }
 
  private:
-  _vector::allocator_type::arena_type _a;
-  _vector bytes;
+  bool is_inline() const { return ptr == buf; }
+
+  // makes sure the capacity is at least n, keeping the current contents
+  void grow(size_t n) {
+    if (n <= cap) return;
+    const size_t new_cap = std::max<size_t>(n, 2 * cap);
+    char *new_ptr = new char[new_cap];
+    std::memcpy(new_ptr, ptr, sz);
+    if (!is_inline()) delete[] ptr;
+    ptr = new_ptr;
+    cap = static_cast<uint32_t>(new_cap);
+  }
+
+  void release() {
+    if (!is_inline()) delete[] ptr;
+    ptr = buf;
+    cap = S;
+  }
+
+  // other is left empty; assumes this container does not own a heap buffer
+  void steal(ByteContainer *other) {
+    if (other->is_inline()) {
+      std::memcpy(buf, other->buf, other->sz);
+    } else {
+      ptr = other->ptr;
+      cap = other->cap;
+      other->ptr = other->buf;
+      other->cap = S;
+    }
+    sz = other->sz;
+    other->sz = 0;
+  }
+
+  char buf[S];
+  char *ptr{buf};
+  uint32_t sz{0};
+  uint32_t cap{S};
 };
 
+//! Hashes the contents of a ByteContainer 8 bytes at a time. Keys of less than
+//! 8 bytes and of up to 16 bytes (the vast majority of match keys) are hashed
+//! without a loop.
 struct ByteContainerKeyHash {
   std::size_t operator()(const ByteContainer& b) const {
-    // Murmur, boost::hash_range or Jenkins?
-    return boost::hash_range(b.begin(), b.end());
+    const char *p = b.data();
+    const size_t n = b.size();
+    uint64_t h = n * 0x9e3779b97f4a7c15ULL;
+    if (n < 8) {
+      h = mix(h, load_short(p, n));
+    } else if (n <= 16) {
+      // the 2 words overlap if n < 16
+      h = mix(h, load(p));
+      h = mix(h, load(p + n - 8));
+    } else {
+      size_t i = 0;
+      for (; i + 8 <= n; i += 8)
+        h = mix(h, load(p + i));
+      if (i < n) h = mix(h, load(p + n - 8));
+    }
+    return static_cast<std::size_t>(finalize(h));
+  }
+
+ private:
+  static uint64_t load(const char *p) {
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    return w;
+  }
+
+  static uint64_t load_u32(const char *p) {
+    uint32_t w;
+    std::memcpy(&w, p, sizeof(w));
+    return w;
+  }
+
+  // for n < 8, combines the bytes into one word without a variable-length
+  // copy; the 2 loads overlap if n < 8 (the size is hashed separately)
+  static uint64_t load_short(const char *p, size_t n) {
+    if (n >= 4) return load_u32(p) | (load_u32(p + n - 4) << 32);
+    if (n == 0) return 0;
+    const auto byte = [p](size_t i) {
+      return static_cast<uint64_t>(static_cast<unsigned char>(p[i]));
+    };
+    return byte(0) | (byte(n / 2) << 8) | (byte(n - 1) << 16);
+  }
+
+  static uint64_t mix(uint64_t h, uint64_t w) {
+    w *= 0x87c37b91114253d5ULL;
+    w = (w << 31) | (w >> 33);
+    w *= 0x4cf5ad432745937fULL;
+    h ^= w;
+    h = (h << 27) | (h >> 37);
+    return h * 5 + 0x52dce729;
+  }
+
+  // MurmurHash3 finalizer, so that all the bits of the hash (in particular the
+  // low ones used to select a bucket) depend on all the bits of the key
+  static uint64_t finalize(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
   }
 };
 
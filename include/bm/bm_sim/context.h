@@ -126,6 +126,12 @@ class Context final {
     return p4objects->get_field_list(field_list_id);
   }
 
+  //! Get a raw, non-owning pointer to the NamedCalculation object with P4 name
+  //! \p name, or nullptr if the P4 program does not include it
+  NamedCalculation *get_named_calculation(const std::string &name) {
+    return p4objects->get_named_calculation_rt(name);
+  }
+
   // Added for testing, other "object types" can be added if needed
   p4object_id_t get_table_id(const std::string &name) {
     return p4objects->get_match_action_table(name)->get_id();
@@ -248,11 +254,28 @@ class Context final {
   std::vector<typename T::Entry>
   mt_get_entries(const std::string &table_name) const;
 
+  template <typename T>
+  MatchErrorCode
+  mt_get_entries_page(const std::string &table_name, size_t cursor,
+                      size_t max_entries,
+                      std::vector<typename T::Entry> *entries,
+                      size_t *next_cursor) const;
+
   template <typename T>
   MatchErrorCode
   mt_get_entry(const std::string &table_name, entry_handle_t handle,
                typename T::Entry *entry) const;
 
+  MatchErrorCode
+  mt_get_change_seq(const std::string &table_name,
+                    MatchTableAbstract::seq_t *seq) const;
+
+  template <typename T>
+  MatchErrorCode
+  mt_get_entries_since(const std::string &table_name,
+                       MatchTableAbstract::seq_t since,
+                       typename T::Changes *changes) const;
+
   template <typename T>
   MatchErrorCode
   mt_get_default_entry(const std::string &table_name,
@@ -261,6 +284,12 @@ class Context final {
   std::vector<MatchTableIndirect::Member>
   mt_indirect_get_members(const std::string &table_name) const;
 
+  MatchErrorCode
+  mt_indirect_get_members_page(const std::string &table_name, size_t cursor,
+                               size_t max_members,
+                               std::vector<MatchTableIndirect::Member> *members,
+                               size_t *next_cursor) const;
+
   MatchErrorCode
   mt_indirect_get_member(const std::string &table_name, grp_hdl_t grp,
                          MatchTableIndirect::Member *member) const;
@@ -268,6 +297,12 @@ class Context final {
   std::vector<MatchTableIndirectWS::Group>
   mt_indirect_ws_get_groups(const std::string &table_name) const;
 
+  MatchErrorCode
+  mt_indirect_ws_get_groups_page(
+      const std::string &table_name, size_t cursor, size_t max_groups,
+      std::vector<MatchTableIndirectWS::Group> *groups,
+      size_t *next_cursor) const;
+
   MatchErrorCode
   mt_indirect_ws_get_group(const std::string &table_name, grp_hdl_t grp,
                            MatchTableIndirectWS::Group *group) const;
@@ -0,0 +1,86 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file context_workers.h
+
+#ifndef BM_BM_SIM_CONTEXT_WORKERS_H_
+#define BM_BM_SIM_CONTEXT_WORKERS_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "packet.h"
+#include "thread_pool.h"
+
+namespace bm {
+
+//! The input queue and the worker threads of one Context of a
+//! SwitchWContexts. Packets pushed to the queue are processed by calling the
+//! handler provided by the target on one of the worker threads. Each context
+//! has its own workers, so the contexts of a switch (e.g. the stages of a
+//! multi-stage pipeline, or one pipeline per tenant) can run in parallel on
+//! different cores. With more than one worker thread, the packets of a given
+//! context are also processed in parallel, and their order is not preserved.
+//! Targets usually do not use this class directly, see
+//! SwitchWContexts::start_context_workers() and
+//! SwitchWContexts::hand_off_to_context().
+class ContextWorkers {
+ public:
+  using Handler = std::function<void(std::unique_ptr<Packet> packet)>;
+
+  //! Starts \p nb_threads worker threads (at least one), named
+  //! `cxt<cxt_id>-<index>`. At most \p capacity packets can be queued.
+  ContextWorkers(size_t cxt_id, size_t nb_threads, size_t capacity,
+                 Handler handler);
+
+  //! Calls stop()
+  ~ContextWorkers();
+
+  //! Queues \p packet for processing. Never blocks: returns `1` if the queue
+  //! is full or if the workers were stopped (and the packet is dropped), `0`
+  //! otherwise.
+  int push(std::unique_ptr<Packet> &&packet);
+
+  //! Stops accepting packets, discards the packets which are still queued and
+  //! joins the worker threads, after the calls to the handler which are in
+  //! progress complete. The handler is never called once this returns. Must
+  //! not be called from a worker thread. Calling it more than once is a no-op.
+  void stop();
+
+  //! Number of packets waiting to be processed
+  size_t size() const;
+
+  ContextWorkers(const ContextWorkers &other) = delete;
+  ContextWorkers &operator=(const ContextWorkers &other) = delete;
+
+ private:
+  // every push posts exactly one task, which pops exactly one packet
+  void process_one();
+
+  Handler handler;
+  size_t capacity;
+  mutable std::mutex mutex{};
+  std::deque<std::unique_ptr<Packet> > queue{};
+  bool stopped{false};
+  // reset by stop(), so that no task can run once the queue is gone
+  std::unique_ptr<ThreadPool> pool;
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_CONTEXT_WORKERS_H_
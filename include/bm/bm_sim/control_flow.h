@@ -34,6 +34,15 @@ class ControlFlowNode : public NamedP4Object {
       : NamedP4Object(name, id) { }
   virtual ~ControlFlowNode() { }
   virtual const ControlFlowNode *operator()(Packet *pkt) const = 0;
+
+  // Applies the node to each of the n packets and stores the next node for
+  // pkts[i] in next[i]. Nodes which can amortize some work over several
+  // packets (e.g. match-action tables) override this; the default simply
+  // processes the packets one at a time.
+  virtual void apply_batch(Packet *const *pkts, size_t n,
+                           const ControlFlowNode **next) const {
+    for (size_t i = 0; i < n; i++) next[i] = (*this)(pkts[i]);
+  }
 };
 
 }  // namespace bm
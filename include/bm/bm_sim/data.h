@@ -52,8 +52,9 @@ using bignum::Bignum;
 //! @endcode
 //!
 //! Note that Data includes a Bignum (for arbitrary arithmetic). Therefore,
-//! operations involving Data can be rather costly. In particular, constructing
-//! a Data instance involves a heap memory allocation.
+//! operations involving Data can be rather costly. Values of up to 128 bits are
+//! stored inline, but operations on larger values involve heap memory
+//! allocations.
 class Data {
  public:
   Data() {}
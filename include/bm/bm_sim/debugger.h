@@ -21,11 +21,10 @@
 #ifndef BM_BM_SIM_DEBUGGER_H_
 #define BM_BM_SIM_DEBUGGER_H_
 
+#include <atomic>
 #include <limits>
 #include <string>
 
-// #define BMDEBUG_ON
-
 namespace bm {
 
 /* This whole code if for a proof of concept and is temporary */
@@ -76,6 +75,13 @@ class Debugger {
     return debugger;
   }
 
+  //! Returns true iff a debugger client is currently attached. All the
+  //! debugger hooks are guarded by this check, so that they cost a single
+  //! branch when no client is attached.
+  static bool is_attached() {
+    return attached.load(std::memory_order_relaxed);
+  }
+
   // returns an empty string if debugger wasn't initialized
   static std::string get_addr();
 
@@ -84,7 +90,10 @@ class Debugger {
   static constexpr PacketId dummy_PacketId{0u, 0u};
 
  private:
+  friend class DebuggerNN;
+
   static bool is_init;
+  static std::atomic<bool> attached;
 };
 
 class DebuggerIface {
@@ -142,24 +151,33 @@ class DebuggerIface {
   virtual std::string get_addr_() const = 0;
 };
 
-#ifdef BMDEBUG_ON
-#define DEBUGGER_NOTIFY_UPDATE(packet_id, id, bytes, nbits) \
-  Debugger::get()->notify_update(packet_id, id, bytes, nbits);
-#define DEBUGGER_NOTIFY_UPDATE_V(packet_id, id, v) \
-  Debugger::get()->notify_update(packet_id, id, v);
-#define DEBUGGER_NOTIFY_CTR(packet_id, ctr) \
-  Debugger::get()->notify_ctr(packet_id, ctr);
-#define DEBUGGER_PACKET_IN(packet_id, port) \
-  Debugger::get()->packet_in(packet_id, port);
-#define DEBUGGER_PACKET_OUT(packet_id, port) \
-  Debugger::get()->packet_out(packet_id, port);
-#else
-#define DEBUGGER_NOTIFY_UPDATE(packet_id, id, bytes, nbits)
-#define DEBUGGER_NOTIFY_UPDATE_V(packet_id, id, v)
-#define DEBUGGER_NOTIFY_CTR(packet_id, ctr)
-#define DEBUGGER_PACKET_IN(packet_id, port)
-#define DEBUGGER_PACKET_OUT(packet_id, port)
-#endif
+// The hooks are compiled in every build, but they only call into the debugger
+// when a client is attached (see Debugger::is_attached()).
+#define DEBUGGER_NOTIFY_UPDATE(packet_id, id, bytes, nbits)             \
+  do {                                                                  \
+    if (Debugger::is_attached())                                        \
+      Debugger::get()->notify_update(packet_id, id, bytes, nbits);      \
+  } while (0)
+#define DEBUGGER_NOTIFY_UPDATE_V(packet_id, id, v)                      \
+  do {                                                                  \
+    if (Debugger::is_attached())                                        \
+      Debugger::get()->notify_update(packet_id, id, v);                 \
+  } while (0)
+#define DEBUGGER_NOTIFY_CTR(packet_id, ctr)                             \
+  do {                                                                  \
+    if (Debugger::is_attached())                                        \
+      Debugger::get()->notify_ctr(packet_id, ctr);                      \
+  } while (0)
+#define DEBUGGER_PACKET_IN(packet_id, port)                             \
+  do {                                                                  \
+    if (Debugger::is_attached())                                        \
+      Debugger::get()->packet_in(packet_id, port);                      \
+  } while (0)
+#define DEBUGGER_PACKET_OUT(packet_id, port)                            \
+  do {                                                                  \
+    if (Debugger::is_attached())                                        \
+      Debugger::get()->packet_out(packet_id, port);                     \
+  } while (0)
 
 }  // namespace bm
 
@@ -23,8 +23,13 @@
 #ifndef BM_BM_SIM_EVENT_LOGGER_H_
 #define BM_BM_SIM_EVENT_LOGGER_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "packet.h"
 #include "phv.h"
@@ -63,11 +68,27 @@ typedef uint32_t entry_handle_t;
 //! responsible of generated "packet in" and "packet out" messages (when a
 //! packet is received / transmitted). Obviously, this is optional and you do
 //! not have to do it if you are not interested in using the event logger.
+//!
+//! By default, messages are sent synchronously by the thread which generated
+//! the event. Once start_async_writer() has been called, each event is instead
+//! copied as a fixed-size record into a lock-free ring (one per data path
+//! thread) and a dedicated writer thread drains the rings and sends the
+//! messages, ordered by the time at which the events were generated (the data
+//! path threads do not share any counter). When a ring is full, the event is
+//! dropped and accounted for (see get_dropped_events()) instead of slowing down
+//! the data path. Finally, set_sampling_rate() can be used to only log events
+//! for 1 packet out of N, which makes it possible to keep event logging on at
+//! high packet rates.
 class EventLogger {
  public:
+  //! Number of event records which can be buffered by each ring when the
+  //! asynchronous writer is used
+  static constexpr size_t ring_size = 4096u;
+
   explicit EventLogger(std::unique_ptr<TransportIface> transport,
-                       int device_id = 0)
-      : transport_instance(std::move(transport)), device_id(device_id) { }
+                       int device_id = 0);
+
+  ~EventLogger();
 
   // we need the ingress / egress ports, but they are part of the Packet
   //! Signal that a packet was received by the switch
@@ -99,20 +120,81 @@ class EventLogger {
 
   void config_change();
 
+  //! Start the dedicated writer thread; from now on, messages are no longer
+  //! sent by the thread which generated the event. Does nothing if the writer
+  //! thread is already running.
+  void start_async_writer();
+  //! Send all pending messages and stop the writer thread; messages are sent
+  //! synchronously again after this call.
+  void stop_async_writer();
+
+  //! Only log the events for packets whose packet id is a multiple of \p
+  //! one_in_n. Configuration changes are always logged. A value of 0 or 1
+  //! means that the events for all packets are logged.
+  void set_sampling_rate(unsigned int one_in_n);
+
+  //! Return the number of events which were dropped by the asynchronous writer
+  //! because the rings were full
+  uint64_t get_dropped_events() const;
+
   static EventLogger *get() {
     static EventLogger event_logger(TransportIface::make_dummy());
     return &event_logger;
   }
 
+  //! Replace the transport used to publish messages. If the asynchronous
+  //! writer was running, it is stopped (after sending pending messages) and
+  //! needs to be restarted with start_async_writer().
   static void init(std::unique_ptr<TransportIface> transport,
                    int device_id = 0) {
+    get()->stop_async_writer();
     get()->transport_instance = std::move(transport);
     get()->device_id = device_id;
   }
 
+  // largest message generated by the event logger
+  static constexpr size_t max_record_size = 48u;
+
  private:
+  class RecordRing;
+
+  bool is_sampled(const Packet &packet) const {
+    const auto rate = sampling_rate.load(std::memory_order_relaxed);
+    return rate <= 1 || packet.get_packet_id() % rate == 0;
+  }
+
+  template <typename M>
+  void emit(const M &msg);
+
+  void emit_(const char *msg, size_t len);
+
+  void write_loop();
+  bool flush_rings(bool flush_all);
+
   std::unique_ptr<TransportIface> transport_instance{nullptr};
   int device_id{};
+
+  std::atomic<unsigned int> sampling_rate{1};
+
+  std::vector<std::unique_ptr<RecordRing> > rings;
+  std::atomic<bool> async{false};
+  std::atomic<uint64_t> dropped_events{0};
+  uint64_t dropped_events_reported{0};
+  // records retrieved from the rings which cannot be sent yet, because an
+  // older event may not have been published in its ring yet; only accessed by
+  // the writer thread
+  struct PendingRecord {
+    // used to merge the records from the different rings
+    uint64_t timestamp;
+    size_t len;
+    char data[max_record_size];  // NOLINT(runtime/arrays)
+  };
+  std::vector<PendingRecord> pending{};
+
+  std::thread writer_thread{};
+  bool stop_writer_thread{false};
+  mutable std::mutex writer_mutex{};
+  std::condition_variable writer_cv{};
 };
 
 }  // namespace bm
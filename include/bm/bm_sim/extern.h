@@ -23,6 +23,7 @@
 #ifndef BM_BM_SIM_EXTERN_H_
 #define BM_BM_SIM_EXTERN_H_
 
+#include <cassert>
 #include <unordered_map>
 #include <string>
 #include <memory>
@@ -60,20 +61,36 @@ class ExternFactoryMap {
            #extern_name,                                                \
            [](){ return std::unique_ptr<ExternType>(new extern_name()); });
 
+// The method is called directly on the extern instance, with no per-call
+// synchronization, unless the extern type opted in with BM_EXTERN_NEEDS_LOCK;
+// the check is done at compile time.
 #define BM_REGISTER_EXTERN_METHOD(extern_name, extern_method_name, ...) \
   template <typename... Args>                                           \
   struct _##extern_name##_##extern_method_name##_0                      \
       : public ActionPrimitive<ExternType *, Args...> {                 \
     void operator ()(ExternType *instance, Args... args) override {     \
-      auto lock = instance->_unique_lock();                             \
-      instance->_set_packet_ptr(&this->get_packet());                   \
-      dynamic_cast<extern_name *>(instance)->extern_method_name(args...); \
+      assert(dynamic_cast<extern_name *>(instance) != nullptr);         \
+      auto obj = static_cast<extern_name *>(instance);                  \
+      ExternType::_set_packet_ptr(&this->get_packet());                 \
+      if (extern_name::_needs_lock) {                                   \
+        auto lock = instance->_unique_lock();                           \
+        obj->extern_method_name(args...);                               \
+      } else {                                                          \
+        obj->extern_method_name(args...);                               \
+      }                                                                 \
     }                                                                   \
   };                                                                    \
   struct _##extern_name##_##extern_method_name                          \
       : public _##extern_name##_##extern_method_name##_0<__VA_ARGS__> {}; \
   REGISTER_PRIMITIVE(_##extern_name##_##extern_method_name)
 
+// To be used in the definition of an extern type whose methods must not run
+// concurrently (e.g. because they update several members which have to remain
+// consistent); by default, the methods of an extern instance can be called
+// concurrently by different packet processing threads, and the extern type is
+// in charge of its own synchronization (e.g. with atomics).
+#define BM_EXTERN_NEEDS_LOCK static constexpr bool _needs_lock = true
+
 #define BM_EXTERN_ATTRIBUTES void _register_attributes() override
 
 #define BM_EXTERN_ATTRIBUTE_ADD(attr_name)                      \
@@ -96,7 +113,8 @@ class ExternType {
     return attributes.find(attr_name) != attributes.end();
   }
 
-  void _set_packet_ptr(Packet *pkt_ptr) { pkt = pkt_ptr; }
+  // the packet is per thread, so that methods can run concurrently
+  static void _set_packet_ptr(Packet *pkt_ptr) { pkt = pkt_ptr; }
 
   // called in P4Objects after constructing the instance
   void _set_name_and_id(const std::string &name, p4object_id_t id);
@@ -104,6 +122,12 @@ class ExternType {
   const std::string &get_name() const { return name; }
   p4object_id_t get_id() const { return id; }
 
+  // overridden with BM_EXTERN_NEEDS_LOCK
+  static constexpr bool _needs_lock = false;
+
+  // held during method calls if the extern type opted in with
+  // BM_EXTERN_NEEDS_LOCK; can also be used to synchronize with the control
+  // plane
   using UniqueLock = std::unique_lock<std::mutex>;
   UniqueLock _unique_lock() { return UniqueLock(mutex); }
 
@@ -122,7 +146,7 @@ class ExternType {
   // will use static_cast to cast from T * to void * and vice-versa
   std::unordered_map<std::string, void *> attributes;
   mutable std::mutex mutex{};
-  Packet *pkt{nullptr};
+  static thread_local Packet *pkt;
   // set by _set_name_and_id
   std::string name{};
   p4object_id_t id{};
@@ -23,6 +23,7 @@
 
 #include <algorithm>  // for swap
 #include <type_traits>
+#include <vector>
 
 #include <Judy.h>
 
@@ -214,6 +215,23 @@ class HandleMgr {
     return (Rc == 1);
   }
 
+  // Appends to page at most max_handles (at least 1) of the allocated handles,
+  // in increasing order, starting with the first one greater than or equal to
+  // cursor. Returns the cursor for the next call, or 0 once all the handles
+  // have been returned; start with cursor 0.
+  handle_t get_page(handle_t cursor, size_t max_handles,
+                    std::vector<handle_t> *page) const {
+    max_handles = std::max<size_t>(max_handles, 1);
+    Word_t jindex = cursor;
+    int Rc_int;
+    J1F(Rc_int, handles, jindex);  // Judy1First()
+    for (; Rc_int && max_handles > 0; max_handles--) {
+      page->push_back(jindex);
+      J1N(Rc_int, handles, jindex);  // Judy1Next()
+    }
+    return Rc_int ? jindex : 0;
+  }
+
   void clear() {
     Word_t Rc_word;
     // only clang complains, not gcc
@@ -33,6 +33,7 @@
 #include <condition_variable>
 #include <memory>
 #include <functional>
+#include <atomic>
 
 #include "packet.h"
 #include "phv.h"
@@ -46,6 +47,15 @@ namespace bm {
 //! Enables learning in the switch. For now it is the responsibility of the
 //! switch (look at the simple switch target for an example) to invoke the
 //! learn() method, which will send out the learning notifications.
+//!
+//! The learn() method never blocks: samples are filtered with a lock-free
+//! fingerprint table and pushed to bounded lock-free staging rings (one per
+//! data path thread). A single aggregator thread per learn list drains the
+//! rings, performs exact de-duplication and batches the samples into
+//! notifications, according to the list's max samples and timeout. If the
+//! aggregator cannot keep up (e.g. during a learning storm), samples are
+//! dropped rather than slowing down packet processing; since these samples
+//! were not recorded, they will be learned again by subsequent packets.
 class LearnEngine {
  public:
   typedef int list_id_t;
@@ -147,6 +157,10 @@ class LearnEngine {
     std::vector<LearnFilter::iterator> buffer{};
   };
 
+  // defined in learning.cpp
+  class SampleRing;
+  class FingerprintFilter;
+
   class LearnList {
    public:
     enum class LearnMode {NONE, WRITER, CB};
@@ -185,11 +199,24 @@ class LearnEngine {
     using MutexType = std::mutex;
     using LockType = std::unique_lock<MutexType>;
 
+    // number of staging rings, data path threads are mapped to a ring based on
+    // a per-thread index, so rings are only shared if there are more threads
+    static constexpr size_t nb_rings = 8u;
+    // capacity of each staging ring, in samples
+    static constexpr size_t ring_size = 1024u;
+
    private:
-    void swap_buffers();
-    void process_full_buffer(LockType &lock);  // NOLINT(runtime/references)
-    void buffer_transmit_loop();
-    void buffer_transmit();
+    void drain_rings(LockType &lock);  // NOLINT(runtime/references)
+    void add_sample_to_buffer(const ByteContainer &sample, uint64_t fp);
+    void buffer_transmit(LockType &lock);  // NOLINT(runtime/references)
+    void aggregate_loop();
+    void wait_for_samples(bool with_deadline, clock::time_point deadline);
+    bool rings_empty() const;
+    // used by the data path, only takes a lock if the aggregator is sleeping
+    void wake_aggregator();
+    // used by the control plane when the list configuration changes
+    void notify_aggregator();
+    void erase_sample(LearnFilter::iterator it);
 
    private:
     mutable MutexType mutex{};
@@ -213,12 +240,21 @@ class LearnEngine {
     LearnFilter filter{};
     std::unordered_map<buffer_id_t, FilterPtrs> old_buffers{};
 
-    std::vector<char> buffer_tmp{};
-    size_t num_samples_tmp{0};
-    mutable std::condition_variable b_can_swap{};
-    mutable std::condition_variable b_can_send{};
-    std::thread transmit_thread{};
-    bool stop_transmit_thread{false};
+    // lock-free part, used by the data path
+    std::unique_ptr<FingerprintFilter> fp_filter;
+    std::vector<std::unique_ptr<SampleRing> > rings{};
+    std::atomic<uint64_t> dropped_samples{0};
+    uint64_t dropped_samples_reported{0};
+
+    // used to put the aggregator thread to sleep when there is no sample to
+    // process
+    std::atomic<bool> aggregator_waiting{false};
+    MutexType wait_mutex{};
+    std::condition_variable wait_cv{};
+    bool wake_up{false};
+
+    std::thread aggregator_thread{};
+    bool stop_aggregator_thread{false};
 
     LearnMode learn_mode{LearnMode::NONE};
 
@@ -80,6 +80,17 @@ class Logger {
     return logger;
   }
 
+  //! Get the logger used for the messages regarding packets selected for
+  //! tracing (see PacketTracer). This logger shares its destination (stdout or
+  //! file) with the main logger, but messages are written to the destination
+  //! by a background thread. Messages are discarded if that thread cannot keep
+  //! up. The level of the main logger does not apply to this logger.
+  static spdlog::logger *get_packet_trace() {
+    static spdlog::logger *logger_ = init_logger();
+    (void) logger_;
+    return packet_trace_logger;
+  }
+
   //! Set the log level. Messages with a lesser level will not be logged.
   static void set_log_level(LogLevel level);
 
@@ -98,10 +109,13 @@ class Logger {
 
   static void set_pattern();
 
+  static void set_sink(spdlog::sink_ptr sink);
+
   static void unset_logger();
 
  private:
   static spdlog::logger *logger;
+  static spdlog::logger *packet_trace_logger;
 };
 
 }  // namespace bm
@@ -122,18 +136,42 @@ class Logger {
 #define BMLOG_TRACE(...)
 #endif
 
+// Used for per-packet messages when they are not compiled in for all packets:
+// only the packets selected by the PacketTracer are logged.
+#define BMLOG_PKT_IF_TRACED(level, pkt, s, ...)                         \
+  do {                                                                  \
+    if ((pkt).is_traced()) {                                            \
+      bm::Logger::get_packet_trace()->level(                            \
+          "[{}] [cxt {}] " s, (pkt).get_unique_id(), (pkt).get_context(), \
+          ##__VA_ARGS__);                                               \
+    }                                                                   \
+  } while (0)
+
+#ifdef BMLOG_DEBUG_ON
 //! Same as for BMLOG_DEBUG but for messages regarding a specific packet. Will
 //! automatically print the packet id and packet context, along with your
-//! message.
+//! message. If BMLOG_DEBUG_ON is not defined, the message is only logged for
+//! the packets selected for tracing (see PacketTracer).
 #define BMLOG_DEBUG_PKT(pkt, s, ...)                     \
   BMLOG_DEBUG("[{}] [cxt {}] " s, (pkt).get_unique_id(), \
               (pkt).get_context(), ##__VA_ARGS__)
+#else
+#define BMLOG_DEBUG_PKT(pkt, s, ...)                            \
+  BMLOG_PKT_IF_TRACED(debug, pkt, s, ##__VA_ARGS__)
+#endif
+
+#ifdef BMLOG_TRACE_ON
 //! Same as for BMLOG_TRACE but for messages regarding a specific packet. Will
 //! automatically print the packet id and packet context, along with your
-//! message.
+//! message. If BMLOG_TRACE_ON is not defined, the message is only logged for
+//! the packets selected for tracing (see PacketTracer).
 #define BMLOG_TRACE_PKT(pkt, s, ...)                     \
   BMLOG_TRACE("[{}] [cxt {}] " s, (pkt).get_unique_id(), \
               (pkt).get_context(), ##__VA_ARGS__)
+#else
+#define BMLOG_TRACE_PKT(pkt, s, ...)                            \
+  BMLOG_PKT_IF_TRACED(trace, pkt, s, ##__VA_ARGS__)
+#endif
 
 #define BMLOG_ERROR(...) bm::Logger::get()->error(__VA_ARGS__)
 
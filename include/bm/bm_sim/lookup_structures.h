@@ -105,6 +105,8 @@
 #ifndef BM_BM_SIM_LOOKUP_STRUCTURES_H_
 #define BM_BM_SIM_LOOKUP_STRUCTURES_H_
 
+#include <memory>
+
 #include "match_key_types.h"
 #include "bytecontainer.h"
 
@@ -156,10 +158,40 @@ typedef LookupStructure<RangeMatchKey>   RangeLookupStructure;
 //! of LookupStructureFactory should be created, overriding the
 //! `create_for_<match type>` function or functions corresponding to the new
 //! data structure.
+//!
+//! For exact and ternary matches, the default implementation uses a
+//! direct-indexed array with one slot per possible key value (i.e. 2^bits
+//! slots) when the key is at most get_direct_max_bits() bits wide and the
+//! table is large enough for the array to pay off (see direct_min_fill), so
+//! that lookups for these tables are a single array load. For ternary tables,
+//! the result of the lookup is precomputed for every key value when entries
+//! are added or deleted.
 class LookupStructureFactory {
  public:
+  //! Keys of at most 16 bits use the direct-indexed structures by default,
+  //! which means at most 256KB of memory per table.
+  static constexpr size_t default_direct_max_bits = 16u;
+  //! Upper bound for set_direct_max_bits(), which limits the memory used by
+  //! a single table to 64MB.
+  static constexpr size_t max_direct_max_bits = 24u;
+  //! The direct-indexed structures are only used if the table can fill at
+  //! least 1 / direct_min_fill of the 2^bits slots (i.e. if size *
+  //! direct_min_fill >= 2^bits), so that e.g. a table of size 1 with a 16-bit
+  //! key does not allocate 2^16 slots.
+  static constexpr size_t direct_min_fill = 64u;
+
   virtual ~LookupStructureFactory() = default;
 
+  //! Sets the maximum key width (in bits) for which the direct-indexed lookup
+  //! structures are used for exact and ternary matches. Since keys are stored
+  //! as bytes, the width of a key is rounded up to a multiple of 8. Setting
+  //! this to 0 effectively disables the direct-indexed structures (except for
+  //! tables without a key). Only affects the lookup structures created after
+  //! the call.
+  void set_direct_max_bits(size_t max_bits);
+
+  size_t get_direct_max_bits() const { return direct_max_bits; }
+
   //! This is a utility to call the correct `create_for_<type>` function based
   //! on the bm::MatchKey subtype passed as the template parameter K. This is
   //! used by bm::MatchUnitGeneric when creating its lookup structure.
@@ -182,6 +214,15 @@ class LookupStructureFactory {
   //! Create a lookup structure for range macthes
   virtual std::unique_ptr<RangeLookupStructure>
   create_for_range(size_t size, size_t nbytes_key);
+
+ protected:
+  //! Returns true if the default implementation of `create_for_exact` and
+  //! `create_for_ternary` would use a direct-indexed structure for a table of
+  //! \p size entries with a key of \p nbytes_key bytes.
+  bool use_direct_lookup(size_t size, size_t nbytes_key) const;
+
+ private:
+  size_t direct_max_bits{default_direct_max_bits};
 };
 
 
@@ -47,6 +47,7 @@ enum class MatchErrorCode {
   DEFAULT_ACTION_IS_CONST,
   DEFAULT_ENTRY_IS_CONST,
   NO_DEFAULT_ENTRY,
+  CHANGES_UNAVAILABLE,
   ERROR,
 };
 
@@ -24,6 +24,7 @@
 #include <vector>
 #include <type_traits>
 #include <iostream>
+#include <memory>
 #include <string>
 
 #include "match_units.h"
@@ -32,6 +33,7 @@
 #include "calculations.h"
 #include "control_flow.h"
 #include "lookup_structures.h"
+#include "table_change_log.h"
 
 namespace bm {
 
@@ -48,6 +50,21 @@ class MatchTableAbstract : public NamedP4Object {
 
   typedef Counter::counter_value_t counter_value_t;
 
+  typedef TableChangeLog::seq_t seq_t;
+
+  // The changes made to a table since a given sequence number, as returned by
+  // get_entries_since(): the current version of the entries which were added
+  // or modified, and the handles of the entries which were deleted (an entry
+  // which was added and then deleted only appears in the latter). last_seq is
+  // the sequence number to provide in the next call.
+  template <typename E>
+  struct EntryChanges {
+    std::vector<E> entries{};
+    std::vector<entry_handle_t> deleted{};
+    bool default_entry_changed{false};
+    seq_t last_seq{0};
+  };
+
   struct ActionEntry {
     ActionEntry() { }
 
@@ -130,6 +147,13 @@ class MatchTableAbstract : public NamedP4Object {
 
   const ControlFlowNode *apply_action(Packet *pkt);
 
+  // same as calling apply_action() on each of the n packets, with the next
+  // node for pkts[i] stored in next[i]; the read lock is only acquired once
+  // for the whole batch and all the lookups of a chunk are done before any
+  // action is executed, so that their cache misses can overlap
+  void apply_action_batch(Packet *const *pkts, size_t n,
+                          const ControlFlowNode **next);
+
   virtual MatchTableType get_table_type() const = 0;
 
   virtual const ActionEntry &lookup(const Packet &pkt, bool *hit,
@@ -188,6 +212,16 @@ class MatchTableAbstract : public NamedP4Object {
   handle_iterator handles_begin() const;
   handle_iterator handles_end() const;
 
+  // Returns the sequence number of the last change made to the table entries
+  // by the control plane. To start mirroring a table, a client reads it
+  // before dumping the entries, then calls get_entries_since() with it.
+  seq_t get_change_seq() const;
+
+  // Publishes every change made to the table entries on transport (see
+  // TableChangeLog).
+  void set_change_notifications(std::shared_ptr<TransportIface> transport,
+                                int device_id, int cxt_id);
+
   MatchTableAbstract(const MatchTableAbstract &other) = delete;
   MatchTableAbstract &operator=(const MatchTableAbstract &other) = delete;
 
@@ -207,6 +241,18 @@ class MatchTableAbstract : public NamedP4Object {
   void unlock(ReadLock &lock) const { lock.unlock(); }  //NOLINT
   void unlock(WriteLock &lock) const { lock.unlock(); }  // NOLINT
 
+  // to be called with the write lock held, after a successful change
+  void log_change(TableChangeLog::ChangeType type, entry_handle_t handle = 0) {
+    change_log.log(type, handle);
+  }
+
+  // to be called with the read lock held; returns the handles of the entries
+  // which were changed since the given sequence number, without duplicates
+  MatchErrorCode get_changed_handles_(seq_t since,
+                                      std::vector<entry_handle_t> *handles,
+                                      bool *default_entry_changed,
+                                      seq_t *last_seq) const;
+
  protected:
   // Not sure these guys need to be atomic with the current code
   // TODO(antonin): check
@@ -241,9 +287,16 @@ class MatchTableAbstract : public NamedP4Object {
   // the internal version does not acquire the lock
   std::string dump_entry_string_(entry_handle_t handle) const;
 
+  // executes the action for an entry returned by lookup(), to be called with
+  // the read lock held
+  const ControlFlowNode *apply_entry_(Packet *pkt,
+                                      const ActionEntry &action_entry,
+                                      bool hit, entry_handle_t handle);
+
  private:
   mutable boost::shared_mutex t_mutex{};
   MatchUnitAbstract_ *match_unit_{nullptr};
+  TableChangeLog change_log{};
 };
 
 // MatchTable is exposed to the runtime for configuration
@@ -284,6 +337,22 @@ class MatchTable : public MatchTableAbstract {
 
   std::vector<Entry> get_entries() const;
 
+  // Paginated version of get_entries(), for large tables: appends at most
+  // max_entries entries to entries and returns the cursor to provide in the
+  // next call. Start with cursor 0; 0 is returned once all the entries have
+  // been retrieved. The table lock is only held for the duration of one call,
+  // so an entry added or deleted during the dump may or may not be included.
+  size_t get_entries_page(size_t cursor, size_t max_entries,
+                          std::vector<Entry> *entries) const;
+
+  typedef EntryChanges<Entry> Changes;
+
+  // Retrieves the changes made to the table after the change with sequence
+  // number since (see get_change_seq()). Returns
+  // MatchErrorCode::CHANGES_UNAVAILABLE if they are no longer all recorded,
+  // in which case the client needs to dump the table with get_entries().
+  MatchErrorCode get_entries_since(seq_t since, Changes *changes) const;
+
   MatchErrorCode get_default_entry(Entry *entry) const;
 
   MatchTableType get_table_type() const override {
@@ -477,12 +546,26 @@ class MatchTableIndirect : public MatchTableAbstract {
 
   std::vector<Entry> get_entries() const;
 
+  // see MatchTable::get_entries_page()
+  size_t get_entries_page(size_t cursor, size_t max_entries,
+                          std::vector<Entry> *entries) const;
+
+  typedef EntryChanges<Entry> Changes;
+
+  // See MatchTable::get_entries_since(). Changes made to the members are not
+  // tracked, use get_members() for these.
+  MatchErrorCode get_entries_since(seq_t since, Changes *changes) const;
+
   MatchErrorCode get_default_entry(Entry *entry) const;
 
   MatchErrorCode get_member(mbr_hdl_t mbr, Member *member) const;
 
   std::vector<Member> get_members() const;
 
+  // same as MatchTable::get_entries_page(), for members
+  size_t get_members_page(size_t cursor, size_t max_members,
+                          std::vector<Member> *members) const;
+
   MatchTableType get_table_type() const override {
     return MatchTableType::INDIRECT;
   }
@@ -601,12 +684,26 @@ class MatchTableIndirectWS : public MatchTableIndirect {
 
   std::vector<Entry> get_entries() const;
 
+  // see MatchTable::get_entries_page()
+  size_t get_entries_page(size_t cursor, size_t max_entries,
+                          std::vector<Entry> *entries) const;
+
+  typedef EntryChanges<Entry> Changes;
+
+  // See MatchTable::get_entries_since(). Changes made to the members and
+  // groups are not tracked, use get_members() and get_groups() for these.
+  MatchErrorCode get_entries_since(seq_t since, Changes *changes) const;
+
   MatchErrorCode get_default_entry(Entry *entry) const;
 
   MatchErrorCode get_group(grp_hdl_t grp, Group *group) const;
 
   std::vector<Group> get_groups() const;
 
+  // same as MatchTable::get_entries_page(), for groups
+  size_t get_groups_page(size_t cursor, size_t max_groups,
+                         std::vector<Group> *groups) const;
+
   MatchTableType get_table_type() const override {
     return MatchTableType::INDIRECT_WS;
   }
@@ -300,6 +300,10 @@ class MatchUnitAbstract_ {
   handle_iterator handles_begin() const;
   handle_iterator handles_end() const;
 
+  // for paginated dumps, see HandleMgr::get_page()
+  size_t get_handles_page(size_t cursor, size_t max_handles,
+                          std::vector<entry_handle_t> *page) const;
+
  protected:
   MatchErrorCode get_and_set_handle(internal_handle_t *handle);
   MatchErrorCode unset_handle(internal_handle_t handle);
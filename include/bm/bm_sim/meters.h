@@ -39,6 +39,8 @@
 #include <mutex>
 #include <memory>
 #include <string>
+#include <atomic>
+#include <chrono>
 
 #include "named_p4object.h"
 #include "packet.h"
@@ -64,6 +66,14 @@ namespace bm {
 //!
 //! Note that a Meter operates on either bytes or packets (not both, unlike a
 //! Counter).
+//!
+//! Meter::execute() is lock-free: the state of each rate (token count and
+//! timestamp of the last refill) is packed into a single 64-bit word which is
+//! updated with a CAS loop, so that many pipeline threads can police traffic
+//! through the same meter without serializing. Configuration operations
+//! (set_rates(), reset_rates(), ...) still use a mutex. By default, execute()
+//! reads the steady clock for every packet; see set_clock_precision() to use
+//! a coarse shared clock instead.
 class Meter {
  public:
   typedef unsigned int color_t;
@@ -98,6 +108,11 @@ class Meter {
   Meter(MeterType type, size_t rate_count)
     : type(type), rates(rate_count) { }
 
+  // std::atomic members are not movable, but MeterArray needs to store Meter
+  // instances in a vector
+  Meter(Meter &&other) noexcept;
+  Meter &operator=(Meter &&other) noexcept;
+
   // the rate configs must be sorted from smaller rate to higher rate
   // in the 2 rate meter case: {CIR, PIR}
 
@@ -119,13 +134,18 @@ class Meter {
     assert(n >= 0);
     auto lock = unique_lock();
     if (static_cast<size_t>(n) != rates.size()) return BAD_RATES_LIST;
-    size_t idx = 0;
+    const rate_config_t *prev = nullptr;
     for (auto it = first; it < last; ++it) {
-      MeterErrorCode rc = set_rate(idx++, *it);
+      MeterErrorCode rc = check_rate(prev, *it);
       if (rc != SUCCESS) return rc;
+      prev = &(*it);
     }
-    std::reverse(rates.begin(), rates.end());
-    configured = true;
+    // we stop executing the meter while the rates are being updated, since
+    // the rates cannot be updated atomically as a whole
+    configured.store(false, std::memory_order_release);
+    size_t idx = 0;
+    for (auto it = first; it < last; ++it) set_rate(idx++, *it);
+    configured.store(true, std::memory_order_release);
     return SUCCESS;
   }
 
@@ -151,6 +171,14 @@ class Meter {
   void serialize(std::ostream *out) const;
   void deserialize(std::istream *in);
 
+  //! By default, each call to execute() reads the steady clock. When \p
+  //! precision is non-zero, a background thread instead refreshes a shared
+  //! timestamp every \p precision microseconds and all meters read that
+  //! timestamp, which saves a `clock::now()` call per packet at the cost of
+  //! metering accuracy. Calling this method with a zero \p precision stops
+  //! the background thread and restores per-packet clock reads.
+  static void set_clock_precision(std::chrono::microseconds precision);
+
  public:
   /* This is for testing purposes only, for more accurate tests */
   static void reset_global_clock();
@@ -161,17 +189,32 @@ class Meter {
   void unlock(UniqueLock &lock) const { lock.unlock(); }  // NOLINT
 
  private:
+  // The state of a rate is a single 64-bit word: the time (in nanoseconds
+  // since the clock init) at which the bucket will be full again. It encodes
+  // both the token count and the time of the last update (tokens at time t are
+  // burst_size - (full_at - t) * info_rate), which lets us refill and consume
+  // tokens with a single CAS. This is also known as the Generic Cell Rate
+  // Algorithm. The parameters used by execute() are stored in atomic variables,
+  // because they can be updated by the control plane at any time.
   struct MeterRate {
-    bool valid{};  // TODO(antonin): get rid of this?
+    MeterRate() = default;
+    MeterRate(const MeterRate &other);
+    MeterRate &operator=(const MeterRate &other);
+
+    bool consume(uint64_t now, size_t input);
+
     double info_rate{};  // in bytes / packets per microsecond
     size_t burst_size{};
-    size_t tokens{};
-    uint64_t tokens_last{};
+    std::atomic<double> ns_per_token{0.};
+    std::atomic<uint64_t> burst_ns{0u};
+    std::atomic<uint64_t> full_at{0u};
     color_t color{};
   };
 
  private:
-  MeterErrorCode set_rate(size_t idx, const rate_config_t &config);
+  static MeterErrorCode check_rate(const rate_config_t *prev,
+                                   const rate_config_t &config);
+  void set_rate(size_t idx, const rate_config_t &config);
 
  private:
   MeterType type;
@@ -180,8 +223,9 @@ class Meter {
   // MeterArray implementation. I don't think this will incur a performance hit
   std::unique_ptr<std::mutex> m_mutex{new std::mutex()};
   // mutable std::mutex m_mutex;
+  // rates are stored from the highest to the smallest rate
   std::vector<MeterRate> rates;
-  bool configured{false};
+  std::atomic<bool> configured{false};
 };
 
 typedef p4object_id_t meter_array_id_t;
@@ -63,6 +63,10 @@ class OptionsParser {
   InterfaceList ifaces{};
   bool pcap{false};
   int thrift_port{};
+  // see SwitchWContexts::RuntimeServerOptions
+  bool thrift_nonblocking{false};
+  bool thrift_compact{false};
+  int thrift_workers{4};
   int device_id{};
   // if true read/write packets from files instead of interfaces
   bool use_files{false};
@@ -82,6 +86,8 @@ class OptionsParser {
   bool debugger{false};
   std::string debugger_addr{};
   std::string state_file_path{};
+  // 0 means that meters read the clock for every packet
+  int meter_clock_precision_us{0};
 };
 
 }  // namespace bm
@@ -235,6 +235,13 @@ class Packet final {
   //! called on the packet).
   bool is_marked_for_exit() const { return flags & (1 << FLAGS_EXIT); }
 
+  //! Returns true iff the packet was selected for tracing (see PacketTracer).
+  //! Clones of a traced packet are traced as well.
+  bool is_traced() const { return traced; }
+  //! Select or deselect the packet for tracing, regardless of the
+  //! PacketTracer configuration.
+  void set_traced(bool traced) { this->traced = traced; }
+
   //! Changes the context of the packet. You will only need to call this
   //! function if you target switch leverages the Context class and if your
   //! Packet instance changes contexts during its lifetime. This is needed
@@ -270,6 +277,11 @@ class Packet final {
   Packet clone_with_phv_reset_metadata() const;
   //! @copydoc clone_with_phv_reset_metadata
   std::unique_ptr<Packet> clone_with_phv_reset_metadata_ptr() const;
+  //! Same as clone_with_phv_reset_metadata_ptr(), but only the first \p
+  //! max_data_size bytes of packet data are copied to the clone. The clone is
+  //! not truncated with truncate() though, which is up to the caller.
+  std::unique_ptr<Packet> clone_with_phv_reset_metadata_ptr(
+      size_t max_data_size) const;
 
   //! Clone the current packet, without the PHV. The value of the fields in the
   //! clone will be undefined and should not be accessed before setting it
@@ -277,6 +289,10 @@ class Packet final {
   Packet clone_no_phv() const;
   //! @copydoc clone_no_phv
   std::unique_ptr<Packet> clone_no_phv_ptr() const;
+  //! Same as clone_no_phv_ptr(), but only the first \p max_data_size bytes of
+  //! packet data are copied to the clone. The clone is not truncated with
+  //! truncate() though, which is up to the caller.
+  std::unique_ptr<Packet> clone_no_phv_ptr(size_t max_data_size) const;
 
   //! Same as clone_no_phv(), but also changes the context id for the clone.
   //! See change_context() for more information on how a Packet instance belongs
@@ -285,6 +301,14 @@ class Packet final {
   //! @copydoc clone_choose_context
   std::unique_ptr<Packet> clone_choose_context_ptr(size_t new_cxt) const;
 
+  //! Prepare the packet for another pass through the pipelines (e.g. for
+  //! resubmit or recirculate) when the original is no longer needed. This is
+  //! a cheaper alternative to clone_no_phv(): the buffer is not copied and the
+  //! PHV is kept. Just like for a clone, the packet gets a new copy id, and the
+  //! exit flag, truncation and payload size are cleared. The PHV fields are
+  //! left untouched; it is up to the caller to reset them as needed.
+  void recycle();
+
   //! Deleted copy constructor
   Packet(const Packet &other) = delete;
   //! Deleted copy assignment operator
@@ -312,6 +336,8 @@ class Packet final {
   Packet(size_t cxt, int ingress_port, packet_id_t id, copy_id_t copy_id,
          int ingress_length, PacketBuffer &&buffer, PHVSourceIface *phv_source);
 
+  PacketBuffer clone_buffer(size_t max_data_size) const;
+
   void update_signature(uint64_t seed = 0);
   void set_ingress_ts();
 
@@ -327,6 +353,8 @@ class Packet final {
   };
   int flags{0};
 
+  bool traced{false};
+
   uint64_t signature{0};
 
   PacketBuffer buffer{};
@@ -118,6 +118,15 @@ class PacketBuffer {
     return pb;
   }
 
+  //! Same as clone(), but copies the first \p start_bytes bytes of packet
+  //! data, which is useful to clone a truncated packet.
+  PacketBuffer clone_start(size_t start_bytes) const {
+    assert(start_bytes <= data_size);
+    PacketBuffer pb(size);
+    std::copy(head, head + start_bytes, pb.push(start_bytes));
+    return pb;
+  }
+
   PacketBuffer(const PacketBuffer &other) = delete;
   PacketBuffer &operator=(const PacketBuffer &other) = delete;
 
@@ -0,0 +1,104 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file packet_tracer.h
+
+#ifndef BM_BM_SIM_PACKET_TRACER_H_
+#define BM_BM_SIM_PACKET_TRACER_H_
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "data.h"
+
+namespace bm {
+
+class Packet;
+
+//! Decides which packets are traced when bmv2 was compiled without per-packet
+//! debug logging (i.e. without `BMLOG_DEBUG_ON` / `BMLOG_TRACE_ON`). In such a
+//! build, BMLOG_DEBUG_PKT() and BMLOG_TRACE_PKT() only test a flag in the
+//! Packet and, if the packet was selected, send the message to an asynchronous
+//! logger (see Logger::get_packet_trace()).
+//!
+//! Tracing is armed at runtime with a Config. A packet is traced if it matches
+//! all the criteria in the config:
+//!   - its ingress port is one of Config::ports (ignored if empty)
+//!   - its packet id is a multiple of Config::sampling_rate (ignored if 0 or 1)
+//!   - all the fields in Config::field_matches have the requested value, in
+//!     which case the decision can only be taken once the packet has been
+//!     parsed, and the parser messages are not traced.
+//!
+//! Clones of a traced packet are traced as well.
+class PacketTracer {
+ public:
+  struct FieldMatch {
+    //! field name, in the `"hdr.f"` format
+    std::string field_name;
+    Data value;
+  };
+
+  struct Config {
+    std::vector<int> ports{};
+    unsigned int sampling_rate{1};
+    std::vector<FieldMatch> field_matches{};
+  };
+
+  //! Arm tracing with the given configuration
+  void enable(const Config &config);
+
+  //! Stop tracing packets; already selected packets will keep being traced
+  void disable();
+
+  //! Return true if tracing is armed, in which case \p config is set to the
+  //! current configuration
+  bool get_config(Config *config) const;
+
+  //! Called when a new packet is created; decides whether the packet needs to
+  //! be traced
+  bool select(const Packet &pkt) const {
+    if (!armed.load(std::memory_order_relaxed)) return false;
+    return select_(pkt);
+  }
+
+  //! Called at the end of parsing; decides whether the packet needs to be
+  //! traced when the config includes field matches
+  void select_after_parse(Packet *pkt) const {
+    if (!with_field_matches.load(std::memory_order_relaxed)) return;
+    select_after_parse_(pkt);
+  }
+
+  static PacketTracer *get() {
+    static PacketTracer packet_tracer;
+    return &packet_tracer;
+  }
+
+ private:
+  bool select_(const Packet &pkt) const;
+  void select_after_parse_(Packet *pkt) const;
+
+  bool match_ingress(const Config &config, const Packet &pkt) const;
+
+  std::atomic<bool> armed{false};
+  std::atomic<bool> with_field_matches{false};
+  // accessed with std::atomic_load / std::atomic_store
+  std::shared_ptr<const Config> config{nullptr};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_PACKET_TRACER_H_
@@ -0,0 +1,143 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file perf_counters.h
+
+#ifndef BM_BM_SIM_PERF_COUNTERS_H_
+#define BM_BM_SIM_PERF_COUNTERS_H_
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "named_p4object.h"
+#include "packet.h"
+
+namespace bm {
+
+class ControlFlowNode;
+
+//! Attributes hardware performance counters (cycles, instructions, last-level
+//! cache misses and branch misses) to the P4 objects which process a packet:
+//! parsers, tables, conditionals and deparsers. This relies on the Linux
+//! `perf_event_open` system call and is only available when the kernel lets
+//! the process count user-space events for its own threads (see
+//! `/proc/sys/kernel/perf_event_paranoid`).
+//!
+//! Counting is armed at runtime with enable(). Only one in every \p
+//! sampling_rate packets (based on the packet id) is measured, because each
+//! measurement requires 2 system calls. When counting is not armed, the cost
+//! for each P4 object is a relaxed atomic load.
+class PerfCounters {
+ public:
+  enum class ObjectType {
+    PARSER,
+    TABLE,
+    CONDITIONAL,
+    DEPARSER,
+  };
+
+  //! Counters accumulated over all the sampled packets for one P4 object
+  struct Stats {
+    size_t cxt_id;
+    ObjectType type;
+    p4object_id_t id;
+    std::string name;
+    uint64_t samples;
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t llc_misses;
+    uint64_t branch_misses;
+  };
+
+  //! Measures the P4 object for the lifetime of the Sample, if the packet is
+  //! sampled
+  class Sample {
+   public:
+    Sample(const Packet &pkt, ObjectType type, const NamedP4Object &object) {
+      if (get()->is_sampled(pkt)) start(pkt, type, &object);
+    }
+
+    //! The type of \p node (table or conditional) is only determined if the
+    //! packet is sampled
+    Sample(const Packet &pkt, const ControlFlowNode &node);
+
+    ~Sample() {
+      if (object) stop();
+    }
+
+    Sample(const Sample &other) = delete;
+    Sample &operator=(const Sample &other) = delete;
+
+   private:
+    void start(const Packet &pkt, ObjectType type,
+               const NamedP4Object *object);
+    void stop();
+
+    const NamedP4Object *object{nullptr};
+    size_t cxt_id{0};
+    ObjectType type{ObjectType::PARSER};
+    // cycles, instructions, LLC misses, branch misses
+    uint64_t begin[4];
+  };
+
+  //! Arm counting, for one in every \p sampling_rate packets. Returns false
+  //! and sets \p error if the counters cannot be opened. The counters
+  //! accumulated so far are preserved.
+  bool enable(unsigned int sampling_rate, std::string *error);
+
+  //! Stop counting; the counters accumulated so far are preserved
+  void disable();
+
+  bool is_enabled() const {
+    return armed.load(std::memory_order_relaxed);
+  }
+
+  void reset();
+
+  //! One entry for each P4 object which was measured at least once
+  std::vector<Stats> get_stats() const;
+
+  bool is_sampled(const Packet &pkt) const {
+    if (!armed.load(std::memory_order_relaxed)) return false;
+    return pkt.get_packet_id() %
+        sampling_rate.load(std::memory_order_relaxed) == 0;
+  }
+
+  static const char *object_type_name(ObjectType type);
+
+  static PerfCounters *get() {
+    static PerfCounters perf_counters;
+    return &perf_counters;
+  }
+
+ private:
+  typedef std::tuple<size_t, ObjectType, p4object_id_t> Key;
+
+  void add_sample(size_t cxt_id, ObjectType type,
+                  const NamedP4Object &object, const uint64_t *deltas);
+
+  std::atomic<bool> armed{false};
+  std::atomic<unsigned int> sampling_rate{1};
+  mutable std::mutex mutex{};
+  std::map<Key, Stats> stats{};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_PERF_COUNTERS_H_
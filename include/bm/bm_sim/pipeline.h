@@ -45,6 +45,32 @@ class Pipeline : public NamedP4Object {
   //! flow graph.
   void apply(Packet *pkt);
 
+  //! Sends a burst of \p n packets through the control flow. Each packet
+  //! follows the same path through the control flow graph as with apply(), but
+  //! each ControlFlowNode processes all the packets which reach it together
+  //! (see ControlFlowNode::apply_batch()), which amortizes the per-node
+  //! overhead (e.g. acquiring the table lock) over the burst. The packets are
+  //! grouped by next node after every step, and packets which reach a node for
+  //! which a group is still pending join that group.
+  //!
+  //! The packets are therefore interleaved: a node sees every packet of its
+  //! group before the next node sees any of them, and packets which took
+  //! different branches can reach a later node in a different order than the
+  //! burst order. When the program has state shared between packets
+  //! (registers, counters, meters, stateful externs), the accesses to that
+  //! state happen in a different order than if apply() was called for each
+  //! packet in turn, and the results (e.g. a register read by a later table,
+  //! or a meter color) can differ. Only use this when such a reordering is
+  //! acceptable, as it would be for packets arriving at the same time on
+  //! different ports. In addition, a match-action table holds its read lock
+  //! while it processes all the packets of its group, i.e. up to the whole
+  //! burst, so a control plane update to the table waits for the burst and
+  //! not for a single packet.
+  //!
+  //! While PerfCounters are enabled, the packets are processed one at a time,
+  //! so that the measurements remain attributed to a single packet.
+  void apply_batch(Packet *const *pkts, size_t n);
+
   //! Deleted copy constructor
   Pipeline(const Pipeline &other) = delete;
   //! Deleted copy assignment operator
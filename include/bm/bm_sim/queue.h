@@ -88,6 +88,18 @@ class Queue {
     q_not_empty.notify_one();
   }
 
+  //! Moves \p item to the front of the queue if the queue is not full, and
+  //! never blocks, whatever the write behavior of the queue. Returns true if
+  //! \p item was pushed; otherwise \p item is left untouched.
+  bool try_push_front(T &&item) {
+    std::unique_lock<std::mutex> lock(q_mutex);
+    if (!is_not_full()) return false;
+    queue.push_front(std::move(item));
+    lock.unlock();
+    q_not_empty.notify_one();
+    return true;
+  }
+
   //! Pops an element from the back of the queue: moves the element to `*pItem`.
   void pop_back(T* pItem) {
     std::unique_lock<std::mutex> lock(q_mutex);
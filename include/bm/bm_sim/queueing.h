@@ -30,6 +30,7 @@
 #ifndef BM_BM_SIM_QUEUEING_H_
 #define BM_BM_SIM_QUEUEING_H_
 
+#include <array>
 #include <deque>
 #include <queue>
 #include <vector>
@@ -211,6 +212,10 @@ class QueueingLogic {
 template <typename T, typename FMap>
 class QueueingLogicRL {
  public:
+  // clock choice? switch to steady if observing re-ordering
+  // using clock = std::chrono::steady_clock;
+  using clock = std::chrono::high_resolution_clock;
+
   //! @copydoc QueueingLogic::QueueingLogic()
   //!
   //! Initially, none of the logical queues will be rate-limited, i.e. the
@@ -286,6 +291,34 @@ class QueueingLogicRL {
     q_info.size--;
   }
 
+  //! Non-blocking version of pop_back(), for callers which cannot afford to
+  //! wait (e.g. tasks running on a ThreadPool). If an element is free to leave
+  //! the queue, it is moved to \p pItem and the function returns `1`.
+  //! Otherwise the function returns `0` and, if the queues of the worker are
+  //! not empty, \p next is set to the time at which the next element will be
+  //! released by the rate limiter (or to `clock::time_point::max()` if they
+  //! are empty).
+  int try_pop_back(size_t worker_id, size_t *queue_id, T *pItem,
+                   clock::time_point *next) {
+    auto &w_info = workers_info.at(worker_id);
+    auto &queue = w_info.queue;
+    std::unique_lock<std::mutex> lock(w_info.q_mutex);
+    if (queue.size() == 0) {
+      *next = clock::time_point::max();
+      return 0;
+    }
+    if (queue.top().send > clock::now()) {
+      *next = queue.top().send;
+      return 0;
+    }
+    *queue_id = queue.top().queue_id;
+    *pItem = std::move(const_cast<QE &>(queue.top()).e);
+    queue.pop();
+    auto &q_info = queues_info.at(*queue_id);
+    q_info.size--;
+    return 1;
+  }
+
   //! @copydoc QueueingLogic::size
   size_t size(size_t queue_id) const {
     size_t worker_id = map_to_worker(queue_id);
@@ -330,9 +363,6 @@ class QueueingLogicRL {
 
  private:
   using ticks = std::chrono::nanoseconds;
-  // clock choice? switch to steady if observing re-ordering
-  // using clock = std::chrono::steady_clock;
-  using clock = std::chrono::high_resolution_clock;
 
   struct QE {
     // QE(T e, size_t queue_id, const clock::time_point &send, size_t id)
@@ -408,6 +438,10 @@ class QueueingLogicPriRL {
   using LockType = std::unique_lock<MutexType>;
 
  public:
+  // clock choice? switch to steady if observing re-ordering
+  // using clock = std::chrono::steady_clock;
+  using clock = std::chrono::high_resolution_clock;
+
   //! See QueueingLogic::QueueingLogicRL() for an introduction. The difference
   //! here is that each logical queues can receive several priority queues (as
   //! determined by \p nb_priorities, which is set to `2` by default). Each of
@@ -529,6 +563,45 @@ class QueueingLogicPriRL {
     return pop_back(worker_id, queue_id, &priority, pItem);
   }
 
+  //! Non-blocking version of
+  //! pop_back(size_t worker_id, size_t *queue_id, size_t *priority, T *pItem).
+  //! See QueueingLogicRL::try_pop_back() for the meaning of the return value
+  //! and of \p next.
+  int try_pop_back(size_t worker_id, size_t *queue_id, size_t *priority,
+                   T *pItem, clock::time_point *next) {
+    auto &w_info = workers_info.at(worker_id);
+    LockType lock(w_info.q_mutex);
+    auto now = clock::now();
+    *next = clock::time_point::max();
+    for (size_t pri = 0; pri < nb_priorities; pri++) {
+      auto &q = w_info.queues[pri];
+      if (q.size() == 0) continue;
+      if (q.top().send > now) {
+        *next = std::min(*next, q.top().send);
+        continue;
+      }
+      *queue_id = q.top().queue_id;
+      *priority = pri;
+      *pItem = std::move(const_cast<QE &>(q.top()).e);
+      q.pop();
+      auto &q_info = queues_info.at(*queue_id);
+      auto &q_info_pri = q_info.at(pri);
+      q_info_pri.size--;
+      q_info.size--;
+      return 1;
+    }
+    return 0;
+  }
+
+  //! Same as try_pop_back(size_t worker_id, size_t *queue_id,
+  //! size_t *priority, T *pItem, clock::time_point *next), but the priority of
+  //! the popped element is discarded.
+  int try_pop_back(size_t worker_id, size_t *queue_id, T *pItem,
+                   clock::time_point *next) {
+    size_t priority;
+    return try_pop_back(worker_id, queue_id, &priority, pItem, next);
+  }
+
   //! @copydoc QueueingLogic::size
   //! The occupancies of all the priority queues for this logical queue are
   //! added.
@@ -589,9 +662,6 @@ class QueueingLogicPriRL {
 
  private:
   using ticks = std::chrono::nanoseconds;
-  // clock choice? switch to steady if observing re-ordering
-  // using clock = std::chrono::steady_clock;
-  using clock = std::chrono::high_resolution_clock;
 
   struct QE {
     QE(T e, size_t queue_id, const clock::time_point &send)
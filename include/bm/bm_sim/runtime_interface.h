@@ -206,6 +206,26 @@ class RuntimeInterface {
   mt_indirect_ws_get_entries(size_t cxt_id,
                              const std::string &table_name) const = 0;
 
+  // paginated versions of the above, see MatchTable::get_entries_page()
+  virtual MatchErrorCode
+  mt_get_entries_page(size_t cxt_id, const std::string &table_name,
+                      size_t cursor, size_t max_entries,
+                      std::vector<MatchTable::Entry> *entries,
+                      size_t *next_cursor) const = 0;
+
+  virtual MatchErrorCode
+  mt_indirect_get_entries_page(size_t cxt_id, const std::string &table_name,
+                               size_t cursor, size_t max_entries,
+                               std::vector<MatchTableIndirect::Entry> *entries,
+                               size_t *next_cursor) const = 0;
+
+  virtual MatchErrorCode
+  mt_indirect_ws_get_entries_page(
+      size_t cxt_id, const std::string &table_name,
+      size_t cursor, size_t max_entries,
+      std::vector<MatchTableIndirectWS::Entry> *entries,
+      size_t *next_cursor) const = 0;
+
   virtual MatchErrorCode
   mt_get_entry(size_t cxt_id, const std::string &table_name,
                entry_handle_t handle, MatchTable::Entry *entry) const = 0;
@@ -220,6 +240,26 @@ class RuntimeInterface {
                            entry_handle_t handle,
                            MatchTableIndirectWS::Entry *entry) const = 0;
 
+  virtual MatchErrorCode
+  mt_get_change_seq(size_t cxt_id, const std::string &table_name,
+                    MatchTableAbstract::seq_t *seq) const = 0;
+
+  virtual MatchErrorCode
+  mt_get_entries_since(size_t cxt_id, const std::string &table_name,
+                       MatchTableAbstract::seq_t since,
+                       MatchTable::Changes *changes) const = 0;
+
+  virtual MatchErrorCode
+  mt_indirect_get_entries_since(size_t cxt_id, const std::string &table_name,
+                                MatchTableAbstract::seq_t since,
+                                MatchTableIndirect::Changes *changes) const = 0;
+
+  virtual MatchErrorCode
+  mt_indirect_ws_get_entries_since(
+      size_t cxt_id, const std::string &table_name,
+      MatchTableAbstract::seq_t since,
+      MatchTableIndirectWS::Changes *changes) const = 0;
+
   virtual MatchErrorCode
   mt_get_default_entry(size_t cxt_id, const std::string &table_name,
                        MatchTable::Entry *entry) const = 0;
@@ -237,6 +277,13 @@ class RuntimeInterface {
   mt_indirect_get_members(size_t cxt_id,
                           const std::string &table_name) const = 0;
 
+  virtual MatchErrorCode
+  mt_indirect_get_members_page(
+      size_t cxt_id, const std::string &table_name,
+      size_t cursor, size_t max_members,
+      std::vector<MatchTableIndirect::Member> *members,
+      size_t *next_cursor) const = 0;
+
   virtual MatchErrorCode
   mt_indirect_get_member(size_t cxt_id, const std::string &table_name,
                          mbr_hdl_t mbr,
@@ -246,6 +293,13 @@ class RuntimeInterface {
   mt_indirect_ws_get_groups(size_t cxt_id,
                             const std::string &table_name) const = 0;
 
+  virtual MatchErrorCode
+  mt_indirect_ws_get_groups_page(
+      size_t cxt_id, const std::string &table_name,
+      size_t cursor, size_t max_groups,
+      std::vector<MatchTableIndirectWS::Group> *groups,
+      size_t *next_cursor) const = 0;
+
   virtual MatchErrorCode
   mt_indirect_ws_get_group(size_t cxt_id, const std::string &table_name,
                            grp_hdl_t grp,
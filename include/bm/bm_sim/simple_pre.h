@@ -26,6 +26,9 @@
 
 #include <boost/thread/shared_mutex.hpp>
 
+#include <array>
+#include <atomic>
+#include <memory>
 #include <unordered_map>
 #include <string>
 #include <vector>
@@ -88,7 +91,8 @@ class McSimplePre {
   static constexpr size_t LAG_MAP_SIZE = 256;
   typedef McPre::Set<LAG_MAP_SIZE> LagMap;
 
-  McSimplePre() {}
+  McSimplePre();
+  virtual ~McSimplePre() { }
   McReturnCode mc_mgrp_create(const mgrp_t, mgrp_hdl_t *);
   McReturnCode mc_mgrp_destroy(const mgrp_hdl_t);
   McReturnCode mc_node_create(const rid_t,
@@ -105,9 +109,10 @@ class McSimplePre {
 
   void reset_state();
 
-  //! This is the only "dataplane" method for this class. It takes as input a
+  //! This is the "dataplane" method for this class. It takes as input a
   //! multicast group id (set during pipeline processing) and returns a vector
-  //! of McOut instances (rid + egress port).
+  //! of McOut instances (rid + egress port). See also the other overload of
+  //! replicate(), which does not allocate memory.
   //!
   //! The mgid (multicast group id) points to a L1 (level 1) node. Each L1 node
   //! has a unique rid and points to a L2 node. The L2 node includes a list of
@@ -129,6 +134,50 @@ class McSimplePre {
   //! @endcode
   std::vector<McOut> replicate(const McIn) const;
 
+  //! Calls \p f (with a `const McOut &` argument) for every copy of the
+  //! packet which needs to be generated for multicast group \p
+  //! ingress_info.mgid, and returns the number of copies. The copies are read
+  //! from a flattened list of (rid, egress port) pairs, which is computed
+  //! every time the group is modified. This method does not acquire any lock,
+  //! does not update any reference count and does not allocate any memory:
+  //! the data path threads only increment and decrement a counter of their
+  //! own (see ReaderEpochs), which makes it the preferred method for targets.
+  //! Control plane operations which modify a group wait for the calls to this
+  //! method which are in progress, so \p f should not block for long:
+  //! @code
+  //! pre->replicate({mgid}, [&packet](const McSimplePre::McOut &out) {
+  //!   std::unique_ptr<Packet> packet_copy = packet->clone_with_phv_ptr();
+  //!   // ...
+  //!   // send packet_copy to out.egress_port
+  //! });
+  //! @endcode
+  template <typename F>
+  size_t replicate(const McIn ingress_info, F f) const {
+    return replicate(ingress_info, 0, f);
+  }
+
+  //! Same as above, but \p lag_hash (a hash of the packet flow) is used by
+  //! McSimplePreLAG to select one member of each LAG.
+  template <typename F>
+  size_t replicate(const McIn ingress_info, uint64_t lag_hash, F f) const {
+    ReaderEpochs::Guard guard(&reader_epochs);
+    const auto *lists = replication_lists.load();
+    const auto it = lists->find(ingress_info.mgid);
+    if (it == lists->end()) {
+      warn_unknown_mgid(ingress_info.mgid);
+      return 0;
+    }
+    for (const auto &copy : *it->second) {
+      McOut out{copy.rid, copy.egress_port};
+      if (copy.lag_buckets) {
+        const auto &buckets = *copy.lag_buckets;
+        out.egress_port = buckets[lag_hash % buckets.size()];
+      }
+      f(out);
+    }
+    return it->second->size();
+  }
+
   //! Deleted copy constructor
   McSimplePre(const McSimplePre &other) = delete;
   //! Deleted move assignment operator
@@ -180,9 +229,75 @@ class McSimplePre {
             lag_map(lag_map) {}
   };
 
+  typedef std::vector<egress_port_t> LagBuckets;
+
+  struct Copy {
+    rid_t rid;
+    egress_port_t egress_port;
+    // only used by McSimplePreLAG: if not null, the copy is for a LAG and
+    // egress_port is ignored; the member is selected with the lag hash
+    std::shared_ptr<const LagBuckets> lag_buckets;
+  };
+
+  typedef std::vector<Copy> ReplicationList;
+  // maps a mgid to the flattened list of copies for the group; immutable once
+  // published
+  typedef std::unordered_map<mgrp_t, std::shared_ptr<const ReplicationList> >
+      ReplicationLists;
+
+  // Epoch-based reclamation for the published replication lists. Each reader
+  // increments a counter for the current epoch parity in a slot of its own
+  // while it uses the lists, so the data path does not share any cache line
+  // with the other threads (unless there are more threads than slots). After
+  // publishing a new version, a writer flips the parity and waits for the
+  // counters of the previous parity to drop to 0, after which no reader can
+  // still be using the previous version. Writers need to be serialized.
+  class ReaderEpochs {
+   public:
+    class Guard {
+     public:
+      explicit Guard(ReaderEpochs *epochs);
+      ~Guard();
+
+     private:
+      std::atomic<uint64_t> *counter;
+    };
+
+    void synchronize();
+
+   private:
+    static constexpr size_t nb_slots = 64;
+
+    struct Slot {
+      std::atomic<uint64_t> counters[2];
+      char pad[64 - 2 * sizeof(std::atomic<uint64_t>)];
+    };
+
+    std::array<Slot, nb_slots> slots{};
+    std::atomic<unsigned int> parity{0};
+  };
+
   // internal version, which does not acquire the lock
   void reset_state_();
 
+  // computes the copies for the given group, does not acquire lock
+  virtual void build_replication_list(const MgidEntry &mgid_entry,
+                                      ReplicationList *list) const;
+
+  // replaces the published lists and destroys the previous version once no
+  // reader uses it anymore, does not acquire lock
+  void publish_replication_lists(
+      std::unique_ptr<const ReplicationLists> lists);
+
+  // recomputes the replication lists for the given groups (which may have
+  // been destroyed) and publishes them, does not acquire lock
+  void update_replication_lists(const std::vector<mgrp_hdl_t> &mgrp_hdls);
+  void update_all_replication_lists();
+  // the groups which include the given L1 node, does not acquire lock
+  std::vector<mgrp_hdl_t> get_groups_with_node(l1_hdl_t l1_hdl) const;
+
+  static void warn_unknown_mgid(mgrp_t mgid);
+
   // does not acquire lock
   void get_entries_common(Json::Value *root) const;
 
@@ -191,6 +306,10 @@ class McSimplePre {
   std::unordered_map<l2_hdl_t, L2Entry> l2_entries{};
   HandleMgr l1_handles{};
   HandleMgr l2_handles{};
+  // the published version, owned by current_lists
+  std::atomic<const ReplicationLists *> replication_lists{nullptr};
+  std::unique_ptr<const ReplicationLists> current_lists{nullptr};
+  mutable ReaderEpochs reader_epochs{};
   mutable boost::shared_mutex mutex{};
 };
 
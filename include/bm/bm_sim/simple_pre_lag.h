@@ -24,6 +24,7 @@
 #ifndef BM_BM_SIM_SIMPLE_PRE_LAG_H_
 #define BM_BM_SIM_SIMPLE_PRE_LAG_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -32,10 +33,17 @@
 
 namespace bm {
 
-//! Enhances McSimplePre with LAG (link aggregation) support.
+//! Enhances McSimplePre with LAG (link aggregation) support. For each LAG in
+//! the LAG map of a L1 node, one copy of the packet is sent to one of the
+//! members of the LAG, selected with the lag hash passed to replicate(). Each
+//! LAG has LAG_BUCKETS buckets, each one mapped to an active member, and the
+//! member is the one mapped to bucket `lag_hash % LAG_BUCKETS`. When a member
+//! is removed from the LAG or goes down (see mc_set_port_status()), only the
+//! flows which were mapped to this member are moved to other members.
 class McSimplePreLAG : public McSimplePre {
  public:
   static constexpr int LAG_MAX_ENTRIES = 256;
+  static constexpr size_t LAG_BUCKETS = 256;
   typedef uint16_t lag_id_t;
 
   McReturnCode mc_node_create(const rid_t rid,
@@ -49,17 +57,20 @@ class McSimplePreLAG : public McSimplePre {
   McReturnCode mc_set_lag_membership(const lag_id_t lag_index,
                                      const PortMap &port_map);
 
+  //! Notifies the PRE that a port went up or down. LAG members which are down
+  //! are not selected. All ports are considered up initially.
+  McReturnCode mc_set_port_status(const egress_port_t port, const bool up);
+
   std::string mc_get_entries() const;
 
   void reset_state();
 
-  //! TODO(unknown)
-  std::vector<McOut> replicate(const McIn) const;
-
  private:
   struct LagEntry {
     uint16_t member_count;
     PortMap port_map{};
+    // active member for each bucket, null if there is no active member
+    std::shared_ptr<const LagBuckets> buckets{nullptr};
 
     LagEntry() {}
     LagEntry(uint16_t member_count,
@@ -68,7 +79,16 @@ class McSimplePreLAG : public McSimplePre {
             port_map(port_map) {}
   };
 
+  // in addition to the ports in the node port map, one member of each LAG in
+  // the node LAG map is included in the copies
+  void build_replication_list(const MgidEntry &mgid_entry,
+                              ReplicationList *list) const override;
+
+  // does not acquire lock
+  void update_lag_buckets(LagEntry *lag_entry) const;
+
   std::unordered_map<lag_id_t, LagEntry> lag_entries{};
+  PortMap ports_down{};
 };
 
 }  // namespace bm
@@ -79,6 +79,7 @@
 #include "context.h"
 #include "queue.h"
 #include "packet.h"
+#include "context_workers.h"
 #include "learning.h"
 #include "runtime_interface.h"
 #include "dev_mgr.h"
@@ -127,6 +128,23 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
   //! Returns the Thrift port used for the runtime RPC server.
   int get_runtime_port() const { return thrift_port; }
 
+  //! Configuration of the Thrift runtime server, set from the command line
+  //! (see `--thrift-server`, `--thrift-protocol` and `--thrift-workers`)
+  struct RuntimeServerOptions {
+    //! event-driven server with framed transport, instead of one thread per
+    //! connection with buffered transport
+    bool nonblocking{false};
+    //! compact protocol instead of binary protocol
+    bool compact_protocol{false};
+    //! number of threads executing the requests, for the non-blocking server
+    int nb_workers{4};
+  };
+
+  //! Returns the configuration of the Thrift runtime server
+  const RuntimeServerOptions &get_runtime_server_options() const {
+    return runtime_server_options;
+  }
+
   //! Returns the device id for this switch instance.
   int get_device_id() const { return device_id; }
 
@@ -257,6 +275,41 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
                   std::move(buffer), phv_source.get());
   }
 
+  //! Starts \p nb_threads worker threads dedicated to context \p cxt_id, which
+  //! call \p handler for each packet handed off to this context with
+  //! hand_off_to_context(). At most \p queue_capacity packets can be waiting
+  //! for the workers of the context. This lets the contexts of the switch run
+  //! in parallel, without the target managing the threads itself. See
+  //! ContextWorkers for more information.
+  //!
+  //! Like hand_off_to_context() and ContextWorkers::push(), returns `0` on
+  //! success and `1` on failure: here if \p cxt_id is invalid or if the
+  //! workers for this context were already started.
+  //!
+  //! The workers are owned by this base class, but \p handler usually
+  //! captures the target: a target which starts context workers must call
+  //! stop_context_workers() from its destructor, or the workers may still be
+  //! running the handler once the target part of the object is destroyed.
+  int start_context_workers(size_t cxt_id, size_t nb_threads,
+                            size_t queue_capacity,
+                            ContextWorkers::Handler handler);
+
+  //! Stops the workers of all the contexts (see start_context_workers()): the
+  //! packets which are still queued are discarded and the worker threads are
+  //! joined, after the calls to the handlers which are in progress complete.
+  //! Packets handed off to a context after this call are dropped. Must not be
+  //! called from a context worker thread.
+  void stop_context_workers();
+
+  //! Moves \p packet to context \p cxt_id with Packet::change_context(), so
+  //! the packet buffer is not copied and only the PHV is exchanged for one of
+  //! the new context, and queues it for the workers of this context (see
+  //! start_context_workers()). The call never blocks. Returns `0` on success,
+  //! and `1` if the packet was dropped: because \p cxt_id is invalid, because
+  //! the workers for \p cxt_id were not started (or were stopped), or because
+  //! the queue of the context is full.
+  int hand_off_to_context(size_t cxt_id, std::unique_ptr<Packet> &&packet);
+
   //! Obtain a pointer to the LearnEngine for a given Context
   LearnEngine *get_learn_engine(size_t cxt_id) {
     return contexts.at(cxt_id).get_learn_engine();
@@ -466,6 +519,34 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
     return contexts.at(cxt_id).mt_get_entries<MatchTableIndirectWS>(table_name);
   }
 
+  MatchErrorCode
+  mt_get_entries_page(size_t cxt_id, const std::string &table_name,
+                      size_t cursor, size_t max_entries,
+                      std::vector<MatchTable::Entry> *entries,
+                      size_t *next_cursor) const override {
+    return contexts.at(cxt_id).mt_get_entries_page<MatchTable>(
+        table_name, cursor, max_entries, entries, next_cursor);
+  }
+
+  MatchErrorCode
+  mt_indirect_get_entries_page(size_t cxt_id, const std::string &table_name,
+                               size_t cursor, size_t max_entries,
+                               std::vector<MatchTableIndirect::Entry> *entries,
+                               size_t *next_cursor) const override {
+    return contexts.at(cxt_id).mt_get_entries_page<MatchTableIndirect>(
+        table_name, cursor, max_entries, entries, next_cursor);
+  }
+
+  MatchErrorCode
+  mt_indirect_ws_get_entries_page(
+      size_t cxt_id, const std::string &table_name,
+      size_t cursor, size_t max_entries,
+      std::vector<MatchTableIndirectWS::Entry> *entries,
+      size_t *next_cursor) const override {
+    return contexts.at(cxt_id).mt_get_entries_page<MatchTableIndirectWS>(
+        table_name, cursor, max_entries, entries, next_cursor);
+  }
+
   MatchErrorCode
   mt_get_entry(size_t cxt_id, const std::string &table_name,
                entry_handle_t handle, MatchTable::Entry *entry) const override {
@@ -489,6 +570,38 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
         table_name, handle, entry);
   }
 
+  MatchErrorCode
+  mt_get_change_seq(size_t cxt_id, const std::string &table_name,
+                    MatchTableAbstract::seq_t *seq) const override {
+    return contexts.at(cxt_id).mt_get_change_seq(table_name, seq);
+  }
+
+  MatchErrorCode
+  mt_get_entries_since(size_t cxt_id, const std::string &table_name,
+                       MatchTableAbstract::seq_t since,
+                       MatchTable::Changes *changes) const override {
+    return contexts.at(cxt_id).mt_get_entries_since<MatchTable>(
+        table_name, since, changes);
+  }
+
+  MatchErrorCode
+  mt_indirect_get_entries_since(
+      size_t cxt_id, const std::string &table_name,
+      MatchTableAbstract::seq_t since,
+      MatchTableIndirect::Changes *changes) const override {
+    return contexts.at(cxt_id).mt_get_entries_since<MatchTableIndirect>(
+        table_name, since, changes);
+  }
+
+  MatchErrorCode
+  mt_indirect_ws_get_entries_since(
+      size_t cxt_id, const std::string &table_name,
+      MatchTableAbstract::seq_t since,
+      MatchTableIndirectWS::Changes *changes) const override {
+    return contexts.at(cxt_id).mt_get_entries_since<MatchTableIndirectWS>(
+        table_name, since, changes);
+  }
+
   MatchErrorCode
   mt_get_default_entry(size_t cxt_id, const std::string &table_name,
                        MatchTable::Entry *entry) const override {
@@ -518,6 +631,16 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
     return contexts.at(cxt_id).mt_indirect_get_members(table_name);
   }
 
+  MatchErrorCode
+  mt_indirect_get_members_page(
+      size_t cxt_id, const std::string &table_name,
+      size_t cursor, size_t max_members,
+      std::vector<MatchTableIndirect::Member> *members,
+      size_t *next_cursor) const override {
+    return contexts.at(cxt_id).mt_indirect_get_members_page(
+        table_name, cursor, max_members, members, next_cursor);
+  }
+
   MatchErrorCode
   mt_indirect_get_member(size_t cxt_id, const std::string &table_name,
                          mbr_hdl_t mbr,
@@ -531,6 +654,16 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
     return contexts.at(cxt_id).mt_indirect_ws_get_groups(table_name);
   }
 
+  MatchErrorCode
+  mt_indirect_ws_get_groups_page(
+      size_t cxt_id, const std::string &table_name,
+      size_t cursor, size_t max_groups,
+      std::vector<MatchTableIndirectWS::Group> *groups,
+      size_t *next_cursor) const override {
+    return contexts.at(cxt_id).mt_indirect_ws_get_groups_page(
+        table_name, cursor, max_groups, groups, next_cursor);
+  }
+
   MatchErrorCode
   mt_indirect_ws_get_group(size_t cxt_id, const std::string &table_name,
                            grp_hdl_t grp,
@@ -735,12 +868,17 @@ class SwitchWContexts : public DevMgr, public RuntimeInterface {
 
   std::unique_ptr<PHVSourceIface> phv_source{nullptr};
 
+  // one entry per context, null if the workers were not started; declared
+  // after phv_source, so that the queued packets are destroyed first
+  std::vector<std::unique_ptr<ContextWorkers> > context_workers{};
+
   std::unordered_map<std::type_index, std::shared_ptr<void> > components{};
 
   std::set<header_field_pair> required_fields{};
   ForceArith arith_objects{};
 
   int thrift_port{};
+  RuntimeServerOptions runtime_server_options{};
 
   int device_id{};
 
@@ -827,6 +965,14 @@ class Switch : public SwitchWContexts {
     return get_context(0)->get_field_list(field_list_id);
   }
 
+  //! Return a raw, non-owning pointer to NamedCalculation \p name, or nullptr
+  //! if the P4 program does not include it. This pointer will be invalidated if
+  //! a configuration swap is performed by the target. See switch.h
+  //! documentation for details.
+  NamedCalculation *get_named_calculation(const std::string &name) {
+    return get_context(0)->get_named_calculation(name);
+  }
+
   // Added for testing, other "object types" can be added if needed
   p4object_id_t get_table_id(const std::string &name) {
     return get_context(0)->get_table_id(name);
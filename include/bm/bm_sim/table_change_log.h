@@ -0,0 +1,122 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file table_change_log.h
+
+#ifndef BM_BM_SIM_TABLE_CHANGE_LOG_H_
+#define BM_BM_SIM_TABLE_CHANGE_LOG_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "match_key_types.h"
+#include "named_p4object.h"
+#include "transport.h"
+
+namespace bm {
+
+//! Records the changes made by the control plane to the entries of a match
+//! table, in a ring of fixed capacity. Each change gets a sequence number,
+//! starting at 1 and increasing by 1 for every change, which lets a client
+//! mirroring the table retrieve only the changes it missed (see
+//! MatchTable::get_entries_since()), instead of dumping the whole table. Each
+//! change is also published on the notifications transport, with the "TBL|"
+//! sub-topic.
+//!
+//! This class does not do any synchronization: log() and reset() are called
+//! with the table write lock held, get_since() with the table read lock held.
+class TableChangeLog {
+ public:
+  typedef uint64_t seq_t;
+
+  enum class ChangeType : unsigned int {
+    ADD = 0,
+    MODIFY,
+    DELETE,
+    //! the default entry (or member, or group) was changed
+    SET_DEFAULT
+  };
+
+  struct Record {
+    seq_t seq;
+    ChangeType type;
+    //! undefined for ChangeType::SET_DEFAULT
+    entry_handle_t handle;
+  };
+
+  typedef struct {
+    char sub_topic[4];
+    int switch_id;
+    int cxt_id;
+    int table_id;
+    uint64_t seq;
+    unsigned int type;
+    unsigned int handle;
+  } __attribute__((packed)) msg_hdr_t;
+
+  static constexpr size_t default_capacity = 1024u;
+
+  //! The ring is only allocated when the first change is logged, so tables
+  //! which are never modified at runtime do not pay for it.
+  explicit TableChangeLog(size_t capacity = default_capacity);
+
+  //! Sets the transport on which the changes are published and the ids
+  //! included in the notifications. Nothing is published until this is called.
+  void set_notifications(std::shared_ptr<TransportIface> transport,
+                         int device_id, int cxt_id, p4object_id_t table_id);
+
+  //! Records a change and returns its sequence number.
+  seq_t log(ChangeType type, entry_handle_t handle = 0);
+
+  //! Appends to \p records the changes with a sequence number strictly greater
+  //! than \p since, oldest first. Returns false (and leaves \p records
+  //! untouched) if some of them have already been overwritten in the ring or
+  //! were dropped by reset(), or if \p since is in the future; the client then
+  //! needs to resynchronize by dumping the table.
+  bool get_since(seq_t since, std::vector<Record> *records) const;
+
+  //! Returns the sequence number of the last change, or 0 if there has been
+  //! none.
+  seq_t get_last_seq() const { return next_seq - 1; }
+
+  //! Drops all the records (e.g. when the table state is reset), without
+  //! restarting the sequence numbers. Clients which were mirroring the table
+  //! will need to resynchronize.
+  void reset();
+
+  size_t get_capacity() const { return capacity; }
+
+  TableChangeLog(const TableChangeLog &other) = delete;
+  TableChangeLog &operator=(const TableChangeLog &other) = delete;
+
+ private:
+  void notify(const Record &record) const;
+
+  size_t capacity;
+  std::vector<Record> ring{};
+  seq_t next_seq{1};
+  // the oldest sequence number which can still be retrieved, if not
+  // overwritten in the ring since
+  seq_t first_seq{1};
+  std::shared_ptr<TransportIface> transport{nullptr};
+  int device_id{0};
+  int cxt_id{0};
+  p4object_id_t table_id{0};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_TABLE_CHANGE_LOG_H_
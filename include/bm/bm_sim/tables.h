@@ -68,6 +68,24 @@ class MatchActionTable : public ControlFlowNode {
     return next;
   }
 
+  void apply_batch(Packet *const *pkts, size_t n,
+                   const ControlFlowNode **next) const override {
+    for (size_t i = 0; i < n; i++) {
+      DEBUGGER_NOTIFY_CTR(
+          Debugger::PacketId::make(pkts[i]->get_packet_id(),
+                                   pkts[i]->get_copy_id()),
+          DBG_CTR_TABLE | get_id());
+      BMLOG_TRACE_PKT(*pkts[i], "Applying table '{}'", get_name());
+    }
+    match_table->apply_action_batch(pkts, n, next);
+    for (size_t i = 0; i < n; i++) {
+      DEBUGGER_NOTIFY_CTR(
+          Debugger::PacketId::make(pkts[i]->get_packet_id(),
+                                   pkts[i]->get_copy_id()),
+          DBG_CTR_EXIT(DBG_CTR_TABLE) | get_id());
+    }
+  }
+
   MatchTableAbstract *get_match_table() { return match_table.get(); }
 
  public:
@@ -0,0 +1,142 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//! @file thread_pool.h
+
+#ifndef BM_BM_SIM_THREAD_POOL_H_
+#define BM_BM_SIM_THREAD_POOL_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace bm {
+
+//! A pool of worker threads executing tasks, which can be shared by several
+//! Switch instances running in the same process, so that the number of packet
+//! processing threads scales with the number of cores rather than with the
+//! number of switches (see SimpleSwitch::set_thread_pool(); the other threads
+//! of a switch, e.g. for port I/O, ageing, learning or the Thrift server, are
+//! not affected). Each worker has its own task queue: tasks posted from a
+//! worker thread go to the queue of that worker, and a worker with an empty
+//! queue steals tasks from the other workers. Tasks posted from other threads
+//! are distributed to the workers in a round-robin fashion.
+//!
+//! Tasks must not block for long periods of time (e.g. waiting for a full
+//! queue to drain), as this would prevent the other tasks assigned to the
+//! same worker from running. Tasks which need to run in order, e.g. the
+//! processing of packets by a given pipeline stage, should be posted to a
+//! ThreadPool::Strand.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+  using clock = std::chrono::steady_clock;
+
+  //! Executes the tasks posted to it one at a time, in the order in which they
+  //! were posted, on the threads of a ThreadPool. The strand does not own any
+  //! thread: it is only scheduled on the pool when it has tasks to run. It
+  //! must outlive all the tasks posted to it.
+  class Strand {
+   public:
+    explicit Strand(ThreadPool *pool)
+        : pool(pool) { }
+
+    void post(Task task);
+
+    Strand(const Strand &other) = delete;
+    Strand &operator=(const Strand &other) = delete;
+
+   private:
+    // maximum number of tasks run in a row before giving the worker back to
+    // the pool
+    static constexpr size_t max_batch = 64;
+
+    void run();
+
+    ThreadPool *pool;
+    std::mutex mutex{};
+    std::deque<Task> tasks{};
+    bool scheduled{false};
+  };
+
+  //! Starts \p nb_threads worker threads (at least one), named
+  //! `<name>-<index>`.
+  explicit ThreadPool(size_t nb_threads, const std::string &name = "pool");
+
+  //! Stops the worker threads, after the tasks which are running complete;
+  //! pending tasks are discarded.
+  ~ThreadPool();
+
+  void post(Task task);
+
+  //! Runs \p task after \p delay has elapsed
+  void post_after(clock::duration delay, Task task);
+
+  size_t get_nb_threads() const { return workers.size(); }
+
+  ThreadPool(const ThreadPool &other) = delete;
+  ThreadPool &operator=(const ThreadPool &other) = delete;
+
+ private:
+  struct Worker {
+    std::mutex mutex{};
+    std::deque<Task> tasks{};
+    std::thread thread{};
+  };
+
+  struct Timer {
+    clock::time_point tp;
+    Task task;
+  };
+
+  struct TimerComp {
+    bool operator()(const Timer &lhs, const Timer &rhs) const {
+      return lhs.tp > rhs.tp;
+    }
+  };
+
+  void worker_loop(size_t worker_id);
+  bool get_task(size_t worker_id, Task *task);
+  void push_task(size_t worker_id, Task &&task);
+  // moves the timers which are due to the task queues, returns the time at
+  // which the next timer is due; called with sleep_mutex held
+  clock::time_point run_timers(size_t worker_id);
+
+  std::vector<std::unique_ptr<Worker> > workers{};
+  std::atomic<size_t> next_worker{0};
+  // number of tasks in the worker queues
+  std::atomic<size_t> pending{0};
+  std::atomic<size_t> sleepers{0};
+  std::atomic<bool> stop{false};
+  std::mutex sleep_mutex{};
+  std::condition_variable sleep_cv{};
+  std::priority_queue<Timer, std::vector<Timer>, TimerComp> timers{};
+  // time at which the first timer is due, lets busy workers check the timers
+  // without acquiring sleep_mutex
+  std::atomic<clock::rep> next_timer{std::numeric_limits<clock::rep>::max()};
+};
+
+}  // namespace bm
+
+#endif  // BM_BM_SIM_THREAD_POOL_H_
@@ -4,7 +4,6 @@ sudo apt-get install -y \
     automake \
     cmake \
     libjudy-dev \
-    libgmp-dev \
     libpcap-dev \
     libboost-dev \
     libboost-test-dev \
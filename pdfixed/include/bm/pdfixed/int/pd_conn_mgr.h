@@ -26,6 +26,7 @@
 #include <p4thrift/transport/TSocket.h>
 #include <p4thrift/transport/TTransportUtils.h>
 #include <p4thrift/protocol/TMultiplexedProtocol.h>
+#include <p4thrift/protocol/TCompactProtocol.h>
 
 namespace thrift_provider = p4::thrift;
 #else
@@ -33,17 +34,27 @@ namespace thrift_provider = p4::thrift;
 #include <thrift/transport/TSocket.h>
 #include <thrift/transport/TTransportUtils.h>
 #include <thrift/protocol/TMultiplexedProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
 
 namespace thrift_provider = apache::thrift;
 #endif
 
+#include <bm/pdfixed/pd_common.h>
+
+#include <cassert>
+#include <atomic>
 #include <mutex>
 #include <iostream>
 #include <array>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <typeindex>
 #include <string>
+#include <utility>
 
 #define NUM_DEVICES 256
 
@@ -70,32 +81,226 @@ struct TypeMapper {
   std::unordered_map<std::type_index, size_t> map{};
 };
 
-struct ClientState {
+// one connection to the switch, shared by the clients for all the Thrift
+// services (thanks to the multiplexed protocol); only used by one caller at a
+// time
+struct Connection {
   std::mutex mutex{};
   std::vector<void *> ptrs{};
+  boost::shared_ptr<::thrift_provider::transport::TTransport> transport{
+    nullptr};
+};
+
+struct ClientState {
+  std::vector<std::unique_ptr<Connection> > connections{};
+  // where the next caller starts looking for an available connection, so that
+  // concurrent callers are spread over the pool
+  std::atomic<size_t> next{0};
   int dev_id{};
-  boost::shared_ptr<::thrift_provider::protocol::TTransport> transport{nullptr};
+  int thrift_port_num{};
+  // set by client_init(), so that the connections opened later for the
+  // pipelines match the pool
+  bool framed{false};
+  bool compact{false};
+};
+
+struct PipelineIface {
+  virtual ~PipelineIface() { }
+
+  virtual p4_pd_status_t flush() = 0;
 };
 
 }  // namespace detail
 
+// Thrift calls made through a pipeline are sent to the switch without waiting
+// for the responses to the previous calls, which are only read when needed:
+// one round trip is paid for many calls instead of one per call. Each call
+// comes with a callback which reads its response (by calling the generated
+// recv_* method) and returns a PD status. A pipeline has a connection of its
+// own, which is not part of the pool used by regular calls.
+template <typename A>
+class PdPipeline : public detail::PipelineIface {
+ public:
+  using Recv = std::function<p4_pd_status_t(A *)>;
+
+  // bounds the amount of unread responses, so that neither end can block
+  // forever on a full socket buffer
+  static constexpr size_t max_outstanding = 64;
+
+  PdPipeline(std::shared_ptr<detail::Connection> conn, A *c)
+      : conn(std::move(conn)), c(c) { }
+
+  ~PdPipeline() {
+    try {
+      flush();
+    } catch (...) { }
+  }
+
+  // Send calls the generated send_* method on the client it receives
+  template <typename Send>
+  void call(const Send &send, Recv recv) {
+    if (outstanding.size() >= max_outstanding) recv_one();
+    send(c);
+    outstanding.push_back(std::move(recv));
+  }
+
+  // reads all the outstanding responses, returns the first error reported by
+  // their callbacks since the last flush
+  p4_pd_status_t flush() override {
+    while (!outstanding.empty()) recv_one();
+    p4_pd_status_t rv = status;
+    status = 0;
+    return rv;
+  }
+
+ private:
+  void recv_one() {
+    auto recv = std::move(outstanding.front());
+    outstanding.pop_front();
+    p4_pd_status_t rv = recv(c);
+    if (rv != 0 && status == 0) status = rv;
+  }
+
+  std::shared_ptr<detail::Connection> conn;
+  A *c;
+  std::deque<Recv> outstanding{};
+  p4_pd_status_t status{0};
+};
+
+// Keeps a pool of connections to each device. Checking out a client does not
+// go through any lock shared by all the callers: each connection has its own
+// mutex and a caller only blocks if all the connections of the device are in
+// use.
 struct PdConnMgr {
+  static constexpr size_t default_pool_size = 4;
+
   virtual ~PdConnMgr() { }
 
   template <typename A>
   Client<A> get(int dev_id) {
     static size_t idx = mapper.get<A>();
-    auto &cstate = clients[dev_id];
-    return {static_cast<A *>(cstate.ptrs[idx]),
-          std::unique_lock<std::mutex>(cstate.mutex)};
+    std::unique_lock<std::mutex> lock;
+    auto *conn = checkout(dev_id, &lock);
+    return {static_cast<A *>(conn->ptrs[idx]), std::move(lock)};
+  }
+
+  // Returns the pipeline used by the session for the device, opening its
+  // connection if needed, or nullptr if the connection cannot be opened (the
+  // caller then needs to fall back to a regular call). A session must only be
+  // used by one thread at a time.
+  template <typename A>
+  PdPipeline<A> *get_pipeline(p4_pd_sess_hdl_t sess_hdl, int dev_id) {
+    static size_t idx = mapper.get<A>();
+    const auto key = std::make_pair(dev_id, idx);
+    {
+      std::unique_lock<std::mutex> lock(sessions_mutex);
+      auto it = sessions.find(sess_hdl);
+      if (it != sessions.end()) {
+        auto p_it = it->second.find(key);
+        if (p_it != it->second.end())
+          return static_cast<PdPipeline<A> *>(p_it->second.get());
+      }
+    }
+    // connecting blocks, so it is done without holding sessions_mutex; since
+    // the session is only used by this thread, no other thread can add the
+    // same pipeline in the meantime
+    auto conn = open_connection(dev_id);
+    if (!conn) return nullptr;
+    auto *c = static_cast<A *>(conn->ptrs[idx]);
+    std::unique_ptr<detail::PipelineIface> pipeline(
+        new PdPipeline<A>(std::move(conn), c));
+    auto *ptr = static_cast<PdPipeline<A> *>(pipeline.get());
+    std::unique_lock<std::mutex> lock(sessions_mutex);
+    sessions[sess_hdl][key] = std::move(pipeline);
+    return ptr;
+  }
+
+  // waits for the responses to all the pipelined calls of the session;
+  // returns the first error
+  p4_pd_status_t complete_operations(p4_pd_sess_hdl_t sess_hdl) {
+    std::vector<detail::PipelineIface *> pipelines;
+    {
+      std::unique_lock<std::mutex> lock(sessions_mutex);
+      auto it = sessions.find(sess_hdl);
+      if (it == sessions.end()) return 0;
+      for (auto &p : it->second) pipelines.push_back(p.second.get());
+    }
+    // the pipelines of a session are only destroyed by the thread using the
+    // session, so they can be used without holding sessions_mutex
+    p4_pd_status_t status = 0;
+    for (auto *pipeline : pipelines) {
+      p4_pd_status_t rv = pipeline->flush();
+      if (rv != 0 && status == 0) status = rv;
+    }
+    return status;
+  }
+
+  // completes the pipelined calls of the session and closes its connections
+  p4_pd_status_t close_session(p4_pd_sess_hdl_t sess_hdl) {
+    p4_pd_status_t status = complete_operations(sess_hdl);
+    Pipelines pipelines;
+    {
+      std::unique_lock<std::mutex> lock(sessions_mutex);
+      auto it = sessions.find(sess_hdl);
+      if (it == sessions.end()) return status;
+      pipelines = std::move(it->second);
+      sessions.erase(it);
+    }
+    return status;
+  }
+
+  // number of connections opened to each device by subsequent calls to
+  // client_init()
+  void set_pool_size(size_t size) {
+    pool_size = (size == 0) ? 1 : size;
+  }
+
+  // Thrift transport and protocol used by subsequent calls to client_init();
+  // they need to match the switch: framed transport for a switch started with
+  // `--thrift-server nonblocking`, compact protocol for a switch started with
+  // `--thrift-protocol compact`
+  void set_thrift_options(bool framed, bool compact) {
+    use_framed = framed;
+    use_compact = compact;
   }
 
   virtual int client_init(int dev_id, int thrift_port_num) = 0;
   virtual int client_close(int dev_id) = 0;
 
  protected:
+  // keyed by device id and client type
+  using Pipelines = std::map<std::pair<int, size_t>,
+                             std::unique_ptr<detail::PipelineIface> >;
+
+  // opens a new connection to the device, which is closed when the last
+  // reference to it is released; returns nullptr on error
+  virtual std::shared_ptr<detail::Connection> open_connection(int dev_id) = 0;
+
+  detail::Connection *checkout(int dev_id, std::unique_lock<std::mutex> *lock) {
+    auto &cstate = clients[dev_id];
+    const size_t nb = cstate.connections.size();
+    assert(nb > 0);
+    const size_t start = cstate.next.fetch_add(1, std::memory_order_relaxed);
+    for (size_t i = 0; i < nb; i++) {
+      auto *conn = cstate.connections[(start + i) % nb].get();
+      std::unique_lock<std::mutex> conn_lock(conn->mutex, std::try_to_lock);
+      if (conn_lock.owns_lock()) {
+        *lock = std::move(conn_lock);
+        return conn;
+      }
+    }
+    auto *conn = cstate.connections[start % nb].get();
+    *lock = std::unique_lock<std::mutex>(conn->mutex);
+    return conn;
+  }
+
   std::array<detail::ClientState, NUM_DEVICES> clients;
   detail::TypeMapper mapper{};
+  size_t pool_size{default_pool_size};
+  bool use_framed{false};
+  bool use_compact{false};
+  std::mutex sessions_mutex{};
+  std::unordered_map<p4_pd_sess_hdl_t, Pipelines> sessions{};
 };
 
 namespace detail {
@@ -104,42 +309,28 @@ template <typename... Args> struct Connector;
 
 template <>
 struct Connector<> {
-  static int connect(ClientState *cstate, int thrift_port_num,
-                     std::vector<std::string>::iterator it) {
-    (void) cstate; (void) thrift_port_num; (void) it;
-    return 0;
+  static void connect(
+      Connection *conn,
+      boost::shared_ptr<::thrift_provider::protocol::TProtocol> protocol,
+      std::vector<std::string>::iterator it) {
+    (void) conn; (void) protocol; (void) it;
   }
 };
 
 template <typename A, typename... Args>
 struct Connector<A, Args...> {
-  static int connect(ClientState *cstate, int thrift_port_num,
-                      std::vector<std::string>::iterator it) {
-    using namespace ::thrift_provider;  // NOLINT(build/namespaces)
-    using namespace ::thrift_provider::protocol;  // NOLINT(build/namespaces)
-    using namespace ::thrift_provider::transport;  // NOLINT(build/namespaces)
-
-    boost::shared_ptr<TTransport> socket(
-        new TSocket("localhost", thrift_port_num));
-    boost::shared_ptr<TTransport> transport(new TBufferedTransport(socket));
-    boost::shared_ptr<TProtocol> protocol(new TBinaryProtocol(transport));
+  static void connect(
+      Connection *conn,
+      boost::shared_ptr<::thrift_provider::protocol::TProtocol> protocol,
+      std::vector<std::string>::iterator it) {
+    using ::thrift_provider::protocol::TMultiplexedProtocol;
 
     boost::shared_ptr<TMultiplexedProtocol> sub_protocol(
         new TMultiplexedProtocol(protocol, *it));
 
-    cstate->transport = transport;
-    cstate->ptrs.push_back(static_cast<void *>(new A(sub_protocol)));
-
-    try {
-      transport->open();
-    }
-    catch (TException& tx) {
-      std::cout << "Could not connect to port " << thrift_port_num
-                << "(device " << cstate->dev_id << ")" << std::endl;
-      return 1;
-    }
+    conn->ptrs.push_back(static_cast<void *>(new A(sub_protocol)));
 
-    return Connector<Args...>::connect(cstate, thrift_port_num, ++it);
+    Connector<Args...>::connect(conn, protocol, ++it);
   }
 };
 
@@ -147,17 +338,19 @@ template <typename... Args> struct Cleaner;
 
 template <>
 struct Cleaner<> {
-  static void clean(ClientState *cstate) {
-    assert(cstate->ptrs.empty());
+  static void clean(Connection *conn) {
+    (void) conn;
   }
 };
 
+// the clients were pushed in the order of the types, so they are popped in the
+// reverse order
 template <typename A, typename... Args>
 struct Cleaner<A, Args...> {
-  static void clean(ClientState *cstate) {
-    delete static_cast<A *>(cstate->ptrs.back());
-    cstate->ptrs.pop_back();
-    Cleaner<Args...>::clean(cstate);
+  static void clean(Connection *conn) {
+    Cleaner<Args...>::clean(conn);
+    delete static_cast<A *>(conn->ptrs.back());
+    conn->ptrs.pop_back();
   }
 };
 
@@ -191,21 +384,83 @@ struct PdConnMgr_ : public PdConnMgr {
   int client_init(int dev_id, int thrift_port_num) override {
     auto &cstate = clients[dev_id];
     cstate.dev_id = dev_id;
-    assert(cstate.ptrs.empty());
-    return Connector<Args...>::connect(&cstate, thrift_port_num,
-                                       names_.begin());
+    cstate.thrift_port_num = thrift_port_num;
+    cstate.framed = use_framed;
+    cstate.compact = use_compact;
+    assert(cstate.connections.empty());
+    for (size_t i = 0; i < pool_size; i++) {
+      std::unique_ptr<Connection> conn(new Connection());
+      if (connect(conn.get(), cstate) != 0) {
+        // close the connections which were already opened, so that
+        // client_init() can be called again for this device
+        client_close(dev_id);
+        return 1;
+      }
+      cstate.connections.push_back(std::move(conn));
+    }
+    return 0;
   }
 
   int client_close(int dev_id) override {
     auto &cstate = clients[dev_id];
-    assert(cstate.ptrs.size() == sizeof...(Args));
-    cstate.transport->close();
-    cstate.transport = nullptr;
-    Cleaner<Args...>::clean(&cstate);
-    assert(cstate.ptrs.empty());
+    for (auto &conn : cstate.connections) disconnect(conn.get());
+    cstate.connections.clear();
     return 0;
   }
 
+ protected:
+  std::shared_ptr<Connection> open_connection(int dev_id) override {
+    std::shared_ptr<Connection> conn(
+        new Connection(), [](Connection *c) {
+          disconnect(c);
+          delete c;
+        });
+    if (connect(conn.get(), clients[dev_id]) != 0) return nullptr;
+    return conn;
+  }
+
+ private:
+  int connect(Connection *conn, const ClientState &cstate) {
+    using namespace ::thrift_provider;  // NOLINT(build/namespaces)
+    using namespace ::thrift_provider::protocol;  // NOLINT(build/namespaces)
+    using namespace ::thrift_provider::transport;  // NOLINT(build/namespaces)
+
+    boost::shared_ptr<TTransport> socket(
+        new TSocket("localhost", cstate.thrift_port_num));
+    boost::shared_ptr<TTransport> transport;
+    if (cstate.framed)
+      transport.reset(new TFramedTransport(socket));
+    else
+      transport.reset(new TBufferedTransport(socket));
+    boost::shared_ptr<TProtocol> protocol;
+    if (cstate.compact)
+      protocol.reset(new TCompactProtocol(transport));
+    else
+      protocol.reset(new TBinaryProtocol(transport));
+    conn->transport = transport;
+    Connector<Args...>::connect(conn, protocol, names_.begin());
+
+    try {
+      transport->open();
+    }
+    catch (TException& tx) {
+      std::cout << "Could not connect to port " << cstate.thrift_port_num
+                << "(device " << cstate.dev_id << ")" << std::endl;
+      disconnect(conn);
+      return 1;
+    }
+    return 0;
+  }
+
+  static void disconnect(Connection *conn) {
+    if (!conn->transport) return;
+    assert(conn->ptrs.size() == sizeof...(Args));
+    conn->transport->close();
+    conn->transport = nullptr;
+    Cleaner<Args...>::clean(conn);
+    assert(conn->ptrs.empty());
+  }
+
  private:
   std::vector<std::string> names_{};
 };
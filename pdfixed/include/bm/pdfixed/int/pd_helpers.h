@@ -25,9 +25,15 @@
 
 #include <bm/pdfixed/pd_common.h>
 
+#include <string>
 #include <vector>
 
 using ::bm_runtime::standard::BmMeterRateConfig;
+using ::bm_runtime::standard::BmMatchParams;
+using ::bm_runtime::standard::BmActionData;
+using ::bm_runtime::standard::BmAddEntryOptions;
+using ::bm_runtime::standard::BmMemberHandle;
+using ::bm_runtime::standard::BmGroupHandle;
 
 std::vector<BmMeterRateConfig>
 pd_bytes_meter_spec_to_rates(p4_pd_bytes_meter_spec_t *meter_spec);
@@ -35,4 +41,35 @@ pd_bytes_meter_spec_to_rates(p4_pd_bytes_meter_spec_t *meter_spec);
 std::vector<BmMeterRateConfig>
 pd_packets_meter_spec_to_rates(p4_pd_packets_meter_spec_t *meter_spec);
 
+// Asynchronous versions of the table add calls, for the P4-dependent PD: the
+// request is sent to the switch without waiting for the response, which is
+// read by the next p4_pd_complete_operations() call for the session. This is
+// when the handle is written to *entry_hdl (which must remain valid until
+// then) and when errors are reported. If no connection is available for the
+// session, the call completes synchronously.
+p4_pd_status_t
+pd_mt_add_entry_async(p4_pd_sess_hdl_t sess_hdl, int dev_id,
+                      const std::string &table_name,
+                      const BmMatchParams &match_key,
+                      const std::string &action_name,
+                      const BmActionData &action_data,
+                      const BmAddEntryOptions &options,
+                      p4_pd_entry_hdl_t *entry_hdl);
+
+p4_pd_status_t
+pd_mt_indirect_add_entry_async(p4_pd_sess_hdl_t sess_hdl, int dev_id,
+                               const std::string &table_name,
+                               const BmMatchParams &match_key,
+                               BmMemberHandle mbr_hdl,
+                               const BmAddEntryOptions &options,
+                               p4_pd_entry_hdl_t *entry_hdl);
+
+p4_pd_status_t
+pd_mt_indirect_ws_add_entry_async(p4_pd_sess_hdl_t sess_hdl, int dev_id,
+                                  const std::string &table_name,
+                                  const BmMatchParams &match_key,
+                                  BmGroupHandle grp_hdl,
+                                  const BmAddEntryOptions &options,
+                                  p4_pd_entry_hdl_t *entry_hdl);
+
 #endif  // BM_PDFIXED_INT_PD_HELPERS_H_
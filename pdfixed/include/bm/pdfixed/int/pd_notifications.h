@@ -21,12 +21,39 @@
 #ifndef BM_PDFIXED_INT_PD_NOTIFICATIONS_H_
 #define BM_PDFIXED_INT_PD_NOTIFICATIONS_H_
 
+#include <functional>
+#include <vector>
+
+// defined in <bm/bm_apps/nn_msg_dispatcher.h>, which callers of the batch
+// version of pd_notifications_add_device need to include; not included here so
+// that this header does not expose nanomsg
+namespace bm_apps {
+
+struct NnMsg;
+
+}  // namespace bm_apps
+
 typedef void (*NotificationCb)(const char *hdr, const char *data);
 
+// Zero-copy delivery: the callback is given consecutive notifications of the
+// same type, each one in the nanomsg buffer in which it was received (the
+// 32-byte header followed by the data), and takes ownership of them.
+typedef std::function<void(std::vector<bm_apps::NnMsg> &&msgs)>
+    NotificationBatchCb;
+
 int pd_notifications_add_device(int dev_id, const char *notifications_addr,
                                 NotificationCb ageing_cb,
                                 NotificationCb learning_cb);
 
+// With nb_workers > 0, the callbacks are invoked by nb_workers threads instead
+// of by the receiving thread, so that slow callbacks do not delay the
+// reception of notifications. Up to max_batch notifications are passed to each
+// callback invocation.
+int pd_notifications_add_device(int dev_id, const char *notifications_addr,
+                                NotificationBatchCb ageing_cb,
+                                NotificationBatchCb learning_cb,
+                                size_t nb_workers, size_t max_batch);
+
 int pd_notifications_remove_device(int dev_id);
 
 #endif  // BM_PDFIXED_INT_PD_NOTIFICATIONS_H_
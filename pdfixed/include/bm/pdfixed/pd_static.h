@@ -33,6 +33,31 @@ p4_pd_init(void);
 void
 p4_pd_cleanup(void);
 
+// Number of Thrift connections opened to each device by the next calls to
+// p4_pd_<prog>_assign_device (default 4). Threads issuing PD calls to the same
+// device concurrently use different connections.
+p4_pd_status_t
+p4_pd_set_connections_per_device(unsigned int nb_connections);
+
+typedef enum {
+  PD_THRIFT_TRANSPORT_BUFFERED = 0,
+  PD_THRIFT_TRANSPORT_FRAMED,
+} p4_pd_thrift_transport_t;
+
+typedef enum {
+  PD_THRIFT_PROTOCOL_BINARY = 0,
+  PD_THRIFT_PROTOCOL_COMPACT,
+} p4_pd_thrift_protocol_t;
+
+// Thrift transport and protocol used to connect to the devices by the next
+// calls to p4_pd_<prog>_assign_device (default buffered / binary). They must
+// match the options the switch was started with: the framed transport for
+// `--thrift-server nonblocking` and the compact protocol for
+// `--thrift-protocol compact`.
+p4_pd_status_t
+p4_pd_set_thrift_options(p4_pd_thrift_transport_t transport,
+                         p4_pd_thrift_protocol_t protocol);
+
 p4_pd_status_t
 p4_pd_client_init(p4_pd_sess_hdl_t *sess_hdl);
 
@@ -51,6 +76,8 @@ p4_pd_abort_txn(p4_pd_sess_hdl_t shdl);
 p4_pd_status_t
 p4_pd_commit_txn(p4_pd_sess_hdl_t shdl, bool hwSynchronous);
 
+// Waits for the completion of the pipelined operations issued with the
+// session, e.g. asynchronous table adds, and returns the first error.
 p4_pd_status_t
 p4_pd_complete_operations(p4_pd_sess_hdl_t shdl);
 
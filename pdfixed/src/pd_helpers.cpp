@@ -21,8 +21,42 @@
 #include <bm/pdfixed/int/pd_helpers.h>
 #include <bm/pdfixed/int/pd_conn_mgr.h>
 
+#include <string>
 #include <vector>
 
+using ::bm_runtime::standard::StandardClient;
+using ::bm_runtime::standard::InvalidTableOperation;
+
+extern PdConnMgr *conn_mgr_state;
+
+namespace {
+
+// Send and Recv call the generated send_* and recv_* methods for the add
+template <typename Send, typename Recv>
+p4_pd_status_t
+pipelined_add(p4_pd_sess_hdl_t sess_hdl, int dev_id, const Send &send,
+              const Recv &recv, p4_pd_entry_hdl_t *entry_hdl) {
+  auto read_handle = [recv, entry_hdl](StandardClient *c) -> p4_pd_status_t {
+    try {
+      *entry_hdl = recv(c);
+    } catch (InvalidTableOperation &ito) {
+      return ito.code;
+    }
+    return 0;
+  };
+  auto *pipeline = conn_mgr_state->get_pipeline<StandardClient>(sess_hdl,
+                                                                dev_id);
+  if (pipeline) {
+    pipeline->call(send, read_handle);
+    return 0;
+  }
+  auto client = conn_mgr_state->get<StandardClient>(dev_id);
+  send(client.c);
+  return read_handle(client.c);
+}
+
+}  // namespace
+
 std::vector<BmMeterRateConfig>
 pd_bytes_meter_spec_to_rates(p4_pd_bytes_meter_spec_t *meter_spec) {
   double info_rate;
@@ -65,3 +99,55 @@ pd_packets_meter_spec_to_rates(p4_pd_packets_meter_spec_t *meter_spec) {
 
   return rates;
 }
+
+p4_pd_status_t
+pd_mt_add_entry_async(p4_pd_sess_hdl_t sess_hdl, int dev_id,
+                      const std::string &table_name,
+                      const BmMatchParams &match_key,
+                      const std::string &action_name,
+                      const BmActionData &action_data,
+                      const BmAddEntryOptions &options,
+                      p4_pd_entry_hdl_t *entry_hdl) {
+  return pipelined_add(
+      sess_hdl, dev_id,
+      [&](StandardClient *c) {
+        c->send_bm_mt_add_entry(0, table_name, match_key, action_name,
+                                action_data, options);
+      },
+      [](StandardClient *c) { return c->recv_bm_mt_add_entry(); },
+      entry_hdl);
+}
+
+p4_pd_status_t
+pd_mt_indirect_add_entry_async(p4_pd_sess_hdl_t sess_hdl, int dev_id,
+                               const std::string &table_name,
+                               const BmMatchParams &match_key,
+                               BmMemberHandle mbr_hdl,
+                               const BmAddEntryOptions &options,
+                               p4_pd_entry_hdl_t *entry_hdl) {
+  return pipelined_add(
+      sess_hdl, dev_id,
+      [&](StandardClient *c) {
+        c->send_bm_mt_indirect_add_entry(0, table_name, match_key, mbr_hdl,
+                                         options);
+      },
+      [](StandardClient *c) { return c->recv_bm_mt_indirect_add_entry(); },
+      entry_hdl);
+}
+
+p4_pd_status_t
+pd_mt_indirect_ws_add_entry_async(p4_pd_sess_hdl_t sess_hdl, int dev_id,
+                                  const std::string &table_name,
+                                  const BmMatchParams &match_key,
+                                  BmGroupHandle grp_hdl,
+                                  const BmAddEntryOptions &options,
+                                  p4_pd_entry_hdl_t *entry_hdl) {
+  return pipelined_add(
+      sess_hdl, dev_id,
+      [&](StandardClient *c) {
+        c->send_bm_mt_indirect_ws_add_entry(0, table_name, match_key, grp_hdl,
+                                            options);
+      },
+      [](StandardClient *c) { return c->recv_bm_mt_indirect_ws_add_entry(); },
+      entry_hdl);
+}
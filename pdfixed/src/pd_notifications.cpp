@@ -18,29 +18,39 @@
  *
  */
 
+#include <bm/bm_apps/nn_msg_dispatcher.h>
 #include <bm/bm_sim/nn.h>
 #include <bm/pdfixed/int/pd_notifications.h>
 
 #include <nanomsg/pubsub.h>
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <thread>
 #include <mutex>
 #include <map>
-#include <type_traits>
 #include <functional>
 #include <cstring>
+#include <utility>
+#include <vector>
 
 #define NUM_DEVICES 256
 
 namespace {
 
+using bm_apps::NnMsg;
+using bm_apps::NnMsgDispatcher;
+
+// all notification headers have size 32 bytes, padded at the end if needed
+constexpr size_t hdr_size = 32;
+
 class NotificationsListener {
  public:
-  typedef std::function<void(const char *hdr, const char *data)> NotificationCb;
-
-  NotificationsListener(int dev_id, const char *nn_addr)
-      : dev_id(dev_id), s(AF_SP, NN_SUB) {
+  NotificationsListener(int dev_id, const char *nn_addr, size_t nb_workers,
+                        size_t max_batch)
+      : dev_id(dev_id), s(AF_SP, NN_SUB), nb_workers(nb_workers),
+        max_batch(max_batch) {
     if (nn_addr) {
       strncpy(addr, nn_addr, sizeof(addr));
       enabled = true;
@@ -56,12 +66,12 @@ class NotificationsListener {
     receiver_thread.join();
   }
 
-  void register_ageing_cb(const NotificationCb &cb) {
+  void register_ageing_cb(const NotificationBatchCb &cb) {
     std::unique_lock<std::mutex> lock(mutex);
     age_cb = cb;
   }
 
-  void register_learning_cb(const NotificationCb &cb) {
+  void register_learning_cb(const NotificationBatchCb &cb) {
     std::unique_lock<std::mutex> lock(mutex);
     learn_cb = cb;
   }
@@ -70,8 +80,10 @@ class NotificationsListener {
     std::unique_lock<std::mutex> lock(mutex);
     if (!enabled) return;
     if (started || stop_required) return;
-    // subscribe to all notifications
-    s.setsockopt(NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    // only subscribe to the notifications we can handle (e.g. not to the
+    // table change notifications)
+    s.setsockopt(NN_SUB, NN_SUB_SUBSCRIBE, "AGE|", 4);
+    s.setsockopt(NN_SUB, NN_SUB_SUBSCRIBE, "LEA|", 4);
     int rcv_timeout_ms = 200;
     s.setsockopt(NN_SOL_SOCKET, NN_RCVTIMEO,
                  &rcv_timeout_ms, sizeof(rcv_timeout_ms));
@@ -82,80 +94,102 @@ class NotificationsListener {
 
   void receive_loop() {
     (void) dev_id;
-    struct nn_msghdr msghdr;
-    struct nn_iovec iov[2];
-    // all notification headers have size 32 bytes, padded at the end if needed
-    std::aligned_storage<32>::type storage;
-    char data[4096];
-    iov[0].iov_base = reinterpret_cast<char *>(&storage);
-    iov[0].iov_len = sizeof(storage);
-    iov[1].iov_base = data;
-    iov[1].iov_len = sizeof(data);  // apparently only max size needed ?
-    memset(&msghdr, 0, sizeof(msghdr));
-    msghdr.msg_iov = iov;
-    msghdr.msg_iovlen = 2;
-
-    while (true) {
-      if (s.recvmsg(&msghdr, 0) <= 0) {
-          std::unique_lock<std::mutex> lock(mutex);
-          if (stop_required) return;
-          continue;
-      }
-
-      const char *hdr = reinterpret_cast<char *>(&storage);
-      if (!memcmp("AGE|", hdr, 4)) {
-        std::cout << "Received ageing notification\n";
-        if (!age_cb) {
-          std::cout << "No cb registered\n";
-          continue;
-        }
-        NotificationCb cb;
-        {
-          std::unique_lock<std::mutex> lock(mutex);
-          cb = age_cb;
-        }
-        cb(hdr, data);
-      } else if (!memcmp("LEA|", hdr, 4)) {
-        std::cout << "Received learning notification\n";
-        if (!learn_cb) {
-          std::cout << "No cb registered\n";
-          continue;
-        }
-        NotificationCb cb;
-        {
-          std::unique_lock<std::mutex> lock(mutex);
-          cb = learn_cb;
-        }
-        cb(hdr, data);
-
-      } else {
-        std::cout << "Unknow notification type\n";
-      }
-    }
+    NnMsgDispatcher dispatcher(
+        nb_workers, max_batch,
+        [this](NnMsgDispatcher::Batch batch) {
+          handle_batch(std::move(batch));
+        });
+    dispatcher.receive_loop(&s, [this]() {
+      std::unique_lock<std::mutex> lock(mutex);
+      return stop_required;
+    });
   }
 
  private:
+  enum class NotificationType { AGEING, LEARNING, UNKNOWN };
+
+  static NotificationType get_type(const NnMsg &msg) {
+    if (msg.size < hdr_size) return NotificationType::UNKNOWN;
+    if (!memcmp("AGE|", msg.buffer.get(), 4)) return NotificationType::AGEING;
+    if (!memcmp("LEA|", msg.buffer.get(), 4))
+      return NotificationType::LEARNING;
+    return NotificationType::UNKNOWN;
+  }
+
+  // splits the batch into runs of consecutive notifications of the same type
+  void handle_batch(NnMsgDispatcher::Batch batch) {
+    auto it = batch.begin();
+    while (it != batch.end()) {
+      auto type = get_type(*it);
+      auto run_end = std::find_if(it, batch.end(), [type](const NnMsg &msg) {
+          return get_type(msg) != type; });
+      std::vector<NnMsg> msgs(std::make_move_iterator(it),
+                              std::make_move_iterator(run_end));
+      deliver(type, std::move(msgs));
+      it = run_end;
+    }
+  }
+
+  void deliver(NotificationType type, std::vector<NnMsg> &&msgs) {
+    if (type == NotificationType::UNKNOWN) {
+      std::cout << "Unknow notification type\n";
+      return;
+    }
+    NotificationBatchCb cb;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      cb = (type == NotificationType::AGEING) ? age_cb : learn_cb;
+    }
+    if (!cb) {
+      std::cout << "No cb registered\n";
+      return;
+    }
+    cb(std::move(msgs));
+  }
+
   int dev_id;
   bool enabled{false};
   char addr[128];
   nn::socket s;
+  size_t nb_workers;
+  size_t max_batch;
   bool started{false};
   bool stop_required{false};
   std::thread receiver_thread{};
   mutable std::mutex mutex{};
-  NotificationCb age_cb{};
-  NotificationCb learn_cb{};
+  NotificationBatchCb age_cb{};
+  NotificationBatchCb learn_cb{};
 };
 
 NotificationsListener *listeners[NUM_DEVICES];
 
+// calls cb once per notification, with a pointer to its header and a pointer
+// to its data
+NotificationBatchCb to_batch_cb(NotificationCb cb) {
+  if (!cb) return nullptr;
+  return [cb](std::vector<NnMsg> &&msgs) {
+    for (const auto &msg : msgs)
+      cb(msg.buffer.get(), msg.buffer.get() + hdr_size);
+  };
+}
+
 }  // namespace
 
 int pd_notifications_add_device(int dev_id, const char *notifications_addr,
                                 NotificationCb ageing_cb,
                                 NotificationCb learning_cb) {
+  return pd_notifications_add_device(dev_id, notifications_addr,
+                                     to_batch_cb(ageing_cb),
+                                     to_batch_cb(learning_cb), 0, 1);
+}
+
+int pd_notifications_add_device(int dev_id, const char *notifications_addr,
+                                NotificationBatchCb ageing_cb,
+                                NotificationBatchCb learning_cb,
+                                size_t nb_workers, size_t max_batch) {
   assert(!listeners[dev_id]);
-  listeners[dev_id] = new NotificationsListener(dev_id, notifications_addr);
+  listeners[dev_id] = new NotificationsListener(
+      dev_id, notifications_addr, nb_workers, max_batch);
   listeners[dev_id]->register_ageing_cb(ageing_cb);
   listeners[dev_id]->register_learning_cb(learning_cb);
   listeners[dev_id]->start();
@@ -25,11 +25,13 @@
 #include <bm/pdfixed/pd_static.h>
 #include <bm/pdfixed/int/pd_conn_mgr.h>
 
+#include <atomic>
+
 using ::bm_runtime::standard::StandardClient;
 using ::bm_runtime::simple_pre_lag::SimplePreLAGClient;
 using ::sswitch_runtime::SimpleSwitchClient;
 
-static uint64_t session_hdl = 0;
+static std::atomic<p4_pd_sess_hdl_t> session_hdl{0};
 
 PdConnMgr *conn_mgr_state;
 
@@ -48,6 +50,21 @@ p4_pd_cleanup(void) {
   delete conn_mgr_state;
 }
 
+p4_pd_status_t
+p4_pd_set_connections_per_device(unsigned int nb_connections) {
+  conn_mgr_state->set_pool_size(nb_connections);
+  return 0;
+}
+
+p4_pd_status_t
+p4_pd_set_thrift_options(p4_pd_thrift_transport_t transport,
+                         p4_pd_thrift_protocol_t protocol) {
+  conn_mgr_state->set_thrift_options(
+      transport == PD_THRIFT_TRANSPORT_FRAMED,
+      protocol == PD_THRIFT_PROTOCOL_COMPACT);
+  return 0;
+}
+
 p4_pd_status_t
 p4_pd_client_init(p4_pd_sess_hdl_t *sess_hdl) {
   *sess_hdl = session_hdl++;
@@ -56,8 +73,7 @@ p4_pd_client_init(p4_pd_sess_hdl_t *sess_hdl) {
 
 p4_pd_status_t
 p4_pd_client_cleanup(p4_pd_sess_hdl_t sess_hdl) {
-  (void) sess_hdl;
-  return 0;
+  return conn_mgr_state->close_session(sess_hdl);
 }
 
 p4_pd_status_t
@@ -86,8 +102,7 @@ p4_pd_commit_txn(p4_pd_sess_hdl_t shdl, bool hwSynchronous) {
 
 p4_pd_status_t
 p4_pd_complete_operations(p4_pd_sess_hdl_t shdl) {
-  (void) shdl;
-  return 0;
+  return conn_mgr_state->complete_operations(shdl);
 }
 
 }
@@ -42,8 +42,11 @@ namespace thrift_provider = apache::thrift;
 
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <cassert>
+#include <cstring>
 
 #include "nn.h"
 
@@ -67,24 +70,33 @@ typedef struct {
 
 LearnListener::LearnListener(const std::string &learn_socket,
                              const std::string &thrift_addr,
-                             const int thrift_port)
+                             const int thrift_port,
+                             size_t nb_workers, size_t max_batch)
   : socket_name(learn_socket),
-    thrift_addr(thrift_addr), thrift_port(thrift_port) {
-  (void) this->thrift_port;  // clang unused private field warning
-}
+    thrift_addr(thrift_addr), thrift_port(thrift_port),
+    nb_workers(nb_workers), max_batch(max_batch) { }
 
 LearnListener::~LearnListener() {
   {
     std::unique_lock<std::mutex> lock(mutex);
-    stop_listen_thread = false;
+    stop_listen_thread = true;
   }
-  listen_thread.join();
+  if (listen_thread.joinable()) listen_thread.join();
 }
 
 void
 LearnListener::register_cb(const LearnCb &cb, void *cookie) {
   std::unique_lock<std::mutex> lock(mutex);
   cb_fn = cb;
+  batch_cb_fn = nullptr;
+  cb_cookie = cookie;
+}
+
+void
+LearnListener::register_batch_cb(const LearnBatchCb &cb, void *cookie) {
+  std::unique_lock<std::mutex> lock(mutex);
+  batch_cb_fn = cb;
+  cb_fn = nullptr;
   cb_cookie = cookie;
 }
 
@@ -104,7 +116,7 @@ LearnListener::start() {
   using thrift_provider::transport::TTransport;
   using thrift_provider::transport::TBufferedTransport;
 
-  boost::shared_ptr<TTransport> tsocket(new TSocket("localhost", 9090));
+  boost::shared_ptr<TTransport> tsocket(new TSocket(thrift_addr, thrift_port));
   boost::shared_ptr<TTransport> transport(new TBufferedTransport(tsocket));
   boost::shared_ptr<TProtocol> protocol(new TBinaryProtocol(transport));
 
@@ -128,46 +140,54 @@ LearnListener::listen_loop() {
   s.setsockopt(NN_SOL_SOCKET, NN_RCVTIMEO, &to, sizeof(to));
   s.connect(socket_name.c_str());
 
-  struct nn_msghdr msghdr;
-  struct nn_iovec iov[2];
-  learn_hdr_t learn_hdr;
-  char data[4096];
-  iov[0].iov_base = &learn_hdr;
-  iov[0].iov_len = sizeof(learn_hdr);
-  iov[1].iov_base = data;
-  iov[1].iov_len = sizeof(data);  // apparently only max size needed ?
-  memset(&msghdr, 0, sizeof(msghdr));
-  msghdr.msg_iov = iov;
-  msghdr.msg_iovlen = 2;
-
-  while (true) {
-    if (s.recvmsg(&msghdr, 0) <= 0) {
-      std::unique_lock<std::mutex> lock(mutex);
-      if (stop_listen_thread) return;
-      continue;
-    }
-
-    LearnCb cb_fn_;
-    void *cb_cookie_;
-    std::cout << "I received " << learn_hdr.num_samples << " samples\n";
-
-    {
-      std::unique_lock<std::mutex> lock(mutex);
-      // I don't believe this is expensive
-      cb_fn_ = cb_fn;
-      cb_cookie_ = cb_cookie;
-    }
-
-    if (!cb_fn_) {
-      std::cout << "No callback\n";
-      continue;
-    }
-
-    std::cout << "Calling callback function\n";
+  // destroyed before the socket, once all the received notifications have
+  // been handled
+  NnMsgDispatcher dispatcher(
+      nb_workers, max_batch,
+      [this](NnMsgDispatcher::Batch batch) {
+        handle_batch(std::move(batch));
+      });
+  dispatcher.receive_loop(&s, [this]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    return stop_listen_thread;
+  });
+}
+
+void
+LearnListener::handle_batch(NnMsgDispatcher::Batch batch) {
+  LearnCb cb_fn_;
+  LearnBatchCb batch_cb_fn_;
+  void *cb_cookie_;
+
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    // once per batch, not per notification
+    cb_fn_ = cb_fn;
+    batch_cb_fn_ = batch_cb_fn;
+    cb_cookie_ = cb_cookie;
+  }
+
+  if (!cb_fn_ && !batch_cb_fn_) {
+    std::cout << "No callback\n";
+    return;
+  }
+
+  std::vector<Msg> msgs;
+  msgs.reserve(batch.size());
+  for (auto &nn_msg : batch) {
+    if (nn_msg.size < sizeof(learn_hdr_t)) continue;
+    learn_hdr_t learn_hdr;
+    memcpy(&learn_hdr, nn_msg.buffer.get(), sizeof(learn_hdr));
+    const char *data = nn_msg.buffer.get() + sizeof(learn_hdr);
     MsgInfo info = {learn_hdr.switch_id, learn_hdr.cxt_id, learn_hdr.list_id,
                     learn_hdr.buffer_id, learn_hdr.num_samples};
-    cb_fn_(info, data, cb_cookie_);
+    if (cb_fn_)
+      cb_fn_(info, data, cb_cookie_);
+    else
+      msgs.push_back({info, data, std::move(nn_msg)});
   }
+
+  if (batch_cb_fn_ && !msgs.empty()) batch_cb_fn_(std::move(msgs), cb_cookie_);
 }
 
 }  // namespace bm_apps
@@ -22,7 +22,10 @@
 
 #include <bm/bm_sim/switch.h>
 #include <bm/bm_sim/logger.h>
+#include <bm/bm_sim/packet_tracer.h>
+#include <bm/bm_sim/perf_counters.h>
 
+#include <algorithm>
 #include <functional>
 
 namespace bm_runtime { namespace standard {
@@ -83,6 +86,8 @@ public:
       return TableOperationErrorCode::DEFAULT_ENTRY_IS_CONST;
       case MatchErrorCode::NO_DEFAULT_ENTRY:
       return TableOperationErrorCode::NO_DEFAULT_ENTRY;
+    case MatchErrorCode::CHANGES_UNAVAILABLE:
+      return TableOperationErrorCode::CHANGES_UNAVAILABLE;
     case MatchErrorCode::ERROR:
       return TableOperationErrorCode::ERROR;
     default:
@@ -565,6 +570,62 @@ public:
     }
   }
 
+  template <typename M,
+            MatchErrorCode (RuntimeInterface::*GetFn)(
+                size_t, const std::string &, size_t, size_t,
+                std::vector<typename M::Entry> *, size_t *) const>
+  void get_entries_page_common(size_t cxt_id, const std::string &table_name,
+                               int64_t cursor, int32_t max_entries,
+                               BmMtEntriesPage &_return) {
+    std::vector<typename M::Entry> entries;
+    size_t next_cursor;
+    auto rc = std::bind(GetFn, switch_, cxt_id, table_name,
+                        static_cast<size_t>(cursor),
+                        static_cast<size_t>(std::max(max_entries, 1)),
+                        &entries, &next_cursor)();
+    if(rc != MatchErrorCode::SUCCESS) {
+      InvalidTableOperation ito;
+      ito.code = get_exception_code(rc);
+      throw ito;
+    }
+    _return.entries.reserve(entries.size());
+    for (const auto &entry : entries) {
+      BmMtEntry e;
+      copy_match_part_entry(&e, entry);
+      build_action_entry(&e.action_entry, entry);
+      _return.entries.push_back(std::move(e));
+    }
+    _return.next_cursor = static_cast<int64_t>(next_cursor);
+  }
+
+  void bm_mt_get_entries_page(BmMtEntriesPage& _return, const int32_t cxt_id, const std::string& table_name, const int64_t cursor, const int32_t max_entries) {
+    Logger::get()->trace("bm_mt_get_entries_page");
+    switch (switch_->mt_get_type(cxt_id, table_name)) {
+      case MatchTableType::NONE:
+        {
+          InvalidTableOperation ito;
+          ito.code = TableOperationErrorCode::INVALID_TABLE_NAME;
+          throw ito;
+        }
+      case MatchTableType::SIMPLE:
+        get_entries_page_common<MatchTable,
+                                &RuntimeInterface::mt_get_entries_page>(
+            cxt_id, table_name, cursor, max_entries, _return);
+        break;
+      case MatchTableType::INDIRECT:
+        get_entries_page_common<
+          MatchTableIndirect, &RuntimeInterface::mt_indirect_get_entries_page>(
+              cxt_id, table_name, cursor, max_entries, _return);
+        break;
+      case MatchTableType::INDIRECT_WS:
+        get_entries_page_common<
+          MatchTableIndirectWS,
+          &RuntimeInterface::mt_indirect_ws_get_entries_page>(
+              cxt_id, table_name, cursor, max_entries, _return);
+        break;
+    }
+  }
+
   void bm_mt_get_entry(BmMtEntry& _return, const int32_t cxt_id, const std::string& table_name, const BmEntryHandle entry_handle) {
     Logger::get()->trace("bm_mt_get_entry");
     switch (switch_->mt_get_type(cxt_id, table_name)) {
@@ -587,6 +648,72 @@ public:
     }
   }
 
+  int64_t bm_mt_get_change_seq(const int32_t cxt_id, const std::string& table_name) {
+    Logger::get()->trace("bm_mt_get_change_seq");
+    MatchTableAbstract::seq_t seq;
+    auto rc = switch_->mt_get_change_seq(cxt_id, table_name, &seq);
+    if(rc != MatchErrorCode::SUCCESS) {
+      InvalidTableOperation ito;
+      ito.code = get_exception_code(rc);
+      throw ito;
+    }
+    return static_cast<int64_t>(seq);
+  }
+
+  template <typename M,
+            MatchErrorCode (RuntimeInterface::*GetFn)(
+                size_t, const std::string &, MatchTableAbstract::seq_t,
+                typename M::Changes *) const>
+  void get_entries_since_common(size_t cxt_id, const std::string &table_name,
+                                int64_t seq, BmMtChanges &_return) {
+    typename M::Changes changes;
+    auto rc = std::bind(GetFn, switch_, cxt_id, table_name,
+                        static_cast<MatchTableAbstract::seq_t>(seq),
+                        &changes)();
+    if(rc != MatchErrorCode::SUCCESS) {
+      InvalidTableOperation ito;
+      ito.code = get_exception_code(rc);
+      throw ito;
+    }
+    for (const auto &entry : changes.entries) {
+      BmMtEntry e;
+      copy_match_part_entry(&e, entry);
+      build_action_entry(&e.action_entry, entry);
+      _return.entries.push_back(std::move(e));
+    }
+    _return.deleted.assign(changes.deleted.begin(), changes.deleted.end());
+    _return.default_entry_changed = changes.default_entry_changed;
+    _return.last_seq = static_cast<int64_t>(changes.last_seq);
+  }
+
+  void bm_mt_get_entries_since(BmMtChanges& _return, const int32_t cxt_id, const std::string& table_name, const int64_t seq) {
+    Logger::get()->trace("bm_mt_get_entries_since");
+    switch (switch_->mt_get_type(cxt_id, table_name)) {
+      case MatchTableType::NONE:
+        {
+          InvalidTableOperation ito;
+          ito.code = TableOperationErrorCode::INVALID_TABLE_NAME;
+          throw ito;
+        }
+      case MatchTableType::SIMPLE:
+        get_entries_since_common<MatchTable,
+                                 &RuntimeInterface::mt_get_entries_since>(
+            cxt_id, table_name, seq, _return);
+        break;
+      case MatchTableType::INDIRECT:
+        get_entries_since_common<
+          MatchTableIndirect, &RuntimeInterface::mt_indirect_get_entries_since>(
+              cxt_id, table_name, seq, _return);
+        break;
+      case MatchTableType::INDIRECT_WS:
+        get_entries_since_common<
+          MatchTableIndirectWS,
+          &RuntimeInterface::mt_indirect_ws_get_entries_since>(
+              cxt_id, table_name, seq, _return);
+        break;
+    }
+  }
+
   template <typename M,
             MatchErrorCode (RuntimeInterface::*GetFn)(
                 size_t, const std::string &, typename M::Entry *) const>
@@ -644,6 +771,28 @@ public:
     }
   }
 
+  void bm_mt_indirect_get_members_page(BmMtIndirectMembersPage& _return, const int32_t cxt_id, const std::string& table_name, const int64_t cursor, const int32_t max_members) {
+    Logger::get()->trace("bm_mt_indirect_get_members_page");
+    std::vector<MatchTableIndirect::Member> members;
+    size_t next_cursor;
+    auto rc = switch_->mt_indirect_get_members_page(
+        cxt_id, table_name, static_cast<size_t>(cursor),
+        static_cast<size_t>(std::max(max_members, 1)), &members,
+        &next_cursor);
+    if(rc != MatchErrorCode::SUCCESS) {
+      InvalidTableOperation ito;
+      ito.code = get_exception_code(rc);
+      throw ito;
+    }
+    _return.members.reserve(members.size());
+    for (const auto &member : members) {
+      BmMtIndirectMember m;
+      copy_one_member(&m, member);
+      _return.members.push_back(std::move(m));
+    }
+    _return.next_cursor = static_cast<int64_t>(next_cursor);
+  }
+
   void bm_mt_indirect_get_member(BmMtIndirectMember& _return, const int32_t cxt_id, const std::string& table_name, const BmMemberHandle mbr_handle) {
     Logger::get()->trace("bm_mt_indirect_get_member");
     MatchTableIndirect::Member member;
@@ -670,6 +819,27 @@ public:
     }
   }
 
+  void bm_mt_indirect_ws_get_groups_page(BmMtIndirectWsGroupsPage& _return, const int32_t cxt_id, const std::string& table_name, const int64_t cursor, const int32_t max_groups) {
+    Logger::get()->trace("bm_mt_indirect_ws_get_groups_page");
+    std::vector<MatchTableIndirectWS::Group> groups;
+    size_t next_cursor;
+    auto rc = switch_->mt_indirect_ws_get_groups_page(
+        cxt_id, table_name, static_cast<size_t>(cursor),
+        static_cast<size_t>(std::max(max_groups, 1)), &groups, &next_cursor);
+    if(rc != MatchErrorCode::SUCCESS) {
+      InvalidTableOperation ito;
+      ito.code = get_exception_code(rc);
+      throw ito;
+    }
+    _return.groups.reserve(groups.size());
+    for (const auto &group : groups) {
+      BmMtIndirectWsGroup g;
+      copy_one_group(&g, group);
+      _return.groups.push_back(std::move(g));
+    }
+    _return.next_cursor = static_cast<int64_t>(next_cursor);
+  }
+
   void bm_mt_indirect_ws_get_group(BmMtIndirectWsGroup& _return, const int32_t cxt_id, const std::string& table_name, const BmGroupHandle grp_handle) {
     Logger::get()->trace("bm_mt_indirect_ws_get_group");
     MatchTableIndirectWS::Group group;
@@ -963,6 +1133,63 @@ public:
     switch_->reset_state();
   }
 
+  void bm_enable_packet_tracing(const BmPacketTracingConfig& config) {
+    Logger::get()->trace("bm_enable_packet_tracing");
+    PacketTracer::Config c;
+    c.ports = config.ports;
+    c.sampling_rate = static_cast<unsigned int>(
+        std::max(config.sampling_rate, 1));
+    for (const auto &m : config.field_matches) {
+      c.field_matches.push_back(
+          {m.field_name, Data(m.value.data(), m.value.size())});
+    }
+    PacketTracer::get()->enable(c);
+  }
+
+  void bm_disable_packet_tracing() {
+    Logger::get()->trace("bm_disable_packet_tracing");
+    PacketTracer::get()->disable();
+  }
+
+  void bm_enable_perf_counters(const int32_t sampling_rate) {
+    Logger::get()->trace("bm_enable_perf_counters");
+    std::string error;
+    if (!PerfCounters::get()->enable(
+            static_cast<unsigned int>(std::max(sampling_rate, 1)), &error)) {
+      InvalidPerfCountersOperation ipco;
+      ipco.code = PerfCountersErrorCode::NOT_SUPPORTED;
+      ipco.info = error;
+      throw ipco;
+    }
+  }
+
+  void bm_disable_perf_counters() {
+    Logger::get()->trace("bm_disable_perf_counters");
+    PerfCounters::get()->disable();
+  }
+
+  void bm_reset_perf_counters() {
+    Logger::get()->trace("bm_reset_perf_counters");
+    PerfCounters::get()->reset();
+  }
+
+  void bm_get_perf_counters(std::vector<BmPerfCountersEntry> &_return) {
+    Logger::get()->trace("bm_get_perf_counters");
+    for (const auto &s : PerfCounters::get()->get_stats()) {
+      BmPerfCountersEntry entry;
+      entry.cxt_id = static_cast<int32_t>(s.cxt_id);
+      entry.type = static_cast<BmPerfCountersObjectType::type>(s.type);
+      entry.id = s.id;
+      entry.name = s.name;
+      entry.samples = static_cast<int64_t>(s.samples);
+      entry.cycles = static_cast<int64_t>(s.cycles);
+      entry.instructions = static_cast<int64_t>(s.instructions);
+      entry.llc_misses = static_cast<int64_t>(s.llc_misses);
+      entry.branch_misses = static_cast<int64_t>(s.branch_misses);
+      _return.push_back(std::move(entry));
+    }
+  }
+
   void bm_get_config(std::string& _return) {
     Logger::get()->trace("bm_get_config");
     _return.append(switch_->get_config());
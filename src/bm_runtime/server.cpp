@@ -25,6 +25,7 @@
 #include <p4thrift/transport/TServerSocket.h>
 #include <p4thrift/transport/TBufferTransports.h>
 #include <p4thrift/processor/TMultiplexedProcessor.h>
+#include <p4thrift/protocol/TCompactProtocol.h>
 
 namespace thrift_provider = p4::thrift;
 #else
@@ -34,6 +35,12 @@ namespace thrift_provider = p4::thrift;
 #include <thrift/transport/TServerSocket.h>
 #include <thrift/transport/TBufferTransports.h>
 #include <thrift/processor/TMultiplexedProcessor.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#ifdef BM_THRIFT_NB_ON
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/concurrency/PosixThreadFactory.h>
+#include <thrift/server/TNonblockingServer.h>
+#endif
 
 namespace thrift_provider = apache::thrift;
 #endif
@@ -88,6 +95,39 @@ bool switch_has_component() {
   return (switch_->get_cxt_component<T>(0) != nullptr);
 }
 
+void notify_ready() {
+  std::unique_lock<std::mutex> lock(m_ready);
+  ready = true;
+  cv_ready.notify_one();
+}
+
+#ifdef BM_THRIFT_NB_ON
+// Event-driven server: a single I/O thread reads the (framed) requests from
+// all the connections and hands them off to a pool of worker threads. A
+// client does not need to wait for a response before sending its next
+// request on the same connection, which lets it pipeline many table
+// operations; the responses are sent back in the order of the requests.
+int serve_nonblocking(shared_ptr<TMultiplexedProcessor> processor,
+                      shared_ptr<TProtocolFactory> protocolFactory,
+                      int port, int nb_workers) {
+  using ::thrift_provider::concurrency::ThreadManager;
+  using ::thrift_provider::concurrency::PosixThreadFactory;
+
+  shared_ptr<ThreadManager> threadManager(
+      ThreadManager::newSimpleThreadManager(nb_workers));
+  threadManager->threadFactory(
+      shared_ptr<PosixThreadFactory>(new PosixThreadFactory()));
+  threadManager->start();
+
+  TNonblockingServer server(processor, protocolFactory, port, threadManager);
+
+  notify_ready();
+
+  server.serve();
+  return 0;
+}
+#endif
+
 int serve(int port) {
   shared_ptr<TMultiplexedProcessor> processor(new TMultiplexedProcessor());
   processor_ = processor.get();
@@ -114,15 +154,28 @@ int serve(int port) {
     );
   }
 
+  const auto &options = switch_->get_runtime_server_options();
+
+  shared_ptr<TProtocolFactory> protocolFactory;
+  if (options.compact_protocol)
+    protocolFactory.reset(new TCompactProtocolFactory());
+  else
+    protocolFactory.reset(new TBinaryProtocolFactory());
+
+  if (options.nonblocking) {
+#ifdef BM_THRIFT_NB_ON
+    return serve_nonblocking(processor, protocolFactory, port,
+                             options.nb_workers);
+#else
+    printf("Non-blocking Thrift server not available in this build, "
+           "using threaded server\n");
+#endif
+  }
+
   shared_ptr<TServerTransport> serverTransport(new TServerSocket(port));
   shared_ptr<TTransportFactory> transportFactory(new TBufferedTransportFactory());
-  shared_ptr<TProtocolFactory> protocolFactory(new TBinaryProtocolFactory());
 
-  {
-    std::unique_lock<std::mutex> lock(m_ready);
-    ready = true;
-    cv_ready.notify_one();
-  }
+  notify_ready();
 
   TThreadedServer server(processor, serverTransport, transportFactory, protocolFactory);
   server.serve();
@@ -821,6 +821,9 @@ P4Objects::init_objects(std::istream *is,
 
       if (with_ageing) ageing_monitor->add_table(table->get_match_table());
 
+      table->get_match_table()->set_change_notifications(
+          notifications_transport, device_id, cxt_id);
+
       add_match_action_table(table_name, std::move(table));
     }
 
@@ -1238,4 +1241,10 @@ P4Objects::get_register_array_rt(const std::string &name) const {
   return (it != register_arrays.end()) ? it->second.get() : nullptr;
 }
 
+NamedCalculation *
+P4Objects::get_named_calculation_rt(const std::string &name) const {
+  auto it = calculations.find(name);
+  return (it != calculations.end()) ? it->second.get() : nullptr;
+}
+
 }  // namespace bm
@@ -37,7 +37,7 @@ ByteContainer::to_hex(size_t start, size_t s, bool upper_case) const {
         << (upper_case ? std::uppercase : std::nouppercase)
         // the int cast was not sufficient 0xab -> 0xffffffab
         // << static_cast<int>(bytes[i]);
-        << static_cast<int>(static_cast<unsigned char>(bytes[i]));
+        << static_cast<int>(static_cast<unsigned char>((*this)[i]));
   }
 
   return ret.str();
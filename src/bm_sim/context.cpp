@@ -379,6 +379,36 @@ Context::mt_get_entries<MatchTableIndirect>(const std::string &) const;
 template std::vector<MatchTableIndirectWS::Entry>
 Context::mt_get_entries<MatchTableIndirectWS>(const std::string &) const;
 
+template <typename T>
+MatchErrorCode
+Context::mt_get_entries_page(const std::string &table_name, size_t cursor,
+                             size_t max_entries,
+                             std::vector<typename T::Entry> *entries,
+                             size_t *next_cursor) const {
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  MatchTableAbstract *abstract_table =
+      p4objects_rt->get_abstract_match_table(table_name);
+  if (!abstract_table) return MatchErrorCode::INVALID_TABLE_NAME;
+  T *table = dynamic_cast<T *>(abstract_table);
+  if (!table) return MatchErrorCode::WRONG_TABLE_TYPE;
+  *next_cursor = table->get_entries_page(cursor, max_entries, entries);
+  return MatchErrorCode::SUCCESS;
+}
+
+// explicit instantiation
+template MatchErrorCode
+Context::mt_get_entries_page<MatchTable>(
+    const std::string &, size_t, size_t, std::vector<MatchTable::Entry> *,
+    size_t *) const;
+template MatchErrorCode
+Context::mt_get_entries_page<MatchTableIndirect>(
+    const std::string &, size_t, size_t,
+    std::vector<MatchTableIndirect::Entry> *, size_t *) const;
+template MatchErrorCode
+Context::mt_get_entries_page<MatchTableIndirectWS>(
+    const std::string &, size_t, size_t,
+    std::vector<MatchTableIndirectWS::Entry> *, size_t *) const;
+
 template <typename T>
 MatchErrorCode
 Context::mt_get_entry(const std::string &table_name,
@@ -403,6 +433,45 @@ template MatchErrorCode
 Context::mt_get_entry<MatchTableIndirectWS>(
     const std::string &, entry_handle_t, MatchTableIndirectWS::Entry *) const;
 
+MatchErrorCode
+Context::mt_get_change_seq(const std::string &table_name,
+                           MatchTableAbstract::seq_t *seq) const {
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  MatchTableAbstract *abstract_table =
+      p4objects_rt->get_abstract_match_table(table_name);
+  if (!abstract_table) return MatchErrorCode::INVALID_TABLE_NAME;
+  *seq = abstract_table->get_change_seq();
+  return MatchErrorCode::SUCCESS;
+}
+
+template <typename T>
+MatchErrorCode
+Context::mt_get_entries_since(const std::string &table_name,
+                              MatchTableAbstract::seq_t since,
+                              typename T::Changes *changes) const {
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  MatchTableAbstract *abstract_table =
+      p4objects_rt->get_abstract_match_table(table_name);
+  if (!abstract_table) return MatchErrorCode::INVALID_TABLE_NAME;
+  T *table = dynamic_cast<T *>(abstract_table);
+  if (!table) return MatchErrorCode::WRONG_TABLE_TYPE;
+  return table->get_entries_since(since, changes);
+}
+
+// explicit instantiation
+template MatchErrorCode
+Context::mt_get_entries_since<MatchTable>(
+    const std::string &, MatchTableAbstract::seq_t,
+    MatchTable::Changes *) const;
+template MatchErrorCode
+Context::mt_get_entries_since<MatchTableIndirect>(
+    const std::string &, MatchTableAbstract::seq_t,
+    MatchTableIndirect::Changes *) const;
+template MatchErrorCode
+Context::mt_get_entries_since<MatchTableIndirectWS>(
+    const std::string &, MatchTableAbstract::seq_t,
+    MatchTableIndirectWS::Changes *) const;
+
 template <typename T>
 MatchErrorCode
 Context::mt_get_default_entry(const std::string &table_name,
@@ -437,6 +506,20 @@ Context::mt_indirect_get_members(const std::string &table_name) const {
   return table->get_members();
 }
 
+MatchErrorCode
+Context::mt_indirect_get_members_page(
+    const std::string &table_name, size_t cursor, size_t max_members,
+    std::vector<MatchTableIndirect::Member> *members,
+    size_t *next_cursor) const {
+  MatchErrorCode rc;
+  MatchTableIndirect *table;
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  if ((rc = get_mt_indirect(table_name, &table)) != MatchErrorCode::SUCCESS)
+    return rc;
+  *next_cursor = table->get_members_page(cursor, max_members, members);
+  return MatchErrorCode::SUCCESS;
+}
+
 MatchErrorCode
 Context::mt_indirect_get_member(const std::string &table_name, grp_hdl_t grp,
                                 MatchTableIndirect::Member *member) const {
@@ -458,6 +541,20 @@ Context::mt_indirect_ws_get_groups(const std::string &table_name) const {
   return table->get_groups();
 }
 
+MatchErrorCode
+Context::mt_indirect_ws_get_groups_page(
+    const std::string &table_name, size_t cursor, size_t max_groups,
+    std::vector<MatchTableIndirectWS::Group> *groups,
+    size_t *next_cursor) const {
+  MatchErrorCode rc;
+  MatchTableIndirectWS *table;
+  boost::shared_lock<boost::shared_mutex> lock(request_mutex);
+  if ((rc = get_mt_indirect_ws(table_name, &table)) != MatchErrorCode::SUCCESS)
+    return rc;
+  *next_cursor = table->get_groups_page(cursor, max_groups, groups);
+  return MatchErrorCode::SUCCESS;
+}
+
 MatchErrorCode
 Context::mt_indirect_ws_get_group(const std::string &table_name, grp_hdl_t grp,
                                   MatchTableIndirectWS::Group *group) const {
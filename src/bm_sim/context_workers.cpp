@@ -0,0 +1,79 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/context_workers.h>
+
+#include <deque>
+#include <string>
+#include <utility>
+
+namespace bm {
+
+ContextWorkers::ContextWorkers(size_t cxt_id, size_t nb_threads,
+                               size_t capacity, Handler handler)
+    : handler(std::move(handler)), capacity(capacity),
+      pool(new ThreadPool(nb_threads, "cxt" + std::to_string(cxt_id))) { }
+
+ContextWorkers::~ContextWorkers() {
+  stop();
+}
+
+int
+ContextWorkers::push(std::unique_ptr<Packet> &&packet) {
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (stopped || queue.size() >= capacity) return 1;
+    queue.push_back(std::move(packet));
+    // posted with the lock held, so that stop() cannot destroy the pool
+    // concurrently
+    pool->post([this] { process_one(); });
+  }
+  return 0;
+}
+
+void
+ContextWorkers::stop() {
+  std::deque<std::unique_ptr<Packet> > discarded;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (stopped) return;
+    stopped = true;
+    discarded.swap(queue);
+  }
+  // the tasks which are still pending find an empty queue and return; the
+  // packets are released outside of the lock
+  pool.reset();
+}
+
+size_t
+ContextWorkers::size() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  return queue.size();
+}
+
+void
+ContextWorkers::process_one() {
+  std::unique_ptr<Packet> packet;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    // the queue was cleared by stop()
+    if (queue.empty()) return;
+    packet = std::move(queue.front());
+    queue.pop_front();
+  }
+  handler(std::move(packet));
+}
+
+}  // namespace bm
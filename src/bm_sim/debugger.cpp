@@ -116,6 +116,7 @@ class DebuggerNN final : public DebuggerIface {
   }
 
   void reset_state();
+  void reset_packets();
 
   void notify_update_generic(const PacketId &packet_id, uint64_t id,
                              const char *bytes, int nbits);
@@ -296,7 +297,8 @@ void
 DebuggerNN::notify_update_generic(const PacketId &packet_id,
                                   uint64_t id, const char *bytes, int nbits) {
   auto it = packet_registers_map.find(packet_id);
-  assert(it != packet_registers_map.end());
+  // packet was already in the switch when the client attached
+  if (it == packet_registers_map.end()) return;
   PacketRegisters &registers = it->second;
   int nbytes = (nbits + 7) / 8;
   registers.update(id, ByteContainer(bytes, nbytes));
@@ -347,7 +349,7 @@ DebuggerNN::notify_ctr_(const PacketId &packet_id, uint32_t ctr) {
   wait_for_continue(lock);
 
   auto it = packet_ctr_stacks.find(packet_id);
-  assert(it != packet_ctr_stacks.end());
+  if (it == packet_ctr_stacks.end()) return;
   auto &ctr_stack = it->second;
   if (bytes[0] & 0x80)
     ctr_stack.pop_back();
@@ -396,7 +398,7 @@ DebuggerNN::packet_out_(const PacketId &packet_id, int port) {
   wait_for_continue(lock);
 
   auto it = packet_registers_map.find(packet_id);
-  assert(it != packet_registers_map.end());
+  if (it == packet_registers_map.end()) return;
   packet_registers_map.erase(it);
 
   auto it2 = packet_ctr_stacks.find(packet_id);
@@ -639,6 +641,13 @@ DebuggerNN::req_unset_watchpoint(const char *data) {
     send_rep_status(1, 0);
 }
 
+void
+DebuggerNN::reset_packets() {
+  packet_registers_map.clear();
+  packet_ctr_stacks.clear();
+  packet_ids_count.clear();
+}
+
 void
 DebuggerNN::reset_state() {
   watchpoints.clear();
@@ -671,6 +680,10 @@ DebuggerNN::req_attach(const char *data) {
   attached = true;
   can_continue = false;
   reset_state();
+  // we only keep track of the packets which are received while the client is
+  // attached
+  reset_packets();
+  Debugger::attached.store(true);
   send_rep_status(0, 0);
 }
 
@@ -685,7 +698,9 @@ DebuggerNN::req_detach(const char *data) {
     return;
   }
   attached = false;
+  Debugger::attached.store(false);
   reset_state();
+  reset_packets();
   can_continue = true;
   cvar_continue.notify_all();
   send_rep_status(0, 0);
@@ -911,6 +926,8 @@ DebuggerIface *Debugger::debugger = new DebuggerDummy();
 
 bool Debugger::is_init = false;
 
+std::atomic<bool> Debugger::attached{false};
+
 void
 Debugger::init_debugger(const std::string &addr) {
   if (is_init) return;
@@ -21,6 +21,7 @@
 #include <bm/bm_sim/deparser.h>
 #include <bm/bm_sim/debugger.h>
 #include <bm/bm_sim/logger.h>
+#include <bm/bm_sim/perf_counters.h>
 
 namespace bm {
 
@@ -46,6 +47,8 @@ Deparser::deparse(Packet *pkt) const {
       Debugger::PacketId::make(pkt->get_packet_id(), pkt->get_copy_id()),
       DBG_CTR_DEPARSER | get_id());
   BMLOG_DEBUG_PKT(*pkt, "Deparser '{}': start", get_name());
+  PerfCounters::Sample perf_sample(*pkt, PerfCounters::ObjectType::DEPARSER,
+                                   *this);
   update_checksums(pkt);
   char *data = pkt->prepend(get_headers_size(*phv));
   int bytes_parsed = 0;
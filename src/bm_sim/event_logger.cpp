@@ -24,7 +24,11 @@
 #include <bm/bm_sim/tables.h>
 #include <bm/bm_sim/conditionals.h>
 #include <bm/bm_sim/actions.h>
+#include <bm/bm_sim/logger.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cassert>
 #include <cstring>
 
 namespace bm {
@@ -62,10 +66,220 @@ fill_msg_hdr(EventType type, int device_id,
   msg_hdr->copy_id = packet.get_copy_id();
 }
 
+constexpr size_t nb_rings = 8u;
+// how often the writer thread checks the rings when it is idle
+constexpr std::chrono::milliseconds flush_interval(1);
+
+std::atomic<size_t> next_thread_idx{0};
+
+uint64_t
+get_timestamp_ns() {
+  using std::chrono::duration_cast;
+  using std::chrono::nanoseconds;
+  using clock = std::chrono::steady_clock;
+  return duration_cast<nanoseconds>(clock::now().time_since_epoch()).count();
+}
+
+size_t
+get_thread_idx() {
+  static thread_local size_t idx = next_thread_idx++;
+  return idx;
+}
+
 }  // namespace
 
+// Bounded multi-producer / single-consumer ring of fixed-size event records,
+// based on Dmitry Vyukov's bounded MPMC queue. Each data path thread is mapped
+// to one ring, so producers rarely contend.
+class EventLogger::RecordRing {
+ public:
+  explicit RecordRing(size_t size)
+      : mask(size - 1), cells(new Cell[size]) {
+    assert((size & mask) == 0);
+    for (size_t i = 0; i < size; i++)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  // the timestamp is only taken once a cell has been reserved, to keep the
+  // window between timestamping and publishing the record as short as
+  // possible (see flush_rings())
+  bool push(const char *msg, size_t len) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells[pos & mask];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {  // full
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+    cell->record.timestamp = get_timestamp_ns();
+    cell->record.len = len;
+    std::memcpy(cell->record.data, msg, len);
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // single consumer
+  bool pop(PendingRecord *record) {
+    Cell &cell = cells[head & mask];
+    if (cell.seq.load(std::memory_order_acquire) != head + 1) return false;
+    *record = cell.record;
+    cell.seq.store(head + mask + 1, std::memory_order_release);
+    head++;
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq{0};
+    PendingRecord record;
+  };
+
+  size_t mask;
+  std::unique_ptr<Cell[]> cells;
+  std::atomic<size_t> tail{0};
+  // we do not want producers and the consumer to share a cache line
+  char pad[64 - sizeof(std::atomic<size_t>)];
+  size_t head{0};
+};
+
+EventLogger::EventLogger(std::unique_ptr<TransportIface> transport,
+                         int device_id)
+    : transport_instance(std::move(transport)), device_id(device_id) { }
+
+EventLogger::~EventLogger() {
+  stop_async_writer();
+}
+
+template <typename M>
+void
+EventLogger::emit(const M &msg) {
+  static_assert(sizeof(M) <= max_record_size,
+                "Event message does not fit in a ring record");
+  emit_(reinterpret_cast<const char *>(&msg), sizeof(msg));
+}
+
+void
+EventLogger::emit_(const char *msg, size_t len) {
+  if (!async.load(std::memory_order_acquire)) {
+    transport_instance->send(msg, static_cast<int>(len));
+    return;
+  }
+  RecordRing &ring = *rings[get_thread_idx() % nb_rings];
+  if (!ring.push(msg, len))
+    dropped_events.fetch_add(1, std::memory_order_relaxed);
+}
+
+void
+EventLogger::start_async_writer() {
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  if (writer_thread.joinable()) return;
+  // the rings are only allocated if they are needed
+  if (rings.empty()) {
+    for (size_t i = 0; i < nb_rings; i++)
+      rings.emplace_back(new RecordRing(ring_size));
+  }
+  stop_writer_thread = false;
+  writer_thread = std::thread(&EventLogger::write_loop, this);
+  async.store(true, std::memory_order_release);
+}
+
+void
+EventLogger::stop_async_writer() {
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  if (!writer_thread.joinable()) return;
+  async.store(false, std::memory_order_release);
+  stop_writer_thread = true;
+  lock.unlock();
+  writer_cv.notify_one();
+  writer_thread.join();
+}
+
+void
+EventLogger::set_sampling_rate(unsigned int one_in_n) {
+  sampling_rate.store(one_in_n, std::memory_order_relaxed);
+}
+
+uint64_t
+EventLogger::get_dropped_events() const {
+  return dropped_events.load(std::memory_order_relaxed);
+}
+
+void
+EventLogger::write_loop() {
+  std::unique_lock<std::mutex> lock(writer_mutex);
+  while (true) {
+    const bool stop = stop_writer_thread;
+    lock.unlock();
+    // when stopping, we send everything we have, even if some events are
+    // missing, as no more records are expected
+    if (!flush_rings(stop)) {
+      uint64_t dropped = dropped_events.load(std::memory_order_relaxed);
+      if (dropped != dropped_events_reported && !stop) {
+        Logger::get()->warn(
+            "Event logger: {} events were dropped because the rings were "
+            "full", dropped - dropped_events_reported);
+        dropped_events_reported = dropped;
+      }
+    }
+    lock.lock();
+    if (stop) break;
+    writer_cv.wait_for(lock, flush_interval,
+                       [this]{ return stop_writer_thread; });
+  }
+}
+
+// returns true if some records are still pending; the rings are drained until
+// they are empty, so the writer thread only sleeps once it has caught up with
+// the producers. The records from the different rings are merged based on
+// their timestamp. A record is only sent once it is older than flush_interval:
+// by then, all the events which were generated before it have been published
+// in their ring (unless a producer was descheduled for that long between
+// timestamping and publishing a record, in which case the event may be sent
+// out of order).
+bool
+EventLogger::flush_rings(bool flush_all) {
+  while (true) {
+    const uint64_t drain_start = get_timestamp_ns();
+    PendingRecord record;
+    const size_t nb_pending = pending.size();
+    for (auto &ring : rings) {
+      while (ring->pop(&record)) pending.push_back(record);
+    }
+    if (pending.empty()) return false;
+
+    // each ring is FIFO, and a stable sort preserves that order for records
+    // with identical timestamps
+    std::stable_sort(pending.begin(), pending.end(),
+                     [](const PendingRecord &r1, const PendingRecord &r2) {
+                       return r1.timestamp < r2.timestamp; });
+    const uint64_t grace = std::chrono::duration_cast<
+      std::chrono::nanoseconds>(flush_interval).count();
+    size_t sent = 0;
+    for (const auto &r : pending) {
+      if (!flush_all && r.timestamp + grace > drain_start) break;
+      transport_instance->send(r.data, static_cast<int>(r.len));
+      sent++;
+    }
+    pending.erase(pending.begin(), pending.begin() + sent);
+    if (flush_all) return false;
+    // most of the time, all events are retrieved in a single pass
+    if (pending.size() == nb_pending - sent) return !pending.empty();
+  }
+}
+
 void
 EventLogger::packet_in(const Packet &packet) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int port_in;
   } __attribute__((packed)) msg_t;
@@ -73,11 +287,13 @@ EventLogger::packet_in(const Packet &packet) {
   msg_t msg;
   fill_msg_hdr(EventType::PACKET_IN, device_id, packet, &msg);
   msg.port_in = packet.get_ingress_port();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::packet_out(const Packet &packet) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int port_out;
   } __attribute__((packed)) msg_t;
@@ -85,11 +301,13 @@ EventLogger::packet_out(const Packet &packet) {
   msg_t msg;
   fill_msg_hdr(EventType::PACKET_OUT, device_id, packet, &msg);
   msg.port_out = packet.get_egress_port();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::parser_start(const Packet &packet, const Parser &parser) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int parser_id;
   } __attribute__((packed)) msg_t;
@@ -97,11 +315,13 @@ EventLogger::parser_start(const Packet &packet, const Parser &parser) {
   msg_t msg;
   fill_msg_hdr(EventType::PARSER_START, device_id, packet, &msg);
   msg.parser_id = parser.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::parser_done(const Packet &packet, const Parser &parser) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int parser_id;
   } __attribute__((packed)) msg_t;
@@ -109,11 +329,13 @@ EventLogger::parser_done(const Packet &packet, const Parser &parser) {
   msg_t msg;
   fill_msg_hdr(EventType::PARSER_DONE, device_id, packet, &msg);
   msg.parser_id = parser.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::parser_extract(const Packet &packet, header_id_t header) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int header_id;
   } __attribute__((packed)) msg_t;
@@ -121,11 +343,13 @@ EventLogger::parser_extract(const Packet &packet, header_id_t header) {
   msg_t msg;
   fill_msg_hdr(EventType::PARSER_EXTRACT, device_id, packet, &msg);
   msg.header_id = header;
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::deparser_start(const Packet &packet, const Deparser &deparser) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int deparser_id;
   } __attribute__((packed)) msg_t;
@@ -133,11 +357,13 @@ EventLogger::deparser_start(const Packet &packet, const Deparser &deparser) {
   msg_t msg;
   fill_msg_hdr(EventType::DEPARSER_START, device_id, packet, &msg);
   msg.deparser_id = deparser.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::deparser_done(const Packet &packet, const Deparser &deparser) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int deparser_id;
   } __attribute__((packed)) msg_t;
@@ -145,11 +371,13 @@ EventLogger::deparser_done(const Packet &packet, const Deparser &deparser) {
   msg_t msg;
   fill_msg_hdr(EventType::DEPARSER_DONE, device_id, packet, &msg);
   msg.deparser_id = deparser.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::deparser_emit(const Packet &packet, header_id_t header) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int header_id;
   } __attribute__((packed)) msg_t;
@@ -157,11 +385,13 @@ EventLogger::deparser_emit(const Packet &packet, header_id_t header) {
   msg_t msg;
   fill_msg_hdr(EventType::DEPARSER_EMIT, device_id, packet, &msg);
   msg.header_id = header;
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::checksum_update(const Packet &packet, const Checksum &checksum) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int checksum_id;
   } __attribute__((packed)) msg_t;
@@ -169,11 +399,13 @@ EventLogger::checksum_update(const Packet &packet, const Checksum &checksum) {
   msg_t msg;
   fill_msg_hdr(EventType::CHECKSUM_UPDATE, device_id, packet, &msg);
   msg.checksum_id = checksum.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::pipeline_start(const Packet &packet, const Pipeline &pipeline) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int pipeline_id;
   } __attribute__((packed)) msg_t;
@@ -181,11 +413,13 @@ EventLogger::pipeline_start(const Packet &packet, const Pipeline &pipeline) {
   msg_t msg;
   fill_msg_hdr(EventType::PIPELINE_START, device_id, packet, &msg);
   msg.pipeline_id = pipeline.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::pipeline_done(const Packet &packet, const Pipeline &pipeline) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int pipeline_id;
   } __attribute__((packed)) msg_t;
@@ -193,12 +427,14 @@ EventLogger::pipeline_done(const Packet &packet, const Pipeline &pipeline) {
   msg_t msg;
   fill_msg_hdr(EventType::PIPELINE_DONE, device_id, packet, &msg);
   msg.pipeline_id = pipeline.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::condition_eval(const Packet &packet,
                             const Conditional &cond, bool result) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int condition_id;
     int result;  // 0 (true) or 1 (false);
@@ -208,7 +444,7 @@ EventLogger::condition_eval(const Packet &packet,
   fill_msg_hdr(EventType::CONDITION_EVAL, device_id, packet, &msg);
   msg.condition_id = cond.get_id();
   msg.result = result;
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 // static inline size_t get_pascal_str_size(const ByteContainer &src) {
@@ -224,6 +460,8 @@ EventLogger::condition_eval(const Packet &packet,
 void
 EventLogger::table_hit(const Packet &packet, const MatchTableAbstract &table,
                        entry_handle_t handle) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int table_id;
     int entry_hdl;
@@ -233,11 +471,13 @@ EventLogger::table_hit(const Packet &packet, const MatchTableAbstract &table,
   fill_msg_hdr(EventType::TABLE_HIT, device_id, packet, &msg);
   msg.table_id = table.get_id();
   msg.entry_hdl = static_cast<int>(handle);
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::table_miss(const Packet &packet, const MatchTableAbstract &table) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int table_id;
   } __attribute__((packed)) msg_t;
@@ -245,13 +485,15 @@ EventLogger::table_miss(const Packet &packet, const MatchTableAbstract &table) {
   msg_t msg;
   fill_msg_hdr(EventType::TABLE_MISS, device_id, packet, &msg);
   msg.table_id = table.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 void
 EventLogger::action_execute(const Packet &packet,
                             const ActionFn &action_fn,
                             const ActionData &action_data) {
+  if (!is_sampled(packet)) return;
+
   typedef struct : msg_hdr_t {
     int action_id;
   } __attribute__((packed)) msg_t;
@@ -259,7 +501,7 @@ EventLogger::action_execute(const Packet &packet,
   msg_t msg;
   fill_msg_hdr(EventType::ACTION_EXECUTE, device_id, packet, &msg);
   msg.action_id = action_fn.get_id();
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
   // to costly to send action data?
   (void) action_data;
 }
@@ -270,7 +512,7 @@ EventLogger::config_change() {
   std::memset(&msg, 0, sizeof(msg));
   msg.type = static_cast<int>(EventType::CONFIG_CHANGE);
   msg.switch_id = device_id;
-  transport_instance->send(reinterpret_cast<char *>(&msg), sizeof(msg));
+  emit(msg);
 }
 
 // TODO(antonin): move this?
@@ -24,6 +24,10 @@
 
 namespace bm {
 
+thread_local Packet *ExternType::pkt = nullptr;
+
+constexpr bool ExternType::_needs_lock;
+
 ExternFactoryMap *
 ExternFactoryMap::get_instance() {
   static ExternFactoryMap instance;
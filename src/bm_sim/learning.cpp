@@ -26,6 +26,7 @@
 #include <algorithm>
 
 #include <cassert>
+#include <cstddef>
 
 namespace bm {
 
@@ -72,24 +73,166 @@ LearnEngine::LearnSampleBuilder::operator()(const PHV &phv,
   }
 }
 
+namespace {
+
+// used to map data path threads to staging rings
+std::atomic<size_t> next_thread_idx{0};
+
+size_t
+get_thread_idx() {
+  static thread_local size_t idx = next_thread_idx++;
+  return idx;
+}
+
+}  // namespace
+
+// Lock-free set of sample fingerprints, which lets the data path discard
+// samples which have already been learned without taking a lock. This is only
+// a cache in front of the exact filter maintained by the aggregator: each slot
+// is direct-mapped and a colliding fingerprint simply evicts the previous one,
+// in which case a duplicate sample may reach the aggregator, where it will be
+// discarded.
+class LearnEngine::FingerprintFilter {
+ public:
+  explicit FingerprintFilter(size_t size)
+      : mask(size - 1), slots(new std::atomic<uint64_t>[size]) {
+    assert((size & mask) == 0);
+    clear();
+  }
+
+  static uint64_t fingerprint(const ByteContainer &sample) {
+    uint64_t fp = ByteContainerKeyHash()(sample);
+    // 0 is reserved for empty slots
+    return (fp == 0) ? 1 : fp;
+  }
+
+  // returns false if the fingerprint was already present
+  bool insert(uint64_t fp) {
+    auto &slot = slots[fp & mask];
+    uint64_t current = slot.load(std::memory_order_relaxed);
+    while (current != fp) {
+      if (slot.compare_exchange_weak(current, fp, std::memory_order_relaxed))
+        return true;
+    }
+    return false;
+  }
+
+  void erase(uint64_t fp) {
+    uint64_t expected = fp;
+    slots[fp & mask].compare_exchange_strong(expected, 0,
+                                             std::memory_order_relaxed);
+  }
+
+  void clear() {
+    for (size_t i = 0; i <= mask; i++)
+      slots[i].store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  size_t mask;
+  std::unique_ptr<std::atomic<uint64_t>[]> slots;
+};
+
+// Bounded ring with multiple producers (data path threads) and a single
+// consumer (the aggregator). This is Dmitry Vyukov's bounded queue: each cell
+// carries a sequence number which tells producers and the consumer whether the
+// cell is ready to be written or read. Because each data path thread is mapped
+// to a different ring, producers are not expected to contend in practice.
+// Samples are copied into pre-allocated ByteContainer instances, so once the
+// ring has been warmed up no memory allocation is performed.
+class LearnEngine::SampleRing {
+ public:
+  explicit SampleRing(size_t size)
+      : mask(size - 1), cells(new Cell[size]) {
+    assert((size & mask) == 0);
+    for (size_t i = 0; i < size; i++)
+      cells[i].seq.store(i, std::memory_order_relaxed);
+  }
+
+  bool push(const ByteContainer &sample, uint64_t fp) {
+    size_t pos = tail.load(std::memory_order_relaxed);
+    Cell *cell;
+    while (true) {
+      cell = &cells[pos & mask];
+      size_t seq = cell->seq.load(std::memory_order_acquire);
+      auto diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (tail.compare_exchange_weak(pos, pos + 1,
+                                       std::memory_order_relaxed))
+          break;
+      } else if (diff < 0) {  // full
+        return false;
+      } else {
+        pos = tail.load(std::memory_order_relaxed);
+      }
+    }
+    cell->sample = sample;
+    cell->fp = fp;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // the consumer is responsible for calling pop_done() once it is done with
+  // the sample
+  const ByteContainer *front(uint64_t *fp) const {
+    const size_t pos = head.load(std::memory_order_relaxed);
+    Cell &cell = cells[pos & mask];
+    if (cell.seq.load(std::memory_order_acquire) != pos + 1) return nullptr;
+    *fp = cell.fp;
+    return &cell.sample;
+  }
+
+  void pop_done() {
+    const size_t pos = head.load(std::memory_order_relaxed);
+    cells[pos & mask].seq.store(pos + mask + 1, std::memory_order_release);
+    head.store(pos + 1, std::memory_order_release);
+  }
+
+  // unlike front() and pop_done(), which are called with the list mutex held,
+  // this can be called without it, concurrently with pop_done()
+  bool empty() const {
+    const size_t pos = head.load(std::memory_order_acquire);
+    const Cell &cell = cells[pos & mask];
+    return cell.seq.load(std::memory_order_acquire) != pos + 1;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> seq{0};
+    ByteContainer sample{};
+    uint64_t fp{0};
+  };
+
+  size_t mask;
+  std::unique_ptr<Cell[]> cells;
+  std::atomic<size_t> tail{0};
+  // we do not want producers and the consumer to share a cache line
+  char pad[64 - sizeof(std::atomic<size_t>)];
+  // only advanced with the list mutex held, but read by empty() without it
+  std::atomic<size_t> head{0};
+};
+
 LearnEngine::LearnList::LearnList(list_id_t list_id, int device_id, int cxt_id,
                                   size_t max_samples, unsigned int timeout)
     : list_id(list_id), device_id(device_id), cxt_id(cxt_id),
-      max_samples(max_samples), timeout(timeout), with_timeout(timeout > 0) { }
+      max_samples(max_samples), timeout(timeout), with_timeout(timeout > 0),
+      fp_filter(new FingerprintFilter(nb_rings * ring_size)) {
+  for (size_t i = 0; i < nb_rings; i++)
+    rings.emplace_back(new SampleRing(ring_size));
+}
 
 void
 LearnEngine::LearnList::init() {
-  transmit_thread = std::thread(&LearnList::buffer_transmit_loop, this);
-  // transmit_thread.detach();
+  aggregator_thread = std::thread(&LearnList::aggregate_loop, this);
 }
 
 LearnEngine::LearnList::~LearnList() {
   {
     LockType lock(mutex);
-    stop_transmit_thread = true;
+    stop_aggregator_thread = true;
   }
-  b_can_send.notify_all();
-  transmit_thread.join();
+  notify_aggregator();
+  if (aggregator_thread.joinable()) aggregator_thread.join();
 }
 
 void
@@ -130,33 +273,57 @@ LearnEngine::LearnList::set_timeout(unsigned int timeout_ms) {
   LockType lock(mutex);
   timeout = milliseconds(timeout_ms);
   with_timeout = (timeout_ms > 0);
+  notify_aggregator();
 }
 
 void
 LearnEngine::LearnList::set_max_samples(size_t nb_samples) {
   LockType lock(mutex);
   max_samples = nb_samples;
-  if (num_samples > 0 && num_samples >= max_samples) {
-    process_full_buffer(lock);
-  }
+  notify_aggregator();
 }
 
 void
-LearnEngine::LearnList::swap_buffers() {
-  buffer_tmp.swap(buffer);
-  num_samples_tmp = num_samples;
-  num_samples = 0;
-  buffer_id++;
+LearnEngine::LearnList::wake_aggregator() {
+  // pairs with the fence in wait_for_samples(): either the aggregator sees the
+  // sample we just pushed before going to sleep, or we see that it is sleeping
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (!aggregator_waiting.load(std::memory_order_relaxed)) return;
+  // only the first producer to see the aggregator sleeping needs to wake it up
+  if (!aggregator_waiting.exchange(false)) return;
+  notify_aggregator();
 }
 
 void
-LearnEngine::LearnList::process_full_buffer(LockType &lock) {
-  while (buffer_tmp.size() != 0) {
-    b_can_swap.wait(lock);
-  }
-  swap_buffers();
+LearnEngine::LearnList::notify_aggregator() {
+  std::unique_lock<MutexType> lock(wait_mutex);
+  wake_up = true;
+  wait_cv.notify_one();
+}
+
+bool
+LearnEngine::LearnList::rings_empty() const {
+  for (const auto &ring : rings)
+    if (!ring->empty()) return false;
+  return true;
+}
 
-  b_can_send.notify_one();
+void
+LearnEngine::LearnList::wait_for_samples(bool with_deadline,
+                                         clock::time_point deadline) {
+  std::unique_lock<MutexType> lock(wait_mutex);
+  aggregator_waiting.store(true, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  while (!wake_up && rings_empty()) {
+    if (!with_deadline) {
+      wait_cv.wait(lock);
+    } else if (wait_cv.wait_until(lock, deadline) ==
+               std::cv_status::timeout) {
+      break;
+    }
+  }
+  wake_up = false;
+  aggregator_waiting.store(false, std::memory_order_relaxed);
 }
 
 void
@@ -165,58 +332,70 @@ LearnEngine::LearnList::add_sample(const PHV &phv) {
   sample.clear();
   builder(phv, &sample);
 
-  LockType lock(mutex);
+  const uint64_t fp = FingerprintFilter::fingerprint(sample);
+  if (!fp_filter->insert(fp)) return;
+
+  SampleRing &ring = *rings[get_thread_idx() % nb_rings];
+  if (!ring.push(sample, fp)) {
+    // the sample was not recorded, so we need to let the next packet try again
+    fp_filter->erase(fp);
+    dropped_samples.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
 
+  wake_aggregator();
+}
+
+void
+LearnEngine::LearnList::add_sample_to_buffer(const ByteContainer &sample,
+                                             uint64_t fp) {
   const auto it = filter.find(sample);
   if (it != filter.end()) return;
 
   buffer.insert(buffer.end(), sample.begin(), sample.end());
   num_samples++;
-  auto filter_it = filter.insert(filter.end(), std::move(sample));
+  auto filter_it = filter.insert(filter.end(), sample);
   FilterPtrs &filter_ptrs = old_buffers[buffer_id];
   filter_ptrs.unacked_count++;
   filter_ptrs.buffer.push_back(filter_it);
+  // in case this fingerprint was evicted from the lock-free filter by a
+  // colliding sample, we can re-insert it now
+  fp_filter->insert(fp);
 
-  if (num_samples == 1 && max_samples > 1) {
-    buffer_started = clock::now();
-    // wake transmit thread to update cond var wait time
-    b_can_send.notify_one();
-  } else if (num_samples >= max_samples) {
-    process_full_buffer(lock);
-  }
+  if (num_samples == 1) buffer_started = clock::now();
 }
 
 void
-LearnEngine::LearnList::buffer_transmit() {
-  size_t num_samples_to_send;
-  LockType lock(mutex);
-  clock::time_point now = clock::now();
-  while (!stop_transmit_thread &&
-         buffer_tmp.size() == 0 &&
-         (!with_timeout ||
-          num_samples == 0 ||
-          now < (buffer_started + timeout))) {
-    if (with_timeout && num_samples > 0) {
-      b_can_send.wait_until(lock, buffer_started + timeout);
-    } else {
-      b_can_send.wait(lock);
+LearnEngine::LearnList::drain_rings(LockType &lock) {
+  for (auto &ring : rings) {
+    uint64_t fp;
+    const ByteContainer *sample;
+    while (!stop_aggregator_thread && (sample = ring->front(&fp)) != nullptr) {
+      add_sample_to_buffer(*sample, fp);
+      ring->pop_done();
+      if (num_samples > 0 && num_samples >= max_samples)
+        buffer_transmit(lock);
     }
-    now = clock::now();
   }
 
-  if (stop_transmit_thread) return;
-
-  if (buffer_tmp.size() == 0) {  // timeout -> we need to swap here
-    num_samples_to_send = num_samples;
-    swap_buffers();
-  } else {  // buffer full -> swapping was already done
-    // maybe max_samples was modified in between, so it would not be safe to do
-    // this
-    // num_samples_to_send = max_samples;
-    num_samples_to_send = num_samples_tmp;
+  uint64_t dropped = dropped_samples.load(std::memory_order_relaxed);
+  if (dropped != dropped_samples_reported) {
+    Logger::get()->warn(
+        "Learn list {}: {} samples were dropped because the staging rings "
+        "were full", list_id, dropped - dropped_samples_reported);
+    dropped_samples_reported = dropped;
   }
+}
+
+void
+LearnEngine::LearnList::buffer_transmit(LockType &lock) {
+  std::vector<char> buffer_to_send;
+  buffer_to_send.swap(buffer);
+  const size_t num_samples_to_send = num_samples;
+  num_samples = 0;
+  buffer_id++;
 
-  last_sent = now;
+  last_sent = clock::now();
   writer_busy = true;
 
   lock.unlock();
@@ -228,22 +407,22 @@ LearnEngine::LearnList::buffer_transmit() {
   msg_hdr.switch_id = device_id;
   msg_hdr.cxt_id = cxt_id;
   msg_hdr.list_id = list_id;
+  // do not forget the -1 !!!
+  // buffer_id was incremented above
   msg_hdr.buffer_id = buffer_id - 1;
   msg_hdr.num_samples = static_cast<unsigned int>(num_samples_to_send);
 
   if (learn_mode == LearnMode::WRITER) {
-    // do not forget the -1 !!!
-    // swap_buffers() is in charge of incrementing the count
     TransportIface::MsgBuf buf_hdr =
       {reinterpret_cast<char *>(&msg_hdr), sizeof(msg_hdr)};
     TransportIface::MsgBuf buf_samples =
-      {buffer_tmp.data(), static_cast<unsigned int>(buffer_tmp.size())};
+      {buffer_to_send.data(), static_cast<unsigned int>(buffer_to_send.size())};
 
     writer->send_msgs({buf_hdr, buf_samples});  // no lock for I/O
   } else if (learn_mode == LearnMode::CB) {
-    std::unique_ptr<char[]> buf(new char[buffer_tmp.size()]);
-    std::copy(buffer_tmp.begin(), buffer_tmp.end(), &buf[0]);
-    cb_fn(msg_hdr, buffer_tmp.size(), std::move(buf), cb_cookie);
+    std::unique_ptr<char[]> buf(new char[buffer_to_send.size()]);
+    std::copy(buffer_to_send.begin(), buffer_to_send.end(), &buf[0]);
+    cb_fn(msg_hdr, buffer_to_send.size(), std::move(buf), cb_cookie);
   } else {
     assert(learn_mode == LearnMode::NONE);
   }
@@ -253,19 +432,41 @@ LearnEngine::LearnList::buffer_transmit() {
   writer_busy = false;
   can_change_writer.notify_all();
 
-  buffer_tmp.clear();
-
-  b_can_swap.notify_one();
+  // give the memory back to avoid a new allocation for the next buffer
+  if (buffer.empty()) {
+    buffer_to_send.clear();
+    buffer.swap(buffer_to_send);
+  }
 }
 
 void
-LearnEngine::LearnList::buffer_transmit_loop() {
+LearnEngine::LearnList::aggregate_loop() {
   while (true) {
-    buffer_transmit();
-    if (stop_transmit_thread) return;
+    LockType lock(mutex);
+    if (stop_aggregator_thread) return;
+    drain_rings(lock);
+    if (stop_aggregator_thread) return;
+
+    if (num_samples > 0 &&
+        (num_samples >= max_samples ||
+         (with_timeout && clock::now() >= (buffer_started + timeout)))) {
+      buffer_transmit(lock);
+      continue;
+    }
+
+    const bool with_deadline = with_timeout && num_samples > 0;
+    const clock::time_point deadline = buffer_started + timeout;
+    lock.unlock();
+    wait_for_samples(with_deadline, deadline);
   }
 }
 
+void
+LearnEngine::LearnList::erase_sample(LearnFilter::iterator it) {
+  fp_filter->erase(FingerprintFilter::fingerprint(*it));
+  filter.erase(it);
+}
+
 void
 LearnEngine::LearnList::ack(buffer_id_t buffer_id,
                             const std::vector<int> &sample_ids) {
@@ -278,7 +479,7 @@ LearnEngine::LearnList::ack(buffer_id_t buffer_id,
   FilterPtrs &filter_ptrs = it->second;
   for (int sample_id : sample_ids) {
     // what happens if bad input :(
-    filter.erase(filter_ptrs.buffer[sample_id]);
+    erase_sample(filter_ptrs.buffer[sample_id]);
     if (--filter_ptrs.unacked_count == 0) {
       old_buffers.erase(it);
     }
@@ -298,9 +499,10 @@ LearnEngine::LearnList::ack_buffer(buffer_id_t buffer_id) {
   // and the ack clears out the filter
   if (filter_ptrs.unacked_count == filter.size()) {
     filter.clear();
+    fp_filter->clear();
   } else {  // slow: linear in the number of elements acked
     for (const auto &sample_it : filter_ptrs.buffer) {
-      filter.erase(sample_it);
+      erase_sample(sample_it);
     }
   }
   old_buffers.erase(it);
@@ -309,13 +511,19 @@ LearnEngine::LearnList::ack_buffer(buffer_id_t buffer_id) {
 void
 LearnEngine::LearnList::reset_state() {
   LockType lock(mutex);
+  // the aggregator only pops samples with the mutex held, so we can empty the
+  // rings here; it may however be checking whether they are empty (see
+  // wait_for_samples()), hence the atomic head in SampleRing
+  for (auto &ring : rings) {
+    uint64_t fp;
+    while (ring->front(&fp) != nullptr) ring->pop_done();
+  }
   buffer.clear();
   buffer_id = 0;
   num_samples = 0;
-  num_samples_tmp = 0;
   filter.clear();
+  fp_filter->clear();
   old_buffers.clear();
-  buffer_tmp.clear();
 }
 
 LearnEngine::LearnEngine(int device_id, int cxt_id)
@@ -20,7 +20,10 @@
 
 #include <bm/bm_sim/logger.h>
 
+#include <bm/spdlog/async_logger.h>
+#include <bm/spdlog/sinks/file_sinks.h>
 #include <bm/spdlog/sinks/null_sink.h>
+#include <bm/spdlog/sinks/stdout_sinks.h>
 
 #include <memory>
 #include <string>
@@ -28,34 +31,53 @@
 namespace bm {
 
 spdlog::logger *Logger::logger = nullptr;
+spdlog::logger *Logger::packet_trace_logger = nullptr;
+
+namespace {
+
+// number of messages which can be queued by the packet trace logger; needs to
+// be a power of 2
+constexpr size_t packet_trace_queue_size = 1 << 16;
+
+}  // namespace
 
 void
 Logger::set_logger_console() {
-  unset_logger();
-  auto logger_ = spdlog::stdout_logger_mt("bmv2");
-  logger = logger_.get();
-  set_pattern();
-  logger_->set_level(to_spd_level(LogLevel::DEBUG));
+  set_sink(spdlog::sinks::stdout_sink_mt::instance());
 }
 
 void
 Logger::set_logger_file(const std::string &filename, bool force_flush) {
+  set_sink(std::make_shared<spdlog::sinks::rotating_file_sink_mt>(
+      filename, "txt", 1024 * 1024 * 5, 3, force_flush));
+}
+
+void
+Logger::set_sink(spdlog::sink_ptr sink) {
   unset_logger();
-  auto logger_ = spdlog::rotating_logger_mt("bmv2", filename,
-                                            1024 * 1024 * 5, 3, force_flush);
+  auto logger_ = std::make_shared<spdlog::logger>("bmv2", sink);
+  spdlog::register_logger(logger_);
   logger = logger_.get();
+  auto packet_trace_logger_ = std::make_shared<spdlog::async_logger>(
+      "bmv2-pkt", sink, packet_trace_queue_size,
+      spdlog::async_overflow_policy::discard_log_msg);
+  spdlog::register_logger(packet_trace_logger_);
+  packet_trace_logger = packet_trace_logger_.get();
   set_pattern();
   logger_->set_level(to_spd_level(LogLevel::DEBUG));
+  packet_trace_logger_->set_level(to_spd_level(LogLevel::TRACE));
 }
 
 void
 Logger::set_pattern() {
   logger->set_pattern("[%H:%M:%S.%e] [%n] [%L] [thread %t] %v");
+  packet_trace_logger->set_pattern("[%H:%M:%S.%e] [%n] [%L] [thread %t] %v");
 }
 
 void
 Logger::unset_logger() {
   spdlog::drop("bmv2");
+  spdlog::drop("bmv2-pkt");
 }
 
 spdlog::logger *
@@ -65,6 +87,10 @@ Logger::init_logger() {
   auto null_logger = std::make_shared<spdlog::logger>("bmv2", null_sink);
   spdlog::register_logger(null_logger);
   logger = null_logger.get();
+  auto null_packet_trace_logger = std::make_shared<spdlog::logger>(
+      "bmv2-pkt", null_sink);
+  spdlog::register_logger(null_packet_trace_logger);
+  packet_trace_logger = null_packet_trace_logger.get();
   return logger;
 }
 
@@ -22,7 +22,7 @@
 #include <bm/bm_sim/lookup_structures.h>
 #include <bm/bm_sim/match_key_types.h>
 
-#include <algorithm>  // for std::swap
+#include <algorithm>  // for std::swap, std::fill
 #include <unordered_map>
 #include <vector>
 #include <tuple>
@@ -128,6 +128,55 @@ class ExactMap : public ExactLookupStructure {
     entries_map{};
 };
 
+// Used for exact keys of at most LookupStructureFactory::direct_max_bits bits:
+// the key value is used directly as an index in an array with one slot per
+// possible key value, so a lookup is a single array load.
+class DirectExactMap : public ExactLookupStructure {
+ public:
+  explicit DirectExactMap(size_t nbytes_key)
+      : nbytes_key(nbytes_key), slots(size_t(1) << (8 * nbytes_key), kEmpty) { }
+
+  bool lookup(const ByteContainer &key,
+              internal_handle_t *handle) const override {
+    const uint32_t slot = slots[index(key)];
+    if (slot == kEmpty) return false;
+    *handle = slot;
+    return true;
+  }
+
+  bool entry_exists(const ExactMatchKey &key) const override {
+    return slots[index(key.data)] != kEmpty;
+  }
+
+  void add_entry(const ExactMatchKey &key,
+                 internal_handle_t handle) override {
+    slots[index(key.data)] = static_cast<uint32_t>(handle);
+  }
+
+  void delete_entry(const ExactMatchKey &key) override {
+    slots[index(key.data)] = kEmpty;
+  }
+
+  void clear() override {
+    std::fill(slots.begin(), slots.end(), kEmpty);
+  }
+
+ private:
+  static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+  size_t index(const ByteContainer &key) const {
+    size_t idx = 0;
+    for (size_t i = 0; i < nbytes_key; i++)
+      idx = (idx << 8) | static_cast<unsigned char>(key[i]);
+    return idx;
+  }
+
+  size_t nbytes_key;
+  std::vector<uint32_t> slots;
+};
+
+constexpr uint32_t DirectExactMap::kEmpty;
+
 bool operator==(const TernaryMatchKey &k1, const TernaryMatchKey &k2) {
   return (k1.data == k2.data && k1.mask == k2.mask);
 }
@@ -159,9 +208,10 @@ class EntryList {
       if (cmp(key_data, *entry->key)) {
         min_priority = entry->priority;
         min_entry = entry;
-        // a bit sad that this cast is needed, almost makes me want to do the
-        // pointer arithmetic by hand
-        min_handle = std::distance(const_cast<const Entry *>(head), entry);
+        // the handle is the index in the entries vector; head is not
+        // necessarily the first element of the vector (e.g. if handle 0 was
+        // deleted)
+        min_handle = std::distance(entries.data(), entry);
       }
     }
 
@@ -275,6 +325,127 @@ class TernaryMap : public TernaryLookupStructure {
   size_t nbytes_key;
 };
 
+// Used for ternary keys of at most LookupStructureFactory::direct_max_bits
+// bits: the result of the lookup is precomputed for every possible key value,
+// so a lookup is a single array load. The array is updated when entries are
+// added or deleted, which only touches the key values matched by the entry
+// (and, when deleting, the entries overlapping with it).
+class DirectTernaryMap : public TernaryLookupStructure {
+ public:
+  DirectTernaryMap(size_t size, size_t nbytes_key)
+      : nbytes_key(nbytes_key), entries(size),
+        slots(size_t(1) << (8 * nbytes_key), kEmpty) { }
+
+  bool lookup(const ByteContainer &key_data,
+              internal_handle_t *handle) const override {
+    const uint32_t slot = slots[to_uint(key_data)];
+    if (slot == kEmpty) return false;
+    *handle = slot;
+    return true;
+  }
+
+  bool entry_exists(const TernaryMatchKey &key) const override {
+    return find_entry(key) != kEmpty;
+  }
+
+  void add_entry(const TernaryMatchKey &key,
+                 internal_handle_t handle) override {
+    Entry &entry = entries.at(handle);
+    entry.valid = true;
+    entry.priority = key.priority;
+    entry.data = to_uint(key.data);
+    entry.mask = to_uint(key.mask);
+    const uint32_t h = static_cast<uint32_t>(handle);
+    for_each_value(entry.data, entry.mask, [this, h](uint32_t v) {
+        if (better(h, slots[v])) slots[v] = h;
+      });
+  }
+
+  void delete_entry(const TernaryMatchKey &key) override {
+    const uint32_t h = find_entry(key);
+    if (h == kEmpty) return;
+    Entry &deleted = entries[h];
+    deleted.valid = false;
+    for_each_value(deleted.data, deleted.mask, [this, h](uint32_t v) {
+        if (slots[v] == h) slots[v] = kEmpty;
+      });
+    // the key values which were matched by the deleted entry can only be
+    // matched by the entries overlapping with it
+    for (uint32_t other = 0; other < entries.size(); other++) {
+      const Entry &entry = entries[other];
+      if (!entry.valid) continue;
+      const uint32_t common = entry.mask & deleted.mask;
+      if ((entry.data & common) != (deleted.data & common)) continue;
+      for_each_value(entry.data | deleted.data, entry.mask | deleted.mask,
+                     [this, other](uint32_t v) {
+                       if (better(other, slots[v])) slots[v] = other;
+                     });
+    }
+  }
+
+  void clear() override {
+    for (auto &entry : entries) entry.valid = false;
+    std::fill(slots.begin(), slots.end(), kEmpty);
+  }
+
+ private:
+  static constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+  struct Entry {
+    bool valid{false};
+    int priority{0};
+    uint32_t data{0};
+    uint32_t mask{0};
+  };
+
+  uint32_t to_uint(const ByteContainer &bytes) const {
+    uint32_t v = 0;
+    for (size_t i = 0; i < nbytes_key; i++)
+      v = (v << 8) | static_cast<unsigned char>(bytes[i]);
+    return v;
+  }
+
+  // same semantics as EntryList::lookup: the entry with the lowest priority
+  // value wins, ties are broken in favor of the lowest handle
+  bool better(uint32_t h, uint32_t current) const {
+    if (current == kEmpty) return true;
+    const int p = entries[h].priority;
+    const int p_current = entries[current].priority;
+    return (p < p_current) || (p == p_current && h < current);
+  }
+
+  // calls f for each key value v such that (v & mask) == data, by enumerating
+  // the subsets of the wildcard bits
+  template <typename F>
+  void for_each_value(uint32_t data, uint32_t mask, const F &f) const {
+    const uint32_t wildcard =
+        static_cast<uint32_t>(slots.size() - 1) & ~mask;
+    uint32_t subset = 0;
+    do {
+      f(data | subset);
+      subset = (subset - wildcard) & wildcard;
+    } while (subset != 0);
+  }
+
+  uint32_t find_entry(const TernaryMatchKey &key) const {
+    const uint32_t data = to_uint(key.data);
+    const uint32_t mask = to_uint(key.mask);
+    for (uint32_t h = 0; h < entries.size(); h++) {
+      const Entry &entry = entries[h];
+      if (entry.valid && entry.priority == key.priority &&
+          entry.data == data && entry.mask == mask)
+        return h;
+    }
+    return kEmpty;
+  }
+
+  size_t nbytes_key;
+  std::vector<Entry> entries;
+  std::vector<uint32_t> slots;
+};
+
+constexpr uint32_t DirectTernaryMap::kEmpty;
+
 class RangeMap : public RangeLookupStructure {
  public:
   RangeMap(size_t size, size_t nbytes_key)
@@ -360,7 +531,10 @@ LookupStructureFactory::create<RangeMatchKey>(
 
 std::unique_ptr<ExactLookupStructure>
 LookupStructureFactory::create_for_exact(size_t size, size_t nbytes_key) {
-  (void) nbytes_key;
+  if (use_direct_lookup(size, nbytes_key)) {
+    return std::unique_ptr<ExactLookupStructure>(
+        new DirectExactMap(nbytes_key));
+  }
   return std::unique_ptr<ExactLookupStructure>(new ExactMap(size));
 }
 
@@ -372,10 +546,32 @@ LookupStructureFactory::create_for_LPM(size_t size, size_t nbytes_key) {
 
 std::unique_ptr<TernaryLookupStructure>
 LookupStructureFactory::create_for_ternary(size_t size, size_t nbytes_key) {
+  if (use_direct_lookup(size, nbytes_key)) {
+    return std::unique_ptr<TernaryLookupStructure>(
+        new DirectTernaryMap(size, nbytes_key));
+  }
   return std::unique_ptr<TernaryLookupStructure>(new TernaryMap(size,
                                                                 nbytes_key));
 }
 
+constexpr size_t LookupStructureFactory::default_direct_max_bits;
+constexpr size_t LookupStructureFactory::max_direct_max_bits;
+constexpr size_t LookupStructureFactory::direct_min_fill;
+
+void
+LookupStructureFactory::set_direct_max_bits(size_t max_bits) {
+  direct_max_bits = std::min(max_bits, max_direct_max_bits);
+}
+
+bool
+LookupStructureFactory::use_direct_lookup(size_t size,
+                                          size_t nbytes_key) const {
+  const size_t nbits_key = nbytes_key * 8;
+  if (nbits_key > direct_max_bits) return false;
+  // the direct-indexed array has 2^bits slots, whatever the size of the table
+  return size >= (size_t(1) << nbits_key) / direct_min_fill;
+}
+
 std::unique_ptr<RangeLookupStructure>
 LookupStructureFactory::create_for_range(size_t size, size_t nbytes_key) {
   return std::unique_ptr<RangeLookupStructure>(new RangeMap(size, nbytes_key));
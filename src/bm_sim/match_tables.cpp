@@ -24,7 +24,12 @@
 #include <bm/bm_sim/lookup_structures.h>
 #include <bm/bm_sim/P4Objects.h>
 
+#include <algorithm>  // std::min
+#include <array>
+#include <memory>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 #include <limits>  // std::numeric_limits
 
@@ -100,6 +105,42 @@ MatchTableAbstract::apply_action(Packet *pkt) {
 
   const ActionEntry &action_entry = lookup(*pkt, &hit, &handle);
 
+  return apply_entry_(pkt, action_entry, hit, handle);
+}
+
+void
+MatchTableAbstract::apply_action_batch(Packet *const *pkts, size_t n,
+                                       const ControlFlowNode **next) {
+  // the lookup results are kept on the stack, so we go through the batch in
+  // chunks of bounded size
+  static constexpr size_t max_chunk = 64;
+  struct LookupResult {
+    const ActionEntry *action_entry;
+    entry_handle_t handle;
+    bool hit;
+  };
+  std::array<LookupResult, max_chunk> results;
+
+  ReadLock lock = lock_read();
+
+  for (size_t start = 0; start < n; start += max_chunk) {
+    const size_t chunk = std::min(n - start, max_chunk);
+    for (size_t i = 0; i < chunk; i++) {
+      auto &r = results[i];
+      r.action_entry = &lookup(*pkts[start + i], &r.hit, &r.handle);
+      __builtin_prefetch(r.action_entry);
+    }
+    for (size_t i = 0; i < chunk; i++) {
+      const auto &r = results[i];
+      next[start + i] = apply_entry_(pkts[start + i], *r.action_entry, r.hit,
+                                     r.handle);
+    }
+  }
+}
+
+const ControlFlowNode *
+MatchTableAbstract::apply_entry_(Packet *pkt, const ActionEntry &action_entry,
+                                 bool hit, entry_handle_t handle) {
   if (hit && with_meters) {
     // we only execute the direct meter if hit, should we have a miss meter?
     Field &target_f = pkt->get_phv()->get_field(
@@ -135,6 +176,7 @@ void
 MatchTableAbstract::reset_state() {
   WriteLock lock = lock_write();
   reset_state_();
+  change_log.reset();
 }
 
 void
@@ -159,6 +201,7 @@ MatchTableAbstract::deserialize(std::istream *in, const P4Objects &objs) {
     assert(next_node_miss);
   }
   deserialize_(in, objs);
+  change_log.reset();
 }
 
 void
@@ -271,6 +314,40 @@ MatchTableAbstract::handles_end() const {
   return handle_iterator(this, match_unit_->handles_end());
 }
 
+MatchTableAbstract::seq_t
+MatchTableAbstract::get_change_seq() const {
+  ReadLock lock = lock_read();
+  return change_log.get_last_seq();
+}
+
+void
+MatchTableAbstract::set_change_notifications(
+    std::shared_ptr<TransportIface> transport, int device_id, int cxt_id) {
+  WriteLock lock = lock_write();
+  change_log.set_notifications(std::move(transport), device_id, cxt_id,
+                               get_id());
+}
+
+MatchErrorCode
+MatchTableAbstract::get_changed_handles_(seq_t since,
+                                         std::vector<entry_handle_t> *handles,
+                                         bool *default_entry_changed,
+                                         seq_t *last_seq) const {
+  std::vector<TableChangeLog::Record> records;
+  if (!change_log.get_since(since, &records))
+    return MatchErrorCode::CHANGES_UNAVAILABLE;
+  std::unordered_set<entry_handle_t> seen;
+  *default_entry_changed = false;
+  for (const auto &record : records) {
+    if (record.type == TableChangeLog::ChangeType::SET_DEFAULT)
+      *default_entry_changed = true;
+    else if (seen.insert(record.handle).second)
+      handles->push_back(record.handle);
+  }
+  *last_seq = change_log.get_last_seq();
+  return MatchErrorCode::SUCCESS;
+}
+
 const ControlFlowNode *
 MatchTableAbstract::get_next_node(p4object_id_t action_id) const {
   if (has_next_node_hit)
@@ -327,6 +404,8 @@ MatchTable::add_entry(const std::vector<MatchKeyParam> &match_key,
         match_key,
         ActionEntry(std::move(action_fn_entry), next_node),
         handle, priority);
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::ADD, *handle);
   }
 
   // because we let go of the lock, there is a possibility of the entry being
@@ -354,6 +433,8 @@ MatchTable::delete_entry(entry_handle_t handle) {
   {
     WriteLock lock = lock_write();
     rc = match_unit->delete_entry(handle);
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::DELETE, handle);
   }
 
   if (rc == MatchErrorCode::SUCCESS) {
@@ -378,6 +459,8 @@ MatchTable::modify_entry(entry_handle_t handle,
     const ControlFlowNode *next_node = get_next_node(action_fn->get_id());
     rc = match_unit->modify_entry(
         handle, ActionEntry(std::move(action_fn_entry), next_node));
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::MODIFY, handle);
   }
 
   if (rc == MatchErrorCode::SUCCESS) {
@@ -406,6 +489,7 @@ MatchTable::set_default_action(const ActionFn *action_fn,
   {
     WriteLock lock = lock_write();
     default_entry = ActionEntry(std::move(action_fn_entry), next_node);
+    log_change(TableChangeLog::ChangeType::SET_DEFAULT);
   }
 
   BMLOG_DEBUG("Set default entry for table '{}': {}",
@@ -450,6 +534,40 @@ MatchTable::get_entries() const {
   return entries;
 }
 
+size_t
+MatchTable::get_entries_page(size_t cursor, size_t max_entries,
+                             std::vector<Entry> *entries) const {
+  ReadLock lock = lock_read();
+  std::vector<entry_handle_t> handles;
+  size_t next_cursor = match_unit->get_handles_page(
+      cursor, max_entries, &handles);
+  entries->resize(entries->size() + handles.size());
+  auto entry_it = entries->end() - handles.size();
+  for (const auto handle : handles) {
+    MatchErrorCode rc = get_entry_(handle, &*entry_it++);
+    assert(rc == MatchErrorCode::SUCCESS);
+  }
+  return next_cursor;
+}
+
+MatchErrorCode
+MatchTable::get_entries_since(seq_t since, Changes *changes) const {
+  ReadLock lock = lock_read();
+  std::vector<entry_handle_t> handles;
+  MatchErrorCode rc = get_changed_handles_(
+      since, &handles, &changes->default_entry_changed, &changes->last_seq);
+  if (rc != MatchErrorCode::SUCCESS) return rc;
+  for (auto handle : handles) {
+    Entry entry;
+    // the entry was deleted if its handle is no longer valid
+    if (get_entry_(handle, &entry) == MatchErrorCode::SUCCESS)
+      changes->entries.push_back(std::move(entry));
+    else
+      changes->deleted.push_back(handle);
+  }
+  return MatchErrorCode::SUCCESS;
+}
+
 MatchErrorCode
 MatchTable::get_default_entry(Entry *entry) const {
   ReadLock lock = lock_read();
@@ -678,6 +796,8 @@ MatchTableIndirect::add_entry(const std::vector<MatchKeyParam> &match_key,
       index_ref_count.increase(index);
       rc = match_unit->add_entry(match_key, std::move(index), handle, priority);
     }
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::ADD, *handle);
   }
 
   if (rc == MatchErrorCode::SUCCESS) {
@@ -705,6 +825,8 @@ MatchTableIndirect::delete_entry(entry_handle_t handle) {
 
       rc = match_unit->delete_entry(handle);
     }
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::DELETE, handle);
   }
 
   if (rc == MatchErrorCode::SUCCESS) {
@@ -739,6 +861,8 @@ MatchTableIndirect::modify_entry(entry_handle_t handle, mbr_hdl_t mbr) {
 
       rc = match_unit->modify_entry(handle, std::move(new_index));
     }
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::MODIFY, handle);
   }
 
   if (rc == MatchErrorCode::SUCCESS) {
@@ -764,6 +888,7 @@ MatchTableIndirect::set_default_member(mbr_hdl_t mbr) {
     } else {
       default_index = IndirectIndex::make_mbr_index(mbr);
       default_set = true;
+      log_change(TableChangeLog::ChangeType::SET_DEFAULT);
     }
   }
 
@@ -811,6 +936,40 @@ MatchTableIndirect::get_entries() const {
   return entries;
 }
 
+size_t
+MatchTableIndirect::get_entries_page(size_t cursor, size_t max_entries,
+                                     std::vector<Entry> *entries) const {
+  ReadLock lock = lock_read();
+  std::vector<entry_handle_t> handles;
+  size_t next_cursor = match_unit->get_handles_page(
+      cursor, max_entries, &handles);
+  entries->resize(entries->size() + handles.size());
+  auto entry_it = entries->end() - handles.size();
+  for (const auto handle : handles) {
+    MatchErrorCode rc = get_entry_(handle, &*entry_it++);
+    assert(rc == MatchErrorCode::SUCCESS);
+  }
+  return next_cursor;
+}
+
+MatchErrorCode
+MatchTableIndirect::get_entries_since(seq_t since, Changes *changes) const {
+  ReadLock lock = lock_read();
+  std::vector<entry_handle_t> handles;
+  MatchErrorCode rc = get_changed_handles_(
+      since, &handles, &changes->default_entry_changed, &changes->last_seq);
+  if (rc != MatchErrorCode::SUCCESS) return rc;
+  for (auto handle : handles) {
+    Entry entry;
+    // the entry was deleted if its handle is no longer valid
+    if (get_entry_(handle, &entry) == MatchErrorCode::SUCCESS)
+      changes->entries.push_back(std::move(entry));
+    else
+      changes->deleted.push_back(handle);
+  }
+  return MatchErrorCode::SUCCESS;
+}
+
 MatchErrorCode
 MatchTableIndirect::get_default_entry(Entry *entry) const {
   ReadLock lock = lock_read();
@@ -850,6 +1009,21 @@ MatchTableIndirect::get_members() const {
   return members;
 }
 
+size_t
+MatchTableIndirect::get_members_page(size_t cursor, size_t max_members,
+                                     std::vector<Member> *members) const {
+  ReadLock lock = lock_read();
+  std::vector<handle_t> handles;
+  size_t next_cursor = mbr_handles.get_page(cursor, max_members, &handles);
+  members->resize(members->size() + handles.size());
+  auto member_it = members->end() - handles.size();
+  for (const auto h : handles) {
+    MatchErrorCode rc = get_member_(h, &*member_it++);
+    assert(rc == MatchErrorCode::SUCCESS);
+  }
+  return next_cursor;
+}
+
 MatchErrorCode
 MatchTableIndirect::dump_entry_common(std::ostream *out,
                                       entry_handle_t handle,
@@ -1205,6 +1379,8 @@ MatchTableIndirectWS::add_entry_ws(const std::vector<MatchKeyParam> &match_key,
       index_ref_count.increase(index);
       rc = match_unit->add_entry(match_key, std::move(index), handle, priority);
     }
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::ADD, *handle);
   }
 
   if (rc == MatchErrorCode::SUCCESS) {
@@ -1242,6 +1418,8 @@ MatchTableIndirectWS::modify_entry_ws(entry_handle_t handle, grp_hdl_t grp) {
 
       rc = match_unit->modify_entry(handle, std::move(new_index));
     }
+    if (rc == MatchErrorCode::SUCCESS)
+      log_change(TableChangeLog::ChangeType::MODIFY, handle);
   }
 
   if (rc == MatchErrorCode::SUCCESS) {
@@ -1267,6 +1445,7 @@ MatchTableIndirectWS::set_default_group(grp_hdl_t grp) {
     } else {
       default_index = IndirectIndex::make_grp_index(grp);
       default_set = true;
+      log_change(TableChangeLog::ChangeType::SET_DEFAULT);
     }
   }
 
@@ -1320,6 +1499,40 @@ MatchTableIndirectWS::get_entries() const {
   return entries;
 }
 
+size_t
+MatchTableIndirectWS::get_entries_page(size_t cursor, size_t max_entries,
+                                       std::vector<Entry> *entries) const {
+  ReadLock lock = lock_read();
+  std::vector<entry_handle_t> handles;
+  size_t next_cursor = match_unit->get_handles_page(
+      cursor, max_entries, &handles);
+  entries->resize(entries->size() + handles.size());
+  auto entry_it = entries->end() - handles.size();
+  for (const auto handle : handles) {
+    MatchErrorCode rc = get_entry_(handle, &*entry_it++);
+    assert(rc == MatchErrorCode::SUCCESS);
+  }
+  return next_cursor;
+}
+
+MatchErrorCode
+MatchTableIndirectWS::get_entries_since(seq_t since, Changes *changes) const {
+  ReadLock lock = lock_read();
+  std::vector<entry_handle_t> handles;
+  MatchErrorCode rc = get_changed_handles_(
+      since, &handles, &changes->default_entry_changed, &changes->last_seq);
+  if (rc != MatchErrorCode::SUCCESS) return rc;
+  for (auto handle : handles) {
+    Entry entry;
+    // the entry was deleted if its handle is no longer valid
+    if (get_entry_(handle, &entry) == MatchErrorCode::SUCCESS)
+      changes->entries.push_back(std::move(entry));
+    else
+      changes->deleted.push_back(handle);
+  }
+  return MatchErrorCode::SUCCESS;
+}
+
 MatchErrorCode
 MatchTableIndirectWS::get_default_entry(Entry *entry) const {
   ReadLock lock = lock_read();
@@ -1364,6 +1577,21 @@ MatchTableIndirectWS::get_groups() const {
   return groups;
 }
 
+size_t
+MatchTableIndirectWS::get_groups_page(size_t cursor, size_t max_groups,
+                                      std::vector<Group> *groups) const {
+  ReadLock lock = lock_read();
+  std::vector<handle_t> handles;
+  size_t next_cursor = grp_handles.get_page(cursor, max_groups, &handles);
+  groups->resize(groups->size() + handles.size());
+  auto group_it = groups->end() - handles.size();
+  for (const auto h : handles) {
+    MatchErrorCode rc = get_group_(h, &*group_it++);
+    assert(rc == MatchErrorCode::SUCCESS);
+  }
+  return next_cursor;
+}
+
 MatchErrorCode
 MatchTableIndirectWS::get_num_members_in_group(grp_hdl_t grp,
                                                size_t *nb) const {
@@ -650,6 +650,17 @@ MatchUnitAbstract_::handles_end() const {
   return handle_iterator(this, handles.end());
 }
 
+size_t
+MatchUnitAbstract_::get_handles_page(size_t cursor, size_t max_handles,
+                                     std::vector<entry_handle_t> *page) const {
+  std::vector<handle_t> internal_handles;
+  size_t next_cursor = handles.get_page(cursor, max_handles, &internal_handles);
+  page->reserve(page->size() + internal_handles.size());
+  for (const auto h : internal_handles)
+    page->push_back(HANDLE_SET(entry_meta.at(h).version, h));
+  return next_cursor;
+}
+
 MatchUnitAbstract_::MatchUnitAbstract_(size_t size,
                                        const MatchKeyBuilder &key_builder)
     : size(size), nbytes_key(key_builder.get_nbytes_key()),
@@ -973,7 +984,8 @@ MatchUnitGeneric<K, V>::delete_entry_(entry_handle_t handle) {
   Entry &entry = entries[handle_];
   if (HANDLE_VERSION(handle) != entry.key.version)
     return MatchErrorCode::EXPIRED_HANDLE;
-  entry.key.version += 1;
+  // the handle only has room for the 8 low bits of the version
+  entry.key.version = (entry.key.version + 1) & 0xff;
   lookup_structure->delete_entry(entry.key);
 
   return this->unset_handle(handle_);
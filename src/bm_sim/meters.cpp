@@ -21,43 +21,178 @@
 #include <bm/bm_sim/meters.h>
 
 #include <algorithm>
+#include <limits>
+#include <cmath>
+#include <thread>
+#include <condition_variable>
 
 namespace bm {
 
 typedef Meter::MeterErrorCode MeterErrorCode;
 
-using ticks = std::chrono::microseconds;  // better with nanoseconds ?
+using std::chrono::microseconds;
 using std::chrono::duration_cast;
 
 namespace {
 
 Meter::clock::time_point time_init = Meter::clock::now();
 
+uint64_t
+nanos_since_init() {
+  return duration_cast<std::chrono::nanoseconds>(
+      Meter::clock::now() - time_init).count();
+}
+
+// Shared clock used by all meters when a non-zero precision is requested with
+// Meter::set_clock_precision(). A single thread refreshes the timestamp and the
+// data path only needs to do an atomic load.
+class CoarseClock {
+ public:
+  ~CoarseClock() {
+    stop();
+  }
+
+  void start(microseconds precision) {
+    stop();
+    std::unique_lock<std::mutex> lock(mutex);
+    refresh();
+    stop_thread = false;
+    update_thread = std::thread(&CoarseClock::update_loop, this, precision);
+    enabled.store(true, std::memory_order_release);
+  }
+
+  void stop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!update_thread.joinable()) return;
+    enabled.store(false, std::memory_order_release);
+    stop_thread = true;
+    lock.unlock();
+    cv.notify_one();
+    update_thread.join();
+  }
+
+  void refresh() {
+    now.store(nanos_since_init(), std::memory_order_relaxed);
+  }
+
+  uint64_t get() const {
+    if (enabled.load(std::memory_order_acquire))
+      return now.load(std::memory_order_relaxed);
+    return nanos_since_init();
+  }
+
+ private:
+  void update_loop(microseconds precision) {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stop_thread) {
+      cv.wait_for(lock, precision);
+      refresh();
+    }
+  }
+
+  std::atomic<bool> enabled{false};
+  std::atomic<uint64_t> now{0};
+  std::thread update_thread{};
+  bool stop_thread{false};
+  std::mutex mutex{};
+  std::condition_variable cv{};
+};
+
+CoarseClock coarse_clock;
+
+// a rate of 0 would mean an infinite time per token, we cap it to ~11 days
+constexpr double max_ns_per_token = 1e15;
+
+uint64_t
+saturating_ns(double ns) {
+  constexpr double max_ns = std::numeric_limits<uint64_t>::max() / 4;
+  return static_cast<uint64_t>(std::min(ns, max_ns) + 0.5);
+}
+
 }  // namespace
 
+Meter::MeterRate::MeterRate(const MeterRate &other)
+    : info_rate(other.info_rate), burst_size(other.burst_size),
+      ns_per_token(other.ns_per_token.load()),
+      burst_ns(other.burst_ns.load()), full_at(other.full_at.load()),
+      color(other.color) { }
+
+Meter::MeterRate &
+Meter::MeterRate::operator=(const MeterRate &other) {
+  info_rate = other.info_rate;
+  burst_size = other.burst_size;
+  ns_per_token.store(other.ns_per_token.load());
+  burst_ns.store(other.burst_ns.load());
+  full_at.store(other.full_at.load());
+  color = other.color;
+  return *this;
+}
+
+// I tried to make this as accurate as I could. Everything is computed in
+// nanoseconds since a single time point (init) and, just like in the previous
+// mutex-based implementation, tokens are only generated at multiples of the
+// token period since init, which is why we align the current time on that grid
+// before refilling. If another thread read the clock after us and already
+// updated the state, max() ensures we do not refill the bucket twice.
+bool
+Meter::MeterRate::consume(uint64_t now, size_t input) {
+  const double period = ns_per_token.load(std::memory_order_relaxed);
+  const uint64_t cost = saturating_ns(input * period);
+  const uint64_t burst = burst_ns.load(std::memory_order_relaxed);
+  const uint64_t now_aligned = saturating_ns(std::floor(now / period) * period);
+  uint64_t old_full_at = full_at.load(std::memory_order_relaxed);
+  while (true) {
+    const uint64_t new_full_at = std::max(old_full_at, now_aligned) + cost;
+    // not enough tokens: the state is left unchanged
+    if (new_full_at - now_aligned > burst) return false;
+    if (full_at.compare_exchange_weak(old_full_at, new_full_at,
+                                      std::memory_order_relaxed))
+      return true;
+  }
+}
+
+Meter::Meter(Meter &&other) noexcept
+    : type(other.type), m_mutex(std::move(other.m_mutex)),
+      rates(std::move(other.rates)), configured(other.configured.load()) { }
+
+Meter &
+Meter::operator=(Meter &&other) noexcept {
+  type = other.type;
+  m_mutex = std::move(other.m_mutex);
+  rates = std::move(other.rates);
+  configured.store(other.configured.load());
+  return *this;
+}
+
 MeterErrorCode
+Meter::check_rate(const rate_config_t *prev, const rate_config_t &config) {
+  if (config.info_rate < 0) return INVALID_INFO_RATE_VALUE;
+  if (prev && prev->info_rate > config.info_rate)
+    return INVALID_INFO_RATE_VALUE;
+  return SUCCESS;
+}
+
+// rates are provided from the smallest to the highest rate, but are stored in
+// the reverse order, since execute() needs to check the highest rate first
+void
 Meter::set_rate(size_t idx, const rate_config_t &config) {
-  MeterRate &rate = rates[idx];
-  rate.valid = true;
+  MeterRate &rate = rates[rates.size() - 1 - idx];
   rate.info_rate = config.info_rate;
   rate.burst_size = config.burst_size;
-  rate.tokens = config.burst_size;
-  rate.tokens_last = 0u;
+  const double ns_per_token = (config.info_rate > 0) ?
+      std::min(1000. / config.info_rate, max_ns_per_token) : max_ns_per_token;
+  rate.ns_per_token.store(ns_per_token, std::memory_order_relaxed);
+  rate.burst_ns.store(saturating_ns(config.burst_size * ns_per_token),
+                      std::memory_order_relaxed);
+  // the bucket is full
+  rate.full_at.store(0u, std::memory_order_relaxed);
   rate.color = (idx + 1);
-  if (idx > 0) {
-    MeterRate &prev_rate = rates[idx - 1];
-    if (prev_rate.info_rate > rate.info_rate) return INVALID_INFO_RATE_VALUE;
-  }
-  return SUCCESS;
 }
 
 MeterErrorCode
 Meter::reset_rates() {
   auto lock = unique_lock();
-  for (MeterRate &rate : rates) {
-    rate.valid = false;
-  }
-  configured = false;
+  configured.store(false, std::memory_order_release);
   return SUCCESS;
 }
 
@@ -65,35 +200,16 @@ Meter::color_t
 Meter::execute(const Packet &pkt) {
   color_t packet_color = 0;
 
-  if (!configured) return packet_color;
-
-  clock::time_point now = clock::now();
-  int64_t micros_since_init = duration_cast<ticks>(now - time_init).count();
+  if (!configured.load(std::memory_order_acquire)) return packet_color;
 
-  auto lock = unique_lock();
+  const uint64_t now = coarse_clock.get();
+  const size_t input =
+      (type == MeterType::PACKETS) ? 1u : pkt.get_ingress_length();
 
-  /* I tried to make this as accurate as I could. Everything is computed
-     compared to a single time point (init). I do not use the interval since
-     last update, because it would require multiple consecutive
-     approximations. Maybe this is an overkill or I am underestimating the code
-     I wrote for BMv1.
-     The only thing that could go wrong is if tokens_since_init grew too large,
-     but I think it would take years even at high throughput */
   for (MeterRate &rate : rates) {
-    uint64_t tokens_since_init =
-      static_cast<uint64_t>(micros_since_init * rate.info_rate);
-    assert(tokens_since_init >= rate.tokens_last);
-    size_t new_tokens = tokens_since_init - rate.tokens_last;
-    rate.tokens_last = tokens_since_init;
-    rate.tokens = std::min(rate.tokens + new_tokens, rate.burst_size);
-
-    size_t input = (type == MeterType::PACKETS) ? 1u : pkt.get_ingress_length();
-
-    if (rate.tokens < input) {
+    if (!rate.consume(now, input)) {
       packet_color = rate.color;
       break;
-    } else {
-      rate.tokens -= input;
     }
   }
 
@@ -103,8 +219,9 @@ Meter::execute(const Packet &pkt) {
 void
 Meter::serialize(std::ostream *out) const {
   auto lock = unique_lock();
-  (*out) << configured << "\n";
-  if (configured) {
+  bool is_configured = configured.load();
+  (*out) << is_configured << "\n";
+  if (is_configured) {
     for (const auto &rate : rates)
       (*out) << rate.info_rate << " " << rate.burst_size << "\n";
   }
@@ -113,20 +230,33 @@ Meter::serialize(std::ostream *out) const {
 void
 Meter::deserialize(std::istream *in) {
   auto lock = unique_lock();
-  (*in) >> configured;
-  if (configured) {
+  bool is_configured;
+  (*in) >> is_configured;
+  if (is_configured) {
+    // rates were serialized in storage order, i.e. from the highest rate to
+    // the smallest one
     for (size_t i = 0; i < rates.size(); i++) {
       rate_config_t config;
       (*in) >> config.info_rate;
       (*in) >> config.burst_size;
-      set_rate(i, config);
+      set_rate(rates.size() - 1 - i, config);
     }
   }
+  configured.store(is_configured, std::memory_order_release);
+}
+
+void
+Meter::set_clock_precision(std::chrono::microseconds precision) {
+  if (precision.count() > 0)
+    coarse_clock.start(precision);
+  else
+    coarse_clock.stop();
 }
 
 void
 Meter::reset_global_clock() {
   time_init = Meter::clock::now();
+  coarse_clock.refresh();
 }
 
 
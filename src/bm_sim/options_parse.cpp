@@ -98,11 +98,25 @@ OptionsParser::parse(int argc, char *argv[], TargetParserIface *tp) {
        "The --interface options will be ignored.")
       ("thrift-port", po::value<int>(),
        "TCP port on which to run the Thrift runtime server")
+      ("thrift-server", po::value<std::string>(),
+       "Thrift runtime server type, 'threaded' (one thread per connection, "
+       "buffered transport) or 'nonblocking' (event-driven, framed transport, "
+       "requests are executed by a pool of --thrift-workers threads and "
+       "clients can pipeline requests on a connection) (default: threaded)")
+      ("thrift-protocol", po::value<std::string>(),
+       "Thrift protocol used by the runtime server, 'binary' or 'compact' "
+       "(default: binary)")
+      ("thrift-workers", po::value<int>(),
+       "Number of threads executing the requests received by the "
+       "'nonblocking' Thrift server (default: 4)")
       ("device-id", po::value<int>(),
        "Device ID, used to identify the device in IPC messages (default 0)")
       ("nanolog", po::value<std::string>(),
        "IPC socket to use for nanomsg pub/sub logs "
        "(default: no nanomsg logging")
+      ("nanolog-sampling", po::value<unsigned int>(),
+       "Only publish nanomsg pub/sub logs for 1 packet out of N "
+       "(default: 1, i.e. all packets)")
       ("log-console",
        "Enable logging on stdout")
       ("log-file", po::value<std::string>(),
@@ -116,15 +130,19 @@ OptionsParser::parse(int argc, char *argv[], TargetParserIface *tp) {
        "Specify the nanomsg address to use for notifications "
        "(e.g. learning, ageing, ...); "
        "default is ipc:///tmp/bmv2-<device-id>-notifications.ipc")
-#ifdef BMDEBUG_ON
-      ("debugger", "Activate debugger")
+      ("debugger", "Activate debugger; a debugger client can then attach to "
+       "the switch at any time")
       ("debugger-addr", po::value<std::string>(),
        "Specify the nanomsg address to use for debugger communication; "
        "there is no need to use --debugger in addition to this option; "
        "default is ipc:///tmp/bmv2-<device-id>-debug.ipc")
-#endif
       ("restore-state", po::value<std::string>(),
        "Restore state from file")
+      ("meter-clock-precision", po::value<int>(),
+       "Precision (in microseconds) of the shared clock used by meters; "
+       "when non-zero, meters do not read the system clock for every packet "
+       "but instead use a timestamp refreshed by a background thread "
+       "(default: 0, i.e. read the clock for every packet)")
       ("version,v", "Display version information")
       ;  // NOLINT(whitespace/semicolon)
 
@@ -212,6 +230,12 @@ OptionsParser::parse(int argc, char *argv[], TargetParserIface *tp) {
     auto event_transport = TransportIface::make_nanomsg(event_logger_addr);
     event_transport->open();
     EventLogger::init(std::move(event_transport), device_id);
+    if (vm.count("nanolog-sampling"))
+      EventLogger::get()->set_sampling_rate(
+          vm["nanolog-sampling"].as<unsigned int>());
+    // messages are published by a dedicated thread, so that the packet
+    // processing threads never block on the nanomsg socket
+    EventLogger::get()->start_async_writer();
 #endif
   }
 
@@ -305,10 +329,44 @@ OptionsParser::parse(int argc, char *argv[], TargetParserIface *tp) {
     thrift_port = default_thrift_port;
   }
 
+  if (vm.count("thrift-server")) {
+    const auto &server = vm["thrift-server"].as<std::string>();
+    if (server == "nonblocking") {
+      thrift_nonblocking = true;
+    } else if (server != "threaded") {
+      std::cout << "Error: invalid value for --thrift-server: " << server
+                << "\n";
+      exit(1);
+    }
+  }
+
+  if (vm.count("thrift-protocol")) {
+    const auto &protocol = vm["thrift-protocol"].as<std::string>();
+    if (protocol == "compact") {
+      thrift_compact = true;
+    } else if (protocol != "binary") {
+      std::cout << "Error: invalid value for --thrift-protocol: " << protocol
+                << "\n";
+      exit(1);
+    }
+  }
+
+  if (vm.count("thrift-workers")) {
+    thrift_workers = vm["thrift-workers"].as<int>();
+    if (thrift_workers < 1)
+      thrift_workers = 1;
+  }
+
   if (vm.count("restore-state")) {
     state_file_path = vm["restore-state"].as<std::string>();
   }
 
+  if (vm.count("meter-clock-precision")) {
+    meter_clock_precision_us = vm["meter-clock-precision"].as<int>();
+    if (meter_clock_precision_us < 0)
+      meter_clock_precision_us = 0;
+  }
+
   if (tp) {
     std::cout << "Calling target program-options parser\n";
     if (tp->parse(to_pass_further, &std::cout)) {
@@ -19,9 +19,11 @@
  */
 
 #include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/packet_tracer.h>
 
 #include <algorithm>  // for swap
 #include <atomic>
+#include <limits>
 
 #include "xxhash.h"
 
@@ -98,6 +100,7 @@ Packet::Packet(size_t cxt_id, int ingress_port, packet_id_t id,
   set_ingress_ts();
   phv = phv_source->get(cxt_id);
   phv->set_packet_id(packet_id, copy_id);
+  traced = PacketTracer::get()->select(*this);
   DEBUGGER_PACKET_IN(PacketId::make(packet_id, copy_id), ingress_port);
 }
 
@@ -125,6 +128,7 @@ Packet::change_context(size_t new_cxt) {
   phv->reset_header_stacks();
   phv_source->release(cxt_id, std::move(phv));
   phv = phv_source->get(new_cxt);
+  phv->set_packet_id(packet_id, copy_id);
   cxt_id = new_cxt;
 }
 
@@ -152,6 +156,7 @@ Packet::clone_with_phv() const {
   Packet pkt(cxt_id, ingress_port, packet_id, new_copy_id, ingress_length,
              buffer.clone(buffer.get_data_size()), phv_source);
   pkt.phv->copy_headers(*phv);
+  pkt.traced = traced;
   // return std::move(pkt);
   // Enable NRVO
   return pkt;
@@ -170,6 +175,7 @@ Packet::clone_with_phv_reset_metadata() const {
   // TODO(antonin): optimize this
   pkt.phv->copy_headers(*phv);
   pkt.phv->reset_metadata();
+  pkt.traced = traced;
   // return std::move(pkt);
   // Enable NRVO
   return pkt;
@@ -180,11 +186,24 @@ Packet::clone_with_phv_reset_metadata_ptr() const {
   return std::unique_ptr<Packet>(new Packet(clone_with_phv_reset_metadata()));
 }
 
+std::unique_ptr<Packet>
+Packet::clone_with_phv_reset_metadata_ptr(size_t max_data_size) const {
+  copy_id_t new_copy_id = copy_id_gen->add_one(packet_id);
+  std::unique_ptr<Packet> pkt(new Packet(
+      cxt_id, ingress_port, packet_id, new_copy_id, ingress_length,
+      clone_buffer(max_data_size), phv_source));
+  pkt->phv->copy_headers(*phv);
+  pkt->phv->reset_metadata();
+  pkt->traced = traced;
+  return pkt;
+}
+
 Packet
 Packet::clone_choose_context(size_t new_cxt) const {
   copy_id_t new_copy_id = copy_id_gen->add_one(packet_id);
   Packet pkt(new_cxt, ingress_port, packet_id, new_copy_id, ingress_length,
              buffer.clone(buffer.get_data_size()), phv_source);
+  pkt.traced = traced;
   // return std::move(pkt);
   // Enable NRVO
   return pkt;
@@ -205,6 +224,39 @@ Packet::clone_no_phv_ptr() const {
   return clone_choose_context_ptr(cxt_id);
 }
 
+void
+Packet::recycle() {
+  const copy_id_t new_copy_id = copy_id_gen->add_one(packet_id);
+  copy_id_gen->remove_one(packet_id);
+  DEBUGGER_PACKET_OUT(PacketId::make(packet_id, copy_id), egress_port);
+  copy_id = new_copy_id;
+  egress_port = -1;
+  flags = 0;
+  payload_size = 0;
+  truncated_length = std::numeric_limits<size_t>::max();
+  update_signature();
+  set_ingress_ts();
+  phv->set_packet_id(packet_id, copy_id);
+  DEBUGGER_PACKET_IN(PacketId::make(packet_id, copy_id), ingress_port);
+}
+
+std::unique_ptr<Packet>
+Packet::clone_no_phv_ptr(size_t max_data_size) const {
+  copy_id_t new_copy_id = copy_id_gen->add_one(packet_id);
+  std::unique_ptr<Packet> pkt(new Packet(
+      cxt_id, ingress_port, packet_id, new_copy_id, ingress_length,
+      clone_buffer(max_data_size), phv_source));
+  pkt->traced = traced;
+  return pkt;
+}
+
+PacketBuffer
+Packet::clone_buffer(size_t max_data_size) const {
+  const size_t data_size = buffer.get_data_size();
+  if (max_data_size >= data_size) return buffer.clone(data_size);
+  return buffer.clone_start(max_data_size);
+}
+
 /* Cannot get away with defaults here, we need to swap the phvs, otherwise we
    could "leak" the old phv (i.e. not put it back into the pool) */
 
@@ -212,7 +264,8 @@ Packet::Packet(Packet &&other) noexcept
     : cxt_id(other.cxt_id), ingress_port(other.ingress_port),
       egress_port(other.egress_port), packet_id(other.packet_id),
       copy_id(other.copy_id), ingress_length(other.ingress_length),
-      signature(other.signature), payload_size(other.payload_size),
+      traced(other.traced), signature(other.signature),
+      payload_size(other.payload_size),
       ingress_ts(other.ingress_ts), ingress_ts_ms(other.ingress_ts_ms),
   phv_source(other.phv_source), registers(other.registers) {
   buffer = std::move(other.buffer);
@@ -227,6 +280,7 @@ Packet::operator=(Packet &&other) noexcept {
   packet_id = other.packet_id;
   copy_id = other.copy_id;
   ingress_length = other.ingress_length;
+  traced = other.traced;
   signature = other.signature;
   payload_size = other.payload_size;
   ingress_ts = other.ingress_ts;
@@ -0,0 +1,83 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/packet_tracer.h>
+#include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/phv.h>
+
+#include <algorithm>
+
+namespace bm {
+
+void
+PacketTracer::enable(const Config &config) {
+  auto new_config = std::make_shared<Config>(config);
+  std::sort(new_config->ports.begin(), new_config->ports.end());
+  std::atomic_store(&this->config,
+                    std::shared_ptr<const Config>(std::move(new_config)));
+  with_field_matches.store(!config.field_matches.empty());
+  armed.store(true);
+}
+
+void
+PacketTracer::disable() {
+  armed.store(false);
+  with_field_matches.store(false);
+  std::atomic_store(&config, std::shared_ptr<const Config>(nullptr));
+}
+
+bool
+PacketTracer::get_config(Config *config) const {
+  auto current = std::atomic_load(&this->config);
+  if (!current) return false;
+  *config = *current;
+  return true;
+}
+
+bool
+PacketTracer::match_ingress(const Config &config, const Packet &pkt) const {
+  if (!config.ports.empty() &&
+      !std::binary_search(config.ports.begin(), config.ports.end(),
+                          pkt.get_ingress_port()))
+    return false;
+  return config.sampling_rate <= 1 ||
+      pkt.get_packet_id() % config.sampling_rate == 0;
+}
+
+bool
+PacketTracer::select_(const Packet &pkt) const {
+  auto current = std::atomic_load(&config);
+  if (!current) return false;
+  // the field matches will be evaluated once the packet has been parsed
+  if (!current->field_matches.empty()) return false;
+  return match_ingress(*current, pkt);
+}
+
+void
+PacketTracer::select_after_parse_(Packet *pkt) const {
+  auto current = std::atomic_load(&config);
+  if (!current || current->field_matches.empty()) return;
+  if (!match_ingress(*current, *pkt)) return;
+  const PHV &phv = *pkt->get_phv();
+  for (const auto &m : current->field_matches) {
+    if (!phv.has_field(m.field_name)) return;
+    const auto header_name = m.field_name.substr(0, m.field_name.rfind('.'));
+    if (!phv.get_header(header_name).is_valid()) return;
+    if (phv.get_field(m.field_name) != m.value) return;
+  }
+  pkt->set_traced(true);
+}
+
+}  // namespace bm
@@ -20,6 +20,8 @@
 
 #include <bm/bm_sim/parser.h>
 #include <bm/bm_sim/debugger.h>
+#include <bm/bm_sim/packet_tracer.h>
+#include <bm/bm_sim/perf_counters.h>
 #include "extract.h"
 
 namespace bm {
@@ -199,6 +201,8 @@ Parser::parse(Packet *pkt) const {
       Debugger::PacketId::make(pkt->get_packet_id(), pkt->get_copy_id()),
       DBG_CTR_PARSER | get_id());
   BMLOG_DEBUG_PKT(*pkt, "Parser '{}': start", get_name());
+  PerfCounters::Sample perf_sample(*pkt, PerfCounters::ObjectType::PARSER,
+                                   *this);
   const char *data = pkt->data();
   if (!init_state) return;
   const ParseState *next_state = init_state;
@@ -208,6 +212,7 @@ Parser::parse(Packet *pkt) const {
     BMLOG_TRACE("Bytes parsed: {}", bytes_parsed);
   }
   pkt->remove(bytes_parsed);
+  PacketTracer::get()->select_after_parse(pkt);
   BMELOG(parser_done, *pkt, *this);
   DEBUGGER_NOTIFY_CTR(
       Debugger::PacketId::make(pkt->get_packet_id(), pkt->get_copy_id()),
@@ -0,0 +1,215 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/perf_counters.h>
+#include <bm/bm_sim/control_flow.h>
+#include <bm/bm_sim/tables.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bm {
+
+namespace {
+
+constexpr size_t nb_events = 4;
+
+// One group of counters per thread, opened the first time the thread takes a
+// sample. All the counters in the group are read with a single system call.
+class CounterGroup {
+ public:
+  ~CounterGroup() {
+    close_all();
+  }
+
+  // returns an empty string on success
+  std::string open() {
+#ifdef __linux__
+    const uint64_t configs[nb_events] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (size_t i = 0; i < nb_events; i++) {
+      struct perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = PERF_TYPE_HARDWARE;
+      attr.config = configs[i];
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_GROUP;
+      const int group_fd = (i == 0) ? -1 : fds[0];
+      const auto fd = static_cast<int>(
+          syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+      if (fd < 0) {
+        const auto error = std::string("perf_event_open: ") + strerror(errno);
+        close_all();
+        return error;
+      }
+      fds[i] = fd;
+    }
+    return "";
+#else
+    return "hardware performance counters are only supported on Linux";
+#endif
+  }
+
+  bool read_values(uint64_t *values) {
+    if (status == Status::UNOPENED)
+      status = open().empty() ? Status::OPEN : Status::FAILED;
+    if (status != Status::OPEN) return false;
+#ifdef __linux__
+    struct {
+      uint64_t nr;
+      std::array<uint64_t, nb_events> values;
+    } data;
+    if (read(fds[0], &data, sizeof(data)) !=
+        static_cast<ssize_t>(sizeof(data)))
+      return false;
+    for (size_t i = 0; i < nb_events; i++) values[i] = data.values[i];
+    return true;
+#else
+    return false;
+#endif
+  }
+
+ private:
+  enum class Status { UNOPENED, OPEN, FAILED };
+
+  void close_all() {
+#ifdef __linux__
+    for (auto &fd : fds) {
+      if (fd >= 0) close(fd);
+      fd = -1;
+    }
+#endif
+  }
+
+  std::array<int, nb_events> fds{{-1, -1, -1, -1}};
+  Status status{Status::UNOPENED};
+};
+
+CounterGroup *get_thread_counters() {
+  static thread_local CounterGroup counters;
+  return &counters;
+}
+
+}  // namespace
+
+PerfCounters::Sample::Sample(const Packet &pkt, const ControlFlowNode &node) {
+  if (!get()->is_sampled(pkt)) return;
+  const auto type = (dynamic_cast<const MatchActionTable *>(&node) != nullptr)
+      ? ObjectType::TABLE : ObjectType::CONDITIONAL;
+  start(pkt, type, &node);
+}
+
+void
+PerfCounters::Sample::start(const Packet &pkt, ObjectType type,
+                            const NamedP4Object *object) {
+  if (!get_thread_counters()->read_values(begin)) return;
+  this->object = object;
+  this->type = type;
+  cxt_id = pkt.get_context();
+}
+
+void
+PerfCounters::Sample::stop() {
+  std::array<uint64_t, nb_events> end;
+  if (!get_thread_counters()->read_values(end.data())) return;
+  for (size_t i = 0; i < nb_events; i++) end[i] -= begin[i];
+  get()->add_sample(cxt_id, type, *object, end.data());
+}
+
+bool
+PerfCounters::enable(unsigned int sampling_rate, std::string *error) {
+  // we check that the counters are available in the calling thread, which
+  // does not guarantee that they will be available in the packet processing
+  // threads, but it is good enough to report most issues (e.g. permissions)
+  CounterGroup test_counters;
+  auto open_error = test_counters.open();
+  if (!open_error.empty()) {
+    *error = open_error;
+    return false;
+  }
+  this->sampling_rate.store(std::max(sampling_rate, 1u));
+  armed.store(true);
+  return true;
+}
+
+void
+PerfCounters::disable() {
+  armed.store(false);
+}
+
+void
+PerfCounters::reset() {
+  std::unique_lock<std::mutex> lock(mutex);
+  stats.clear();
+}
+
+std::vector<PerfCounters::Stats>
+PerfCounters::get_stats() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  std::vector<Stats> result;
+  for (const auto &p : stats) result.push_back(p.second);
+  return result;
+}
+
+void
+PerfCounters::add_sample(size_t cxt_id, ObjectType type,
+                         const NamedP4Object &object, const uint64_t *deltas) {
+  std::unique_lock<std::mutex> lock(mutex);
+  const auto key = std::make_tuple(cxt_id, type, object.get_id());
+  auto it = stats.find(key);
+  if (it == stats.end()) {
+    it = stats.emplace(
+        key, Stats{cxt_id, type, object.get_id(), object.get_name(),
+                   0, 0, 0, 0, 0}).first;
+  }
+  auto &s = it->second;
+  // the name may change if a new P4 program is loaded
+  if (s.name != object.get_name()) s.name = object.get_name();
+  s.samples++;
+  s.cycles += deltas[0];
+  s.instructions += deltas[1];
+  s.llc_misses += deltas[2];
+  s.branch_misses += deltas[3];
+}
+
+const char *
+PerfCounters::object_type_name(ObjectType type) {
+  switch (type) {
+    case ObjectType::PARSER:
+      return "parser";
+    case ObjectType::TABLE:
+      return "table";
+    case ObjectType::CONDITIONAL:
+      return "conditional";
+    case ObjectType::DEPARSER:
+      return "deparser";
+  }
+  return "";
+}
+
+}  // namespace bm
@@ -22,9 +22,43 @@
 #include <bm/bm_sim/event_logger.h>
 #include <bm/bm_sim/logger.h>
 #include <bm/bm_sim/debugger.h>
+#include <bm/bm_sim/perf_counters.h>
+
+#include <algorithm>  // std::find_if
+#include <utility>
+#include <vector>
 
 namespace bm {
 
+namespace {
+
+// packets waiting to be processed by the same node
+using Group = std::pair<const ControlFlowNode *, std::vector<Packet *> >;
+
+// Pipeline::apply_batch() reuses these vectors from one burst to the next
+// (the bursts processed by a given thread), so that it does not allocate
+// memory once they have grown to the size of the bursts. Only the first
+// nb_groups groups are in use, the vectors of the others are kept for their
+// capacity.
+struct BatchScratch {
+  std::vector<Group> groups;
+  size_t nb_groups{0};
+  std::vector<Packet *> group_pkts;
+  std::vector<const ControlFlowNode *> next;
+
+  std::vector<Packet *> *add_group(const ControlFlowNode *node) {
+    if (nb_groups == groups.size()) groups.emplace_back();
+    auto &group = groups[nb_groups++];
+    group.first = node;
+    group.second.clear();
+    return &group.second;
+  }
+};
+
+thread_local BatchScratch batch_scratch;
+
+}  // namespace
+
 void
 Pipeline::apply(Packet *pkt) {
   BMELOG(pipeline_start, *pkt, *this);
@@ -40,6 +74,7 @@ Pipeline::apply(Packet *pkt) {
       BMLOG_DEBUG_PKT(*pkt, "Packet is marked for exit, interrupting pipeline");
       break;
     }
+    PerfCounters::Sample perf_sample(*pkt, *node);
     node = (*node)(pkt);
   }
   BMELOG(pipeline_done, *pkt, *this);
@@ -49,4 +84,67 @@ Pipeline::apply(Packet *pkt) {
   BMLOG_DEBUG_PKT(*pkt, "Pipeline '{}': end", get_name());
 }
 
+void
+Pipeline::apply_batch(Packet *const *pkts, size_t n) {
+  if (PerfCounters::get()->is_enabled()) {
+    for (size_t i = 0; i < n; i++) apply(pkts[i]);
+    return;
+  }
+  for (size_t i = 0; i < n; i++) {
+    Packet *pkt = pkts[i];
+    BMELOG(pipeline_start, *pkt, *this);
+    DEBUGGER_NOTIFY_CTR(
+        Debugger::PacketId::make(pkt->get_packet_id(), pkt->get_copy_id()),
+        DBG_CTR_CONTROL | get_id());
+    BMLOG_DEBUG_PKT(*pkt, "Pipeline '{}': start", get_name());
+  }
+
+  // groups are processed in FIFO order; the processed ones are left (empty)
+  // at the front of the vector
+  auto &scratch = batch_scratch;
+  auto &groups = scratch.groups;
+  auto &group_pkts = scratch.group_pkts;
+  auto &next = scratch.next;
+  scratch.nb_groups = 0;
+  if (first_node && n > 0)
+    scratch.add_group(first_node)->assign(pkts, pkts + n);
+  for (size_t head = 0; head < scratch.nb_groups; head++) {
+    const ControlFlowNode *node = groups[head].first;
+    // the group keeps the previous (cleared) buffer of group_pkts
+    group_pkts.swap(groups[head].second);
+    groups[head].second.clear();
+    auto exit_it = std::remove_if(
+        group_pkts.begin(), group_pkts.end(), [](Packet *pkt) {
+          if (!pkt->is_marked_for_exit()) return false;
+          BMLOG_DEBUG_PKT(*pkt,
+                          "Packet is marked for exit, interrupting pipeline");
+          return true;
+        });
+    group_pkts.erase(exit_it, group_pkts.end());
+    if (group_pkts.empty()) continue;
+    next.resize(group_pkts.size());
+    node->apply_batch(group_pkts.data(), group_pkts.size(), next.data());
+    for (size_t i = 0; i < group_pkts.size(); i++) {
+      if (!next[i]) continue;
+      const auto groups_end = groups.begin() + scratch.nb_groups;
+      auto it = std::find_if(
+          groups.begin() + head + 1, groups_end,
+          [&next, i](const Group &g) { return g.first == next[i]; });
+      if (it != groups_end)
+        it->second.push_back(group_pkts[i]);
+      else
+        scratch.add_group(next[i])->push_back(group_pkts[i]);
+    }
+  }
+
+  for (size_t i = 0; i < n; i++) {
+    Packet *pkt = pkts[i];
+    BMELOG(pipeline_done, *pkt, *this);
+    DEBUGGER_NOTIFY_CTR(
+        Debugger::PacketId::make(pkt->get_packet_id(), pkt->get_copy_id()),
+        DBG_CTR_EXIT(DBG_CTR_CONTROL) | get_id());
+    BMLOG_DEBUG_PKT(*pkt, "Pipeline '{}': end", get_name());
+  }
+}
+
 }  // namespace bm
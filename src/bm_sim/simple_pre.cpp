@@ -22,7 +22,10 @@
 #include <bm/bm_sim/simple_pre.h>
 #include <bm/bm_sim/logger.h>
 
+#include <algorithm>
 #include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <sstream>
 
@@ -30,6 +33,44 @@
 
 namespace bm {
 
+namespace {
+
+std::atomic<size_t> next_reader_slot{0};
+
+}  // namespace
+
+constexpr size_t McSimplePre::ReaderEpochs::nb_slots;
+
+McSimplePre::ReaderEpochs::Guard::Guard(ReaderEpochs *epochs) {
+  // threads are assigned slots in a round-robin fashion, the first time they
+  // replicate a packet
+  static thread_local size_t slot_idx = next_reader_slot++ % nb_slots;
+  auto &slot = epochs->slots[slot_idx];
+  counter = &slot.counters[epochs->parity.load()];
+  // if a writer flips the parity right after we read it, either it sees our
+  // increment and waits for us, or it already published the new version,
+  // which we are then guaranteed to load (all operations are seq_cst)
+  counter->fetch_add(1);
+}
+
+McSimplePre::ReaderEpochs::Guard::~Guard() {
+  counter->fetch_sub(1);
+}
+
+void
+McSimplePre::ReaderEpochs::synchronize() {
+  const unsigned int old_parity = parity.load();
+  parity.store(1 - old_parity);
+  for (auto &slot : slots) {
+    while (slot.counters[old_parity].load() != 0) std::this_thread::yield();
+  }
+}
+
+McSimplePre::McSimplePre() {
+  publish_replication_lists(std::unique_ptr<const ReplicationLists>(
+      new ReplicationLists()));
+}
+
 McSimplePre::McReturnCode
 McSimplePre::mc_mgrp_create(const mgrp_t mgid, mgrp_hdl_t *mgrp_hdl) {
   boost::unique_lock<boost::shared_mutex> lock(mutex);
@@ -41,6 +82,7 @@ McSimplePre::mc_mgrp_create(const mgrp_t mgid, mgrp_hdl_t *mgrp_hdl) {
   *mgrp_hdl = mgid;
   MgidEntry mgid_entry(mgid);
   mgid_entries.insert(std::make_pair(*mgrp_hdl, std::move(mgid_entry)));
+  update_replication_lists({*mgrp_hdl});
   Logger::get()->debug("mgrp node created for mgid {}", mgid);
   return SUCCESS;
 }
@@ -49,6 +91,7 @@ McSimplePre::McReturnCode
 McSimplePre::mc_mgrp_destroy(mgrp_hdl_t mgrp_hdl) {
   boost::unique_lock<boost::shared_mutex> lock(mutex);
   mgid_entries.erase(mgrp_hdl);
+  update_replication_lists({mgrp_hdl});
   Logger::get()->debug("mgrp node deleted for mgid {}", mgrp_hdl);
   return SUCCESS;
 }
@@ -97,6 +140,7 @@ McSimplePre::mc_node_associate(const mgrp_hdl_t mgrp_hdl,
   L1Entry &l1_entry = l1_entries[l1_hdl];
   mgid_entry.l1_list.push_back(l1_hdl);
   l1_entry.mgrp_hdl = mgrp_hdl;
+  update_replication_lists({mgrp_hdl});
   Logger::get()->debug("node associated with mgid {}", mgrp_hdl);
   return SUCCESS;
 }
@@ -116,6 +160,7 @@ McSimplePre::mc_node_dissociate(const mgrp_hdl_t mgrp_hdl,
                                        l1_hdl),
                            mgid_entry.l1_list.end());
   l1_entry.mgrp_hdl = 0;
+  update_replication_lists({mgrp_hdl});
   Logger::get()->debug("node dissociated with mgid {}", mgrp_hdl);
   return SUCCESS;
 }
@@ -137,6 +182,7 @@ McSimplePre::mc_node_destroy(const l1_hdl_t l1_hdl) {
   }
   l1_entries.erase(l1_hdl);
   assert(!l1_handles.release_handle(l1_hdl));
+  update_replication_lists(get_groups_with_node(l1_hdl));
   Logger::get()->debug("node destroyed for rid {}", rid);
   return SUCCESS;
 }
@@ -153,6 +199,7 @@ McSimplePre::mc_node_update(const l1_hdl_t l1_hdl,
   l2_hdl_t l2_hdl = l1_entry.l2_hdl;
   L2Entry &l2_entry = l2_entries[l2_hdl];
   l2_entry.port_map = port_map;
+  update_replication_lists(get_groups_with_node(l1_hdl));
   Logger::get()->debug("node updated for rid {}", l1_entry.rid);
   return SUCCESS;
 }
@@ -232,6 +279,79 @@ McSimplePre::reset_state_() {
   l2_entries.clear();
   l1_handles.clear();
   l2_handles.clear();
+  publish_replication_lists(std::unique_ptr<const ReplicationLists>(
+      new ReplicationLists()));
+}
+
+void
+McSimplePre::publish_replication_lists(
+    std::unique_ptr<const ReplicationLists> lists) {
+  replication_lists.store(lists.get());
+  reader_epochs.synchronize();
+  current_lists = std::move(lists);
+}
+
+void
+McSimplePre::build_replication_list(const MgidEntry &mgid_entry,
+                                    ReplicationList *list) const {
+  for (const l1_hdl_t l1_hdl : mgid_entry.l1_list) {
+    // a node can be destroyed without being dissociated first
+    const auto l1_it = l1_entries.find(l1_hdl);
+    if (l1_it == l1_entries.end()) continue;
+    const L1Entry &l1_entry = l1_it->second;
+    const L2Entry &l2_entry = l2_entries.at(l1_entry.l2_hdl);
+    for (egress_port_t port_id = 0; port_id < l2_entry.port_map.size();
+         port_id++) {
+      if (l2_entry.port_map[port_id])
+        list->push_back({l1_entry.rid, port_id, nullptr});
+    }
+  }
+}
+
+void
+McSimplePre::update_replication_lists(
+    const std::vector<mgrp_hdl_t> &mgrp_hdls) {
+  if (mgrp_hdls.empty()) return;
+  // the lists for the groups which are not modified are shared with the
+  // previous version
+  std::unique_ptr<ReplicationLists> new_lists(
+      new ReplicationLists(*current_lists));
+  for (const auto mgrp_hdl : mgrp_hdls) {
+    const auto mgid = static_cast<mgrp_t>(mgrp_hdl);
+    const auto mgid_it = mgid_entries.find(mgrp_hdl);
+    if (mgid_it == mgid_entries.end()) {
+      new_lists->erase(mgid);
+      continue;
+    }
+    auto list = std::make_shared<ReplicationList>();
+    build_replication_list(mgid_it->second, list.get());
+    (*new_lists)[mgid] = std::move(list);
+  }
+  publish_replication_lists(std::move(new_lists));
+}
+
+void
+McSimplePre::update_all_replication_lists() {
+  std::vector<mgrp_hdl_t> mgrp_hdls;
+  for (const auto &p : mgid_entries) mgrp_hdls.push_back(p.first);
+  update_replication_lists(mgrp_hdls);
+}
+
+std::vector<McSimplePre::mgrp_hdl_t>
+McSimplePre::get_groups_with_node(l1_hdl_t l1_hdl) const {
+  std::vector<mgrp_hdl_t> mgrp_hdls;
+  for (const auto &p : mgid_entries) {
+    const auto &l1_list = p.second.l1_list;
+    if (std::find(l1_list.begin(), l1_list.end(), l1_hdl) != l1_list.end())
+      mgrp_hdls.push_back(p.first);
+  }
+  return mgrp_hdls;
+}
+
+void
+McSimplePre::warn_unknown_mgid(mgrp_t mgid) {
+  Logger::get()->warn("Replication requested for mgid {}, which is not known "
+                      "to the PRE", mgid);
 }
 
 void
@@ -244,28 +364,8 @@ McSimplePre::reset_state() {
 std::vector<McSimplePre::McOut>
 McSimplePre::replicate(const McSimplePre::McIn ingress_info) const {
   std::vector<McSimplePre::McOut> egress_info_list;
-  egress_port_t port_id;
-  McSimplePre::McOut egress_info;
-  boost::shared_lock<boost::shared_mutex> lock(mutex);
-  auto mgid_it = mgid_entries.find(ingress_info.mgid);
-  if (mgid_it == mgid_entries.end()) {
-    Logger::get()->warn("Replication requested for mgid {}, which is not known "
-                        "to the PRE", ingress_info.mgid);
-    return {};
-  }
-  const MgidEntry &mgid_entry = mgid_it->second;
-  for (const l1_hdl_t l1_hdl : mgid_entry.l1_list) {
-    const L1Entry &l1_entry = l1_entries.at(l1_hdl);
-    egress_info.rid = l1_entry.rid;
-    const L2Entry &l2_entry = l2_entries.at(l1_entry.l2_hdl);
-    // Port replication
-    for (port_id = 0; port_id < l2_entry.port_map.size(); port_id++) {
-      if (l2_entry.port_map[port_id]) {
-        egress_info.egress_port = port_id;
-        egress_info_list.push_back(egress_info);
-      }
-    }
-  }
+  replicate(ingress_info, [&egress_info_list](const McOut &out) {
+      egress_info_list.push_back(out); });
   BMLOG_DEBUG("number of packets replicated : {}", egress_info_list.size());
   return egress_info_list;
 }
@@ -22,13 +22,19 @@
 #include <bm/bm_sim/simple_pre_lag.h>
 #include <bm/bm_sim/logger.h>
 
+#include <cassert>
+#include <initializer_list>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "jsoncpp/json.h"
 
 namespace bm {
 
+constexpr size_t McSimplePreLAG::LAG_BUCKETS;
+
 McSimplePre::McReturnCode
 McSimplePreLAG::mc_node_create(const rid_t rid,
                                const PortMap &port_map,
@@ -77,6 +83,7 @@ McSimplePreLAG::mc_node_update(const l1_hdl_t l1_hdl,
   L2Entry &l2_entry = l2_entries[l2_hdl];
   l2_entry.port_map = port_map;
   l2_entry.lag_map = lag_map;
+  update_replication_lists(get_groups_with_node(l1_hdl));
   Logger::get()->debug("node updated for rid {}", l1_entry.rid);
   return SUCCESS;
 }
@@ -98,10 +105,89 @@ McSimplePreLAG::mc_set_lag_membership(const lag_id_t lag_index,
   LagEntry &lag_entry = lag_entries[lag_index];
   lag_entry.member_count = member_count;
   lag_entry.port_map = port_map;
+  update_lag_buckets(&lag_entry);
+  // LAG membership is not tracked per group
+  update_all_replication_lists();
   Logger::get()->debug("lag membership set for lag index {}", lag_index);
   return SUCCESS;
 }
 
+McSimplePre::McReturnCode
+McSimplePreLAG::mc_set_port_status(const egress_port_t port, const bool up) {
+  boost::unique_lock<boost::shared_mutex> lock(mutex);
+  if (port >= ports_down.size()) {
+    Logger::get()->error("port status update failed, invalid port");
+    return ERROR;
+  }
+  if (ports_down[port] == !up) return SUCCESS;
+  ports_down[port] = !up;
+  bool lags_updated = false;
+  for (auto &p : lag_entries) {
+    if (!p.second.port_map[port]) continue;
+    update_lag_buckets(&p.second);
+    lags_updated = true;
+  }
+  if (lags_updated) update_all_replication_lists();
+  Logger::get()->debug("port {} is {} for LAG member selection",
+                       port, up ? "up" : "down");
+  return SUCCESS;
+}
+
+void
+McSimplePreLAG::update_lag_buckets(LagEntry *lag_entry) const {
+  std::vector<egress_port_t> members;
+  for (egress_port_t port = 0; port < lag_entry->port_map.size(); port++) {
+    if (lag_entry->port_map[port] && !ports_down[port])
+      members.push_back(port);
+  }
+  if (members.empty()) {
+    lag_entry->buckets = nullptr;
+    return;
+  }
+
+  // Each member gets LAG_BUCKETS / members.size() buckets, and some members
+  // get one extra bucket. Buckets already mapped to an active member are not
+  // remapped, unless that member has more than its share.
+  const size_t share = LAG_BUCKETS / members.size();
+  size_t extra_buckets = LAG_BUCKETS % members.size();
+  auto buckets = std::make_shared<LagBuckets>(LAG_BUCKETS);
+  std::vector<size_t> free_buckets;
+  std::unordered_map<egress_port_t, size_t> counts;
+  for (const auto port : members) counts[port] = 0;
+  for (size_t b = 0; b < LAG_BUCKETS; b++) {
+    if (lag_entry->buckets) {
+      const auto port = (*lag_entry->buckets)[b];
+      auto it = counts.find(port);
+      if (it != counts.end() &&
+          (it->second < share || (it->second == share && extra_buckets > 0))) {
+        if (it->second++ == share) extra_buckets--;
+        (*buckets)[b] = port;
+        continue;
+      }
+    }
+    free_buckets.push_back(b);
+  }
+  // the free buckets are spread over the members which are below their share
+  auto free_it = free_buckets.begin();
+  for (const bool extra : {false, true}) {
+    for (const auto port : members) {
+      auto &count = counts[port];
+      while (free_it != free_buckets.end() && count < share) {
+        (*buckets)[*free_it++] = port;
+        count++;
+      }
+      if (extra && extra_buckets > 0 && count == share &&
+          free_it != free_buckets.end()) {
+        (*buckets)[*free_it++] = port;
+        count++;
+        extra_buckets--;
+      }
+    }
+  }
+  assert(free_it == free_buckets.end());
+  lag_entry->buckets = std::move(buckets);
+}
+
 std::string
 McSimplePreLAG::mc_get_entries() const {
   Json::Value root(Json::objectValue);
@@ -141,57 +227,29 @@ McSimplePreLAG::reset_state() {
   lag_entries.clear();
 }
 
-std::vector<McSimplePre::McOut>
-McSimplePreLAG::replicate(const McSimplePre::McIn ingress_info) const {
-  std::vector<McSimplePre::McOut> egress_info_list;
-  egress_port_t port_id;
-  PortMap port_map;
-  lag_id_t lag_index;
-  int lag_hash = 0xFF;  // TODO(unknown): get lag hash from metadata
-  int port_count1 = 0, port_count2 = 0;
-  McSimplePre::McOut egress_info;
-  LagEntry lag_entry;
-  boost::shared_lock<boost::shared_mutex> lock(mutex);
-  auto mgid_it = mgid_entries.find(ingress_info.mgid);
-  if (mgid_it == mgid_entries.end()) {
-    Logger::get()->warn("Replication requested for mgid {}, which is not known "
-                        "to the PRE", ingress_info.mgid);
-    return {};
-  }
-  const MgidEntry &mgid_entry = mgid_it->second;
+void
+McSimplePreLAG::build_replication_list(const MgidEntry &mgid_entry,
+                                       ReplicationList *list) const {
   for (const l1_hdl_t l1_hdl : mgid_entry.l1_list) {
-    const L1Entry &l1_entry = l1_entries.at(l1_hdl);
-    egress_info.rid = l1_entry.rid;
-    // Port replication
+    const auto l1_it = l1_entries.find(l1_hdl);
+    if (l1_it == l1_entries.end()) continue;
+    const L1Entry &l1_entry = l1_it->second;
     const L2Entry &l2_entry = l2_entries.at(l1_entry.l2_hdl);
-    for (port_id = 0; port_id < l2_entry.port_map.size(); port_id++) {
-      if (l2_entry.port_map[port_id]) {
-        egress_info.egress_port = port_id;
-        egress_info_list.push_back(egress_info);
-      }
+    // Port replication
+    for (egress_port_t port_id = 0; port_id < l2_entry.port_map.size();
+         port_id++) {
+      if (l2_entry.port_map[port_id])
+        list->push_back({l1_entry.rid, port_id, nullptr});
     }
     // Lag replication
-    for (lag_index = 0; lag_index < l2_entry.lag_map.size(); lag_index++) {
-      if (l2_entry.lag_map[lag_index]) {
-        lag_entry = lag_entries.at(lag_index);
-        port_map = lag_entry.port_map;
-        port_count1 = (lag_hash % lag_entry.member_count) + 1;
-        port_count2 = 0;
-        for (port_id = 0; port_id < port_map.size(); port_id++) {
-          if (port_map[port_id]) {
-            port_count2++;
-          }
-          if (port_count1 == port_count2) {
-            egress_info.egress_port = port_id;
-            egress_info_list.push_back(egress_info);
-            break;
-          }
-        }
-      }
+    for (lag_id_t lag_index = 0; lag_index < l2_entry.lag_map.size();
+         lag_index++) {
+      if (!l2_entry.lag_map[lag_index]) continue;
+      const auto lag_it = lag_entries.find(lag_index);
+      if (lag_it == lag_entries.end() || !lag_it->second.buckets) continue;
+      list->push_back({l1_entry.rid, 0, lag_it->second.buckets});
     }
   }
-  BMLOG_DEBUG("number of packets replicated : {}", egress_info_list.size());
-  return egress_info_list;
 }
 
 }  // namespace bm
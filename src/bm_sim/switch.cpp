@@ -23,6 +23,7 @@
 #include <bm/bm_sim/options_parse.h>
 #include <bm/bm_sim/logger.h>
 #include <bm/bm_sim/debugger.h>
+#include <bm/bm_sim/meters.h>
 #include <bm/bm_sim/event_logger.h>
 
 #include <cassert>
@@ -47,7 +48,8 @@ packet_handler(int port_num, const char *buffer, int len, void *cookie) {
 SwitchWContexts::SwitchWContexts(size_t nb_cxts, bool enable_swap)
   : DevMgr(),
     nb_cxts(nb_cxts), contexts(nb_cxts), enable_swap(enable_swap),
-    phv_source(PHVSourceIface::make_phv_source(nb_cxts)) {
+    phv_source(PHVSourceIface::make_phv_source(nb_cxts)),
+    context_workers(nb_cxts) {
   for (size_t i = 0; i < nb_cxts; i++) {
     contexts.at(i).set_cxt_id(i);
   }
@@ -57,11 +59,7 @@ LookupStructureFactory SwitchWContexts::default_lookup_factory {};
 
 std::string
 SwitchWContexts::get_debugger_addr() const {
-#ifdef BMDEBUG_ON
   return Debugger::get_addr();
-#else
-  return "";
-#endif
 }
 
 std::string
@@ -136,14 +134,16 @@ SwitchWContexts::init_from_command_line_options(int argc, char *argv[],
       TransportIface::make_nanomsg(notifications_addr));
   transport->open();
 
-#ifdef BMDEBUG_ON
-  // has to be before init_objects because forces arith
   if (parser.debugger) {
+#ifdef BMDEBUG_ON
+    // has to be before init_objects because forces arith; without it, the
+    // debugger only sees the updates to the fields which are used in
+    // arithmetic expressions, but there is no cost when no client is attached
     for (Context &c : contexts)
       c.set_force_arith(true);
+#endif
     Debugger::init_debugger(parser.debugger_addr);
   }
-#endif
 
   event_logger_addr = parser.event_logger_addr;
 
@@ -155,6 +155,11 @@ SwitchWContexts::init_from_command_line_options(int argc, char *argv[],
 
   Logger::set_log_level(parser.log_level);
 
+  if (parser.meter_clock_precision_us > 0) {
+    Meter::set_clock_precision(
+        std::chrono::microseconds(parser.meter_clock_precision_us));
+  }
+
   int status = init_objects(parser.config_file_path, parser.device_id,
                             transport);
   if (status != 0) return status;
@@ -192,6 +197,9 @@ SwitchWContexts::init_from_command_line_options(int argc, char *argv[],
     port_add(iface.second, iface.first, inFileName, outFileName);
   }
   thrift_port = parser.thrift_port;
+  runtime_server_options.nonblocking = parser.thrift_nonblocking;
+  runtime_server_options.compact_protocol = parser.thrift_compact;
+  runtime_server_options.nb_workers = parser.thrift_workers;
 
   if (parser.state_file_path != "") {
     status = deserialize_from_file(parser.state_file_path);
@@ -336,6 +344,35 @@ SwitchWContexts::do_swap() {
   return rc;
 }
 
+int
+SwitchWContexts::start_context_workers(size_t cxt_id, size_t nb_threads,
+                                       size_t queue_capacity,
+                                       ContextWorkers::Handler handler) {
+  if (cxt_id >= nb_cxts || context_workers[cxt_id]) return 1;
+  context_workers[cxt_id] = std::unique_ptr<ContextWorkers>(new ContextWorkers(
+      cxt_id, nb_threads, queue_capacity, std::move(handler)));
+  return 0;
+}
+
+void
+SwitchWContexts::stop_context_workers() {
+  // a handler still running in a context which is not stopped yet can hand a
+  // packet off to a context which is already stopped: the packet is dropped
+  for (auto &workers : context_workers) {
+    if (workers) workers->stop();
+  }
+}
+
+int
+SwitchWContexts::hand_off_to_context(size_t cxt_id,
+                                     std::unique_ptr<Packet> &&packet) {
+  if (cxt_id >= nb_cxts) return 1;
+  auto &workers = context_workers[cxt_id];
+  if (!workers) return 1;
+  packet->change_context(cxt_id);
+  return workers->push(std::move(packet));
+}
+
 std::string
 SwitchWContexts::get_config() const {
   std::unique_lock<std::mutex> config_lock(config_mutex);
@@ -0,0 +1,87 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/table_change_log.h>
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace bm {
+
+static_assert(sizeof(TableChangeLog::msg_hdr_t) == 32u,
+              "Invalid size for table change notification header");
+
+constexpr size_t TableChangeLog::default_capacity;
+
+TableChangeLog::TableChangeLog(size_t capacity)
+    : capacity(std::max<size_t>(capacity, 1)) { }
+
+void
+TableChangeLog::set_notifications(std::shared_ptr<TransportIface> transport,
+                                  int device_id, int cxt_id,
+                                  p4object_id_t table_id) {
+  this->transport = transport;
+  this->device_id = device_id;
+  this->cxt_id = cxt_id;
+  this->table_id = table_id;
+}
+
+TableChangeLog::seq_t
+TableChangeLog::log(ChangeType type, entry_handle_t handle) {
+  if (ring.empty()) ring.resize(capacity);
+  Record &record = ring[next_seq % capacity];
+  record.seq = next_seq++;
+  record.type = type;
+  record.handle = handle;
+  if (transport) notify(record);
+  return record.seq;
+}
+
+bool
+TableChangeLog::get_since(seq_t since, std::vector<Record> *records) const {
+  if (since > get_last_seq()) return false;
+  // the records in [next_seq - capacity, next_seq) are still in the ring
+  const seq_t oldest = (next_seq > capacity) ?
+      std::max(first_seq, next_seq - capacity) : first_seq;
+  if (since + 1 < oldest) return false;
+  records->reserve(records->size() + (next_seq - since - 1));
+  for (seq_t seq = since + 1; seq < next_seq; seq++)
+    records->push_back(ring[seq % capacity]);
+  return true;
+}
+
+void
+TableChangeLog::reset() {
+  first_seq = next_seq;
+}
+
+void
+TableChangeLog::notify(const Record &record) const {
+  msg_hdr_t msg_hdr;
+  char *msg_hdr_ = reinterpret_cast<char *>(&msg_hdr);
+  memset(msg_hdr_, 0, sizeof(msg_hdr));
+  memcpy(msg_hdr_, "TBL|", 4);
+  msg_hdr.switch_id = device_id;
+  msg_hdr.cxt_id = cxt_id;
+  msg_hdr.table_id = table_id;
+  msg_hdr.seq = record.seq;
+  msg_hdr.type = static_cast<unsigned int>(record.type);
+  msg_hdr.handle = record.handle;
+  transport->send(msg_hdr_, sizeof(msg_hdr));
+}
+
+}  // namespace bm
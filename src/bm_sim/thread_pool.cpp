@@ -0,0 +1,204 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/thread_pool.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+namespace bm {
+
+namespace {
+
+// the pool and the worker id of the current thread, if it is a worker thread
+thread_local const ThreadPool *current_pool = nullptr;
+thread_local size_t current_worker = 0;
+
+}  // namespace
+
+constexpr size_t ThreadPool::Strand::max_batch;
+
+void
+ThreadPool::Strand::post(Task task) {
+  bool schedule = false;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks.push_back(std::move(task));
+    if (!scheduled) {
+      scheduled = true;
+      schedule = true;
+    }
+  }
+  if (schedule) pool->post([this] { run(); });
+}
+
+void
+ThreadPool::Strand::run() {
+  for (size_t i = 0; i < max_batch; i++) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (tasks.empty()) {
+        scheduled = false;
+        return;
+      }
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+  // still scheduled, so no other worker can run the strand in the meantime
+  pool->post([this] { run(); });
+}
+
+ThreadPool::ThreadPool(size_t nb_threads, const std::string &name) {
+  nb_threads = std::max<size_t>(nb_threads, 1);
+  for (size_t i = 0; i < nb_threads; i++)
+    workers.emplace_back(new Worker());
+  for (size_t i = 0; i < nb_threads; i++) {
+    auto &thread = workers[i]->thread;
+    thread = std::thread(&ThreadPool::worker_loop, this, i);
+#ifdef __linux__
+    // thread names are limited to 15 characters
+    auto thread_name = name + "-" + std::to_string(i);
+    thread_name.resize(std::min<size_t>(thread_name.size(), 15));
+    pthread_setname_np(thread.native_handle(), thread_name.c_str());
+#else
+    (void) name;
+#endif
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    stop = true;
+    sleep_cv.notify_all();
+  }
+  for (auto &worker : workers) worker->thread.join();
+}
+
+void
+ThreadPool::post(Task task) {
+  size_t worker_id = (current_pool == this) ?
+      current_worker :
+      next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+  push_task(worker_id, std::move(task));
+  // pairs with the increment of sleepers in worker_loop, so that either the
+  // sleeping worker sees the new task or we see the sleeping worker
+  if (sleepers.load() > 0) {
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    sleep_cv.notify_one();
+  }
+}
+
+void
+ThreadPool::post_after(clock::duration delay, Task task) {
+  std::unique_lock<std::mutex> lock(sleep_mutex);
+  const auto tp = clock::now() + delay;
+  timers.push({tp, std::move(task)});
+  next_timer.store(timers.top().tp.time_since_epoch().count());
+  // a sleeping worker may need to wake up earlier than planned
+  sleep_cv.notify_one();
+}
+
+void
+ThreadPool::push_task(size_t worker_id, Task &&task) {
+  auto &worker = *workers[worker_id];
+  {
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  pending.fetch_add(1);
+}
+
+bool
+ThreadPool::get_task(size_t worker_id, Task *task) {
+  const size_t nb_workers = workers.size();
+  // our own tasks are run in FIFO order, and we steal the most recent tasks of
+  // the other workers
+  for (size_t i = 0; i < nb_workers; i++) {
+    auto &worker = *workers[(worker_id + i) % nb_workers];
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    if (worker.tasks.empty()) continue;
+    if (i == 0) {
+      *task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+    } else {
+      *task = std::move(worker.tasks.back());
+      worker.tasks.pop_back();
+    }
+    pending.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+ThreadPool::clock::time_point
+ThreadPool::run_timers(size_t worker_id) {
+  const auto now = clock::now();
+  size_t nb_due = 0;
+  while (!timers.empty() && timers.top().tp <= now) {
+    // moving out of a priority_queue requires a const_cast
+    Task task = std::move(const_cast<Timer &>(timers.top()).task);
+    timers.pop();
+    push_task(worker_id, std::move(task));
+    nb_due++;
+  }
+  // this worker runs the first task, other workers are woken up for the rest
+  for (size_t i = 1; i < nb_due; i++) sleep_cv.notify_one();
+  const auto next = timers.empty() ? clock::time_point::max() :
+      timers.top().tp;
+  next_timer.store(next.time_since_epoch().count());
+  return next;
+}
+
+void
+ThreadPool::worker_loop(size_t worker_id) {
+  current_pool = this;
+  current_worker = worker_id;
+  Task task;
+  while (!stop.load()) {
+    // timers are checked between tasks, so that they are not delayed when all
+    // the workers are busy
+    if (next_timer.load(std::memory_order_relaxed) <=
+        clock::now().time_since_epoch().count()) {
+      std::unique_lock<std::mutex> lock(sleep_mutex);
+      run_timers(worker_id);
+    }
+    if (get_task(worker_id, &task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex);
+    const auto next = run_timers(worker_id);
+    sleepers.fetch_add(1);
+    if (pending.load() == 0 && !stop.load()) {
+      if (next == clock::time_point::max())
+        sleep_cv.wait(lock);
+      else
+        sleep_cv.wait_until(lock, next);
+    }
+    sleepers.fetch_sub(1);
+  }
+}
+
+}  // namespace bm
@@ -139,17 +139,16 @@ void SimpleSwitch::pipeline_thread() {
     if (mgid != 0) {
       assert(mgid == 1);
       phv->get_field("intrinsic_metadata.mgid").set(0);
-      const auto pre_out = pre->replicate({mgid});
-      for (const auto &out : pre_out) {
+      pre->replicate({mgid}, [&](const McSimplePre::McOut &out) {
         egress_port = out.egress_port;
-        if (ingress_port == egress_port) continue;  // pruning
+        if (ingress_port == egress_port) return;  // pruning
         BMLOG_DEBUG_PKT(*packet, "Replicating packet on port {}", egress_port);
         std::unique_ptr<Packet> packet_copy = packet->clone_with_phv_ptr();
         packet_copy->set_egress_port(egress_port);
         egress_mau->apply(packet_copy.get());
         deparser->deparse(packet_copy.get());
         output_buffer.push_front(std::move(packet_copy));
-      }
+      });
     } else {
       packet->set_egress_port(egress_port);
       egress_mau->apply(packet.get());
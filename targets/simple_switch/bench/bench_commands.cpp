@@ -0,0 +1,300 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <bm/bm_sim/runtime_interface.h>
+
+#include <jsoncpp/json.h>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <cstdlib>
+
+#include "bench_commands.h"
+
+namespace sswitch_bench {
+
+namespace {
+
+using bm::MatchKeyParam;
+
+struct TableInfo {
+  std::string match_type;
+  // (match type, bitwidth) for each key field
+  std::vector<std::pair<std::string, int> > key;
+};
+
+struct ProgramInfo {
+  std::unordered_map<std::string, TableInfo> tables;
+  // runtime data bitwidths for each action
+  std::unordered_map<std::string, std::vector<int> > actions;
+};
+
+bool
+read_program_info(const std::string &json_path, ProgramInfo *info) {
+  std::ifstream fs(json_path);
+  Json::Value root;
+  Json::Reader reader;
+  if (!fs || !reader.parse(fs, root)) {
+    std::cerr << "Cannot parse JSON program " << json_path << "\n";
+    return false;
+  }
+
+  std::unordered_map<std::string, std::unordered_map<std::string, int> >
+      header_type_widths;
+  for (const auto &cfg_header_type : root["header_types"]) {
+    auto &widths = header_type_widths[cfg_header_type["name"].asString()];
+    for (const auto &cfg_field : cfg_header_type["fields"])
+      widths[cfg_field[0].asString()] = cfg_field[1].asInt();
+  }
+  std::unordered_map<std::string, std::string> header_types;
+  for (const auto &cfg_header : root["headers"]) {
+    header_types[cfg_header["name"].asString()] =
+        cfg_header["header_type"].asString();
+  }
+
+  for (const auto &cfg_action : root["actions"]) {
+    auto &widths = info->actions[cfg_action["name"].asString()];
+    for (const auto &cfg_param : cfg_action["runtime_data"])
+      widths.push_back(cfg_param["bitwidth"].asInt());
+  }
+
+  for (const auto &cfg_pipeline : root["pipelines"]) {
+    for (const auto &cfg_table : cfg_pipeline["tables"]) {
+      auto &table = info->tables[cfg_table["name"].asString()];
+      table.match_type = cfg_table["match_type"].asString();
+      for (const auto &cfg_key : cfg_table["key"]) {
+        const auto &target = cfg_key["target"];
+        const auto match_type = cfg_key["match_type"].asString();
+        if (match_type == "valid") {
+          table.key.emplace_back(match_type, 1);
+          continue;
+        }
+        const auto header_type = header_types[target[0].asString()];
+        table.key.emplace_back(
+            match_type, header_type_widths[header_type][target[1].asString()]);
+      }
+    }
+  }
+  return true;
+}
+
+// Same formats as runtime_CLI.py: IPv4 address for 32-bit values, MAC address
+// for 48-bit values, otherwise a decimal or hexadecimal (0x) integer. The
+// result is in network byte order and has the byte width of the field.
+bool
+parse_value(const std::string &str, int bitwidth, std::string *bytes) {
+  const size_t nbytes = (bitwidth + 7) / 8;
+  bytes->assign(nbytes, '\x00');
+  auto parse_separated = [&str, bytes](char sep, int base, size_t n) {
+    std::vector<std::string> parts;
+    std::istringstream ss(str);
+    std::string part;
+    while (std::getline(ss, part, sep)) parts.push_back(part);
+    if (parts.size() != n) return false;
+    for (size_t i = 0; i < n; i++) {
+      char *end;
+      auto v = std::strtoul(parts[i].c_str(), &end, base);
+      if (parts[i].empty() || *end != '\0' || v > 0xff) return false;
+      (*bytes)[i] = static_cast<char>(v);
+    }
+    return true;
+  };
+  if (bitwidth == 32 && str.find('.') != std::string::npos)
+    return parse_separated('.', 10, 4);
+  if (bitwidth == 48 && str.find(':') != std::string::npos)
+    return parse_separated(':', 16, 6);
+
+  if (str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) {
+    // arbitrary width hexadecimal value, least significant digit first
+    size_t byte_idx = nbytes;
+    bool low = true;
+    for (size_t i = str.size(); i > 2; i--) {
+      const char c = str[i - 1];
+      int digit;
+      if (c >= '0' && c <= '9') digit = c - '0';
+      else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+      else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+      else
+        return false;
+      if (low) {
+        if (byte_idx == 0) {
+          if (digit != 0) return false;
+          continue;
+        }
+        byte_idx--;
+      }
+      (*bytes)[byte_idx] |= static_cast<char>(low ? digit : digit << 4);
+      low = !low;
+    }
+    return true;
+  }
+
+  char *end;
+  auto v = std::strtoull(str.c_str(), &end, 10);
+  if (str.empty() || *end != '\0') return false;
+  for (size_t i = nbytes; i > 0; i--) {
+    (*bytes)[i - 1] = static_cast<char>(v & 0xff);
+    v >>= 8;
+  }
+  return v == 0;
+}
+
+bool
+parse_match_param(const std::string &str, const std::string &match_type,
+                  int bitwidth, std::vector<MatchKeyParam> *match_key) {
+  std::string key;
+  auto split = [&str](const std::string &sep, std::string *first,
+                      std::string *second) {
+    auto pos = str.find(sep);
+    if (pos == std::string::npos) return false;
+    *first = str.substr(0, pos);
+    *second = str.substr(pos + sep.size());
+    return true;
+  };
+  if (match_type == "exact") {
+    if (!parse_value(str, bitwidth, &key)) return false;
+    match_key->emplace_back(MatchKeyParam::Type::EXACT, std::move(key));
+  } else if (match_type == "valid") {
+    match_key->emplace_back(MatchKeyParam::Type::VALID,
+                            std::string(1, (str == "0") ? '\x00' : '\x01'));
+  } else if (match_type == "lpm") {
+    std::string prefix, length;
+    if (!split("/", &prefix, &length)) return false;
+    if (!parse_value(prefix, bitwidth, &key)) return false;
+    match_key->emplace_back(MatchKeyParam::Type::LPM, std::move(key),
+                            std::atoi(length.c_str()));
+  } else if (match_type == "ternary" || match_type == "range") {
+    const bool ternary = (match_type == "ternary");
+    std::string first, second, second_bytes;
+    if (!split(ternary ? "&&&" : "->", &first, &second)) return false;
+    if (!parse_value(first, bitwidth, &key)) return false;
+    if (!parse_value(second, bitwidth, &second_bytes)) return false;
+    match_key->emplace_back(
+        ternary ? MatchKeyParam::Type::TERNARY : MatchKeyParam::Type::RANGE,
+        std::move(key), std::move(second_bytes));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool
+parse_action_data(const std::vector<std::string> &params,
+                  const std::vector<int> &bitwidths,
+                  bm::ActionData *action_data) {
+  if (params.size() != bitwidths.size()) return false;
+  for (size_t i = 0; i < params.size(); i++) {
+    std::string bytes;
+    if (!parse_value(params[i], bitwidths[i], &bytes)) return false;
+    action_data->push_back_action_data(bytes.data(), bytes.size());
+  }
+  return true;
+}
+
+// returns an error message, or an empty string on success
+std::string
+run_command(bm::RuntimeInterface *sw, const ProgramInfo &info,
+            std::vector<std::string> args) {
+  const auto cmd = args[0];
+  if (cmd != "table_add" && cmd != "table_set_default")
+    return "unsupported command " + cmd;
+  if (args.size() < 3) return "not enough arguments";
+  const auto &table_name = args[1];
+  const auto &action_name = args[2];
+  auto table_it = info.tables.find(table_name);
+  if (table_it == info.tables.end()) return "unknown table " + table_name;
+  const auto &table = table_it->second;
+  auto action_it = info.actions.find(action_name);
+  if (action_it == info.actions.end()) return "unknown action " + action_name;
+  const auto &action_widths = action_it->second;
+
+  bm::ActionData action_data;
+  if (cmd == "table_set_default") {
+    std::vector<std::string> params(args.begin() + 3, args.end());
+    if (!parse_action_data(params, action_widths, &action_data))
+      return "invalid action parameters";
+    auto rc = sw->mt_set_default_action(0, table_name, action_name,
+                                        std::move(action_data));
+    if (rc != bm::MatchErrorCode::SUCCESS)
+      return "error code " + std::to_string(static_cast<int>(rc));
+    return "";
+  }
+
+  int priority = -1;
+  if (table.match_type == "ternary" || table.match_type == "range") {
+    char *end;
+    priority = static_cast<int>(std::strtol(args.back().c_str(), &end, 10));
+    if (args.back().empty() || *end != '\0')
+      return "table is " + table.match_type + ", a priority is required";
+    args.pop_back();
+  }
+  size_t sep = 3;
+  while (sep < args.size() && args[sep] != "=>") sep++;
+  if (sep == args.size()) return "missing '=>'";
+  if (sep - 3 != table.key.size()) return "invalid number of key fields";
+
+  std::vector<MatchKeyParam> match_key;
+  for (size_t i = 0; i < table.key.size(); i++) {
+    if (!parse_match_param(args[3 + i], table.key[i].first,
+                           table.key[i].second, &match_key))
+      return "invalid key field " + args[3 + i];
+  }
+  std::vector<std::string> params(args.begin() + sep + 1, args.end());
+  if (!parse_action_data(params, action_widths, &action_data))
+    return "invalid action parameters";
+  bm::entry_handle_t handle;
+  auto rc = sw->mt_add_entry(0, table_name, match_key, action_name,
+                             std::move(action_data), &handle, priority);
+  if (rc != bm::MatchErrorCode::SUCCESS)
+    return "error code " + std::to_string(static_cast<int>(rc));
+  return "";
+}
+
+}  // namespace
+
+int
+load_commands(bm::RuntimeInterface *sw, const std::string &json_path,
+              const std::string &commands_path) {
+  ProgramInfo info;
+  if (!read_program_info(json_path, &info)) return 1;
+
+  std::ifstream fs(commands_path);
+  if (!fs) {
+    std::cerr << "Cannot open commands file " << commands_path << "\n";
+    return 1;
+  }
+  std::string line;
+  for (int line_nb = 1; std::getline(fs, line); line_nb++) {
+    std::istringstream ss(line);
+    std::vector<std::string> args;
+    std::string arg;
+    while (ss >> arg) args.push_back(arg);
+    if (args.empty() || args[0][0] == '#') continue;
+    auto error = run_command(sw, info, std::move(args));
+    if (!error.empty()) {
+      std::cerr << commands_path << ":" << line_nb << ": " << error << "\n";
+      return 1;
+    }
+  }
+  return 0;
+}
+
+}  // namespace sswitch_bench
@@ -0,0 +1,40 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMPLE_SWITCH_BENCH_BENCH_COMMANDS_H_
+#define SIMPLE_SWITCH_BENCH_BENCH_COMMANDS_H_
+
+#include <string>
+
+namespace bm {
+
+class RuntimeInterface;
+
+}  // namespace bm
+
+namespace sswitch_bench {
+
+// Populates the tables of context 0 from a runtime_CLI script. Only
+// table_set_default and table_add are supported (with the same syntax as in
+// runtime_CLI.py); empty lines and lines starting with '#' are ignored. The
+// key and action parameter widths are read from the program JSON, which has
+// to be the one loaded in the switch. Returns 0 on success; on error, a
+// message is printed to stderr and the remaining commands are not executed.
+int load_commands(bm::RuntimeInterface *sw, const std::string &json_path,
+                  const std::string &commands_path);
+
+}  // namespace sswitch_bench
+
+#endif  // SIMPLE_SWITCH_BENCH_BENCH_COMMANDS_H_
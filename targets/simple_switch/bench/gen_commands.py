@@ -0,0 +1,138 @@
+#!/usr/bin/env python2
+
+# Copyright 2013-present Barefoot Networks, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Generates the table population scripts (runtime_CLI syntax) for the reference
+# programs in testdata/. The flows match the traffic synthesized by
+# sswitch_bench when no pcap file is provided: for flow i, the packet is
+# Ethernet / IPv4 / TCP with:
+#   dstAddr = 00:00:00:00:<i / 256>:<i % 256>
+#   srcAddr = 00:00:01:00:<i / 256>:<i % 256>
+#   ipv4.srcAddr = 192.168.<i / 256>.<i % 256>
+#   ipv4.dstAddr = 10.0.<i / 256>.<i % 256>
+#   tcp.srcPort = 1024 + i, tcp.dstPort = 80
+# and it is forwarded to port i % num_ports.
+
+import argparse
+import os
+
+parser = argparse.ArgumentParser(description='sswitch_bench commands generator')
+parser.add_argument('--flows', help='Num flows',
+                    type=int, action="store", default=256)
+parser.add_argument('--ports', help='Num ports',
+                    type=int, action="store", default=4)
+parser.add_argument('--routes', help='Num extra (non-matching) LPM routes',
+                    type=int, action="store", default=4096)
+parser.add_argument('--acl-entries', help='Num entries in each ACL table',
+                    type=int, action="store", default=256)
+parser.add_argument('--out-dir', help='Destination directory',
+                    type=str, action="store",
+                    default=os.path.join(os.path.dirname(__file__), "testdata"))
+
+args = parser.parse_args()
+
+
+def hi_lo(i):
+    return (i >> 8) & 0xff, i & 0xff
+
+
+def dmac(i):
+    return "00:00:00:00:%02x:%02x" % hi_lo(i)
+
+
+def smac(i):
+    return "00:00:01:00:%02x:%02x" % hi_lo(i)
+
+
+def dst_ip(i):
+    return "10.0.%d.%d" % hi_lo(i)
+
+
+def port_mac(p):
+    return "00:00:02:00:00:%02x" % p
+
+
+def gen_l2():
+    cmds = ["table_set_default smac _nop",
+            "table_set_default dmac _drop"]
+    for i in range(args.flows):
+        cmds.append("table_add smac _nop %s =>" % smac(i))
+        cmds.append("table_add dmac forward %s => %d" % (dmac(i),
+                                                          i % args.ports))
+    return cmds
+
+
+# 172.16.0.0/12 is never used by the synthesized traffic
+def filler_routes(action_params):
+    cmds = []
+    for k in range(args.routes):
+        prefix = "172.%d.%d.0/24" % (16 + ((k >> 8) & 0xf), k & 0xff)
+        cmds.append("table_add ipv4_lpm %s %s => %s" % (
+            action_params[0], prefix, action_params[1]))
+    return cmds
+
+
+def gen_l3_lpm():
+    cmds = ["table_set_default ipv4_lpm _drop",
+            "table_set_default forward _drop",
+            "table_set_default send_frame _drop"]
+    cmds += filler_routes(("set_nhop", "172.16.0.1 0"))
+    cmds.append("table_add forward set_dmac 172.16.0.1 => %s" % dmac(0))
+    for i in range(args.flows):
+        cmds.append("table_add ipv4_lpm set_nhop %s/32 => %s %d" % (
+            dst_ip(i), dst_ip(i), i % args.ports))
+        cmds.append("table_add forward set_dmac %s => %s" % (dst_ip(i),
+                                                             dmac(i)))
+    for p in range(args.ports):
+        cmds.append("table_add send_frame rewrite_mac %d => %s" % (
+            p, port_mac(p)))
+    return cmds
+
+
+# the ACL entries never match the synthesized traffic, and the default action
+# is _nop, so each lookup goes through all the entries
+def gen_acl():
+    cmds = ["table_set_default ipv4_lpm _drop",
+            "table_set_default acl_src _nop",
+            "table_set_default acl_dst _nop",
+            "table_set_default acl_5tuple _nop",
+            "table_set_default acl_ports _nop"]
+    cmds += filler_routes(("set_port", "0"))
+    for i in range(args.flows):
+        cmds.append("table_add ipv4_lpm set_port %s/32 => %d" % (
+            dst_ip(i), i % args.ports))
+    for k in range(args.acl_entries):
+        addr = "172.16.%d.%d" % hi_lo(k)
+        prio = k + 1
+        cmds.append(
+            "table_add acl_src _drop %s&&&0xffffffff 0x06&&&0xff => %d" % (
+                addr, prio))
+        cmds.append(
+            "table_add acl_dst _drop %s&&&0xffffffff 80&&&0xffff => %d" % (
+                addr, prio))
+        cmds.append(
+            "table_add acl_5tuple _drop 192.168.0.0&&&0xffff0000 "
+            "%s&&&0xffffffff 0x06&&&0xff 0&&&0 80&&&0xffff => %d" % (
+                addr, prio))
+        cmds.append("table_add acl_ports _drop 0->1023 %d->%d => %d" % (
+            8000 + k, 8000 + k, prio))
+    return cmds
+
+
+for name, gen in [("l2", gen_l2), ("l3_lpm", gen_l3_lpm), ("acl", gen_acl)]:
+    path = os.path.join(args.out_dir, name + "_commands.txt")
+    with open(path, "w") as f:
+        f.write("\n".join(gen()) + "\n")
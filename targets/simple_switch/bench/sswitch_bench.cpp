@@ -0,0 +1,501 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// End-to-end throughput benchmark for simple_switch. The switch runs in the
+// benchmark process: packets are injected directly with SimpleSwitch::receive
+// and collected by a custom DevMgrIface in transmit_fn, so the results do not
+// depend on the performance of the packet I/O layer. A sequence number is
+// written in the last 8 bytes of each injected packet, which lets us compute
+// the receive-to-transmit latency of each packet (this assumes that the P4
+// program does not modify the end of the packet).
+//
+// Several switches can run in the same process (--switches), in which case the
+// packets are injected in each switch in turn, and they can share a pool of
+// worker threads (--thread-pool) instead of having dedicated threads. With
+// --burst, the ingress thread processes the packets waiting in the input
+// buffer in bursts (see SimpleSwitch::set_ingress_burst).
+
+#include <bm/bm_sim/dev_mgr.h>
+#include <bm/bm_sim/pcap_file.h>
+#include <bm/bm_sim/port_monitor.h>
+#include <bm/bm_sim/thread_pool.h>
+
+#include <jsoncpp/json.h>
+
+#include <pthread.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "simple_switch.h"
+
+#include "bench_commands.h"
+
+namespace {
+
+int64_t
+now_ns() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Options {
+  std::string json_path{};
+  std::string commands_path{};
+  // if empty, synthesized traffic is used
+  std::string pcap_path{};
+  size_t flows{256};
+  size_t pkt_size{256};
+  size_t ports{4};
+  size_t packets{1000000};
+  // 0 means inject as fast as the switch accepts packets
+  uint64_t rate_pps{0};
+  // also report the per-stage latency histograms of the switch
+  bool stage_latency{false};
+  size_t switches{1};
+  // 0 means that each switch has its own packet processing threads
+  size_t pool_threads{0};
+  // max number of packets processed together by the ingress pipeline
+  size_t burst{1};
+  std::string output_path{};
+};
+
+constexpr size_t seq_size = sizeof(uint64_t);
+
+// Records the sequence number and the transmit time of each packet. There is a
+// single transmit thread (or strand) in simple_switch, which is the only
+// writer.
+class TxRecorder {
+ public:
+  struct Record {
+    uint64_t seq;
+    int64_t ts;
+  };
+
+  explicit TxRecorder(size_t capacity)
+      : records(capacity) { }
+
+  void record(const char *buffer, int len) {
+    size_t idx = count.load(std::memory_order_relaxed);
+    if (idx == records.size() || len < static_cast<int>(seq_size)) return;
+    records[idx].ts = now_ns();
+    std::memcpy(&records[idx].seq, buffer + len - seq_size, seq_size);
+    count.store(idx + 1, std::memory_order_release);
+  }
+
+  size_t size() const { return count.load(std::memory_order_acquire); }
+
+  const Record &at(size_t idx) const { return records[idx]; }
+
+ private:
+  std::vector<Record> records;
+  std::atomic<size_t> count{0};
+};
+
+class BenchDevMgr : public bm::DevMgrIface {
+ public:
+  explicit BenchDevMgr(TxRecorder *recorder)
+      : recorder(recorder) {
+    p_monitor = bm::PortMonitorIface::make_dummy();
+  }
+
+ private:
+  ReturnCode port_add_(const std::string &, port_t, const char *,
+                       const char *) override {
+    return ReturnCode::SUCCESS;
+  }
+
+  ReturnCode port_remove_(port_t) override {
+    return ReturnCode::SUCCESS;
+  }
+
+  void transmit_fn_(int port_num, const char *buffer, int len) override {
+    (void) port_num;
+    recorder->record(buffer, len);
+  }
+
+  void start_() override { }
+
+  ReturnCode set_packet_handler_(const PacketHandler &, void *) override {
+    return ReturnCode::SUCCESS;
+  }
+
+  bool port_is_up_(port_t) const override {
+    return true;
+  }
+
+  std::map<port_t, PortInfo> get_port_info_() const override {
+    return {};
+  }
+
+  TxRecorder *recorder;
+};
+
+struct TemplatePacket {
+  int port;
+  std::string data;
+};
+
+// See gen_commands.py for a description of the flows; the commands files in
+// testdata/ assume these flows.
+std::vector<TemplatePacket>
+synthesize_packets(const Options &options) {
+  std::vector<TemplatePacket> packets;
+  for (size_t i = 0; i < options.flows; i++) {
+    const char hi = static_cast<char>((i >> 8) & 0xff);
+    const char lo = static_cast<char>(i & 0xff);
+    const uint16_t sport = 1024 + i;
+    const size_t ip_len = options.pkt_size - 14;
+    const char eth_ip_tcp[] = {
+      // Ethernet
+      0, 0, 0, 0, hi, lo, 0, 0, 1, 0, hi, lo, 0x08, 0x00,
+      // IPv4, the checksum is not verified by the reference programs
+      0x45, 0, static_cast<char>(ip_len >> 8), static_cast<char>(ip_len), 0, 0,
+      0, 0, 64, 6, 0, 0, static_cast<char>(192), static_cast<char>(168), hi, lo,
+      10, 0, hi, lo,
+      // TCP
+      static_cast<char>(sport >> 8), static_cast<char>(sport), 0, 80,
+      0, 0, 0, 0, 0, 0, 0, 0, 0x50, 0x02, 0x20, 0, 0, 0, 0, 0};
+    std::string data(eth_ip_tcp, sizeof(eth_ip_tcp));
+    data.resize(options.pkt_size, '\x00');
+    packets.push_back({static_cast<int>(i % options.ports), std::move(data)});
+  }
+  return packets;
+}
+
+bool
+read_pcap_packets(const Options &options,
+                  std::vector<TemplatePacket> *packets) {
+  bm::PcapFileIn pcap(0, options.pcap_path);
+  size_t i = 0;
+  while (pcap.moveNext()) {
+    auto p = pcap.current();
+    if (p->getLength() < 64) continue;
+    packets->push_back({static_cast<int>(i++ % options.ports),
+                        std::string(p->getData(), p->getLength())});
+  }
+  if (packets->empty()) {
+    std::cerr << "No packet of at least 64 bytes in " << options.pcap_path
+              << "\n";
+    return false;
+  }
+  return true;
+}
+
+// CPU time (user + system) consumed by each thread of the process, in clock
+// ticks, grouped by thread class; the class is the thread name without its
+// "-<index>" suffix, if any (e.g. "egress-0" and "egress-1" are both
+// "egress").
+typedef std::map<int, std::pair<std::string, uint64_t> > ThreadTimes;
+
+ThreadTimes
+read_thread_times() {
+  ThreadTimes times;
+  DIR *dir = opendir("/proc/self/task");
+  if (!dir) return times;
+  while (struct dirent *entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') continue;
+    std::ifstream fs(std::string("/proc/self/task/") + entry->d_name +
+                     "/stat");
+    std::string stat;
+    if (!std::getline(fs, stat)) continue;
+    // the name may contain spaces, but is always between parentheses
+    auto name_start = stat.find('(');
+    auto name_end = stat.rfind(')');
+    if (name_start == std::string::npos || name_end == std::string::npos)
+      continue;
+    auto name = stat.substr(name_start + 1, name_end - name_start - 1);
+    auto dash = name.rfind('-');
+    if (dash != std::string::npos && dash + 1 < name.size() &&
+        name.find_first_not_of("0123456789", dash + 1) == std::string::npos)
+      name.resize(dash);
+    // utime and stime are fields 14 and 15, the name is field 2
+    std::istringstream ss(stat.substr(name_end + 2));
+    std::string field;
+    uint64_t utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && ss >> field; i++) {
+      if (i == 14) utime = std::stoull(field);
+      if (i == 15) stime = std::stoull(field);
+    }
+    times[std::atoi(entry->d_name)] = {name, utime + stime};
+  }
+  closedir(dir);
+  return times;
+}
+
+Json::Value
+cpu_utilization(const ThreadTimes &before, const ThreadTimes &after,
+                double duration_s) {
+  std::map<std::string, uint64_t> ticks_per_class;
+  for (const auto &p : after) {
+    auto it = before.find(p.first);
+    auto prev = (it == before.end()) ? 0 : it->second.second;
+    ticks_per_class[p.second.first] += p.second.second - prev;
+  }
+  const double ticks_per_s = sysconf(_SC_CLK_TCK);
+  // 1.0 means one core fully used
+  Json::Value cpu(Json::objectValue);
+  for (const auto &p : ticks_per_class)
+    cpu[p.first] = p.second / ticks_per_s / duration_s;
+  return cpu;
+}
+
+void usage(const char *prog) {
+  std::cerr << "Usage: " << prog << " --json <program JSON> "
+            << "[--commands <runtime_CLI commands file>] "
+            << "[--pcap <pcap file> | --flows <n> --pkt-size <bytes>] "
+            << "[--ports <n>] [--packets <n>] [--rate <pps>] "
+            << "[--switches <n>] [--thread-pool <nb threads>] "
+            << "[--burst <n>] "
+            << "[--stage-latency] [-o <output file>]\n";
+}
+
+bool
+parse_options(int argc, char *argv[], Options *options) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    if (arg == "--stage-latency") {
+      options->stage_latency = true;
+      continue;
+    }
+    if (i + 1 == argc) return false;
+    const std::string value(argv[++i]);
+    if (arg == "--json") {
+      options->json_path = value;
+    } else if (arg == "--commands") {
+      options->commands_path = value;
+    } else if (arg == "--pcap") {
+      options->pcap_path = value;
+    } else if (arg == "--flows") {
+      options->flows = std::stoul(value);
+    } else if (arg == "--pkt-size") {
+      options->pkt_size = std::stoul(value);
+    } else if (arg == "--ports") {
+      options->ports = std::stoul(value);
+    } else if (arg == "--packets") {
+      options->packets = std::stoul(value);
+    } else if (arg == "--rate") {
+      options->rate_pps = std::stoull(value);
+    } else if (arg == "--switches") {
+      options->switches = std::stoul(value);
+    } else if (arg == "--thread-pool") {
+      options->pool_threads = std::stoul(value);
+    } else if (arg == "--burst") {
+      options->burst = std::stoul(value);
+    } else if (arg == "-o") {
+      options->output_path = value;
+    } else {
+      return false;
+    }
+  }
+  return !options->json_path.empty() && options->flows > 0 &&
+      options->flows <= 65536 && options->pkt_size >= 64 &&
+      options->ports > 0 && options->packets > 0 && options->switches > 0 &&
+      options->burst > 0;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  if (!parse_options(argc, argv, &options)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::vector<TemplatePacket> templates;
+  if (options.pcap_path.empty())
+    templates = synthesize_packets(options);
+  else if (!read_pcap_packets(options, &templates))
+    return 1;
+
+  // the pool and the switches are never deleted, as simple_switch detaches
+  // its threads
+  bm::ThreadPool *pool = nullptr;
+  if (options.pool_threads > 0)
+    pool = new bm::ThreadPool(options.pool_threads, "pool");
+  std::vector<SimpleSwitch *> switches;
+  std::vector<std::unique_ptr<TxRecorder> > recorders;
+  const size_t packets_per_switch =
+      (options.packets + options.switches - 1) / options.switches;
+  for (size_t i = 0; i < options.switches; i++) {
+    auto sw = new SimpleSwitch(std::max<int>(options.ports, 8));
+    if (sw->init_objects(options.json_path, i) != 0) {
+      std::cerr << "Cannot load JSON program " << options.json_path << "\n";
+      return 1;
+    }
+    // transmitted packets may be replicated, hence the extra room
+    recorders.emplace_back(new TxRecorder(2 * packets_per_switch));
+    sw->set_dev_mgr(std::unique_ptr<bm::DevMgrIface>(
+        new BenchDevMgr(recorders.back().get())));
+    if (pool) sw->set_thread_pool(pool);
+    sw->set_ingress_burst(options.burst);
+    sw->Switch::start();  // there is a start member in SimpleSwitch
+    sw->start_and_return();
+    if (!options.commands_path.empty() &&
+        sswitch_bench::load_commands(sw, options.json_path,
+                                     options.commands_path) != 0) {
+      return 1;
+    }
+    switches.push_back(sw);
+  }
+  auto transmitted_count = [&recorders]() {
+    size_t count = 0;
+    for (const auto &recorder : recorders) count += recorder->size();
+    return count;
+  };
+
+#ifdef __linux__
+  pthread_setname_np(pthread_self(), "bench-inject");
+#endif
+  // only the latencies of the first switch are reported
+  if (options.stage_latency) switches[0]->set_stage_latency_enabled(true);
+
+  std::vector<int64_t> rx_ts(options.packets);
+  std::vector<char> buffer;
+  const auto times_before = read_thread_times();
+  const int64_t start = now_ns();
+  for (uint64_t seq = 0; seq < options.packets; seq++) {
+    if (options.rate_pps > 0) {
+      // sleeping rather than spinning leaves the cores to the switch threads;
+      // the schedule is absolute, so the average rate is still accurate
+      const int64_t next = start + seq * 1000000000ull / options.rate_pps;
+      const int64_t wait = next - now_ns();
+      if (wait > 0)
+        std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+    }
+    const auto &p = templates[seq % templates.size()];
+    buffer.assign(p.data.begin(), p.data.end());
+    std::memcpy(buffer.data() + buffer.size() - seq_size, &seq, seq_size);
+    rx_ts[seq] = now_ns();
+    switches[seq % switches.size()]->receive(
+        p.port, buffer.data(), static_cast<int>(buffer.size()));
+  }
+  const int64_t inject_end = now_ns();
+
+  // we do not know how many packets the program drops, so we wait until no
+  // packet has been transmitted for a while
+  constexpr auto idle_time = std::chrono::milliseconds(100);
+  for (size_t count = transmitted_count(); ; ) {
+    std::this_thread::sleep_for(idle_time);
+    size_t new_count = transmitted_count();
+    if (new_count == count) break;
+    count = new_count;
+  }
+  const auto times_after = read_thread_times();
+
+  const size_t transmitted = transmitted_count();
+  std::vector<double> latencies_us;
+  latencies_us.reserve(transmitted);
+  // packets can be dropped by the program or because an egress queue is full
+  std::vector<bool> seen(options.packets, false);
+  size_t dropped = options.packets;
+  int64_t end = start;
+  for (const auto &recorder : recorders) {
+    for (size_t i = 0; i < recorder->size(); i++) {
+      const auto &record = recorder->at(i);
+      if (record.seq >= options.packets) continue;
+      latencies_us.push_back((record.ts - rx_ts[record.seq]) / 1000.);
+      end = std::max(end, record.ts);
+      if (!seen[record.seq]) dropped--;
+      seen[record.seq] = true;
+    }
+  }
+  std::sort(latencies_us.begin(), latencies_us.end());
+  // end is the last transmit time, the idle wait is not included
+  if (transmitted == 0) end = inject_end;
+  const double duration_s = (end - start) / 1e9;
+  const double inject_duration_s = (inject_end - start) / 1e9;
+
+  Json::Value root(Json::objectValue);
+  root["program"] = options.json_path;
+  root["traffic"] = options.pcap_path.empty() ? "synthesized" :
+      options.pcap_path;
+  root["switches"] = Json::UInt64(options.switches);
+  root["pool_threads"] = Json::UInt64(options.pool_threads);
+  root["burst"] = Json::UInt64(options.burst);
+  root["injected"] = Json::UInt64(options.packets);
+  root["transmitted"] = Json::UInt64(transmitted);
+  root["dropped"] = Json::UInt64(dropped);
+  uint64_t output_buffer_drops = 0;
+  for (const auto *sw : switches)
+    output_buffer_drops += sw->get_output_buffer_drops();
+  root["output_buffer_drops"] = Json::UInt64(output_buffer_drops);
+  root["duration_s"] = duration_s;
+  root["offered_pps"] = options.packets / inject_duration_s;
+  root["sustained_pps"] = transmitted / duration_s;
+  Json::Value latency(Json::objectValue);
+  if (!latencies_us.empty()) {
+    auto percentile = [&latencies_us](double p) {
+      size_t idx = static_cast<size_t>(p * (latencies_us.size() - 1));
+      return latencies_us[idx];
+    };
+    latency["min"] = latencies_us.front();
+    latency["p50"] = percentile(0.5);
+    latency["p90"] = percentile(0.9);
+    latency["p99"] = percentile(0.99);
+    latency["p999"] = percentile(0.999);
+    latency["max"] = latencies_us.back();
+  }
+  root["latency_us"] = latency;
+  root["cpu_utilization"] = cpu_utilization(times_before, times_after,
+                                            duration_s);
+  if (options.stage_latency) {
+    Json::Value stages(Json::arrayValue);
+    for (const auto &s : switches[0]->get_stage_latency_stats()) {
+      Json::Value stage(Json::objectValue);
+      stage["stage"] = s.stage;
+      stage["count"] = Json::UInt64(s.count);
+      stage["min_ns"] = Json::UInt64(s.min_ns);
+      stage["mean_ns"] = Json::UInt64(s.mean_ns);
+      stage["p50_ns"] = Json::UInt64(s.p50_ns);
+      stage["p90_ns"] = Json::UInt64(s.p90_ns);
+      stage["p99_ns"] = Json::UInt64(s.p99_ns);
+      stage["p999_ns"] = Json::UInt64(s.p999_ns);
+      stage["max_ns"] = Json::UInt64(s.max_ns);
+      stages.append(stage);
+    }
+    root["stage_latency"] = stages;
+  }
+
+  Json::StyledStreamWriter writer;
+  if (options.output_path.empty()) {
+    writer.write(std::cout, root);
+  } else {
+    std::ofstream fs(options.output_path);
+    if (!fs) {
+      std::cerr << "Cannot open output file " << options.output_path << "\n";
+      return 1;
+    }
+    writer.write(fs, root);
+  }
+  return 0;
+}
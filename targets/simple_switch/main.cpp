@@ -22,6 +22,9 @@
 
 #include <bm/SimpleSwitch.h>
 #include <bm/bm_runtime/bm_runtime.h>
+#include <bm/bm_sim/target_parser.h>
+
+#include <iostream>
 
 #include "simple_switch.h"
 
@@ -35,10 +38,31 @@ shared_ptr<SimpleSwitchIf> get_handler(SimpleSwitch *sw);
 
 int
 main(int argc, char* argv[]) {
+  bm::TargetParserBasic simple_switch_parser;
+  simple_switch_parser.add_int_option(
+      "ingress-burst",
+      "Maximum number of queued packets sent through the ingress pipeline "
+      "together (default 1, i.e. one packet at a time)");
+
   simple_switch = new SimpleSwitch();
-  int status = simple_switch->init_from_command_line_options(argc, argv);
+  int status = simple_switch->init_from_command_line_options(
+      argc, argv, &simple_switch_parser);
   if (status != 0) std::exit(status);
 
+  int ingress_burst = 1;
+  auto rc = simple_switch_parser.get_int_option("ingress-burst",
+                                                &ingress_burst);
+  if (rc == bm::TargetParserBasic::ReturnCode::SUCCESS) {
+    if (ingress_burst < 1) {
+      std::cerr << "Invalid value for --ingress-burst: " << ingress_burst
+                << "\n";
+      std::exit(1);
+    }
+    simple_switch->set_ingress_burst(static_cast<size_t>(ingress_burst));
+  } else if (rc != bm::TargetParserBasic::ReturnCode::OPTION_NOT_PROVIDED) {
+    std::exit(1);
+  }
+
   int thrift_port = simple_switch->get_runtime_port();
   bm_runtime::start_server(simple_switch, thrift_port);
   using ::sswitch_runtime::SimpleSwitchIf;
@@ -0,0 +1,88 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mirroring_sessions.h"
+
+#include <algorithm>
+
+namespace {
+
+double burst_tokens(const MirroringSessions::Config &config) {
+  return static_cast<double>(std::max<uint64_t>(config.burst_size, 1));
+}
+
+}  // namespace
+
+void
+MirroringSessions::add_session(mirror_id_t mirror_id, const Config &config) {
+  std::unique_lock<std::mutex> lock(mutex);
+  sessions[mirror_id] = {config, {0, 0}, burst_tokens(config), clock::now()};
+}
+
+bool
+MirroringSessions::delete_session(mirror_id_t mirror_id) {
+  std::unique_lock<std::mutex> lock(mutex);
+  return sessions.erase(mirror_id) > 0;
+}
+
+bool
+MirroringSessions::get_session(mirror_id_t mirror_id, Config *config) const {
+  std::unique_lock<std::mutex> lock(mutex);
+  const auto it = sessions.find(mirror_id);
+  if (it == sessions.end()) return false;
+  *config = it->second.config;
+  return true;
+}
+
+bool
+MirroringSessions::get_stats(mirror_id_t mirror_id, Stats *stats) const {
+  std::unique_lock<std::mutex> lock(mutex);
+  const auto it = sessions.find(mirror_id);
+  if (it == sessions.end()) return false;
+  *stats = it->second.stats;
+  return true;
+}
+
+void
+MirroringSessions::reset() {
+  std::unique_lock<std::mutex> lock(mutex);
+  sessions.clear();
+}
+
+bool
+MirroringSessions::admit(mirror_id_t mirror_id, Config *config,
+                         clock::time_point now) {
+  std::unique_lock<std::mutex> lock(mutex);
+  const auto it = sessions.find(mirror_id);
+  if (it == sessions.end()) return false;
+  auto &session = it->second;
+  if (session.config.rate_pps > 0) {
+    if (now > session.last_refill) {
+      const std::chrono::duration<double> elapsed = now - session.last_refill;
+      session.tokens = std::min(
+          burst_tokens(session.config),
+          session.tokens + elapsed.count() * session.config.rate_pps);
+      session.last_refill = now;
+    }
+    if (session.tokens < 1.) {
+      session.stats.dropped++;
+      return false;
+    }
+    session.tokens -= 1.;
+  }
+  session.stats.mirrored++;
+  *config = session.config;
+  return true;
+}
@@ -0,0 +1,81 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMPLE_SWITCH_MIRRORING_SESSIONS_H_
+#define SIMPLE_SWITCH_MIRRORING_SESSIONS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Mirroring sessions of simple_switch, indexed by mirror id. Besides the
+// egress port, a session can truncate the mirrored copies and limit the rate
+// at which they are generated with a token bucket. Copies which exceed the
+// rate are never generated (so their payload is never copied) and are counted
+// as dropped. All methods are thread-safe.
+class MirroringSessions {
+ public:
+  typedef int mirror_id_t;
+  typedef std::chrono::steady_clock clock;
+
+  struct Config {
+    int egress_port;
+    // maximum size of the mirrored copies in bytes, 0 means no truncation
+    size_t truncate_length;
+    // maximum number of copies per second, 0 means no rate limit
+    uint64_t rate_pps;
+    // number of copies which can be generated back-to-back when the rate is
+    // limited; values smaller than 1 are treated as 1
+    uint64_t burst_size;
+  };
+
+  struct Stats {
+    uint64_t mirrored;
+    uint64_t dropped;
+  };
+
+  // replaces any existing session with the same id, and clears its counters
+  void add_session(mirror_id_t mirror_id, const Config &config);
+
+  // returns false if the session does not exist
+  bool delete_session(mirror_id_t mirror_id);
+
+  bool get_session(mirror_id_t mirror_id, Config *config) const;
+
+  bool get_stats(mirror_id_t mirror_id, Stats *stats) const;
+
+  // removes all the sessions
+  void reset();
+
+  // Called for each packet to mirror: returns false if there is no session
+  // for mirror_id or if the copy exceeds the rate limit of the session.
+  // Otherwise the session configuration is copied to *config.
+  bool admit(mirror_id_t mirror_id, Config *config,
+             clock::time_point now = clock::now());
+
+ private:
+  struct Session {
+    Config config;
+    Stats stats;
+    double tokens;
+    clock::time_point last_refill;
+  };
+
+  mutable std::mutex mutex{};
+  std::unordered_map<mirror_id_t, Session> sessions{};
+};
+
+#endif  // SIMPLE_SWITCH_MIRRORING_SESSIONS_H_
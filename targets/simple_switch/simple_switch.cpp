@@ -22,11 +22,15 @@
 #include <bm/bm_sim/tables.h>
 #include <bm/bm_sim/logger.h>
 
+#include <pthread.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <limits>
 #include <string>
+#include <vector>
 
 #include "simple_switch.h"
 
@@ -49,6 +53,18 @@ struct hash_ex {
   }
 };
 
+// the names are used to report the CPU utilization per thread class, e.g. in
+// the sswitch_bench benchmark; they are limited to 15 characters
+void
+set_thread_name(std::thread *t, const std::string &name) {
+#ifdef __linux__
+  pthread_setname_np(t->native_handle(), name.c_str());
+#else
+  (void) t;
+  (void) name;
+#endif
+}
+
 struct bmv2_hash {
   uint64_t operator()(const char *buf, size_t s) const {
     return bm::hash::xxh64(buf, s);
@@ -67,7 +83,7 @@ extern int import_primitives();
 SimpleSwitch::SimpleSwitch(int max_port, bool enable_swap)
   : Switch(enable_swap),
     max_port(max_port),
-    input_buffer(1024),
+    input_buffer(1024, 1024),
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
     egress_buffers(max_port, nb_egress_threads,
                    64, EgressThreadMapper(nb_egress_threads),
@@ -109,6 +125,14 @@ SimpleSwitch::SimpleSwitch(int max_port, bool enable_swap)
 }
 
 #define PACKET_LENGTH_REG_IDX 0
+// time at which the packet was pushed to its current queue, see stage_latency
+#define STAGE_TS_REG_IDX 1
+
+using Stage = StageLatency::Stage;
+
+constexpr size_t SimpleSwitch::ingress_worker;
+constexpr size_t SimpleSwitch::egress_worker_0;
+constexpr size_t SimpleSwitch::transmit_worker;
 
 int
 SimpleSwitch::receive(int port_num, const char *buffer, int len) {
@@ -148,7 +172,8 @@ SimpleSwitch::receive(int port_num, const char *buffer, int len) {
         .set(get_ts().count());
   }
 
-  input_buffer.push_front(std::move(packet));
+  packet->set_register(STAGE_TS_REG_IDX, stage_latency.now());
+  input_buffer_push(InputBuffer::PacketType::NORMAL, std::move(packet));
   return 0;
 }
 
@@ -156,16 +181,44 @@ void
 SimpleSwitch::start_and_return() {
   check_queueing_metadata();
 
+  // LAG members which are down are not selected by the PRE
+  for (const auto status : {PortStatus::PORT_UP, PortStatus::PORT_DOWN}) {
+    register_status_cb(status, [this](port_t port, const PortStatus status) {
+        pre->mc_set_port_status(port, status == PortStatus::PORT_UP);
+    });
+  }
+
+  // in thread pool mode, the tasks are posted when packets are received
+  if (thread_pool) return;
+
   std::thread t1(&SimpleSwitch::ingress_thread, this);
+  set_thread_name(&t1, "ingress");
   t1.detach();
   for (size_t i = 0; i < nb_egress_threads; i++) {
     std::thread t2(&SimpleSwitch::egress_thread, this, i);
+    set_thread_name(&t2, "egress-" + std::to_string(i));
     t2.detach();
   }
   std::thread t3(&SimpleSwitch::transmit_thread, this);
+  set_thread_name(&t3, "transmit");
   t3.detach();
 }
 
+void
+SimpleSwitch::set_thread_pool(bm::ThreadPool *pool) {
+  thread_pool = pool;
+  ingress_strand.reset(new bm::ThreadPool::Strand(pool));
+  egress_strands.clear();
+  for (size_t i = 0; i < nb_egress_threads; i++)
+    egress_strands.emplace_back(new bm::ThreadPool::Strand(pool));
+  transmit_strand.reset(new bm::ThreadPool::Strand(pool));
+}
+
+void
+SimpleSwitch::set_ingress_burst(size_t max_burst) {
+  ingress_burst = std::max<size_t>(max_burst, 1);
+}
+
 void
 SimpleSwitch::reset_target_state() {
   bm::Logger::get()->debug("Resetting simple_switch target-specific state");
@@ -200,19 +253,102 @@ SimpleSwitch::set_all_egress_queue_rates(const uint64_t rate_pps) {
   return 0;
 }
 
+int
+SimpleSwitch::set_stage_latency_enabled(bool enabled) {
+  if (enabled)
+    stage_latency.enable();
+  else
+    stage_latency.disable();
+  return 0;
+}
+
+int
+SimpleSwitch::reset_stage_latency_stats() {
+  stage_latency.reset();
+  return 0;
+}
+
 void
 SimpleSwitch::transmit_thread() {
   while (1) {
     std::unique_ptr<Packet> packet;
     output_buffer.pop_back(&packet);
-    BMELOG(packet_out, *packet);
-    BMLOG_DEBUG_PKT(*packet, "Transmitting packet of size {} out of port {}",
-                    packet->get_data_size(), packet->get_egress_port());
-    transmit_fn(packet->get_egress_port(),
-                packet->data(), packet->get_data_size());
+    transmit_process(std::move(packet));
   }
 }
 
+void
+SimpleSwitch::transmit_process(std::unique_ptr<Packet> packet) {
+  stage_latency.record(transmit_worker, Stage::TRANSMIT_QUEUE,
+                       packet->get_register(STAGE_TS_REG_IDX),
+                       stage_latency.now());
+  BMELOG(packet_out, *packet);
+  BMLOG_DEBUG_PKT(*packet, "Transmitting packet of size {} out of port {}",
+                  packet->get_data_size(), packet->get_egress_port());
+  transmit_fn(packet->get_egress_port(),
+              packet->data(), packet->get_data_size());
+}
+
+int
+SimpleSwitch::input_buffer_push(InputBuffer::PacketType packet_type,
+                                std::unique_ptr<Packet> &&packet) {
+  if (!input_buffer.push_front(packet_type, std::move(packet))) return 0;
+  if (thread_pool) ingress_strand->post([this] { ingress_task(); });
+  return 1;
+}
+
+void
+SimpleSwitch::output_buffer_push(std::unique_ptr<Packet> &&packet) {
+  if (!thread_pool) {
+    output_buffer.push_front(std::move(packet));
+    return;
+  }
+  // a task must never block, so we drop the packet if the transmit strand is
+  // too far behind
+  if (!output_buffer.try_push_front(std::move(packet))) {
+    BMLOG_DEBUG_PKT(*packet, "Output buffer full, dropping packet");
+    output_buffer_drops++;
+    return;
+  }
+  transmit_strand->post([this] { transmit_task(); });
+}
+
+void
+SimpleSwitch::ingress_task() {
+  std::unique_ptr<Packet> packet;
+  input_buffer.pop_back(&packet);
+  ingress_process(std::move(packet));
+}
+
+void
+SimpleSwitch::egress_task(size_t worker_id) {
+  using queue_clock = decltype(egress_buffers)::clock;
+  std::unique_ptr<Packet> packet;
+  size_t port;
+  queue_clock::time_point next;
+  if (egress_buffers.try_pop_back(worker_id, &port, &packet, &next)) {
+    egress_process(worker_id, port, std::move(packet));
+    return;
+  }
+  if (next == queue_clock::time_point::max()) return;
+  // the packet is held back by the rate limiter of its queue, we try again
+  // when it is released rather than blocking the worker
+  const auto delay = next - queue_clock::now();
+  thread_pool->post_after(
+      std::chrono::duration_cast<bm::ThreadPool::clock::duration>(delay),
+      [this, worker_id] {
+        egress_strands[worker_id]->post([this, worker_id] {
+            egress_task(worker_id); });
+      });
+}
+
+void
+SimpleSwitch::transmit_task() {
+  std::unique_ptr<Packet> packet;
+  output_buffer.pop_back(&packet);
+  transmit_process(std::move(packet));
+}
+
 ts_res
 SimpleSwitch::get_ts() const {
   return duration_cast<ts_res>(clock::now() - start);
@@ -230,6 +366,8 @@ SimpleSwitch::enqueue(int egress_port, std::unique_ptr<Packet> &&packet) {
           .set(egress_buffers.size(egress_port));
     }
 
+    packet->set_register(STAGE_TS_REG_IDX, stage_latency.now());
+
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
     size_t priority =
         phv->get_field(SSWITCH_PRIORITY_QUEUEING_SRC).get<size_t>();
@@ -237,20 +375,26 @@ SimpleSwitch::enqueue(int egress_port, std::unique_ptr<Packet> &&packet) {
       bm::Logger::get()->error("Priority out of range, dropping packet");
       return;
     }
-    egress_buffers.push_front(
+    int pushed = egress_buffers.push_front(
         egress_port, SSWITCH_PRIORITY_QUEUEING_NB_QUEUES - 1 - priority,
         std::move(packet));
 #else
-    egress_buffers.push_front(egress_port, std::move(packet));
+    int pushed = egress_buffers.push_front(egress_port, std::move(packet));
 #endif
+    if (pushed && thread_pool) {
+      size_t worker_id = EgressThreadMapper(nb_egress_threads)(egress_port);
+      egress_strands[worker_id]->post([this, worker_id] {
+          egress_task(worker_id); });
+    }
 }
 
-// used for ingress cloning, resubmit
+// used for ingress cloning
 std::unique_ptr<Packet>
 SimpleSwitch::copy_ingress_pkt(
     const std::unique_ptr<Packet> &packet,
-    PktInstanceType copy_type, p4object_id_t field_list_id) {
-  std::unique_ptr<Packet> packet_copy = packet->clone_no_phv_ptr();
+    PktInstanceType copy_type, p4object_id_t field_list_id,
+    size_t max_data_size) {
+  std::unique_ptr<Packet> packet_copy = packet->clone_no_phv_ptr(max_data_size);
   PHV *phv_copy = packet_copy->get_phv();
   phv_copy->reset_metadata();
   FieldList *field_list = this->get_field_list(field_list_id);
@@ -263,6 +407,35 @@ SimpleSwitch::copy_ingress_pkt(
   return packet_copy;
 }
 
+void
+SimpleSwitch::reset_pkt_for_reentry(Packet *packet,
+                                    PktInstanceType instance_type,
+                                    p4object_id_t field_list_id) {
+  // one scratch vector per thread, so that preserving the field list values
+  // does not require any allocation in the common case
+  static thread_local std::vector<Data> field_list_values;
+  FieldList *field_list = this->get_field_list(field_list_id);
+  PHV *phv = packet->get_phv();
+  size_t idx = 0;
+  for (const auto &p : *field_list) {
+    if (idx == field_list_values.size()) field_list_values.emplace_back();
+    field_list_values[idx++].set(phv->get_field(p.header, p.offset));
+  }
+  packet->recycle();
+  // same state as the PHV of a new packet, see Packet::~Packet
+  phv->reset();
+  phv->reset_header_stacks();
+  phv->reset_metadata();
+  idx = 0;
+  for (const auto &p : *field_list)
+    phv->get_field(p.header, p.offset).set(field_list_values[idx++]);
+  phv->get_field("standard_metadata.instance_type").set(instance_type);
+  size_t packet_size = packet->get_data_size();
+  packet->set_register(PACKET_LENGTH_REG_IDX, packet_size);
+  phv->get_field("standard_metadata.packet_length").set(packet_size);
+  packet->set_register(STAGE_TS_REG_IDX, stage_latency.now());
+}
+
 void
 SimpleSwitch::check_queueing_metadata() {
   bool enq_timestamp_e = field_exists("queueing_metadata", "enq_timestamp");
@@ -280,235 +453,327 @@ SimpleSwitch::check_queueing_metadata() {
 
 void
 SimpleSwitch::ingress_thread() {
-  PHV *phv;
-
+  if (ingress_burst > 1) {
+    std::vector<std::unique_ptr<Packet> > packets;
+    packets.reserve(ingress_burst);
+    while (1) {
+      input_buffer.pop_back_burst(&packets, ingress_burst);
+      ingress_process_burst(&packets);
+      packets.clear();
+    }
+  }
   while (1) {
     std::unique_ptr<Packet> packet;
     input_buffer.pop_back(&packet);
+    ingress_process(std::move(packet));
+  }
+}
 
-    // TODO(antonin): only update these if swapping actually happened?
-    Parser *parser = this->get_parser("parser");
-    Pipeline *ingress_mau = this->get_pipeline("ingress");
+void
+SimpleSwitch::ingress_process(std::unique_ptr<Packet> packet) {
+  uint64_t ts;
+  const Packet::buffer_state_t packet_in_state =
+      ingress_parse(packet.get(), &ts);
 
-    phv = packet->get_phv();
+  // TODO(antonin): only update this if swapping actually happened?
+  Pipeline *ingress_mau = this->get_pipeline("ingress");
+  ingress_mau->apply(packet.get());
+  stage_latency.stage_done(ingress_worker, Stage::INGRESS, &ts);
 
-    int ingress_port = packet->get_ingress_port();
-    (void) ingress_port;
-    BMLOG_DEBUG_PKT(*packet, "Processing packet received on port {}",
-                    ingress_port);
+  ingress_finish(std::move(packet), packet_in_state);
+}
 
-    /* This looks like it comes out of the blue. However this is needed for
-       ingress cloning. The parser updates the buffer state (pops the parsed
-       headers) to make the deparser's job easier (the same buffer is
-       re-used). But for ingress cloning, the original packet is needed. This
-       kind of looks hacky though. Maybe a better solution would be to have the
-       parser leave the buffer unchanged, and move the pop logic to the
-       deparser. TODO? */
-    const Packet::buffer_state_t packet_in_state = packet->save_buffer_state();
-    parser->parse(packet.get());
+void
+SimpleSwitch::ingress_process_burst(
+    std::vector<std::unique_ptr<Packet> > *packets) {
+  const size_t n = packets->size();
+  auto &packet_in_states = burst_packet_in_states;
+  auto &pkts = burst_pkts;
+  packet_in_states.clear();
+  pkts.clear();
+  for (auto &packet : *packets) {
+    uint64_t ts;
+    packet_in_states.push_back(ingress_parse(packet.get(), &ts));
+    pkts.push_back(packet.get());
+  }
 
-    ingress_mau->apply(packet.get());
+  Pipeline *ingress_mau = this->get_pipeline("ingress");
+  const uint64_t start = stage_latency.now();
+  ingress_mau->apply_batch(pkts.data(), n);
+  const uint64_t end = stage_latency.now();
+
+  for (size_t i = 0; i < n; i++) {
+    // the time spent in the ingress pipeline is shared evenly by the packets
+    // of the burst
+    stage_latency.record(ingress_worker, Stage::INGRESS, start,
+                         start + (end - start) / n);
+    ingress_finish(std::move((*packets)[i]), packet_in_states[i]);
+  }
+}
 
-    packet->reset_exit();
+Packet::buffer_state_t
+SimpleSwitch::ingress_parse(Packet *packet, uint64_t *ts) {
+  *ts = stage_latency.now();
+  stage_latency.record(ingress_worker, Stage::INPUT_BUFFER,
+                       packet->get_register(STAGE_TS_REG_IDX), *ts);
+
+  Parser *parser = this->get_parser("parser");
+
+  int ingress_port = packet->get_ingress_port();
+  (void) ingress_port;
+  BMLOG_DEBUG_PKT(*packet, "Processing packet received on port {}",
+                  ingress_port);
+
+  /* This looks like it comes out of the blue. However this is needed for
+     ingress cloning. The parser updates the buffer state (pops the parsed
+     headers) to make the deparser's job easier (the same buffer is
+     re-used). But for ingress cloning, the original packet is needed. This
+     kind of looks hacky though. Maybe a better solution would be to have the
+     parser leave the buffer unchanged, and move the pop logic to the
+     deparser. TODO? */
+  const Packet::buffer_state_t packet_in_state = packet->save_buffer_state();
+  parser->parse(packet);
+  stage_latency.stage_done(ingress_worker, Stage::PARSER, ts);
+  return packet_in_state;
+}
 
-    Field &f_egress_spec = phv->get_field("standard_metadata.egress_spec");
-    int egress_spec = f_egress_spec.get_int();
+void
+SimpleSwitch::ingress_finish(std::unique_ptr<Packet> packet,
+                             const Packet::buffer_state_t &packet_in_state) {
+  PHV *phv = packet->get_phv();
 
-    Field &f_clone_spec = phv->get_field("standard_metadata.clone_spec");
-    unsigned int clone_spec = f_clone_spec.get_uint();
+  Parser *parser = this->get_parser("parser");
 
-    int learn_id = 0;
-    unsigned int mgid = 0u;
+  packet->reset_exit();
 
-    if (phv->has_field("intrinsic_metadata.lf_field_list")) {
-      Field &f_learn_id = phv->get_field("intrinsic_metadata.lf_field_list");
-      learn_id = f_learn_id.get_int();
-    }
+  Field &f_egress_spec = phv->get_field("standard_metadata.egress_spec");
+  int egress_spec = f_egress_spec.get_int();
 
-    // detect mcast support, if this is true we assume that other fields needed
-    // for mcast are also defined
-    if (phv->has_field("intrinsic_metadata.mcast_grp")) {
-      Field &f_mgid = phv->get_field("intrinsic_metadata.mcast_grp");
-      mgid = f_mgid.get_uint();
-    }
+  Field &f_clone_spec = phv->get_field("standard_metadata.clone_spec");
+  unsigned int clone_spec = f_clone_spec.get_uint();
 
-    int egress_port;
+  int learn_id = 0;
+  unsigned int mgid = 0u;
 
-    // INGRESS CLONING
-    if (clone_spec) {
-      BMLOG_DEBUG_PKT(*packet, "Cloning packet at ingress");
-      egress_port = get_mirroring_mapping(clone_spec & 0xFFFF);
-      f_clone_spec.set(0);
-      if (egress_port >= 0) {
-        const Packet::buffer_state_t packet_out_state =
-            packet->save_buffer_state();
-        packet->restore_buffer_state(packet_in_state);
-        p4object_id_t field_list_id = clone_spec >> 16;
-        auto packet_copy = copy_ingress_pkt(
-            packet, PKT_INSTANCE_TYPE_INGRESS_CLONE, field_list_id);
-        // we need to parse again
-        // the alternative would be to pay the (huge) price of PHV copy for
-        // every ingress packet
-        parser->parse(packet_copy.get());
-        enqueue(egress_port, std::move(packet_copy));
-        packet->restore_buffer_state(packet_out_state);
-      }
-    }
+  if (phv->has_field("intrinsic_metadata.lf_field_list")) {
+    Field &f_learn_id = phv->get_field("intrinsic_metadata.lf_field_list");
+    learn_id = f_learn_id.get_int();
+  }
 
-    // LEARNING
-    if (learn_id > 0) {
-      get_learn_engine()->learn(learn_id, *packet.get());
-    }
+  // detect mcast support, if this is true we assume that other fields needed
+  // for mcast are also defined
+  if (phv->has_field("intrinsic_metadata.mcast_grp")) {
+    Field &f_mgid = phv->get_field("intrinsic_metadata.mcast_grp");
+    mgid = f_mgid.get_uint();
+  }
 
-    // RESUBMIT
-    if (phv->has_field("intrinsic_metadata.resubmit_flag")) {
-      Field &f_resubmit = phv->get_field("intrinsic_metadata.resubmit_flag");
-      if (f_resubmit.get_int()) {
-        BMLOG_DEBUG_PKT(*packet, "Resubmitting packet");
-        // get the packet ready for being parsed again at the beginning of
-        // ingress
-        packet->restore_buffer_state(packet_in_state);
-        p4object_id_t field_list_id = f_resubmit.get_int();
-        f_resubmit.set(0);
-        // TODO(antonin): a copy is not needed here, but I don't yet have an
-        // optimized way of doing this
-        auto packet_copy = copy_ingress_pkt(
-            packet, PKT_INSTANCE_TYPE_RESUBMIT, field_list_id);
-        input_buffer.push_front(std::move(packet_copy));
-        continue;
+  int egress_port;
+
+  // INGRESS CLONING
+  if (clone_spec) {
+    BMLOG_DEBUG_PKT(*packet, "Cloning packet at ingress");
+    MirroringSessions::Config session;
+    f_clone_spec.set(0);
+    if (mirroring_sessions.admit(clone_spec & 0xFFFF, &session)) {
+      const Packet::buffer_state_t packet_out_state =
+          packet->save_buffer_state();
+      const size_t payload_size = packet->get_packet_buffer().get_data_size();
+      packet->restore_buffer_state(packet_in_state);
+      p4object_id_t field_list_id = clone_spec >> 16;
+      // when truncating, we still copy all the parsed headers, so that the
+      // clone can be parsed again
+      size_t max_data_size = std::numeric_limits<size_t>::max();
+      if (session.truncate_length > 0) {
+        max_data_size = std::max(
+            session.truncate_length,
+            packet->get_packet_buffer().get_data_size() - payload_size);
       }
+      auto packet_copy = copy_ingress_pkt(
+          packet, PKT_INSTANCE_TYPE_INGRESS_CLONE, field_list_id,
+          max_data_size);
+      // we need to parse again
+      // the alternative would be to pay the (huge) price of PHV copy for
+      // every ingress packet
+      parser->parse(packet_copy.get());
+      if (session.truncate_length > 0)
+        packet_copy->truncate(session.truncate_length);
+      enqueue(session.egress_port, std::move(packet_copy));
+      packet->restore_buffer_state(packet_out_state);
     }
+  }
 
-    Field &f_instance_type = phv->get_field("standard_metadata.instance_type");
-
-    // MULTICAST
-    int instance_type = f_instance_type.get_int();
-    if (mgid != 0) {
-      BMLOG_DEBUG_PKT(*packet, "Multicast requested for packet");
-      Field &f_rid = phv->get_field("intrinsic_metadata.egress_rid");
-      const auto pre_out = pre->replicate({mgid});
-      auto packet_size = packet->get_register(PACKET_LENGTH_REG_IDX);
-      for (const auto &out : pre_out) {
-        egress_port = out.egress_port;
-        // if (ingress_port == egress_port) continue; // pruning
-        BMLOG_DEBUG_PKT(*packet, "Replicating packet on port {}", egress_port);
-        f_rid.set(out.rid);
-        f_instance_type.set(PKT_INSTANCE_TYPE_REPLICATION);
-        std::unique_ptr<Packet> packet_copy = packet->clone_with_phv_ptr();
-        packet_copy->set_register(PACKET_LENGTH_REG_IDX, packet_size);
-        enqueue(egress_port, std::move(packet_copy));
-      }
-      f_instance_type.set(instance_type);
+  // LEARNING
+  if (learn_id > 0) {
+    get_learn_engine()->learn(learn_id, *packet.get());
+  }
 
-      // when doing multicast, we discard the original packet
-      continue;
+  // RESUBMIT
+  if (phv->has_field("intrinsic_metadata.resubmit_flag")) {
+    Field &f_resubmit = phv->get_field("intrinsic_metadata.resubmit_flag");
+    if (f_resubmit.get_int()) {
+      BMLOG_DEBUG_PKT(*packet, "Resubmitting packet");
+      // get the packet ready for being parsed again at the beginning of
+      // ingress
+      packet->restore_buffer_state(packet_in_state);
+      p4object_id_t field_list_id = f_resubmit.get_int();
+      f_resubmit.set(0);
+      reset_pkt_for_reentry(packet.get(), PKT_INSTANCE_TYPE_RESUBMIT,
+                            field_list_id);
+      if (!input_buffer_push(InputBuffer::PacketType::REENTRY,
+                             std::move(packet))) {
+        bm::Logger::get()->error(
+            "Resubmit queue full, dropping resubmitted packet");
+      }
+      return;
     }
+  }
 
-    egress_port = egress_spec;
-    BMLOG_DEBUG_PKT(*packet, "Egress port is {}", egress_port);
+  Field &f_instance_type = phv->get_field("standard_metadata.instance_type");
 
-    if (egress_port == 511) {  // drop packet
-      BMLOG_DEBUG_PKT(*packet, "Dropping packet at the end of ingress");
-      continue;
-    }
+  // MULTICAST
+  int instance_type = f_instance_type.get_int();
+  if (mgid != 0) {
+    BMLOG_DEBUG_PKT(*packet, "Multicast requested for packet");
+    Field &f_rid = phv->get_field("intrinsic_metadata.egress_rid");
+    uint64_t ts = stage_latency.now();
+    auto packet_size = packet->get_register(PACKET_LENGTH_REG_IDX);
+    // the LAG member is selected with the lag_hash calculation of the P4
+    // program, if it has one; only looked up for multicast packets
+    NamedCalculation *lag_hash = this->get_named_calculation("lag_hash");
+    const uint64_t flow_hash = lag_hash ? lag_hash->output(*packet) : 0;
+    pre->replicate({mgid}, flow_hash, [&](const McSimplePreLAG::McOut &out) {
+      egress_port = out.egress_port;
+      // if (ingress_port == egress_port) continue; // pruning
+      BMLOG_DEBUG_PKT(*packet, "Replicating packet on port {}", egress_port);
+      f_rid.set(out.rid);
+      f_instance_type.set(PKT_INSTANCE_TYPE_REPLICATION);
+      std::unique_ptr<Packet> packet_copy = packet->clone_with_phv_ptr();
+      packet_copy->set_register(PACKET_LENGTH_REG_IDX, packet_size);
+      enqueue(egress_port, std::move(packet_copy));
+    });
+    f_instance_type.set(instance_type);
+    stage_latency.stage_done(ingress_worker, Stage::PRE, &ts);
+
+    // when doing multicast, we discard the original packet
+    return;
+  }
 
-    enqueue(egress_port, std::move(packet));
+  egress_port = egress_spec;
+  BMLOG_DEBUG_PKT(*packet, "Egress port is {}", egress_port);
+
+  if (egress_port == 511) {  // drop packet
+    BMLOG_DEBUG_PKT(*packet, "Dropping packet at the end of ingress");
+    return;
   }
+
+  enqueue(egress_port, std::move(packet));
 }
 
 void
 SimpleSwitch::egress_thread(size_t worker_id) {
-  PHV *phv;
-
   while (1) {
     std::unique_ptr<Packet> packet;
     size_t port;
     egress_buffers.pop_back(worker_id, &port, &packet);
+    egress_process(worker_id, port, std::move(packet));
+  }
+}
 
-    Deparser *deparser = this->get_deparser("deparser");
-    Pipeline *egress_mau = this->get_pipeline("egress");
+void
+SimpleSwitch::egress_process(size_t worker_id, size_t port,
+                             std::unique_ptr<Packet> packet) {
+  PHV *phv;
 
-    phv = packet->get_phv();
+  uint64_t ts = stage_latency.now();
+  stage_latency.record(egress_worker_0 + worker_id, Stage::EGRESS_QUEUE,
+                       packet->get_register(STAGE_TS_REG_IDX), ts);
 
-    if (with_queueing_metadata) {
-      auto enq_timestamp =
-          phv->get_field("queueing_metadata.enq_timestamp").get<ts_res::rep>();
-      phv->get_field("queueing_metadata.deq_timedelta").set(
-          get_ts().count() - enq_timestamp);
-      phv->get_field("queueing_metadata.deq_qdepth").set(
-          egress_buffers.size(port));
-    }
+  Deparser *deparser = this->get_deparser("deparser");
+  Pipeline *egress_mau = this->get_pipeline("egress");
+
+  phv = packet->get_phv();
+
+  if (with_queueing_metadata) {
+    auto enq_timestamp =
+        phv->get_field("queueing_metadata.enq_timestamp").get<ts_res::rep>();
+    phv->get_field("queueing_metadata.deq_timedelta").set(
+        get_ts().count() - enq_timestamp);
+    phv->get_field("queueing_metadata.deq_qdepth").set(
+        egress_buffers.size(port));
+  }
+
+  phv->get_field("standard_metadata.egress_port").set(port);
+
+  Field &f_egress_spec = phv->get_field("standard_metadata.egress_spec");
+  f_egress_spec.set(0);
+
+  phv->get_field("standard_metadata.packet_length").set(
+      packet->get_register(PACKET_LENGTH_REG_IDX));
 
-    phv->get_field("standard_metadata.egress_port").set(port);
-
-    Field &f_egress_spec = phv->get_field("standard_metadata.egress_spec");
-    f_egress_spec.set(0);
-
-    phv->get_field("standard_metadata.packet_length").set(
-        packet->get_register(PACKET_LENGTH_REG_IDX));
-
-    egress_mau->apply(packet.get());
-
-    Field &f_clone_spec = phv->get_field("standard_metadata.clone_spec");
-    unsigned int clone_spec = f_clone_spec.get_uint();
-
-    // EGRESS CLONING
-    if (clone_spec) {
-      BMLOG_DEBUG_PKT(*packet, "Cloning packet at egress");
-      int egress_port = get_mirroring_mapping(clone_spec & 0xFFFF);
-      if (egress_port >= 0) {
-        f_clone_spec.set(0);
-        p4object_id_t field_list_id = clone_spec >> 16;
-        std::unique_ptr<Packet> packet_copy =
-            packet->clone_with_phv_reset_metadata_ptr();
-        PHV *phv_copy = packet_copy->get_phv();
-        FieldList *field_list = this->get_field_list(field_list_id);
-        for (const auto &p : *field_list) {
-          phv_copy->get_field(p.header, p.offset)
-            .set(phv->get_field(p.header, p.offset));
-        }
-        phv_copy->get_field("standard_metadata.instance_type")
-            .set(PKT_INSTANCE_TYPE_EGRESS_CLONE);
-        enqueue(egress_port, std::move(packet_copy));
+  egress_mau->apply(packet.get());
+  stage_latency.stage_done(egress_worker_0 + worker_id, Stage::EGRESS, &ts);
+
+  Field &f_clone_spec = phv->get_field("standard_metadata.clone_spec");
+  unsigned int clone_spec = f_clone_spec.get_uint();
+
+  // EGRESS CLONING
+  if (clone_spec) {
+    BMLOG_DEBUG_PKT(*packet, "Cloning packet at egress");
+    MirroringSessions::Config session;
+    if (mirroring_sessions.admit(clone_spec & 0xFFFF, &session)) {
+      f_clone_spec.set(0);
+      p4object_id_t field_list_id = clone_spec >> 16;
+      // the headers are in the PHV at this point and the buffer only
+      // contains the payload, so we never need to copy more than the
+      // truncation length
+      size_t max_data_size = std::numeric_limits<size_t>::max();
+      if (session.truncate_length > 0)
+        max_data_size = session.truncate_length;
+      std::unique_ptr<Packet> packet_copy =
+          packet->clone_with_phv_reset_metadata_ptr(max_data_size);
+      packet_copy->truncate(max_data_size);
+      PHV *phv_copy = packet_copy->get_phv();
+      FieldList *field_list = this->get_field_list(field_list_id);
+      for (const auto &p : *field_list) {
+        phv_copy->get_field(p.header, p.offset)
+          .set(phv->get_field(p.header, p.offset));
       }
+      phv_copy->get_field("standard_metadata.instance_type")
+          .set(PKT_INSTANCE_TYPE_EGRESS_CLONE);
+      enqueue(session.egress_port, std::move(packet_copy));
     }
+  }
 
-    // TODO(antonin): should not be done like this in egress pipeline
-    int egress_spec = f_egress_spec.get_int();
-    if (egress_spec == 511) {  // drop packet
-      BMLOG_DEBUG_PKT(*packet, "Dropping packet at the end of egress");
-      continue;
-    }
+  // TODO(antonin): should not be done like this in egress pipeline
+  int egress_spec = f_egress_spec.get_int();
+  if (egress_spec == 511) {  // drop packet
+    BMLOG_DEBUG_PKT(*packet, "Dropping packet at the end of egress");
+    return;
+  }
 
-    deparser->deparse(packet.get());
-
-    // RECIRCULATE
-    if (phv->has_field("intrinsic_metadata.recirculate_flag")) {
-      Field &f_recirc = phv->get_field("intrinsic_metadata.recirculate_flag");
-      if (f_recirc.get_int()) {
-        BMLOG_DEBUG_PKT(*packet, "Recirculating packet");
-        p4object_id_t field_list_id = f_recirc.get_int();
-        f_recirc.set(0);
-        FieldList *field_list = this->get_field_list(field_list_id);
-        // TODO(antonin): just like for resubmit, there is no need for a copy
-        // here, but it is more convenient for this first prototype
-        std::unique_ptr<Packet> packet_copy = packet->clone_no_phv_ptr();
-        PHV *phv_copy = packet_copy->get_phv();
-        phv_copy->reset_metadata();
-        for (const auto &p : *field_list) {
-          phv_copy->get_field(p.header, p.offset)
-              .set(phv->get_field(p.header, p.offset));
-        }
-        phv_copy->get_field("standard_metadata.instance_type")
-            .set(PKT_INSTANCE_TYPE_RECIRC);
-        size_t packet_size = packet_copy->get_data_size();
-        packet_copy->set_register(PACKET_LENGTH_REG_IDX, packet_size);
-        phv_copy->get_field("standard_metadata.packet_length").set(packet_size);
-        input_buffer.push_front(std::move(packet_copy));
-        continue;
+  ts = stage_latency.now();
+  deparser->deparse(packet.get());
+  stage_latency.stage_done(egress_worker_0 + worker_id, Stage::DEPARSER,
+                           &ts);
+
+  // RECIRCULATE
+  if (phv->has_field("intrinsic_metadata.recirculate_flag")) {
+    Field &f_recirc = phv->get_field("intrinsic_metadata.recirculate_flag");
+    if (f_recirc.get_int()) {
+      BMLOG_DEBUG_PKT(*packet, "Recirculating packet");
+      p4object_id_t field_list_id = f_recirc.get_int();
+      f_recirc.set(0);
+      reset_pkt_for_reentry(packet.get(), PKT_INSTANCE_TYPE_RECIRC,
+                            field_list_id);
+      if (!input_buffer_push(InputBuffer::PacketType::REENTRY,
+                             std::move(packet))) {
+        bm::Logger::get()->error(
+            "Recirculation queue full, dropping recirculated packet");
       }
+      return;
     }
-
-    output_buffer.push_front(std::move(packet));
   }
+
+  packet->set_register(STAGE_TS_REG_IDX, stage_latency.now());
+  output_buffer_push(std::move(packet));
 }
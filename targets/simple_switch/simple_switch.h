@@ -27,12 +27,22 @@
 #include <bm/bm_sim/switch.h>
 #include <bm/bm_sim/event_logger.h>
 #include <bm/bm_sim/simple_pre_lag.h>
+#include <bm/bm_sim/thread_pool.h>
 
+#include <array>
+#include <atomic>
 #include <memory>
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <limits>
+#include <mutex>
 #include <thread>
 #include <vector>
 
+#include "mirroring_sessions.h"
+#include "stage_latency.h"
+
 // TODO(antonin)
 // experimental support for priority queueing
 // to enable it, uncomment this flag
@@ -58,15 +68,17 @@ using bm::Parser;
 using bm::Deparser;
 using bm::Pipeline;
 using bm::McSimplePreLAG;
+using bm::Data;
 using bm::Field;
 using bm::FieldList;
+using bm::NamedCalculation;
 using bm::packet_id_t;
 using bm::p4object_id_t;
 
 
 class SimpleSwitch : public Switch {
  public:
-  typedef int mirror_id_t;
+  typedef MirroringSessions::mirror_id_t mirror_id_t;
 
  private:
   typedef std::chrono::high_resolution_clock clock;
@@ -79,19 +91,69 @@ class SimpleSwitch : public Switch {
 
   void start_and_return() override;
 
+  // Runs the packet processing on the threads of a shared pool instead of on
+  // threads owned by this switch, which lets many switches share one process.
+  // Only the ingress, egress and transmit threads are replaced: port I/O,
+  // ageing, learning and the Thrift server still have their own threads for
+  // each switch. The simple_switch binary runs a single switch and never
+  // calls this; it is used by sswitch_bench (--switches, --thread-pool).
+  // Must be called before start_and_return(), and the pool must outlive the
+  // switch. Each processing stage (ingress, every egress worker, transmit)
+  // runs as a strand of the pool, so packets are still processed in order.
+  // receive() still blocks when the input buffer is full, so it must not be
+  // called from a task of the pool. The egress tasks cannot block either, so
+  // they drop the packets which do not fit in the output buffer instead of
+  // waiting for the transmit strand (see get_output_buffer_drops()).
+  void set_thread_pool(bm::ThreadPool *pool);
+
+  // number of packets dropped because the output buffer was full, which only
+  // happens in thread pool mode
+  uint64_t get_output_buffer_drops() const {
+    return output_buffer_drops.load();
+  }
+
+  // Lets the ingress thread dequeue up to max_burst packets at a time from the
+  // input buffer and send them through the ingress pipeline together (see
+  // Pipeline::apply_batch()), which amortizes the per-table costs when the
+  // switch is loaded; only the packets already waiting are taken, so a
+  // lightly-loaded switch does not add latency. The default (1) processes
+  // packets one at a time. Set with the `--ingress-burst` target option of the
+  // simple_switch binary. Must be called before start_and_return(); ignored in
+  // thread pool mode.
+  void set_ingress_burst(size_t max_burst);
+
   void reset_target_state() override;
 
+  // a mirroring mapping is a session without truncation or rate limit
   int mirroring_mapping_add(mirror_id_t mirror_id, int egress_port) {
-    mirroring_map[mirror_id] = egress_port;
+    mirroring_sessions.add_session(mirror_id, {egress_port, 0, 0, 0});
     return 0;
   }
 
   int mirroring_mapping_delete(mirror_id_t mirror_id) {
-    return mirroring_map.erase(mirror_id);
+    return mirroring_sessions.delete_session(mirror_id) ? 1 : 0;
   }
 
   int mirroring_mapping_get(mirror_id_t mirror_id) const {
-    return get_mirroring_mapping(mirror_id);
+    MirroringSessions::Config config;
+    if (!mirroring_sessions.get_session(mirror_id, &config)) return -1;
+    return config.egress_port;
+  }
+
+  int mirroring_session_add(mirror_id_t mirror_id,
+                            const MirroringSessions::Config &config) {
+    mirroring_sessions.add_session(mirror_id, config);
+    return 0;
+  }
+
+  bool mirroring_session_get(mirror_id_t mirror_id,
+                             MirroringSessions::Config *config) const {
+    return mirroring_sessions.get_session(mirror_id, config);
+  }
+
+  bool mirroring_session_get_stats(mirror_id_t mirror_id,
+                                   MirroringSessions::Stats *stats) const {
+    return mirroring_sessions.get_stats(mirror_id, stats);
   }
 
   int set_egress_queue_depth(int port, const size_t depth_pkts);
@@ -100,9 +162,21 @@ class SimpleSwitch : public Switch {
   int set_egress_queue_rate(int port, const uint64_t rate_pps);
   int set_all_egress_queue_rates(const uint64_t rate_pps);
 
+  // per-stage latency histograms, disabled by default
+  int set_stage_latency_enabled(bool enabled);
+  std::vector<StageLatency::Stats> get_stage_latency_stats() const {
+    return stage_latency.get_stats();
+  }
+  int reset_stage_latency_stats();
+
  private:
   static constexpr size_t nb_egress_threads = 4u;
 
+  // indices of the packet processing threads for stage_latency
+  static constexpr size_t ingress_worker = 0u;
+  static constexpr size_t egress_worker_0 = 1u;
+  static constexpr size_t transmit_worker = 1u + nb_egress_threads;
+
   enum PktInstanceType {
     PKT_INSTANCE_TYPE_NORMAL,
     PKT_INSTANCE_TYPE_INGRESS_CLONE,
@@ -113,6 +187,75 @@ class SimpleSwitch : public Switch {
     PKT_INSTANCE_TYPE_RESUBMIT,
   };
 
+  // Packets which re-enter the ingress pipeline (resubmit, recirculate) are
+  // queued separately from new arrivals and are always served first. Pushing a
+  // new packet blocks while the queue is full, but re-entering packets are
+  // dropped instead: the ingress thread resubmits packets itself and must
+  // never wait on its own input.
+  class InputBuffer {
+   public:
+    enum class PacketType {
+      NORMAL,
+      REENTRY,
+    };
+
+    InputBuffer(size_t capacity_normal, size_t capacity_reentry)
+        : capacities{{capacity_normal, capacity_reentry}} { }
+
+    // returns 0 if the packet was dropped because the queue was full
+    int push_front(PacketType packet_type, std::unique_ptr<Packet> &&item) {
+      const auto idx = static_cast<size_t>(packet_type);
+      std::unique_lock<std::mutex> lock(mutex);
+      while (queues[idx].size() >= capacities[idx]) {
+        if (packet_type == PacketType::REENTRY) return 0;
+        cvar_can_push.wait(lock);
+      }
+      queues[idx].push_front(std::move(item));
+      lock.unlock();
+      cvar_can_pop.notify_one();
+      return 1;
+    }
+
+    void pop_back(std::unique_ptr<Packet> *pItem) {
+      std::unique_lock<std::mutex> lock(mutex);
+      auto &queue_reentry = queues[static_cast<size_t>(PacketType::REENTRY)];
+      auto &queue_normal = queues[static_cast<size_t>(PacketType::NORMAL)];
+      cvar_can_pop.wait(lock, [&queue_reentry, &queue_normal] {
+          return !queue_reentry.empty() || !queue_normal.empty(); });
+      auto &queue = queue_reentry.empty() ? queue_normal : queue_reentry;
+      *pItem = std::move(queue.back());
+      queue.pop_back();
+      lock.unlock();
+      cvar_can_push.notify_one();
+    }
+
+    // blocks until at least one packet is available, then pops up to max
+    // packets without waiting for more, re-entering packets first
+    void pop_back_burst(std::vector<std::unique_ptr<Packet> > *items,
+                        size_t max) {
+      std::unique_lock<std::mutex> lock(mutex);
+      auto &queue_reentry = queues[static_cast<size_t>(PacketType::REENTRY)];
+      auto &queue_normal = queues[static_cast<size_t>(PacketType::NORMAL)];
+      cvar_can_pop.wait(lock, [&queue_reentry, &queue_normal] {
+          return !queue_reentry.empty() || !queue_normal.empty(); });
+      for (auto *queue : {&queue_reentry, &queue_normal}) {
+        while (items->size() < max && !queue->empty()) {
+          items->push_back(std::move(queue->back()));
+          queue->pop_back();
+        }
+      }
+      lock.unlock();
+      cvar_can_push.notify_all();
+    }
+
+   private:
+    std::mutex mutex{};
+    std::condition_variable cvar_can_push{};
+    std::condition_variable cvar_can_pop{};
+    std::array<std::deque<std::unique_ptr<Packet> >, 2> queues{};
+    std::array<size_t, 2> capacities;
+  };
+
   struct EgressThreadMapper {
     explicit EgressThreadMapper(size_t nb_threads)
         : nb_threads(nb_threads) { }
@@ -129,11 +272,30 @@ class SimpleSwitch : public Switch {
   void egress_thread(size_t worker_id);
   void transmit_thread();
 
-  int get_mirroring_mapping(mirror_id_t mirror_id) const {
-    const auto it = mirroring_map.find(mirror_id);
-    if (it == mirroring_map.end()) return -1;
-    return it->second;
-  }
+  // processing of one packet by each stage, shared by the dedicated threads
+  // and by the thread pool tasks
+  void ingress_process(std::unique_ptr<Packet> packet);
+  void ingress_process_burst(std::vector<std::unique_ptr<Packet> > *packets);
+  void egress_process(size_t worker_id, size_t port,
+                      std::unique_ptr<Packet> packet);
+  void transmit_process(std::unique_ptr<Packet> packet);
+
+  // the steps of ingress_process() before and after the ingress pipeline;
+  // ingress_parse() returns the buffer state before parsing, which is needed
+  // for ingress cloning and resubmit
+  Packet::buffer_state_t ingress_parse(Packet *packet, uint64_t *ts);
+  void ingress_finish(std::unique_ptr<Packet> packet,
+                      const Packet::buffer_state_t &packet_in_state);
+
+  // In thread pool mode, every packet pushed to a buffer posts exactly one
+  // task to the strand which consumes this buffer, and every task pops exactly
+  // one packet, so that the tasks never block.
+  int input_buffer_push(InputBuffer::PacketType packet_type,
+                        std::unique_ptr<Packet> &&packet);
+  void output_buffer_push(std::unique_ptr<Packet> &&packet);
+  void ingress_task();
+  void egress_task(size_t worker_id);
+  void transmit_task();
 
   ts_res get_ts() const;
 
@@ -142,13 +304,18 @@ class SimpleSwitch : public Switch {
 
   std::unique_ptr<Packet> copy_ingress_pkt(
       const std::unique_ptr<Packet> &pkt,
-      PktInstanceType copy_type, p4object_id_t field_list_id);
+      PktInstanceType copy_type, p4object_id_t field_list_id,
+      size_t max_data_size = std::numeric_limits<size_t>::max());
+
+  // resubmit / recirculate in place, without copying the packet
+  void reset_pkt_for_reentry(Packet *pkt, PktInstanceType instance_type,
+                             p4object_id_t field_list_id);
 
   void check_queueing_metadata();
 
  private:
   int max_port;
-  Queue<std::unique_ptr<Packet> > input_buffer;
+  InputBuffer input_buffer;
 #ifdef SSWITCH_PRIORITY_QUEUEING_ON
   bm::QueueingLogicPriRL<std::unique_ptr<Packet>, EgressThreadMapper>
 #else
@@ -158,8 +325,18 @@ class SimpleSwitch : public Switch {
   Queue<std::unique_ptr<Packet> > output_buffer;
   std::shared_ptr<McSimplePreLAG> pre;
   clock::time_point start;
-  std::unordered_map<mirror_id_t, int> mirroring_map;
+  MirroringSessions mirroring_sessions;
   bool with_queueing_metadata{false};
+  StageLatency stage_latency{transmit_worker + 1};
+  size_t ingress_burst{1};
+  // reused by ingress_process_burst(), which only runs on the ingress thread
+  std::vector<Packet::buffer_state_t> burst_packet_in_states{};
+  std::vector<Packet *> burst_pkts{};
+  bm::ThreadPool *thread_pool{nullptr};
+  std::unique_ptr<bm::ThreadPool::Strand> ingress_strand{nullptr};
+  std::vector<std::unique_ptr<bm::ThreadPool::Strand> > egress_strands{};
+  std::unique_ptr<bm::ThreadPool::Strand> transmit_strand{nullptr};
+  std::atomic<uint64_t> output_buffer_drops{0};
 };
 
 #endif  // SIMPLE_SWITCH_SIMPLE_SWITCH_H_
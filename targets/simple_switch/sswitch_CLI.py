@@ -26,6 +26,8 @@ import sys
 import os
 
 from sswitch_runtime import SimpleSwitch
+from sswitch_runtime.ttypes import MirroringSessionConfig, \
+    InvalidMirroringOperation
 
 class SimpleSwitchAPI(runtime_CLI.RuntimeAPI):
     @staticmethod
@@ -58,16 +60,70 @@ class SimpleSwitchAPI(runtime_CLI.RuntimeAPI):
             self.sswitch_client.set_all_egress_queue_rates(rate)
 
     def do_mirroring_add(self, line):
-        "Add mirroring mapping: mirroring_add <mirror_id> <egress_port>"
+        "Add mirroring session: mirroring_add <mirror_id> <egress_port> [truncate=<bytes>] [rate=<pps>] [burst=<pkts>]"
         args = line.split()
+        if len(args) < 2:
+            print "Usage: mirroring_add <mirror_id> <egress_port> [truncate=<bytes>] [rate=<pps>] [burst=<pkts>]"
+            return
         mirror_id, egress_port = int(args[0]), int(args[1])
-        self.sswitch_client.mirroring_mapping_add(mirror_id, egress_port)
+        options = {"truncate": 0, "rate": 0, "burst": 1}
+        for arg in args[2:]:
+            key, sep, value = arg.partition("=")
+            if not sep or key not in options:
+                print "Invalid option '{}'".format(arg)
+                return
+            options[key] = int(value)
+        config = MirroringSessionConfig(
+            port=egress_port, truncate_length=options["truncate"],
+            rate_pps=options["rate"], burst_size=options["burst"])
+        self.sswitch_client.mirroring_session_add(mirror_id, config)
+
+    def do_mirroring_show(self, line):
+        "Show mirroring session and its counters: mirroring_show <mirror_id>"
+        mirror_id = int(line)
+        try:
+            config = self.sswitch_client.mirroring_session_get(mirror_id)
+            stats = self.sswitch_client.mirroring_session_get_stats(mirror_id)
+        except InvalidMirroringOperation:
+            print "Mirroring session {} does not exist".format(mirror_id)
+            return
+        print "{:<16}{}".format("egress port:", config.port)
+        print "{:<16}{}".format(
+            "truncate:", config.truncate_length or "no")
+        print "{:<16}{}".format(
+            "rate (pps):", config.rate_pps or "unlimited")
+        if config.rate_pps:
+            print "{:<16}{}".format("burst:", config.burst_size)
+        print "{:<16}{}".format("mirrored:", stats.mirrored_packets)
+        print "{:<16}{}".format("dropped:", stats.dropped_packets)
 
     def do_mirroring_delete(self, line):
         "Delete mirroring mapping: mirroring_delete <mirror_id>"
         mirror_id = int(line)
         self.sswitch_client.mirroring_mapping_delete(mirror_id)
 
+    def do_set_stage_latency(self, line):
+        "Enable / disable the per-stage latency histograms (disabling keeps the current values): set_stage_latency on|off"
+        args = line.split()
+        if len(args) != 1 or args[0] not in {"on", "off"}:
+            print "Usage: set_stage_latency on|off"
+            return
+        self.sswitch_client.set_stage_latency_enabled(args[0] == "on")
+
+    def do_reset_stage_latency(self, line):
+        "Clear the per-stage latency histograms: reset_stage_latency"
+        self.sswitch_client.reset_stage_latencies()
+
+    def do_show_stage_latency(self, line):
+        "Show the latency of each pipeline stage, in nanoseconds: show_stage_latency"
+        columns = ["count", "min_ns", "mean_ns", "p50_ns", "p90_ns", "p99_ns",
+                   "p999_ns", "max_ns"]
+        print "{:<16}".format("stage") + "".join(
+            "{:>12}".format(c) for c in columns)
+        for s in self.sswitch_client.get_stage_latencies():
+            print "{:<16}".format(s.stage) + "".join(
+                "{:>12}".format(getattr(s, c)) for c in columns)
+
 def main():
     args = runtime_CLI.get_parser().parse_args()
 
@@ -77,7 +133,8 @@ def main():
     services.extend(SimpleSwitchAPI.get_thrift_services())
 
     standard_client, mc_client, sswitch_client = runtime_CLI.thrift_connect(
-        args.thrift_ip, args.thrift_port, services
+        args.thrift_ip, args.thrift_port, services,
+        transport=args.thrift_transport, protocol=args.thrift_protocol
     )
 
     runtime_CLI.load_json_config(standard_client, args.json)
@@ -0,0 +1,182 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stage_latency.h"
+
+constexpr int LatencyHistogram::sub_bucket_bits;
+constexpr uint64_t LatencyHistogram::sub_buckets;
+constexpr int LatencyHistogram::max_value_bits;
+constexpr uint64_t LatencyHistogram::max_value;
+constexpr size_t LatencyHistogram::nb_buckets;
+
+constexpr size_t StageLatency::nb_stages;
+
+LatencyHistogram::LatencyHistogram() {
+  for (auto &c : counts) c.store(0, std::memory_order_relaxed);
+}
+
+void
+LatencyHistogram::merge_into(LatencyHistogram *other) const {
+  for (size_t i = 0; i < nb_buckets; i++) {
+    other->counts[i].fetch_add(counts[i].load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+  }
+  other->sum.fetch_add(sum.load(std::memory_order_relaxed),
+                       std::memory_order_relaxed);
+  auto v_min = min.load(std::memory_order_relaxed);
+  if (v_min < other->min.load(std::memory_order_relaxed))
+    other->min.store(v_min, std::memory_order_relaxed);
+  auto v_max = max.load(std::memory_order_relaxed);
+  if (v_max > other->max.load(std::memory_order_relaxed))
+    other->max.store(v_max, std::memory_order_relaxed);
+}
+
+void
+LatencyHistogram::reset() {
+  for (auto &c : counts) c.store(0, std::memory_order_relaxed);
+  sum.store(0, std::memory_order_relaxed);
+  min.store(max_value, std::memory_order_relaxed);
+  max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t
+LatencyHistogram::get_count() const {
+  uint64_t count = 0;
+  for (const auto &c : counts) count += c.load(std::memory_order_relaxed);
+  return count;
+}
+
+uint64_t
+LatencyHistogram::get_min() const {
+  return (get_count() == 0) ? 0 : min.load(std::memory_order_relaxed);
+}
+
+uint64_t
+LatencyHistogram::get_max() const {
+  return max.load(std::memory_order_relaxed);
+}
+
+uint64_t
+LatencyHistogram::get_mean() const {
+  auto count = get_count();
+  return (count == 0) ? 0 : sum.load(std::memory_order_relaxed) / count;
+}
+
+uint64_t
+LatencyHistogram::get_percentile(double percentile) const {
+  const auto count = get_count();
+  if (count == 0) return 0;
+  // rank of the sample, starting at 1
+  auto rank = static_cast<uint64_t>(percentile / 100. * count + 0.5);
+  if (rank == 0) rank = 1;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < nb_buckets; i++) {
+    seen += counts[i].load(std::memory_order_relaxed);
+    if (seen >= rank) return std::min(bucket_upper_bound(i), get_max());
+  }
+  return get_max();
+}
+
+uint64_t
+LatencyHistogram::bucket_upper_bound(size_t idx) {
+  if (idx < sub_buckets) return idx;
+  const int exp = idx / sub_buckets + sub_bucket_bits - 1;
+  const uint64_t sub = idx % sub_buckets;
+  const int shift = exp - sub_bucket_bits;
+  return ((sub_buckets + sub + 1) << shift) - 1;
+}
+
+StageLatency::StageLatency(size_t nb_workers)
+    : histograms(new WorkerHistograms[nb_workers]), nb_workers(nb_workers) { }
+
+void
+StageLatency::enable() {
+  std::unique_lock<std::mutex> lock(mutex);
+#if defined(__x86_64__) || defined(__i386__)
+  typedef std::chrono::steady_clock clock;
+  const auto t1 = clock::now();
+  const auto tsc1 = __rdtsc();
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  const auto t2 = clock::now();
+  const auto tsc2 = __rdtsc();
+  ns_per_tick = std::chrono::duration<double, std::nano>(t2 - t1).count() /
+      (tsc2 - tsc1);
+#endif
+  for (size_t w = 0; w < nb_workers; w++)
+    for (auto &h : histograms[w]) h.reset();
+  enabled.store(true, std::memory_order_relaxed);
+}
+
+void
+StageLatency::disable() {
+  std::unique_lock<std::mutex> lock(mutex);
+  enabled.store(false, std::memory_order_relaxed);
+}
+
+void
+StageLatency::reset() {
+  std::unique_lock<std::mutex> lock(mutex);
+  for (size_t w = 0; w < nb_workers; w++)
+    for (auto &h : histograms[w]) h.reset();
+}
+
+std::vector<StageLatency::Stats>
+StageLatency::get_stats() const {
+  std::unique_lock<std::mutex> lock(mutex);
+  auto to_ns = [this](uint64_t ticks) {
+    return static_cast<uint64_t>(ticks * ns_per_tick + 0.5);
+  };
+  std::vector<Stats> stats;
+  for (size_t s = 0; s < nb_stages; s++) {
+    LatencyHistogram merged;
+    for (size_t w = 0; w < nb_workers; w++)
+      histograms[w][s].merge_into(&merged);
+    stats.push_back(
+        {stage_name(static_cast<Stage>(s)), merged.get_count(),
+         to_ns(merged.get_min()), to_ns(merged.get_mean()),
+         to_ns(merged.get_percentile(50)), to_ns(merged.get_percentile(90)),
+         to_ns(merged.get_percentile(99)), to_ns(merged.get_percentile(99.9)),
+         to_ns(merged.get_max())});
+  }
+  return stats;
+}
+
+const char *
+StageLatency::stage_name(Stage stage) {
+  switch (stage) {
+    case Stage::INPUT_BUFFER:
+      return "input_buffer";
+    case Stage::PARSER:
+      return "parser";
+    case Stage::INGRESS:
+      return "ingress";
+    case Stage::PRE:
+      return "pre";
+    case Stage::EGRESS_QUEUE:
+      return "egress_queue";
+    case Stage::EGRESS:
+      return "egress";
+    case Stage::DEPARSER:
+      return "deparser";
+    case Stage::TRANSMIT_QUEUE:
+      return "transmit_queue";
+  }
+  return "";
+}
@@ -0,0 +1,177 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIMPLE_SWITCH_STAGE_LATENCY_H_
+#define SIMPLE_SWITCH_STAGE_LATENCY_H_
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Log-linear histogram (in the style of HdrHistogram) of non-negative integer
+// values, with a relative error of at most 1 / 16. It is meant to have a
+// single writer: record() is wait-free and the counts can be read concurrently
+// by any thread.
+class LatencyHistogram {
+ public:
+  static constexpr int sub_bucket_bits = 4;
+  static constexpr uint64_t sub_buckets = 1u << sub_bucket_bits;
+  // values are saturated to max_value
+  static constexpr int max_value_bits = 40;
+  static constexpr uint64_t max_value =
+      (static_cast<uint64_t>(1) << max_value_bits) - 1;
+  static constexpr size_t nb_buckets =
+      (max_value_bits - sub_bucket_bits + 1) * sub_buckets;
+
+  LatencyHistogram();
+
+  void record(uint64_t v) {
+    if (v > max_value) v = max_value;
+    counts[bucket_index(v)].fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(v, std::memory_order_relaxed);
+    if (v < min.load(std::memory_order_relaxed))
+      min.store(v, std::memory_order_relaxed);
+    if (v > max.load(std::memory_order_relaxed))
+      max.store(v, std::memory_order_relaxed);
+  }
+
+  // Adds the contents of this histogram to other, which is not required to be
+  // single-writer
+  void merge_into(LatencyHistogram *other) const;
+
+  void reset();
+
+  uint64_t get_count() const;
+  uint64_t get_min() const;
+  uint64_t get_max() const;
+  uint64_t get_mean() const;
+  // upper bound of the bucket which includes the value at the given
+  // percentile, in [0, 100]
+  uint64_t get_percentile(double percentile) const;
+
+  static size_t bucket_index(uint64_t v) {
+    if (v < sub_buckets) return static_cast<size_t>(v);
+    const int exp = 63 - __builtin_clzll(v);
+    const uint64_t sub = (v >> (exp - sub_bucket_bits)) & (sub_buckets - 1);
+    return (exp - sub_bucket_bits + 1) * sub_buckets + sub;
+  }
+
+  static uint64_t bucket_upper_bound(size_t idx);
+
+ private:
+  std::array<std::atomic<uint64_t>, nb_buckets> counts;
+  std::atomic<uint64_t> sum{0};
+  std::atomic<uint64_t> min{max_value};
+  std::atomic<uint64_t> max{0};
+};
+
+// Records how long packets spend in each stage of the simple_switch pipeline.
+// Every thread which processes packets (a "worker") has its own set of
+// histograms, so recording a sample never involves any synchronization
+// between threads. Timestamps are taken with the TSC on x86, which is cheaper
+// than reading the system clock. When recording is disabled, now() returns 0
+// without reading the clock and samples which start at 0 are ignored, so
+// disabled recording only costs a relaxed atomic load per stage.
+class StageLatency {
+ public:
+  enum class Stage {
+    INPUT_BUFFER,
+    PARSER,
+    INGRESS,
+    PRE,
+    EGRESS_QUEUE,
+    EGRESS,
+    DEPARSER,
+    TRANSMIT_QUEUE,
+  };
+
+  static constexpr size_t nb_stages = 8u;
+
+  struct Stats {
+    std::string stage;
+    uint64_t count;
+    uint64_t min_ns;
+    uint64_t mean_ns;
+    uint64_t p50_ns;
+    uint64_t p90_ns;
+    uint64_t p99_ns;
+    uint64_t p999_ns;
+    uint64_t max_ns;
+  };
+
+  explicit StageLatency(size_t nb_workers);
+
+  // calibrates the clock and resets all the histograms
+  void enable();
+
+  void disable();
+
+  bool is_enabled() const {
+    return enabled.load(std::memory_order_relaxed);
+  }
+
+  void reset();
+
+  uint64_t now() const {
+    if (!is_enabled()) return 0;
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+  }
+
+  // start and end were obtained with now()
+  void record(size_t worker, Stage stage, uint64_t start, uint64_t end) {
+    if (start == 0 || end == 0) return;
+    // the TSCs of different cores may not be perfectly synchronized
+    histograms[worker][static_cast<size_t>(stage)].record(
+        (end > start) ? end - start : 0);
+  }
+
+  // records the time elapsed since *ts in stage and sets *ts to the current
+  // time, for back-to-back stages
+  void stage_done(size_t worker, Stage stage, uint64_t *ts) {
+    const auto end = now();
+    record(worker, stage, *ts, end);
+    *ts = end;
+  }
+
+  // one entry per stage, with the samples from all workers merged
+  std::vector<Stats> get_stats() const;
+
+  static const char *stage_name(Stage stage);
+
+ private:
+  typedef std::array<LatencyHistogram, nb_stages> WorkerHistograms;
+
+  std::atomic<bool> enabled{false};
+  std::unique_ptr<WorkerHistograms[]> histograms;
+  size_t nb_workers;
+  // ticks to ns, measured by enable()
+  double ns_per_tick{1.};
+  mutable std::mutex mutex{};
+};
+
+#endif  // SIMPLE_SWITCH_STAGE_LATENCY_H_
@@ -0,0 +1,89 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+
+#include "mirroring_sessions.h"
+
+using Config = MirroringSessions::Config;
+using Stats = MirroringSessions::Stats;
+
+TEST(MirroringSessions, AddDelete) {
+  MirroringSessions sessions;
+  Config config;
+  ASSERT_FALSE(sessions.get_session(1, &config));
+  ASSERT_FALSE(sessions.admit(1, &config));
+
+  sessions.add_session(1, {3, 64, 0, 0});
+  ASSERT_TRUE(sessions.get_session(1, &config));
+  ASSERT_EQ(3, config.egress_port);
+  ASSERT_EQ(64u, config.truncate_length);
+
+  config.egress_port = -1;
+  ASSERT_TRUE(sessions.admit(1, &config));
+  ASSERT_EQ(3, config.egress_port);
+
+  ASSERT_TRUE(sessions.delete_session(1));
+  ASSERT_FALSE(sessions.delete_session(1));
+  ASSERT_FALSE(sessions.admit(1, &config));
+}
+
+TEST(MirroringSessions, NoRateLimit) {
+  MirroringSessions sessions;
+  sessions.add_session(1, {3, 0, 0, 0});
+  Config config;
+  const auto now = MirroringSessions::clock::now();
+  for (int i = 0; i < 1000; i++) ASSERT_TRUE(sessions.admit(1, &config, now));
+  Stats stats;
+  ASSERT_TRUE(sessions.get_stats(1, &stats));
+  ASSERT_EQ(1000u, stats.mirrored);
+  ASSERT_EQ(0u, stats.dropped);
+}
+
+TEST(MirroringSessions, RateLimit) {
+  MirroringSessions sessions;
+  // 1000 pps, bursts of up to 10 packets
+  sessions.add_session(1, {3, 0, 1000, 10});
+  Config config;
+  auto now = MirroringSessions::clock::now();
+
+  // the bucket starts full
+  for (int i = 0; i < 10; i++) ASSERT_TRUE(sessions.admit(1, &config, now));
+  ASSERT_FALSE(sessions.admit(1, &config, now));
+
+  // one token every ms
+  now += std::chrono::microseconds(2500);
+  ASSERT_TRUE(sessions.admit(1, &config, now));
+  ASSERT_TRUE(sessions.admit(1, &config, now));
+  ASSERT_FALSE(sessions.admit(1, &config, now));
+
+  // the bucket cannot hold more than the burst size
+  now += std::chrono::seconds(1);
+  for (int i = 0; i < 10; i++) ASSERT_TRUE(sessions.admit(1, &config, now));
+  ASSERT_FALSE(sessions.admit(1, &config, now));
+
+  Stats stats;
+  ASSERT_TRUE(sessions.get_stats(1, &stats));
+  ASSERT_EQ(22u, stats.mirrored);
+  ASSERT_EQ(3u, stats.dropped);
+
+  // counters are cleared when the session is replaced
+  sessions.add_session(1, {3, 0, 1000, 10});
+  ASSERT_TRUE(sessions.get_stats(1, &stats));
+  ASSERT_EQ(0u, stats.mirrored);
+  ASSERT_EQ(0u, stats.dropped);
+}
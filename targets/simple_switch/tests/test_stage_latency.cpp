@@ -0,0 +1,136 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "stage_latency.h"
+
+using Stage = StageLatency::Stage;
+
+TEST(LatencyHistogram, BucketBounds) {
+  // exact for small values
+  for (uint64_t v = 0; v < LatencyHistogram::sub_buckets; v++) {
+    auto idx = LatencyHistogram::bucket_index(v);
+    ASSERT_EQ(v, LatencyHistogram::bucket_upper_bound(idx));
+  }
+  // each value is in its bucket, and the relative error is at most 1/16
+  const std::vector<uint64_t> values = {
+    16, 17, 31, 32, 33, 1000, 123456, 1ull << 39, LatencyHistogram::max_value};
+  for (uint64_t v : values) {
+    auto idx = LatencyHistogram::bucket_index(v);
+    ASSERT_LT(idx, LatencyHistogram::nb_buckets);
+    auto upper = LatencyHistogram::bucket_upper_bound(idx);
+    ASSERT_GE(upper, v);
+    ASSERT_LE(upper - v, v / LatencyHistogram::sub_buckets);
+    ASSERT_LT(LatencyHistogram::bucket_upper_bound(idx - 1), v);
+  }
+}
+
+TEST(LatencyHistogram, Percentiles) {
+  LatencyHistogram h;
+  ASSERT_EQ(0u, h.get_count());
+  ASSERT_EQ(0u, h.get_percentile(50));
+  for (uint64_t v = 1; v <= 1000; v++) h.record(v);
+  ASSERT_EQ(1000u, h.get_count());
+  ASSERT_EQ(1u, h.get_min());
+  ASSERT_EQ(1000u, h.get_max());
+  ASSERT_EQ(500u, h.get_mean());
+  auto check_percentile = [&h](double p, uint64_t expected) {
+    auto v = h.get_percentile(p);
+    ASSERT_GE(v, expected);
+    ASSERT_LE(v - expected, expected / LatencyHistogram::sub_buckets);
+  };
+  check_percentile(50, 500);
+  check_percentile(90, 900);
+  check_percentile(99, 990);
+  ASSERT_EQ(1000u, h.get_percentile(100));
+
+  LatencyHistogram merged;
+  h.merge_into(&merged);
+  h.merge_into(&merged);
+  ASSERT_EQ(2000u, merged.get_count());
+  ASSERT_EQ(1u, merged.get_min());
+  ASSERT_EQ(1000u, merged.get_max());
+
+  h.reset();
+  ASSERT_EQ(0u, h.get_count());
+  ASSERT_EQ(0u, h.get_max());
+}
+
+TEST(LatencyHistogram, Saturation) {
+  LatencyHistogram h;
+  h.record(~0ull);
+  ASSERT_EQ(LatencyHistogram::max_value, h.get_max());
+  ASSERT_EQ(LatencyHistogram::max_value, h.get_percentile(50));
+}
+
+TEST(StageLatency, DisabledByDefault) {
+  StageLatency stage_latency(2);
+  ASSERT_FALSE(stage_latency.is_enabled());
+  ASSERT_EQ(0u, stage_latency.now());
+  uint64_t ts = stage_latency.now();
+  stage_latency.stage_done(0, Stage::PARSER, &ts);
+  // samples which start before recording was enabled are ignored
+  stage_latency.enable();
+  stage_latency.record(0, Stage::INGRESS, 0, stage_latency.now());
+  for (const auto &s : stage_latency.get_stats()) ASSERT_EQ(0u, s.count);
+}
+
+TEST(StageLatency, Record) {
+  StageLatency stage_latency(2);
+  stage_latency.enable();
+  ASSERT_TRUE(stage_latency.is_enabled());
+
+  uint64_t ts = stage_latency.now();
+  ASSERT_NE(0u, ts);
+  stage_latency.stage_done(0, Stage::PARSER, &ts);
+  stage_latency.stage_done(0, Stage::INGRESS, &ts);
+  stage_latency.stage_done(1, Stage::EGRESS, &ts);
+  stage_latency.stage_done(1, Stage::INGRESS, &ts);
+  // end before start is recorded as 0
+  stage_latency.record(1, Stage::DEPARSER, ts + 1000, ts);
+
+  const auto stats = stage_latency.get_stats();
+  ASSERT_EQ(StageLatency::nb_stages, stats.size());
+  const std::vector<std::string> names = {
+    "input_buffer", "parser", "ingress", "pre", "egress_queue", "egress",
+    "deparser", "transmit_queue"};
+  for (size_t i = 0; i < stats.size(); i++)
+    ASSERT_EQ(names[i], stats[i].stage);
+  auto get_count = [&stats](Stage stage) {
+    return stats.at(static_cast<size_t>(stage)).count;
+  };
+  ASSERT_EQ(1u, get_count(Stage::PARSER));
+  // samples from both workers are merged
+  ASSERT_EQ(2u, get_count(Stage::INGRESS));
+  ASSERT_EQ(1u, get_count(Stage::EGRESS));
+  ASSERT_EQ(1u, get_count(Stage::DEPARSER));
+  ASSERT_EQ(0u, stats.at(static_cast<size_t>(Stage::DEPARSER)).max_ns);
+  ASSERT_EQ(0u, get_count(Stage::PRE));
+  for (const auto &s : stats) {
+    ASSERT_LE(s.min_ns, s.p50_ns);
+    ASSERT_LE(s.p50_ns, s.max_ns);
+  }
+
+  stage_latency.disable();
+  ASSERT_EQ(0u, stage_latency.now());
+  // values are kept when recording is disabled
+  ASSERT_EQ(1u, stage_latency.get_stats().at(1).count);
+  stage_latency.reset();
+  for (const auto &s : stage_latency.get_stats()) ASSERT_EQ(0u, s.count);
+}
@@ -21,15 +21,57 @@
 namespace cpp sswitch_runtime
 namespace py sswitch_runtime
 
+struct StageLatency {
+  1:string stage,
+  2:i64 count,
+  3:i64 min_ns,
+  4:i64 mean_ns,
+  5:i64 p50_ns,
+  6:i64 p90_ns,
+  7:i64 p99_ns,
+  8:i64 p999_ns,
+  9:i64 max_ns
+}
+
+struct MirroringSessionConfig {
+  1:i32 port,
+  2:i32 truncate_length,  // 0 means no truncation
+  3:i64 rate_pps,  // 0 means no rate limit
+  4:i32 burst_size
+}
+
+struct MirroringSessionStats {
+  1:i64 mirrored_packets,
+  2:i64 dropped_packets  // because of the rate limit
+}
+
+enum MirroringOperationErrorCode {
+  SESSION_NOT_FOUND = 1
+}
+
+exception InvalidMirroringOperation {
+  1:MirroringOperationErrorCode code
+}
+
 service SimpleSwitch {
 
   i32 mirroring_mapping_add(1:i32 mirror_id, 2:i32 egress_port);
   i32 mirroring_mapping_delete(1:i32 mirror_id);
   i32 mirroring_mapping_get_egress_port(1:i32 mirror_id);
 
+  i32 mirroring_session_add(1:i32 mirror_id, 2:MirroringSessionConfig config);
+  MirroringSessionConfig mirroring_session_get(1:i32 mirror_id)
+    throws (1:InvalidMirroringOperation ouch);
+  MirroringSessionStats mirroring_session_get_stats(1:i32 mirror_id)
+    throws (1:InvalidMirroringOperation ouch);
+
   i32 set_egress_queue_depth(1:i32 port_num, 2:i32 depth_pkts);
   i32 set_all_egress_queue_depths(1:i32 depth_pkts);
   i32 set_egress_queue_rate(1:i32 port_num, 2:i64 rate_pps);
   i32 set_all_egress_queue_rates(1:i64 rate_pps);
 
+  i32 set_stage_latency_enabled(1:bool enabled);
+  list<StageLatency> get_stage_latencies();
+  i32 reset_stage_latencies();
+
 }
@@ -39,6 +39,9 @@ namespace thrift_provider = apache::thrift;
 #include <bm/bm_sim/switch.h>
 #include <bm/bm_sim/logger.h>
 
+#include <algorithm>
+#include <vector>
+
 #include "simple_switch.h"
 
 namespace sswitch_runtime {
@@ -64,6 +67,41 @@ class SimpleSwitchHandler : virtual public SimpleSwitchIf {
     return switch_->mirroring_mapping_get(mirror_id);
   }
 
+  int32_t mirroring_session_add(const int32_t mirror_id,
+                                const MirroringSessionConfig &config) {
+    bm::Logger::get()->trace("mirroring_session_add");
+    MirroringSessions::Config session;
+    session.egress_port = config.port;
+    session.truncate_length =
+        static_cast<size_t>(std::max(config.truncate_length, 0));
+    session.rate_pps = static_cast<uint64_t>(
+        std::max<int64_t>(config.rate_pps, 0));
+    session.burst_size = static_cast<uint64_t>(std::max(config.burst_size, 0));
+    return switch_->mirroring_session_add(mirror_id, session);
+  }
+
+  void mirroring_session_get(MirroringSessionConfig &_return,
+                             const int32_t mirror_id) {
+    bm::Logger::get()->trace("mirroring_session_get");
+    MirroringSessions::Config session;
+    if (!switch_->mirroring_session_get(mirror_id, &session))
+      throw_session_not_found();
+    _return.port = session.egress_port;
+    _return.truncate_length = static_cast<int32_t>(session.truncate_length);
+    _return.rate_pps = static_cast<int64_t>(session.rate_pps);
+    _return.burst_size = static_cast<int32_t>(session.burst_size);
+  }
+
+  void mirroring_session_get_stats(MirroringSessionStats &_return,
+                                   const int32_t mirror_id) {
+    bm::Logger::get()->trace("mirroring_session_get_stats");
+    MirroringSessions::Stats stats;
+    if (!switch_->mirroring_session_get_stats(mirror_id, &stats))
+      throw_session_not_found();
+    _return.mirrored_packets = static_cast<int64_t>(stats.mirrored);
+    _return.dropped_packets = static_cast<int64_t>(stats.dropped);
+  }
+
   int32_t set_egress_queue_depth(const int32_t port_num,
                                  const int32_t depth_pkts) {
     bm::Logger::get()->trace("set_egress_queue_depth");
@@ -89,7 +127,40 @@ class SimpleSwitchHandler : virtual public SimpleSwitchIf {
     return switch_->set_all_egress_queue_rates(static_cast<uint64_t>(rate_pps));
   }
 
+  int32_t set_stage_latency_enabled(const bool enabled) {
+    bm::Logger::get()->trace("set_stage_latency_enabled");
+    return switch_->set_stage_latency_enabled(enabled);
+  }
+
+  void get_stage_latencies(std::vector<StageLatency> &_return) {
+    bm::Logger::get()->trace("get_stage_latencies");
+    for (const auto &s : switch_->get_stage_latency_stats()) {
+      StageLatency stage;
+      stage.stage = s.stage;
+      stage.count = static_cast<int64_t>(s.count);
+      stage.min_ns = static_cast<int64_t>(s.min_ns);
+      stage.mean_ns = static_cast<int64_t>(s.mean_ns);
+      stage.p50_ns = static_cast<int64_t>(s.p50_ns);
+      stage.p90_ns = static_cast<int64_t>(s.p90_ns);
+      stage.p99_ns = static_cast<int64_t>(s.p99_ns);
+      stage.p999_ns = static_cast<int64_t>(s.p999_ns);
+      stage.max_ns = static_cast<int64_t>(s.max_ns);
+      _return.push_back(stage);
+    }
+  }
+
+  int32_t reset_stage_latencies() {
+    bm::Logger::get()->trace("reset_stage_latencies");
+    return switch_->reset_stage_latency_stats();
+  }
+
  private:
+  static void throw_session_not_found() {
+    InvalidMirroringOperation imo;
+    imo.code = MirroringOperationErrorCode::SESSION_NOT_FOUND;
+    throw imo;
+  }
+
   SimpleSwitch *switch_;
 };
 
@@ -0,0 +1,143 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the LookupStructure implementations returned by the default
+// LookupStructureFactory, without going through a match unit.
+
+#include <bm/bm_sim/lookup_structures.h>
+
+#include <jsoncpp/json.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_utils.h"
+
+namespace bench_utils {
+
+namespace {
+
+using bm::ByteContainer;
+using bm::ExactMatchKey;
+using bm::LPMMatchKey;
+using bm::TernaryMatchKey;
+using bm::RangeMatchKey;
+using bm::MatchUnitType;
+using bm::internal_handle_t;
+
+constexpr size_t nb_queries = 1024;
+
+ExactMatchKey make_key(const BenchEntry &e, int, const ExactMatchKey &) {
+  ExactMatchKey key;
+  key.data = ByteContainer(e.key.data(), e.key.size());
+  return key;
+}
+
+LPMMatchKey make_key(const BenchEntry &e, int, const LPMMatchKey &) {
+  return LPMMatchKey(ByteContainer(e.key.data(), e.key.size()),
+                     e.prefix_length, 0);
+}
+
+TernaryMatchKey make_key(const BenchEntry &e, int priority,
+                         const TernaryMatchKey &) {
+  return TernaryMatchKey(ByteContainer(e.key.data(), e.key.size()),
+                         ByteContainer(e.mask.data(), e.mask.size()),
+                         priority, 0);
+}
+
+RangeMatchKey make_key(const BenchEntry &e, int priority,
+                       const RangeMatchKey &) {
+  // data is the start of the range and mask the end
+  std::string end(e.key);
+  for (size_t i = 0; i < end.size(); i++) end[i] |= ~e.mask[i];
+  return RangeMatchKey(ByteContainer(e.key.data(), e.key.size()),
+                       ByteContainer(end.data(), end.size()), priority,
+                       {e.key.size()}, 0);
+}
+
+template <typename K>
+Result run_one(const Options &options, const Params &params) {
+  EntryGenerator generator(params.match_type, params.key_bytes);
+  const auto entries = generator.make_entries(params.table_size);
+  std::vector<K> keys;
+  keys.reserve(entries.size());
+  for (size_t i = 0; i < entries.size(); i++)
+    keys.push_back(make_key(entries[i], static_cast<int>(i), K()));
+  std::vector<ByteContainer> queries;
+  for (const auto &q : generator.make_queries(entries, nb_queries,
+                                              params.hit_ratio))
+    queries.emplace_back(q.data(), q.size());
+
+  Result result;
+  bm::LookupStructureFactory factory;
+  auto heap_before = heap_in_use();
+  auto structure = bm::LookupStructureFactory::create<K>(
+      &factory, params.table_size, params.key_bytes);
+
+  typedef std::chrono::steady_clock clock;
+  auto start = clock::now();
+  for (size_t i = 0; i < keys.size(); i++) structure->add_entry(keys[i], i);
+  std::chrono::duration<double> fill_time = clock::now() - start;
+  result.insertions_per_sec = keys.size() / fill_time.count();
+  result.bytes_per_entry =
+      static_cast<double>(heap_in_use() - heap_before) / keys.size();
+
+  const size_t update_every = (params.update_ratio > 0) ?
+      static_cast<size_t>(1 / params.update_ratio) : 0;
+  size_t lookups = 0;
+  size_t hits = 0;
+  auto op = [&](size_t i) {
+    if (update_every > 0 && i % update_every == update_every - 1) {
+      size_t idx = (i / update_every) % keys.size();
+      structure->delete_entry(keys[idx]);
+      structure->add_entry(keys[idx], idx);
+      return;
+    }
+    internal_handle_t handle;
+    lookups++;
+    if (structure->lookup(queries[i % nb_queries], &handle)) hits++;
+  };
+  result.ns_per_op = measure_ns_per_op(op, options.min_time);
+  result.measured_hit_ratio = static_cast<double>(hits) / lookups;
+  return result;
+}
+
+}  // namespace
+
+void
+run_lookup_structures(const Options &options, Json::Value *results) {
+  for (const auto &params : make_params_matrix(options)) {
+    Result result;
+    switch (params.match_type) {
+      case MatchUnitType::EXACT:
+        result = run_one<ExactMatchKey>(options, params);
+        break;
+      case MatchUnitType::LPM:
+        result = run_one<LPMMatchKey>(options, params);
+        break;
+      case MatchUnitType::TERNARY:
+        result = run_one<TernaryMatchKey>(options, params);
+        break;
+      case MatchUnitType::RANGE:
+        result = run_one<RangeMatchKey>(options, params);
+        break;
+    }
+    append_result(results, "lookup_structure", params, result);
+  }
+}
+
+}  // namespace bench_utils
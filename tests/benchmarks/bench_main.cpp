@@ -0,0 +1,78 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Runs the lookup microbenchmarks and prints the results as JSON, either to
+// stdout or to the file given with -o. Use compare_bench.py to compare 2
+// result files.
+
+#include <jsoncpp/json.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "bench_utils.h"
+
+namespace {
+
+void usage(const char *prog) {
+  std::cerr << "Usage: " << prog << " [--quick] [--min-time-ms <ms>] "
+            << "[--suite lookup_structure|match_unit] [-o <output file>]\n";
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  bench_utils::Options options;
+  std::string output_path;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg(argv[i]);
+    const bool has_value = (i + 1 < argc);
+    if (arg == "--quick") {
+      options.quick = true;
+    } else if (arg == "--min-time-ms" && has_value) {
+      options.min_time = std::chrono::milliseconds(std::stoul(argv[++i]));
+    } else if (arg == "--suite" && has_value) {
+      options.suite = argv[++i];
+    } else if (arg == "-o" && has_value) {
+      output_path = argv[++i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  Json::Value root(Json::objectValue);
+  root["quick"] = options.quick;
+  root["min_time_ms"] = Json::UInt64(options.min_time.count());
+  Json::Value &results = root["results"] = Json::Value(Json::arrayValue);
+  if (options.suite.empty() || options.suite == "lookup_structure")
+    bench_utils::run_lookup_structures(options, &results);
+  if (options.suite.empty() || options.suite == "match_unit")
+    bench_utils::run_match_units(options, &results);
+
+  Json::StyledStreamWriter writer;
+  if (output_path.empty()) {
+    writer.write(std::cout, root);
+  } else {
+    std::ofstream fs(output_path);
+    if (!fs) {
+      std::cerr << "Cannot open output file " << output_path << "\n";
+      return 1;
+    }
+    writer.write(fs, root);
+  }
+  return 0;
+}
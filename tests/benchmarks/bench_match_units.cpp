@@ -0,0 +1,185 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Benchmarks the match units, as used by match tables: the lookup includes
+// building the key from the packet PHV and updating the entry counters.
+
+#include <bm/bm_sim/match_units.h>
+#include <bm/bm_sim/match_tables.h>
+#include <bm/bm_sim/phv_source.h>
+
+#include <jsoncpp/json.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cassert>
+
+#include "bench_utils.h"
+
+namespace bench_utils {
+
+namespace {
+
+using bm::MatchKeyParam;
+using bm::MatchUnitType;
+using bm::entry_handle_t;
+using bm::Packet;
+
+typedef bm::MatchTableAbstract::ActionEntry ActionEntry;
+
+constexpr size_t nb_queries = 1024;
+constexpr bm::header_id_t bench_header = 0;
+
+MatchKeyParam::Type to_param_type(MatchUnitType match_type) {
+  switch (match_type) {
+    case MatchUnitType::EXACT:
+      return MatchKeyParam::Type::EXACT;
+    case MatchUnitType::LPM:
+      return MatchKeyParam::Type::LPM;
+    case MatchUnitType::TERNARY:
+      return MatchKeyParam::Type::TERNARY;
+    case MatchUnitType::RANGE:
+      return MatchKeyParam::Type::RANGE;
+  }
+  return MatchKeyParam::Type::EXACT;
+}
+
+MatchKeyParam make_param(MatchUnitType match_type, const BenchEntry &e) {
+  auto param_type = to_param_type(match_type);
+  switch (match_type) {
+    case MatchUnitType::EXACT:
+      return MatchKeyParam(param_type, e.key);
+    case MatchUnitType::LPM:
+      return MatchKeyParam(param_type, e.key, e.prefix_length);
+    case MatchUnitType::TERNARY:
+      return MatchKeyParam(param_type, e.key, e.mask);
+    case MatchUnitType::RANGE:
+      {
+        std::string end(e.key);
+        for (size_t i = 0; i < end.size(); i++) end[i] |= ~e.mask[i];
+        return MatchKeyParam(param_type, e.key, end);
+      }
+  }
+  return MatchKeyParam(param_type, e.key);
+}
+
+std::unique_ptr<bm::MatchUnitAbstract<ActionEntry> >
+make_match_unit(MatchUnitType match_type, size_t size,
+                const bm::MatchKeyBuilder &key_builder,
+                bm::LookupStructureFactory *factory) {
+  typedef bm::MatchUnitAbstract<ActionEntry> MU;
+  switch (match_type) {
+    case MatchUnitType::EXACT:
+      return std::unique_ptr<MU>(
+          new bm::MatchUnitExact<ActionEntry>(size, key_builder, factory));
+    case MatchUnitType::LPM:
+      return std::unique_ptr<MU>(
+          new bm::MatchUnitLPM<ActionEntry>(size, key_builder, factory));
+    case MatchUnitType::TERNARY:
+      return std::unique_ptr<MU>(
+          new bm::MatchUnitTernary<ActionEntry>(size, key_builder, factory));
+    case MatchUnitType::RANGE:
+      return std::unique_ptr<MU>(
+          new bm::MatchUnitRange<ActionEntry>(size, key_builder, factory));
+  }
+  return nullptr;
+}
+
+Result run_one(const Options &options, const Params &params) {
+  bm::HeaderType header_type("bench_t", 0);
+  header_type.push_back_field("f", params.key_bytes * 8);
+  bm::PHVFactory phv_factory;
+  phv_factory.push_back_header("bench", bench_header, header_type);
+  std::unique_ptr<bm::PHVSourceIface> phv_source(
+      bm::PHVSourceIface::make_phv_source());
+  phv_source->set_phv_factory(0, &phv_factory);
+
+  bm::MatchKeyBuilder key_builder;
+  key_builder.push_back_field(bench_header, 0, params.key_bytes * 8,
+                              to_param_type(params.match_type));
+
+  EntryGenerator generator(params.match_type, params.key_bytes);
+  const auto entries = generator.make_entries(params.table_size);
+  std::vector<std::vector<MatchKeyParam> > match_keys;
+  match_keys.reserve(entries.size());
+  for (const auto &e : entries)
+    match_keys.push_back({make_param(params.match_type, e)});
+  const bool with_priority = (params.match_type == MatchUnitType::TERNARY ||
+                              params.match_type == MatchUnitType::RANGE);
+
+  std::vector<Packet> packets;
+  packets.reserve(nb_queries);
+  for (const auto &q : generator.make_queries(entries, nb_queries,
+                                              params.hit_ratio)) {
+    packets.push_back(
+        Packet::make_new(64, bm::PacketBuffer(128), phv_source.get()));
+    auto &header = packets.back().get_phv()->get_header(bench_header);
+    header.mark_valid();
+    header.get_field(0).set_bytes(q.data(), q.size());
+  }
+
+  Result result;
+  bm::LookupStructureFactory factory;
+  auto heap_before = heap_in_use();
+  auto match_unit = make_match_unit(params.match_type, params.table_size,
+                                    key_builder, &factory);
+
+  std::vector<entry_handle_t> handles(match_keys.size());
+  auto add_entry = [&](size_t idx) {
+    auto rc = match_unit->add_entry(match_keys[idx], ActionEntry(),
+                                    &handles[idx],
+                                    with_priority ? static_cast<int>(idx) : -1);
+    assert(rc == bm::MatchErrorCode::SUCCESS);
+    (void) rc;
+  };
+  typedef std::chrono::steady_clock clock;
+  auto start = clock::now();
+  for (size_t i = 0; i < match_keys.size(); i++) add_entry(i);
+  std::chrono::duration<double> fill_time = clock::now() - start;
+  result.insertions_per_sec = match_keys.size() / fill_time.count();
+  result.bytes_per_entry =
+      static_cast<double>(heap_in_use() - heap_before) / match_keys.size();
+
+  const size_t update_every = (params.update_ratio > 0) ?
+      static_cast<size_t>(1 / params.update_ratio) : 0;
+  size_t lookups = 0;
+  size_t hits = 0;
+  auto op = [&](size_t i) {
+    if (update_every > 0 && i % update_every == update_every - 1) {
+      size_t idx = (i / update_every) % match_keys.size();
+      match_unit->delete_entry(handles[idx]);
+      add_entry(idx);
+      return;
+    }
+    lookups++;
+    if (match_unit->lookup(packets[i % nb_queries]).found()) hits++;
+  };
+  result.ns_per_op = measure_ns_per_op(op, options.min_time);
+  result.measured_hit_ratio = static_cast<double>(hits) / lookups;
+  return result;
+}
+
+}  // namespace
+
+void
+run_match_units(const Options &options, Json::Value *results) {
+  for (const auto &params : make_params_matrix(options))
+    append_result(results, "match_unit", params, run_one(options, params));
+}
+
+}  // namespace bench_utils
@@ -0,0 +1,176 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <jsoncpp/json.h>
+
+#include <malloc.h>
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "bench_utils.h"
+
+namespace bench_utils {
+
+using bm::MatchUnitType;
+
+std::vector<Params>
+make_params_matrix(const Options &options) {
+  std::vector<size_t> table_sizes = {256, 4096};
+  if (!options.quick) table_sizes.push_back(65536);
+  const std::vector<size_t> key_widths = {1, 2, 4, 16};
+  // 1 and 2-byte keys only have 2^(bits - 5) distinct ternary and range
+  // entries (see BenchEntry), so they get their own table sizes: one for which
+  // the generic lookup structures are used and one for which the
+  // direct-indexed ones are (see LookupStructureFactory::direct_min_fill)
+  auto table_sizes_for = [&table_sizes](size_t key_bytes) {
+    if (key_bytes == 1) return std::vector<size_t>{2, 8};
+    if (key_bytes == 2) return std::vector<size_t>{256, 1024};
+    return table_sizes;
+  };
+  const std::vector<double> hit_ratios = {0.0, 0.5, 1.0};
+  const std::vector<double> update_ratios = {0.0, 0.1};
+  const std::vector<MatchUnitType> match_types = {
+    MatchUnitType::EXACT, MatchUnitType::LPM, MatchUnitType::TERNARY,
+    MatchUnitType::RANGE};
+
+  std::vector<Params> matrix;
+  for (auto match_type : match_types)
+    for (auto key_bytes : key_widths)
+      for (auto table_size : table_sizes_for(key_bytes))
+        for (auto hit_ratio : hit_ratios)
+          for (auto update_ratio : update_ratios)
+            matrix.push_back(
+                {match_type, table_size, key_bytes, hit_ratio, update_ratio});
+  return matrix;
+}
+
+const char *
+match_type_to_string(MatchUnitType match_type) {
+  switch (match_type) {
+    case MatchUnitType::EXACT:
+      return "exact";
+    case MatchUnitType::LPM:
+      return "lpm";
+    case MatchUnitType::TERNARY:
+      return "ternary";
+    case MatchUnitType::RANGE:
+      return "range";
+  }
+  return "";
+}
+
+EntryGenerator::EntryGenerator(MatchUnitType match_type, size_t key_bytes)
+    : match_type(match_type), key_bytes(key_bytes) { }
+
+std::string
+EntryGenerator::random_bytes() {
+  std::uniform_int_distribution<int> distribution(0, 255);
+  std::string bytes(key_bytes, '\x00');
+  for (auto &b : bytes) b = static_cast<char>(distribution(generator));
+  return bytes;
+}
+
+std::vector<BenchEntry>
+EntryGenerator::make_entries(size_t n) {
+  const int nbits = key_bytes * 8;
+  std::uniform_int_distribution<int> prefix_distribution(
+      nbits - nbits / 4, nbits);
+
+  std::vector<BenchEntry> entries;
+  entries.reserve(n);
+  std::unordered_set<std::string> used;
+  while (entries.size() < n) {
+    BenchEntry entry;
+    entry.key = random_bytes();
+    entry.key[0] &= 0x7f;
+    entry.mask = std::string(key_bytes, '\xff');
+    entry.prefix_length = nbits;
+    switch (match_type) {
+      case MatchUnitType::EXACT:
+        break;
+      case MatchUnitType::LPM:
+        entry.prefix_length = prefix_distribution(generator);
+        for (int i = entry.prefix_length; i < nbits; i++)
+          entry.mask[i / 8] &= ~(0x80 >> (i % 8));
+        break;
+      case MatchUnitType::TERNARY:
+      case MatchUnitType::RANGE:
+        entry.mask.back() = '\xf0';
+        break;
+    }
+    for (size_t i = 0; i < key_bytes; i++) entry.key[i] &= entry.mask[i];
+    auto id = entry.key;
+    id.push_back(static_cast<char>(entry.prefix_length));
+    if (!used.insert(std::move(id)).second) continue;
+    entries.push_back(std::move(entry));
+  }
+  return entries;
+}
+
+std::vector<std::string>
+EntryGenerator::make_queries(const std::vector<BenchEntry> &entries, size_t n,
+                             double hit_ratio) {
+  std::bernoulli_distribution hit_distribution(hit_ratio);
+  std::uniform_int_distribution<size_t> entry_distribution(
+      0, entries.size() - 1);
+  std::vector<std::string> queries;
+  queries.reserve(n);
+  for (size_t q = 0; q < n; q++) {
+    auto query = random_bytes();
+    if (hit_distribution(generator)) {
+      // random values for the bits which are not matched by the entry
+      const auto &entry = entries[entry_distribution(generator)];
+      for (size_t i = 0; i < key_bytes; i++)
+        query[i] = entry.key[i] | (query[i] & ~entry.mask[i]);
+    } else {
+      query[0] |= 0x80;
+    }
+    queries.push_back(std::move(query));
+  }
+  return queries;
+}
+
+size_t
+heap_in_use() {
+#if defined(__GLIBC__) && \
+  (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+  struct mallinfo2 info = mallinfo2();
+#else
+  struct mallinfo info = mallinfo();
+#endif
+  return info.uordblks + info.hblkhd;
+}
+
+void
+append_result(Json::Value *results, const std::string &suite,
+              const Params &params, const Result &result) {
+  Json::Value cfg_result(Json::objectValue);
+  cfg_result["suite"] = suite;
+  cfg_result["match_type"] = match_type_to_string(params.match_type);
+  cfg_result["table_size"] = Json::UInt64(params.table_size);
+  cfg_result["key_bytes"] = Json::UInt64(params.key_bytes);
+  cfg_result["hit_ratio"] = params.hit_ratio;
+  cfg_result["update_ratio"] = params.update_ratio;
+  // ns_per_lookup when update_ratio is 0
+  cfg_result["ns_per_op"] = result.ns_per_op;
+  cfg_result["insertions_per_sec"] = result.insertions_per_sec;
+  cfg_result["bytes_per_entry"] = result.bytes_per_entry;
+  cfg_result["measured_hit_ratio"] = result.measured_hit_ratio;
+  results->append(cfg_result);
+}
+
+}  // namespace bench_utils
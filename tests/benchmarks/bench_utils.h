@@ -0,0 +1,126 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TESTS_BENCHMARKS_BENCH_UTILS_H_
+#define TESTS_BENCHMARKS_BENCH_UTILS_H_
+
+#include <bm/bm_sim/match_key_types.h>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Json {
+
+class Value;
+
+}  // namespace Json
+
+namespace bench_utils {
+
+struct Options {
+  // only the smaller tables
+  bool quick{false};
+  // minimum duration of each timed loop
+  std::chrono::milliseconds min_time{20};
+  // empty means all suites
+  std::string suite{};
+};
+
+// One point in the benchmark matrix
+struct Params {
+  bm::MatchUnitType match_type;
+  size_t table_size;
+  size_t key_bytes;
+  // fraction of the lookups which hit an entry
+  double hit_ratio;
+  // fraction of the operations which are updates (delete + add of an existing
+  // entry) in the timed loop; the other operations are lookups
+  double update_ratio;
+};
+
+std::vector<Params> make_params_matrix(const Options &options);
+
+const char *match_type_to_string(bm::MatchUnitType match_type);
+
+// A table entry, with the match parameters expressed as a (value, mask) pair
+// for all match types. The mask has a single zero nibble at the end for
+// ternary and range entries; the range for range entries is
+// [key, key | ~mask]. The first bit of the key is always 0, which lets us
+// generate keys which are guaranteed to miss.
+struct BenchEntry {
+  std::string key;
+  std::string mask;
+  int prefix_length;
+};
+
+class EntryGenerator {
+ public:
+  EntryGenerator(bm::MatchUnitType match_type, size_t key_bytes);
+
+  // all entries are distinct
+  std::vector<BenchEntry> make_entries(size_t n);
+
+  std::vector<std::string> make_queries(const std::vector<BenchEntry> &entries,
+                                        size_t n, double hit_ratio);
+
+ private:
+  std::string random_bytes();
+
+  bm::MatchUnitType match_type;
+  size_t key_bytes;
+  // fixed seed, so that runs can be compared
+  std::mt19937 generator{0};
+};
+
+// Number of bytes currently allocated on the heap (from all sources, including
+// the C libraries which do not use operator new)
+size_t heap_in_use();
+
+// Calls op(i) for i = 0, 1, ..., doubling the number of calls until the whole
+// loop takes at least min_time. Returns the average duration of one call, in
+// nanoseconds.
+template <typename F>
+double measure_ns_per_op(const F &op, std::chrono::milliseconds min_time) {
+  typedef std::chrono::steady_clock clock;
+  for (size_t iters = 64; ; iters *= 2) {
+    auto start = clock::now();
+    for (size_t i = 0; i < iters; i++) op(i);
+    auto elapsed = clock::now() - start;
+    if (elapsed >= min_time || iters >= (1u << 30)) {
+      return std::chrono::duration<double, std::nano>(elapsed).count() / iters;
+    }
+  }
+}
+
+// Measurements shared by all suites
+struct Result {
+  double ns_per_op{0};
+  double insertions_per_sec{0};
+  double bytes_per_entry{0};
+  double measured_hit_ratio{0};
+};
+
+void append_result(Json::Value *results, const std::string &suite,
+                   const Params &params, const Result &result);
+
+// Each suite appends one entry per point in the matrix to results
+void run_lookup_structures(const Options &options, Json::Value *results);
+void run_match_units(const Options &options, Json::Value *results);
+
+}  // namespace bench_utils
+
+#endif  // TESTS_BENCHMARKS_BENCH_UTILS_H_
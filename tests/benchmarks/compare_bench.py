@@ -0,0 +1,65 @@
+#!/usr/bin/env python
+
+# Copyright 2013-present Barefoot Networks, Inc.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Compares 2 result files produced by bench_lookup (e.g. 'make bench') and
+# prints the relative change for each configuration present in both files.
+
+import argparse
+import json
+import sys
+
+KEY_FIELDS = ["suite", "match_type", "table_size", "key_bytes", "hit_ratio",
+              "update_ratio"]
+METRICS = ["ns_per_op", "insertions_per_sec", "bytes_per_entry"]
+
+def load(path):
+    with open(path) as f:
+        results = json.load(f)["results"]
+    return {tuple(r[k] for k in KEY_FIELDS): r for r in results}
+
+def main():
+    parser = argparse.ArgumentParser(description='Compare bench_lookup results')
+    parser.add_argument('baseline', help='JSON file for the baseline')
+    parser.add_argument('current', help='JSON file to compare to the baseline')
+    parser.add_argument('--threshold', type=float, default=0.0,
+                        help='Only show changes larger than this '
+                        '(e.g. 0.05 for 5%%)')
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    header = "%-60s" % "configuration" + "".join("%22s" % m for m in METRICS)
+    print(header)
+    for key in sorted(set(baseline) & set(current)):
+        changes = []
+        for m in METRICS:
+            old, new = baseline[key][m], current[key][m]
+            changes.append((new - old) / old if old else 0.0)
+        if all(abs(c) <= args.threshold for c in changes):
+            continue
+        name = "/".join(str(k) for k in key)
+        print("%-60s" % name + "".join("%+21.1f%%" % (100 * c)
+                                       for c in changes))
+    missing = set(baseline) ^ set(current)
+    if missing:
+        print("%d configuration(s) present in only one of the files" %
+              len(missing))
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main())
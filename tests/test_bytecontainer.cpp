@@ -0,0 +1,133 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_sim/bytecontainer.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using bm::ByteContainer;
+using bm::ByteContainerKeyHash;
+
+namespace {
+
+std::string make_bytes(size_t n) {
+  std::string s(n, '\x00');
+  for (size_t i = 0; i < n; i++) s[i] = static_cast<char>(i * 7 + 1);
+  return s;
+}
+
+std::string to_string(const ByteContainer &bc) {
+  return std::string(bc.begin(), bc.end());
+}
+
+}  // namespace
+
+// sizes on both sides of the inline capacity
+class ByteContainerSizeTest : public ::testing::TestWithParam<size_t> { };
+
+TEST_P(ByteContainerSizeTest, CopyAndMove) {
+  const auto s = make_bytes(GetParam());
+  ByteContainer bc(s.data(), s.size());
+  ASSERT_EQ(s, to_string(bc));
+
+  ByteContainer bc_copy(bc);
+  ASSERT_EQ(bc, bc_copy);
+  ByteContainer bc_assign;
+  bc_assign = bc;
+  ASSERT_EQ(bc, bc_assign);
+
+  ByteContainer bc_move(std::move(bc_copy));
+  ASSERT_EQ(bc, bc_move);
+  ASSERT_EQ(0u, bc_copy.size());
+  bc_copy.append(s.data(), s.size());
+  ASSERT_EQ(bc, bc_copy);
+
+  ByteContainer bc_move_assign("0xab");
+  bc_move_assign = std::move(bc_move);
+  ASSERT_EQ(bc, bc_move_assign);
+  ASSERT_EQ(0u, bc_move.size());
+}
+
+TEST_P(ByteContainerSizeTest, Grow) {
+  const auto s = make_bytes(GetParam());
+  ByteContainer bc;
+  for (const char c : s) bc.push_back(c);
+  ASSERT_EQ(s, to_string(bc));
+
+  ByteContainer bc_append;
+  bc_append.append(s.substr(0, s.size() / 2));
+  bc_append.append(s.substr(s.size() / 2));
+  ASSERT_EQ(bc, bc_append);
+
+  ByteContainer bc_resize(s.data(), s.size());
+  bc_resize.resize(s.size() + 3, '\xff');
+  ASSERT_EQ(s + std::string(3, '\xff'), to_string(bc_resize));
+  bc_resize.resize(s.size());
+  ASSERT_EQ(bc, bc_resize);
+}
+
+TEST_P(ByteContainerSizeTest, Insert) {
+  const auto s = make_bytes(GetParam());
+  ByteContainer bc("0xabcd");
+  ByteContainer other(s.data(), s.size());
+  bc.insert(bc.begin() + 1, other);
+  ASSERT_EQ(std::string("\xab") + s + std::string("\xcd"), to_string(bc));
+  bc.insert(bc.end(), other);
+  ASSERT_EQ(std::string("\xab") + s + std::string("\xcd") + s,
+            to_string(bc));
+}
+
+TEST_P(ByteContainerSizeTest, Hash) {
+  const auto s = make_bytes(GetParam());
+  const ByteContainer bc1(s.data(), s.size());
+  const ByteContainer bc2(s.data(), s.size());
+  ByteContainerKeyHash hash;
+  ASSERT_EQ(hash(bc1), hash(bc2));
+
+  // flipping any bit changes the hash
+  for (size_t i = 0; i < s.size(); i++) {
+    ByteContainer bc3(bc1);
+    bc3[i] ^= 0x10;
+    ASSERT_NE(hash(bc1), hash(bc3));
+  }
+
+  // the size is part of the hash
+  ByteContainer bc4(bc1);
+  bc4.push_back('\x00');
+  ASSERT_NE(hash(bc1), hash(bc4));
+}
+
+INSTANTIATE_TEST_CASE_P(ByteContainerSizes, ByteContainerSizeTest,
+                        ::testing::Values(0, 1, 7, 8, 9, 16, 17, 31, 32, 33,
+                                          100));
+
+TEST(ByteContainer, HexString) {
+  ByteContainer bc1("0xabc");
+  ASSERT_EQ(std::string("\x0a\xbc", 2), to_string(bc1));
+  ByteContainer bc2(std::string(80, 'f'));
+  ASSERT_EQ(std::string(40, '\xff'), to_string(bc2));
+  ASSERT_EQ(std::string(80, 'f'), bc2.to_hex());
+}
+
+TEST(ByteContainer, ApplyMask) {
+  ByteContainer bc(std::vector<char>(40, '\xff'));
+  ByteContainer mask(40, '\x0f');
+  bc.apply_mask(mask);
+  ASSERT_EQ(mask, bc);
+}
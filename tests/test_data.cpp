@@ -178,3 +178,39 @@ TEST(Data, GetString) {
   Data d(s.data(), s.size());
   ASSERT_EQ(s, d.get_string());
 }
+
+TEST(Data, GetStringZero) {
+  Data d(0);
+  ASSERT_EQ(std::string(1, '\x00'), d.get_string());
+}
+
+// values wider than 64 bits, including some which do not fit in the inline
+// storage of the Bignum
+TEST(Data, WideValues) {
+  const std::string ipv6("\x20\x01\x0d\xb8\x00\x00\x00\x00"
+                         "\x00\x00\x00\x00\x00\x00\x00\x01", 16);
+  Data d(ipv6.data(), ipv6.size());
+  ASSERT_EQ(ipv6, d.get_string());
+  ASSERT_EQ(1u, d.get_uint64());
+
+  const std::string all_ones(16, '\xff');
+  Data d_max(all_ones.data(), all_ones.size());
+  ASSERT_EQ(all_ones, d_max.get_string());
+
+  Data d_sum;
+  d_sum.add(d_max, Data(1));
+  ASSERT_EQ(std::string("\x01") + std::string(16, '\x00'), d_sum.get_string());
+  d_sum.sub(d_sum, Data(1));
+  ASSERT_EQ(d_max, d_sum);
+
+  Data d_shift;
+  d_shift.shift_left(Data(1), 200u);
+  ASSERT_EQ(std::string("\x01") + std::string(25, '\x00'),
+            d_shift.get_string());
+  d_shift.shift_right(d_shift, 200u);
+  ASSERT_EQ(Data(1), d_shift);
+
+  Data d_and;
+  d_and.bit_and(d, Data("0xffffffffffffffffffffffff"));
+  ASSERT_EQ(Data(1), d_and);
+}
@@ -0,0 +1,208 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cstring>
+
+#include <bm/bm_sim/event_logger.h>
+#include <bm/bm_sim/queue.h>
+
+using namespace bm;
+
+namespace {
+
+// stores every message it receives
+class RecordingTransport : public TransportIface {
+ public:
+  struct Event {
+    int type;
+    packet_id_t packet_id;
+  };
+
+  std::vector<Event> get_events() const {
+    std::unique_lock<std::mutex> lock(mutex);
+    return events;
+  }
+
+ private:
+  int open_() override { return 0; }
+
+  int send_(const char *msg, int len) const override {
+    // type is the first field of the header, followed by switch_id (4 bytes),
+    // cxt_id (4 bytes) and sig (8 bytes)
+    Event event;
+    std::memcpy(&event.type, msg, sizeof(event.type));
+    std::memcpy(&event.packet_id, msg + 20, sizeof(event.packet_id));
+    (void) len;
+    std::unique_lock<std::mutex> lock(mutex);
+    events.push_back(event);
+    return 0;
+  }
+
+  int send_(const std::string &msg) const override {
+    return send_(msg.data(), msg.size());
+  }
+
+  int send_msgs_(const std::initializer_list<std::string> &msgs)
+      const override {
+    (void) msgs;
+    return -1;
+  }
+
+  int send_msgs_(const std::initializer_list<MsgBuf> &msgs) const override {
+    (void) msgs;
+    return -1;
+  }
+
+  mutable std::vector<Event> events{};
+  mutable std::mutex mutex{};
+};
+
+constexpr int PACKET_IN = 0;
+constexpr int PACKET_OUT = 1;
+
+}  // namespace
+
+class EventLoggerTest : public ::testing::Test {
+ protected:
+  PHVFactory phv_factory;
+  std::unique_ptr<PHVSourceIface> phv_source{nullptr};
+
+  RecordingTransport *transport{nullptr};
+  std::unique_ptr<EventLogger> event_logger{nullptr};
+
+  EventLoggerTest()
+      : phv_source(PHVSourceIface::make_phv_source()) { }
+
+  virtual void SetUp() {
+    phv_source->set_phv_factory(0, &phv_factory);
+    transport = new RecordingTransport();
+    event_logger = std::unique_ptr<EventLogger>(
+        new EventLogger(std::unique_ptr<TransportIface>(transport)));
+  }
+
+  Packet get_pkt(packet_id_t id) {
+    return Packet::make_new(0, 0, id, 0, 64, PacketBuffer(128),
+                            phv_source.get());
+  }
+};
+
+TEST_F(EventLoggerTest, Sync) {
+  auto pkt = get_pkt(7);
+  event_logger->packet_in(pkt);
+  auto events = transport->get_events();
+  ASSERT_EQ(1u, events.size());
+  ASSERT_EQ(PACKET_IN, events[0].type);
+  ASSERT_EQ(7u, events[0].packet_id);
+}
+
+TEST_F(EventLoggerTest, AsyncPerThreadOrder) {
+  const size_t nb_threads = 4;
+  const packet_id_t nb_pkts = 500;
+  event_logger->start_async_writer();
+
+  auto producer = [this, nb_pkts](packet_id_t first_id) {
+    for (packet_id_t id = first_id; id < first_id + nb_pkts; id++) {
+      auto pkt = get_pkt(id);
+      event_logger->packet_in(pkt);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nb_threads; i++)
+    threads.emplace_back(producer, i * nb_pkts);
+  for (auto &t : threads) t.join();
+
+  event_logger->stop_async_writer();
+  // each thread fits in its own ring
+  ASSERT_EQ(0u, event_logger->get_dropped_events());
+
+  auto events = transport->get_events();
+  ASSERT_EQ(nb_threads * nb_pkts, events.size());
+  std::vector<packet_id_t> next_id;
+  for (size_t i = 0; i < nb_threads; i++) next_id.push_back(i * nb_pkts);
+  for (const auto &event : events) {
+    auto &expected = next_id.at(event.packet_id / nb_pkts);
+    ASSERT_EQ(expected, event.packet_id);
+    expected++;
+  }
+}
+
+// a packet processed by 2 threads successively: the events must be published
+// in the order in which they were generated
+TEST_F(EventLoggerTest, AsyncCrossThreadOrder) {
+  const packet_id_t nb_pkts = 2000;
+  Queue<packet_id_t> queue(64);
+  event_logger->start_async_writer();
+
+  std::thread ingress([this, &queue, nb_pkts]() {
+      for (packet_id_t id = 0; id < nb_pkts; id++) {
+        auto pkt = get_pkt(id);
+        event_logger->packet_in(pkt);
+        queue.push_front(id);
+      }
+    });
+  std::thread egress([this, &queue, nb_pkts]() {
+      for (packet_id_t i = 0; i < nb_pkts; i++) {
+        packet_id_t id;
+        queue.pop_back(&id);
+        auto pkt = get_pkt(id);
+        event_logger->packet_out(pkt);
+      }
+    });
+  ingress.join();
+  egress.join();
+
+  event_logger->stop_async_writer();
+  ASSERT_EQ(0u, event_logger->get_dropped_events());
+
+  auto events = transport->get_events();
+  ASSERT_EQ(2 * nb_pkts, events.size());
+  std::vector<bool> received(nb_pkts, false);
+  for (const auto &event : events) {
+    ASSERT_LT(event.packet_id, nb_pkts);
+    if (event.type == PACKET_IN) {
+      received[event.packet_id] = true;
+    } else {
+      ASSERT_EQ(PACKET_OUT, event.type);
+      ASSERT_TRUE(received[event.packet_id]);
+    }
+  }
+}
+
+TEST_F(EventLoggerTest, Sampling) {
+  const packet_id_t nb_pkts = 100;
+  event_logger->set_sampling_rate(4);
+  event_logger->start_async_writer();
+  for (packet_id_t id = 0; id < nb_pkts; id++) {
+    auto pkt = get_pkt(id);
+    event_logger->packet_in(pkt);
+    event_logger->packet_out(pkt);
+  }
+  event_logger->config_change();
+  event_logger->stop_async_writer();
+
+  auto events = transport->get_events();
+  ASSERT_EQ(2 * nb_pkts / 4 + 1, events.size());
+  for (size_t i = 0; i < events.size() - 1; i++)
+    ASSERT_EQ(0u, events[i].packet_id % 4);
+  ASSERT_EQ(999, events.back().type);
+}
@@ -20,10 +20,15 @@
 
 #include <gtest/gtest.h>
 
-#include <cassert>
-
 #include <bm/bm_sim/extern.h>
 
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
 using namespace bm;
 
 class ExternCounter : public ExternType {
@@ -84,6 +89,57 @@ BM_REGISTER_EXTERN_METHOD(ExternCounter, get);
 constexpr unsigned int ExternCounter::PACKETS;
 constexpr unsigned int ExternCounter::BYTES;
 
+// methods run concurrently, synchronization is done by the extern itself
+class ExternByteCounter : public ExternType {
+ public:
+  BM_EXTERN_ATTRIBUTES { }
+
+  void increment() {
+    count += get_packet().get_ingress_length();
+  }
+
+  size_t get() const {
+    return count;
+  }
+
+ private:
+  std::atomic<size_t> count{0};
+};
+
+BM_REGISTER_EXTERN(ExternByteCounter);
+BM_REGISTER_EXTERN_METHOD(ExternByteCounter, increment);
+
+// methods are serialized by the instance lock
+class ExternLockedPair : public ExternType {
+ public:
+  BM_EXTERN_NEEDS_LOCK;
+
+  BM_EXTERN_ATTRIBUTES { }
+
+  void increment() {
+    first++;
+    second++;
+  }
+
+  bool consistent() const {
+    return first == second;
+  }
+
+  size_t get() const {
+    return first;
+  }
+
+ private:
+  size_t first{0};
+  size_t second{0};
+};
+
+BM_REGISTER_EXTERN(ExternLockedPair);
+BM_REGISTER_EXTERN_METHOD(ExternLockedPair, increment);
+
+static_assert(!ExternCounter::_needs_lock, "locking is opt-in");
+static_assert(ExternLockedPair::_needs_lock, "type opted in for locking");
+
 // Google Test fixture for extern tests
 class ExternTest : public ::testing::Test {
  protected:
@@ -195,3 +251,62 @@ TEST_F(ExternTest, NameAndId) {
   ASSERT_EQ(name, extern_instance->get_name());
   ASSERT_EQ(id, extern_instance->get_id());
 }
+
+class ExternConcurrencyTest : public ExternTest {
+ protected:
+  static constexpr size_t nb_threads = 4u;
+  static constexpr size_t iterations = 10000u;
+
+  // calls the method on the extern instance from several threads, each with
+  // its own packet, of ingress length thread index + 1
+  void run_threads(ExternType *extern_instance,
+                   const std::string &extern_name) {
+    testActionFn.push_back_primitive(
+        get_extern_primitive(extern_name, "increment"));
+    testActionFn.parameter_push_back_extern_instance(extern_instance);
+
+    std::vector<std::unique_ptr<Packet> > pkts;
+    for (size_t i = 0; i < nb_threads; i++) {
+      pkts.emplace_back(new Packet(Packet::make_new(
+          i + 1, PacketBuffer(64), phv_source.get())));
+    }
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nb_threads; i++) {
+      Packet *thread_pkt = pkts[i].get();
+      threads.emplace_back([this, thread_pkt]() {
+          for (size_t j = 0; j < iterations; j++)
+            testActionFnEntry(thread_pkt);
+        });
+    }
+    for (auto &t : threads) t.join();
+  }
+};
+
+constexpr size_t ExternConcurrencyTest::nb_threads;
+constexpr size_t ExternConcurrencyTest::iterations;
+
+TEST_F(ExternConcurrencyTest, PacketIsPerThread) {
+  auto extern_instance = ExternFactoryMap::get_instance()->get_extern_instance(
+      "ExternByteCounter");
+  extern_instance->_register_attributes();
+  extern_instance->init();
+  run_threads(extern_instance.get(), "ExternByteCounter");
+  auto counter_instance = dynamic_cast<ExternByteCounter *>(
+      extern_instance.get());
+  ASSERT_NE(nullptr, counter_instance);
+  // 1 + 2 + ... + nb_threads bytes per iteration
+  ASSERT_EQ(iterations * nb_threads * (nb_threads + 1) / 2,
+            counter_instance->get());
+}
+
+TEST_F(ExternConcurrencyTest, Lock) {
+  auto extern_instance = ExternFactoryMap::get_instance()->get_extern_instance(
+      "ExternLockedPair");
+  extern_instance->_register_attributes();
+  extern_instance->init();
+  run_threads(extern_instance.get(), "ExternLockedPair");
+  auto pair_instance = dynamic_cast<ExternLockedPair *>(extern_instance.get());
+  ASSERT_NE(nullptr, pair_instance);
+  ASSERT_TRUE(pair_instance->consistent());
+  ASSERT_EQ(iterations * nb_threads, pair_instance->get());
+}
@@ -22,6 +22,8 @@
 
 #include <bm/bm_sim/handle_mgr.h>
 
+#include <vector>
+
 using bm::HandleMgr;
 using bm::handle_t;
 
@@ -61,3 +63,31 @@ TYPED_TEST(SimpleTest, Iterate) {
   }
   ASSERT_EQ(N, i);
 }
+
+TEST(HandleMgr, GetPage) {
+  HandleMgr handle_mgr;
+  std::vector<handle_t> page;
+
+  ASSERT_EQ(0u, handle_mgr.get_page(0, 4, &page));
+  ASSERT_TRUE(page.empty());
+
+  const size_t N = 10;
+  handle_t handle;
+  for (size_t i = 0; i < N; i++) ASSERT_EQ(0, handle_mgr.get_handle(&handle));
+  // leave a hole
+  ASSERT_EQ(0, handle_mgr.release_handle(4));
+
+  handle_t cursor = handle_mgr.get_page(0, 4, &page);
+  ASSERT_EQ(std::vector<handle_t>({0, 1, 2, 3}), page);
+  ASSERT_EQ(5u, cursor);
+  cursor = handle_mgr.get_page(cursor, 4, &page);
+  ASSERT_EQ(9u, cursor);
+  cursor = handle_mgr.get_page(cursor, 4, &page);
+  ASSERT_EQ(0u, cursor);
+  ASSERT_EQ(std::vector<handle_t>({0, 1, 2, 3, 5, 6, 7, 8, 9}), page);
+
+  // max_handles is at least 1
+  page.clear();
+  ASSERT_EQ(1u, handle_mgr.get_page(0, 0, &page));
+  ASSERT_EQ(1u, page.size());
+}
@@ -26,6 +26,7 @@
 #include <thread>
 #include <condition_variable>
 #include <chrono>
+#include <vector>
 
 #include <cassert>
 
@@ -547,3 +548,49 @@ TEST_F(LearningTest, OneSampleCbMode) {
   ASSERT_EQ((char) 0xa, data[0]);
   ASSERT_EQ((char) 0xba, data[1]);
 }
+
+TEST_F(LearningTest, ConcurrentLearn) {
+  LearnEngine::list_id_t list_id = 1;
+  size_t max_samples = 16; unsigned timeout_ms = 100;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  size_t received_samples = 0;
+  auto cb = [&mutex, &cv, &received_samples](
+      const LearnEngine::msg_hdr_t &msg_hdr, size_t,
+      std::unique_ptr<char[]>, void *) {
+    std::unique_lock<std::mutex> lock(mutex);
+    received_samples += msg_hdr.num_samples;
+    cv.notify_one();
+  };
+
+  learn_engine.list_create(list_id, max_samples, timeout_ms);
+  learn_engine.list_set_learn_cb(list_id, cb, nullptr);
+  learn_engine.list_push_back_field(list_id, testHeader1, 0); // test1.f16
+  learn_engine.list_init(list_id);
+
+  const size_t nb_threads = 4u;
+  const size_t samples_per_thread = 200u;
+  auto learn_loop = [this, list_id, samples_per_thread](size_t thread_id) {
+    Packet pkt = get_pkt();
+    Field &f = pkt.get_phv()->get_field(testHeader1, 0);
+    for (size_t i = 0; i < samples_per_thread; i++) {
+      f.set(thread_id * samples_per_thread + i);
+      learn_engine.learn(list_id, pkt);
+      // duplicates are filtered out
+      learn_engine.learn(list_id, pkt);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nb_threads; i++)
+    threads.emplace_back(learn_loop, i);
+  for (auto &t : threads) t.join();
+
+  std::unique_lock<std::mutex> lock(mutex);
+  const size_t expected = nb_threads * samples_per_thread;
+  cv.wait_for(lock, milliseconds(1000),
+              [&received_samples, expected] {
+                return received_samples >= expected; });
+  ASSERT_EQ(expected, received_samples);
+}
@@ -22,6 +22,8 @@
 
 #include <thread>
 #include <chrono>
+#include <atomic>
+#include <vector>
 
 #include <bm/bm_sim/meters.h>
 
@@ -154,3 +156,52 @@ TEST_F(MetersTest, trTCM) {
 
   ASSERT_EQ(expected, output);
 }
+
+TEST_F(MetersTest, ConcurrentExecute) {
+  const color_t GREEN = 0;
+
+  Meter meter(MeterType::PACKETS, 1);
+  // rate of 0: only the initial burst can be marked GREEN
+  const size_t burst_size = 1000u;
+  Meter::rate_config_t rate = {0., burst_size};
+  meter.set_rates({rate});
+
+  Packet pkt = get_pkt(128);
+
+  const size_t nb_threads = 4u;
+  const size_t iterations = 1000u;
+  std::atomic<size_t> green_count{0u};
+  auto execute_loop = [&meter, &pkt, &green_count, GREEN, iterations]() {
+    for (size_t i = 0; i < iterations; i++) {
+      if (meter.execute(pkt) == GREEN) green_count++;
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < nb_threads; i++)
+    threads.emplace_back(execute_loop);
+  for (auto &t : threads) t.join();
+
+  ASSERT_EQ(burst_size, green_count.load());
+}
+
+TEST_F(MetersTest, CoarseClock) {
+  const color_t GREEN = 0;
+  const color_t RED = 1;
+
+  Meter::set_clock_precision(std::chrono::microseconds(1000));
+
+  Meter meter(MeterType::PACKETS, 1);
+  // 100 packets per second, burst size of 1
+  Meter::rate_config_t rate = {0.0001, 1};
+  meter.set_rates({rate});
+
+  Packet pkt = get_pkt(128);
+
+  ASSERT_EQ(GREEN, meter.execute(pkt));
+  ASSERT_EQ(RED, meter.execute(pkt));
+  // 1 token every 10ms, the clock is updated every ms
+  sleep_for(milliseconds(30));
+  ASSERT_EQ(GREEN, meter.execute(pkt));
+
+  Meter::set_clock_precision(std::chrono::microseconds(0));
+}
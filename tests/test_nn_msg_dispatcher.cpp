@@ -0,0 +1,149 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_apps/nn_msg_dispatcher.h>
+#include <bm/bm_sim/nn.h>
+
+#include <nanomsg/pair.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using bm_apps::NnMsg;
+using bm_apps::NnMsgDispatcher;
+
+using Batch = NnMsgDispatcher::Batch;
+
+namespace {
+
+class NnMsgDispatcherTest : public ::testing::Test {
+ protected:
+  NnMsgDispatcherTest()
+      : sender(AF_SP, NN_PAIR), receiver(AF_SP, NN_PAIR) { }
+
+  virtual void SetUp() {
+    // one address per test
+    const auto *test_info =
+        ::testing::UnitTest::GetInstance()->current_test_info();
+    const std::string addr =
+        std::string("inproc://test_nn_msg_dispatcher_") + test_info->name();
+    sender.bind(addr.c_str());
+    receiver.connect(addr.c_str());
+    int rcv_timeout_ms = 100;
+    receiver.setsockopt(NN_SOL_SOCKET, NN_RCVTIMEO,
+                        &rcv_timeout_ms, sizeof(rcv_timeout_ms));
+  }
+
+  void send_ids(uint32_t nb_msgs) {
+    for (uint32_t id = 0; id < nb_msgs; id++) {
+      ASSERT_EQ(static_cast<int>(sizeof(id)),
+                sender.send(&id, sizeof(id), 0));
+    }
+  }
+
+  // all the messages are sent before the loop starts, so the receive timeout
+  // only expires once they have all been received
+  void receive_all(NnMsgDispatcher *dispatcher) {
+    dispatcher->receive_loop(&receiver, [] { return true; });
+  }
+
+  static uint32_t get_id(const NnMsg &msg) {
+    uint32_t id = 0;
+    EXPECT_EQ(sizeof(id), msg.size);
+    std::memcpy(&id, msg.buffer.get(), sizeof(id));
+    return id;
+  }
+
+  nn::socket sender;
+  nn::socket receiver;
+};
+
+}  // namespace
+
+TEST_F(NnMsgDispatcherTest, MaxBatch) {
+  const uint32_t nb_msgs = 100;
+  const size_t max_batch = 8;
+  std::vector<size_t> batch_sizes;
+  std::vector<uint32_t> ids;
+  send_ids(nb_msgs);
+  {
+    NnMsgDispatcher dispatcher(0, max_batch, [&](Batch &&batch) {
+      batch_sizes.push_back(batch.size());
+      for (const auto &msg : batch) ids.push_back(get_id(msg));
+    });
+    receive_all(&dispatcher);
+  }
+  ASSERT_EQ(nb_msgs, ids.size());
+  // without workers, the handler sees the messages in order
+  for (uint32_t id = 0; id < nb_msgs; id++) ASSERT_EQ(id, ids.at(id));
+  for (auto size : batch_sizes) {
+    ASSERT_LT(0u, size);
+    ASSERT_GE(max_batch, size);
+  }
+  // the messages were all waiting, so some batches were cut at max_batch
+  ASSERT_NE(batch_sizes.end(),
+            std::find(batch_sizes.begin(), batch_sizes.end(), max_batch));
+}
+
+TEST_F(NnMsgDispatcherTest, HandlerTakesOwnership) {
+  const uint32_t nb_msgs = 10;
+  std::vector<NnMsg> msgs;
+  send_ids(nb_msgs);
+  {
+    NnMsgDispatcher dispatcher(0, 4, [&msgs](Batch &&batch) {
+      std::move(batch.begin(), batch.end(), std::back_inserter(msgs));
+    });
+    receive_all(&dispatcher);
+  }
+  // the buffers are still valid once the dispatcher is gone...
+  ASSERT_EQ(nb_msgs, msgs.size());
+  for (uint32_t id = 0; id < nb_msgs; id++) ASSERT_EQ(id, get_id(msgs.at(id)));
+  // ...and the handler is the only one to free them
+  for (auto &msg : msgs) {
+    char *buffer = msg.buffer.release();
+    ASSERT_NE(nullptr, buffer);
+    ASSERT_EQ(0, nn_freemsg(buffer));
+  }
+}
+
+TEST_F(NnMsgDispatcherTest, Workers) {
+  const uint32_t nb_msgs = 1000;
+  const size_t max_batch = 16;
+  std::mutex mutex;
+  std::vector<uint32_t> ids;
+  size_t max_batch_size = 0;
+  send_ids(nb_msgs);
+  {
+    NnMsgDispatcher dispatcher(4, max_batch, [&](Batch &&batch) {
+      std::unique_lock<std::mutex> lock(mutex);
+      max_batch_size = std::max(max_batch_size, batch.size());
+      for (const auto &msg : batch) ids.push_back(get_id(msg));
+    });
+    receive_all(&dispatcher);
+  }
+  ASSERT_GE(max_batch, max_batch_size);
+  // batches may be handled in any order, but each message exactly once
+  ASSERT_EQ(nb_msgs, ids.size());
+  std::sort(ids.begin(), ids.end());
+  for (uint32_t id = 0; id < nb_msgs; id++) ASSERT_EQ(id, ids.at(id));
+}
@@ -24,6 +24,7 @@
 #include <memory>
 
 #include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/packet_tracer.h>
 
 using namespace bm;
 
@@ -162,6 +163,27 @@ TEST_F(PacketTest, Truncate) {
       data.begin(), data.begin() + pkt_2.get_data_size(), pkt_2.data()));
 }
 
+TEST_F(PacketTest, TruncatedClone) {
+  const size_t length = 128;
+  std::vector<char> data;
+  for (size_t i = 0; i < length; i++) data.push_back(static_cast<char>(i));
+  auto packet = Packet::make_new(
+      0, 0, 0, 0, 0, PacketBuffer(2 * length, data.data(), length),
+      phv_source.get());
+
+  const size_t max_data_size = 47;
+  auto clone_1 = packet.clone_no_phv_ptr(max_data_size);
+  auto clone_2 = packet.clone_with_phv_reset_metadata_ptr(max_data_size);
+  for (auto *clone : {clone_1.get(), clone_2.get()}) {
+    ASSERT_EQ(max_data_size, clone->get_data_size());
+    ASSERT_TRUE(std::equal(data.begin(), data.begin() + max_data_size,
+                           clone->data()));
+  }
+
+  auto clone_3 = packet.clone_no_phv_ptr(2 * length);
+  ASSERT_EQ(length, clone_3->get_data_size());
+}
+
 TEST_F(PacketTest, PacketRegisters) {
   const uint64_t v1 = 0u;
   const uint64_t v2 = 6789u;
@@ -206,3 +228,82 @@ TEST_F(PacketTest, CopyId) {
   auto packet_1_new = packet_0_new->clone_with_phv_ptr();
   ASSERT_EQ(1u, packet_1_new->get_copy_id());
 }
+
+TEST_F(PacketTest, Recycle) {
+  const size_t length = 64;
+  std::vector<char> data(length, '\xab');
+  auto packet = Packet::make_new(
+      0, 0, 0, 0, 0, PacketBuffer(length, data.data(), length),
+      phv_source.get());
+  const char *buffer_start = packet.data();
+  auto clone = packet.clone_no_phv_ptr();
+  ASSERT_EQ(1u, clone->get_copy_id());
+  packet.truncate(length / 2);
+  packet.mark_for_exit();
+
+  packet.recycle();
+  ASSERT_EQ(2u, packet.get_copy_id());
+  ASSERT_FALSE(packet.is_marked_for_exit());
+  ASSERT_EQ(length, packet.get_data_size());
+  // neither the buffer nor the PHV is replaced
+  ASSERT_EQ(buffer_start, packet.data());
+  ASSERT_EQ(2u, phv_source->get_created(0));
+  ASSERT_EQ(0u, phv_source->get_destroyed(0));
+}
+
+TEST_F(PacketTest, TraceIngress) {
+  auto make_packet = [this](int ingress_port, packet_id_t id) {
+    return Packet::make_new(0, ingress_port, id, 0, 0, PacketBuffer(),
+                            phv_source.get());
+  };
+  auto tracer = PacketTracer::get();
+  EXPECT_FALSE(make_packet(1, 4).is_traced());
+
+  PacketTracer::Config config;
+  config.ports = {3, 1};
+  config.sampling_rate = 2;
+  tracer->enable(config);
+  EXPECT_TRUE(make_packet(1, 4).is_traced());
+  EXPECT_TRUE(make_packet(3, 0).is_traced());
+  EXPECT_FALSE(make_packet(2, 4).is_traced());
+  EXPECT_FALSE(make_packet(1, 5).is_traced());
+
+  auto packet = make_packet(1, 6);
+  auto clone = packet.clone_with_phv_ptr();
+  EXPECT_TRUE(clone->is_traced());
+
+  tracer->disable();
+  EXPECT_FALSE(make_packet(1, 4).is_traced());
+  // already selected packets are still traced
+  EXPECT_TRUE(packet.is_traced());
+}
+
+TEST_F(PacketTest, TraceFieldMatch) {
+  HeaderType header_type("test_t", 0);
+  header_type.push_back_field("f16", 16);
+  phv_factory.push_back_header("test", 0, header_type);
+
+  auto tracer = PacketTracer::get();
+  PacketTracer::Config config;
+  config.field_matches.push_back({"test.f16", Data(0xab)});
+  tracer->enable(config);
+
+  auto packet = get_packet(0);
+  // the decision is taken once the packet has been parsed
+  EXPECT_FALSE(packet.is_traced());
+  tracer->select_after_parse(&packet);
+  // header is not valid
+  EXPECT_FALSE(packet.is_traced());
+
+  PHV *phv = packet.get_phv();
+  phv->get_header(0).mark_valid();
+  phv->get_field("test.f16").set(0xcd);
+  tracer->select_after_parse(&packet);
+  EXPECT_FALSE(packet.is_traced());
+
+  phv->get_field("test.f16").set(0xab);
+  tracer->select_after_parse(&packet);
+  EXPECT_TRUE(packet.is_traced());
+
+  tracer->disable();
+}
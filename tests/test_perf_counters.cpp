@@ -0,0 +1,130 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_sim/conditionals.h>
+#include <bm/bm_sim/deparser.h>
+#include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/parser.h>
+#include <bm/bm_sim/perf_counters.h>
+#include <bm/bm_sim/phv_source.h>
+#include <bm/bm_sim/pipeline.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+using namespace bm;
+
+using ObjectType = PerfCounters::ObjectType;
+
+class PerfCountersTest : public ::testing::Test {
+ protected:
+  PHVFactory phv_factory;
+  std::unique_ptr<PHVSourceIface> phv_source{nullptr};
+
+  Parser parser{"parser1", 3};
+  Conditional cond1{"cond1", 1};
+  Conditional cond2{"cond2", 2};
+  Pipeline pipeline{"ingress", 0, &cond1};
+  Deparser deparser{"deparser1", 4};
+
+  PerfCountersTest()
+      : phv_source(PHVSourceIface::make_phv_source()) {
+    cond1.push_back_load_bool(true);
+    cond1.build();
+    cond1.set_next_node_if_true(&cond2);
+    cond2.push_back_load_bool(false);
+    cond2.build();
+  }
+
+  virtual void SetUp() {
+    phv_source->set_phv_factory(0, &phv_factory);
+  }
+
+  virtual void TearDown() {
+    PerfCounters::get()->disable();
+    PerfCounters::get()->reset();
+  }
+
+  void process_packets(packet_id_t nb_packets) {
+    for (packet_id_t id = 0; id < nb_packets; id++) {
+      auto packet = Packet::make_new(0, 0, id, 0, 0, PacketBuffer(256),
+                                     phv_source.get());
+      parser.parse(&packet);
+      pipeline.apply(&packet);
+      deparser.deparse(&packet);
+    }
+  }
+};
+
+TEST_F(PerfCountersTest, DisabledByDefault) {
+  auto perf_counters = PerfCounters::get();
+  ASSERT_FALSE(perf_counters->is_enabled());
+  process_packets(4);
+  ASSERT_TRUE(perf_counters->get_stats().empty());
+}
+
+TEST_F(PerfCountersTest, Sampling) {
+  auto perf_counters = PerfCounters::get();
+  std::string error;
+  if (!perf_counters->enable(2, &error)) {
+    // hardware counters may not be available, e.g. in a VM or container
+    ASSERT_FALSE(error.empty());
+    ASSERT_FALSE(perf_counters->is_enabled());
+    std::cerr << "Hardware counters not available (" << error
+              << "), skipping test\n";
+    return;
+  }
+  ASSERT_TRUE(perf_counters->is_enabled());
+  process_packets(10);
+
+  const auto stats = perf_counters->get_stats();
+  ASSERT_EQ(4u, stats.size());
+  auto check_entry = [&stats](ObjectType type, p4object_id_t id,
+                              const std::string &name) {
+    for (const auto &s : stats) {
+      if (s.type != type || s.id != id) continue;
+      EXPECT_EQ(0u, s.cxt_id);
+      EXPECT_EQ(name, s.name);
+      // only even packet ids are sampled
+      EXPECT_EQ(5u, s.samples);
+      EXPECT_LT(0u, s.instructions);
+      return;
+    }
+    FAIL() << "no entry for " << name;
+  };
+  check_entry(ObjectType::PARSER, 3, "parser1");
+  check_entry(ObjectType::CONDITIONAL, 1, "cond1");
+  check_entry(ObjectType::CONDITIONAL, 2, "cond2");
+  check_entry(ObjectType::DEPARSER, 4, "deparser1");
+
+  // counters are preserved when counting is disabled
+  perf_counters->disable();
+  process_packets(10);
+  ASSERT_EQ(5u, perf_counters->get_stats().at(0).samples);
+  perf_counters->reset();
+  ASSERT_TRUE(perf_counters->get_stats().empty());
+}
+
+TEST(PerfCounters, ObjectTypeName) {
+  ASSERT_STREQ("parser", PerfCounters::object_type_name(ObjectType::PARSER));
+  ASSERT_STREQ("table", PerfCounters::object_type_name(ObjectType::TABLE));
+  ASSERT_STREQ("conditional",
+               PerfCounters::object_type_name(ObjectType::CONDITIONAL));
+  ASSERT_STREQ("deparser",
+               PerfCounters::object_type_name(ObjectType::DEPARSER));
+}
@@ -0,0 +1,295 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_sim/actions.h>
+#include <bm/bm_sim/conditionals.h>
+#include <bm/bm_sim/lookup_structures.h>
+#include <bm/bm_sim/packet.h>
+#include <bm/bm_sim/phv_source.h>
+#include <bm/bm_sim/pipeline.h>
+#include <bm/bm_sim/tables.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace bm;
+
+// t1 (exact on a): hit -> cond, miss -> t3
+// cond (b > 100): true -> t2, false -> t3
+// t2 (exact on b), t3 (default action only): end of pipeline
+class PipelineBatchTest : public ::testing::Test {
+ protected:
+  PHVFactory phv_factory;
+  std::unique_ptr<PHVSourceIface> phv_source{nullptr};
+  LookupStructureFactory lookup_factory;
+
+  HeaderType testHeaderType{"test_t", 0};
+  header_id_t testHeader{0};
+
+  ActionFn set_b{"set_b", 0};
+  ActionFn set_c{"set_c", 1};
+
+  std::unique_ptr<MatchActionTable> t1{nullptr};
+  std::unique_ptr<MatchActionTable> t2{nullptr};
+  std::unique_ptr<MatchActionTable> t3{nullptr};
+  Conditional cond{"cond", 0};
+  std::unique_ptr<Pipeline> pipeline{nullptr};
+
+  PipelineBatchTest()
+      : phv_source(PHVSourceIface::make_phv_source()) {
+    testHeaderType.push_back_field("a", 16);
+    testHeaderType.push_back_field("b", 16);
+    testHeaderType.push_back_field("c", 16);
+    phv_factory.push_back_header("test", testHeader, testHeaderType);
+
+    auto modify_field =
+        ActionOpcodesMap::get_instance()->get_primitive("modify_field");
+    set_b.push_back_primitive(modify_field);
+    set_b.parameter_push_back_field(testHeader, 1);
+    set_b.parameter_push_back_action_data(0);
+    set_c.push_back_primitive(modify_field);
+    set_c.parameter_push_back_field(testHeader, 2);
+    set_c.parameter_push_back_action_data(0);
+
+    t1 = make_table("t1", 0, 0);
+    t2 = make_table("t2", 1, 1);
+    t3 = make_table("t3", 2, 0);
+
+    auto mt1 = get_mt(t1.get());
+    mt1->set_next_node(set_b.get_id(), &cond);
+    mt1->set_next_node_miss(t3.get());
+    auto mt2 = get_mt(t2.get());
+    mt2->set_next_node(set_c.get_id(), nullptr);
+    mt2->set_next_node_miss_default(nullptr);
+    auto mt3 = get_mt(t3.get());
+    mt3->set_next_node(set_c.get_id(), nullptr);
+    mt3->set_next_node_miss_default(nullptr);
+
+    cond.push_back_load_field(testHeader, 1);
+    cond.push_back_load_const(Data(100));
+    cond.push_back_op(ExprOpcode::GT_DATA);
+    cond.build();
+    cond.set_next_node_if_true(t2.get());
+    cond.set_next_node_if_false(t3.get());
+
+    pipeline = std::unique_ptr<Pipeline>(
+        new Pipeline("ingress", 0, t1.get()));
+  }
+
+  std::unique_ptr<MatchActionTable> make_table(const std::string &name,
+                                               p4object_id_t id,
+                                               int field_offset) {
+    MatchKeyBuilder key_builder;
+    key_builder.push_back_field(testHeader, field_offset, 16,
+                                MatchKeyParam::Type::EXACT);
+    return MatchActionTable::create_match_action_table<MatchTable>(
+        "exact", name, id, 1024, key_builder, false, false, &lookup_factory);
+  }
+
+  static MatchTable *get_mt(MatchActionTable *t) {
+    return static_cast<MatchTable *>(t->get_match_table());
+  }
+
+  static std::string key(unsigned int v) {
+    return std::string({static_cast<char>(v >> 8), static_cast<char>(v)});
+  }
+
+  void add_entry(MatchActionTable *t, const ActionFn *action_fn,
+                 unsigned int k, unsigned int v) {
+    std::vector<MatchKeyParam> match_key;
+    match_key.emplace_back(MatchKeyParam::Type::EXACT, key(k));
+    ActionData action_data;
+    action_data.push_back_action_data(v);
+    entry_handle_t handle;
+    ASSERT_EQ(MatchErrorCode::SUCCESS,
+              get_mt(t)->add_entry(match_key, action_fn,
+                                   std::move(action_data), &handle));
+  }
+
+  virtual void SetUp() {
+    phv_source->set_phv_factory(0, &phv_factory);
+  }
+
+  std::unique_ptr<Packet> get_pkt(packet_id_t id, unsigned int a) const {
+    // dummy packet, won't be parsed
+    std::unique_ptr<Packet> packet(new Packet(Packet::make_new(
+        0, 0, id, 0, 0, PacketBuffer(256), phv_source.get())));
+    PHV *phv = packet->get_phv();
+    // the PHVs are recycled by the PHV source
+    phv->reset_headers();
+    phv->get_header(testHeader).mark_valid();
+    phv->get_field(testHeader, 0).set(a);
+    return packet;
+  }
+};
+
+TEST_F(PipelineBatchTest, SameAsSinglePacket) {
+  // t1 sets b to either side of the condition threshold, t2 only has entries
+  // for some of the values of b
+  for (unsigned int a = 0; a < 64; a++) {
+    if (a % 4 == 3) continue;  // miss in t1
+    const unsigned int b = (a % 2 == 0) ? 200 + a : a;
+    add_entry(t1.get(), &set_b, a, b);
+    if (a % 8 != 0) add_entry(t2.get(), &set_c, b, 1000 + a);
+  }
+  ActionData default_data;
+  default_data.push_back_action_data(0xabc);
+  ASSERT_EQ(MatchErrorCode::SUCCESS,
+            get_mt(t3.get())->set_default_action(&set_c,
+                                                 std::move(default_data)));
+
+  std::mt19937 gen(0);
+  std::uniform_int_distribution<unsigned int> a_dis(0, 80);
+  for (size_t n : {0u, 1u, 7u, 64u, 65u, 200u}) {
+    std::vector<std::unique_ptr<Packet> > single_pkts;
+    std::vector<std::unique_ptr<Packet> > batch_pkts;
+    std::vector<Packet *> batch;
+    for (size_t i = 0; i < n; i++) {
+      const unsigned int a = a_dis(gen);
+      single_pkts.push_back(get_pkt(i, a));
+      batch_pkts.push_back(get_pkt(i, a));
+      // packets marked for exit go through none of the tables
+      if (i % 13 == 5) {
+        single_pkts.back()->mark_for_exit();
+        batch_pkts.back()->mark_for_exit();
+      }
+      batch.push_back(batch_pkts.back().get());
+    }
+
+    for (auto &pkt : single_pkts) pipeline->apply(pkt.get());
+    pipeline->apply_batch(batch.data(), batch.size());
+
+    for (size_t i = 0; i < n; i++) {
+      for (int f = 1; f <= 2; f++) {
+        const auto &single_f = single_pkts[i]->get_phv()->get_field(
+            testHeader, f);
+        const auto &batch_f = batch_pkts[i]->get_phv()->get_field(
+            testHeader, f);
+        ASSERT_EQ(single_f.get_uint(), batch_f.get_uint())
+            << "field " << f << " of packet " << i << " in batch of " << n;
+      }
+    }
+  }
+}
+
+namespace {
+
+// sends each packet to next_odd or next_even depending on the parity of the
+// first field, and records the size of each batch it is applied to
+class CountingNode : public ControlFlowNode {
+ public:
+  CountingNode(const std::string &name, p4object_id_t id,
+               header_id_t hdr)
+      : ControlFlowNode(name, id), hdr(hdr) { }
+
+  void set_next_nodes(const ControlFlowNode *odd,
+                      const ControlFlowNode *even) {
+    next_odd = odd;
+    next_even = even;
+  }
+
+  const ControlFlowNode *operator()(Packet *pkt) const override {
+    single_calls++;
+    return next(pkt);
+  }
+
+  void apply_batch(Packet *const *pkts, size_t n,
+                   const ControlFlowNode **next_nodes) const override {
+    batch_sizes.push_back(n);
+    for (size_t i = 0; i < n; i++) next_nodes[i] = next(pkts[i]);
+  }
+
+  mutable std::vector<size_t> batch_sizes{};
+  mutable size_t single_calls{0};
+
+ private:
+  const ControlFlowNode *next(Packet *pkt) const {
+    auto a = pkt->get_phv()->get_field(hdr, 0).get_uint();
+    return (a % 2 == 1) ? next_odd : next_even;
+  }
+
+  header_id_t hdr;
+  const ControlFlowNode *next_odd{nullptr};
+  const ControlFlowNode *next_even{nullptr};
+};
+
+}  // namespace
+
+// split -> odd / even -> join: the packets which take different branches are
+// merged again when they reach the same node
+TEST_F(PipelineBatchTest, CountBatches) {
+  CountingNode split("split", 10, testHeader);
+  CountingNode odd("odd", 11, testHeader);
+  CountingNode even("even", 12, testHeader);
+  CountingNode join("join", 13, testHeader);
+  split.set_next_nodes(&odd, &even);
+  odd.set_next_nodes(&join, &join);
+  even.set_next_nodes(&join, &join);
+  Pipeline counting_pipeline("counting", 1, &split);
+
+  std::vector<std::unique_ptr<Packet> > pkts;
+  std::vector<Packet *> batch;
+  for (unsigned int a : {1u, 2u, 3u, 4u, 5u, 7u, 8u}) {
+    pkts.push_back(get_pkt(pkts.size(), a));
+    batch.push_back(pkts.back().get());
+  }
+  // goes through none of the nodes
+  pkts[3]->mark_for_exit();
+  counting_pipeline.apply_batch(batch.data(), batch.size());
+
+  ASSERT_EQ(std::vector<size_t>({6u}), split.batch_sizes);
+  ASSERT_EQ(std::vector<size_t>({4u}), odd.batch_sizes);
+  ASSERT_EQ(std::vector<size_t>({2u}), even.batch_sizes);
+  ASSERT_EQ(std::vector<size_t>({6u}), join.batch_sizes);
+  for (const auto *node : {&split, &odd, &even, &join})
+    ASSERT_EQ(0u, node->single_calls);
+
+  // a burst of 1 packet still goes through apply_batch
+  counting_pipeline.apply_batch(batch.data(), 1);
+  ASSERT_EQ(std::vector<size_t>({6u, 1u}), split.batch_sizes);
+  ASSERT_EQ(std::vector<size_t>({4u, 1u}), odd.batch_sizes);
+  ASSERT_EQ(std::vector<size_t>({2u}), even.batch_sizes);
+  ASSERT_EQ(std::vector<size_t>({6u, 1u}), join.batch_sizes);
+}
+
+TEST_F(PipelineBatchTest, Groups) {
+  add_entry(t1.get(), &set_b, 1, 200);
+  add_entry(t1.get(), &set_b, 2, 50);
+  add_entry(t2.get(), &set_c, 200, 7);
+  ActionData default_data;
+  default_data.push_back_action_data(9);
+  ASSERT_EQ(MatchErrorCode::SUCCESS,
+            get_mt(t3.get())->set_default_action(&set_c,
+                                                 std::move(default_data)));
+
+  // 1 -> t1, cond, t2; 2 -> t1, cond, t3; 3 -> t1, t3
+  std::vector<std::unique_ptr<Packet> > pkts;
+  std::vector<Packet *> batch;
+  for (unsigned int a : {1u, 2u, 3u, 2u, 1u}) {
+    pkts.push_back(get_pkt(pkts.size(), a));
+    batch.push_back(pkts.back().get());
+  }
+  pipeline->apply_batch(batch.data(), batch.size());
+  const std::vector<unsigned int> expected_c = {7, 9, 9, 9, 7};
+  for (size_t i = 0; i < pkts.size(); i++) {
+    ASSERT_EQ(expected_c[i],
+              pkts[i]->get_phv()->get_field(testHeader, 2).get_uint());
+  }
+  ASSERT_EQ(0u, pkts[2]->get_phv()->get_field(testHeader, 1).get_uint());
+}
@@ -21,7 +21,12 @@
 #include <gtest/gtest.h>
 #include <bm/bm_sim/simple_pre.h>
 #include <bm/bm_sim/simple_pre_lag.h>
+#include <atomic>
 #include <bitset>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
 
 using namespace bm;
 
@@ -360,3 +365,201 @@ TEST(McSimplePreLAG, ResetState) {
   auto mc_out_3 = pre.replicate({1});
   ASSERT_EQ(0u, mc_out_3.size());
 }
+
+TEST(McSimplePre, ReplicateCallback) {
+  McSimplePre pre;
+  McSimplePre::mgrp_hdl_t mgrp;
+  McSimplePre::l1_hdl_t l1h_1, l1h_2;
+  typedef std::vector<std::pair<McSimplePre::rid_t,
+                                McSimplePre::egress_port_t> > Copies;
+  auto get_copies = [&pre](McSimplePre::mgrp_t mgid) {
+    Copies copies;
+    auto count = pre.replicate({mgid}, [&copies](const McSimplePre::McOut &o) {
+        copies.emplace_back(o.rid, o.egress_port); });
+    EXPECT_EQ(copies.size(), count);
+    return copies;
+  };
+
+  ASSERT_TRUE(get_copies(1).empty());
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_create(1, &mgrp));
+  ASSERT_TRUE(get_copies(1).empty());
+
+  McSimplePre::PortMap port_map_1, port_map_2;
+  port_map_1[1] = 1;
+  port_map_1[3] = 1;
+  port_map_2[2] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_create(10, port_map_1, &l1h_1));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_create(20, port_map_2, &l1h_2));
+  // nodes which are not associated with the group are not replicated to
+  ASSERT_TRUE(get_copies(1).empty());
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp, l1h_1));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp, l1h_2));
+  ASSERT_EQ(Copies({{10, 1}, {10, 3}, {20, 2}}), get_copies(1));
+
+  port_map_2[4] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_update(l1h_2, port_map_2));
+  ASSERT_EQ(Copies({{10, 1}, {10, 3}, {20, 2}, {20, 4}}), get_copies(1));
+
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_dissociate(mgrp, l1h_1));
+  ASSERT_EQ(Copies({{20, 2}, {20, 4}}), get_copies(1));
+  // destroying a node which is still associated
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_destroy(l1h_2));
+  ASSERT_TRUE(get_copies(1).empty());
+
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp, l1h_1));
+  ASSERT_EQ(Copies({{10, 1}, {10, 3}}), get_copies(1));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_destroy(mgrp));
+  ASSERT_TRUE(get_copies(1).empty());
+}
+
+// the data path threads replicate while the group is being modified: each
+// call must see one version of the group or the other, never a mix, and the
+// previous versions must not be freed while they are in use
+TEST(McSimplePre, ReplicateConcurrentUpdates) {
+  McSimplePre pre;
+  McSimplePre::mgrp_hdl_t mgrp;
+  McSimplePre::l1_hdl_t l1h;
+  McSimplePre::PortMap port_map_1, port_map_2;
+  port_map_1[1] = 1;
+  port_map_1[2] = 1;
+  port_map_2[3] = 1;
+  port_map_2[4] = 1;
+  port_map_2[5] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_create(1, &mgrp));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_create(10, port_map_1, &l1h));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp, l1h));
+
+  std::atomic<bool> done{false};
+  std::atomic<bool> mixed{false};
+  auto reader = [&pre, &done, &mixed]() {
+    const std::vector<McSimplePre::egress_port_t> v1({1, 2}), v2({3, 4, 5});
+    std::vector<McSimplePre::egress_port_t> ports;
+    while (!done) {
+      ports.clear();
+      pre.replicate({1}, [&ports](const McSimplePre::McOut &o) {
+          ports.push_back(o.egress_port); });
+      if (ports != v1 && ports != v2) mixed = true;
+    }
+  };
+  std::thread t1(reader), t2(reader);
+  for (int i = 0; i < 1000; i++) {
+    EXPECT_EQ(McSimplePre::SUCCESS,
+              pre.mc_node_update(l1h, (i % 2 == 0) ? port_map_2 : port_map_1));
+  }
+  done = true;
+  t1.join();
+  t2.join();
+  ASSERT_FALSE(mixed);
+}
+
+TEST(McSimplePreLAG, ReplicateLagMembershipUpdate) {
+  McSimplePreLAG pre;
+  McSimplePreLAG::mgrp_hdl_t mgrp;
+  McSimplePreLAG::l1_hdl_t l1h;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_create(1, &mgrp));
+  McSimplePreLAG::LagMap lag_map;
+  lag_map[2] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_create(0, {}, lag_map, &l1h));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp, l1h));
+  // LAG 2 has no members yet
+  ASSERT_EQ(0u, pre.replicate({1}).size());
+
+  McSimplePreLAG::PortMap port_map;
+  port_map[5] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_lag_membership(2, port_map));
+  auto mc_out = pre.replicate({1});
+  ASSERT_EQ(1u, mc_out.size());
+  ASSERT_EQ(5u, mc_out[0].egress_port);
+
+  port_map[5] = 0;
+  port_map[7] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_lag_membership(2, port_map));
+  mc_out = pre.replicate({1});
+  ASSERT_EQ(1u, mc_out.size());
+  ASSERT_EQ(7u, mc_out[0].egress_port);
+}
+
+TEST(McSimplePreLAG, LagMemberSelection) {
+  McSimplePreLAG pre;
+  McSimplePreLAG::mgrp_hdl_t mgrp;
+  McSimplePreLAG::l1_hdl_t l1h;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_mgrp_create(1, &mgrp));
+  McSimplePreLAG::LagMap lag_map;
+  lag_map[0] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_create(0, {}, lag_map, &l1h));
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_node_associate(mgrp, l1h));
+  McSimplePreLAG::PortMap members;
+  for (auto port : {1, 2, 3, 4}) members[port] = 1;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_lag_membership(0, members));
+
+  typedef std::vector<McSimplePre::egress_port_t> Selection;
+  auto get_selection = [&pre]() {
+    Selection selection;
+    for (uint64_t hash = 0; hash < McSimplePreLAG::LAG_BUCKETS; hash++) {
+      auto count = pre.replicate(
+          {1}, hash, [&selection](const McSimplePre::McOut &out) {
+            selection.push_back(out.egress_port); });
+      EXPECT_EQ(1u, count);
+    }
+    return selection;
+  };
+  auto get_counts = [](const Selection &selection) {
+    std::map<McSimplePre::egress_port_t, size_t> counts;
+    for (auto port : selection) counts[port]++;
+    return counts;
+  };
+
+  const auto selection_1 = get_selection();
+  ASSERT_EQ(McSimplePreLAG::LAG_BUCKETS, selection_1.size());
+  ASSERT_EQ(4u, get_counts(selection_1).size());
+  for (const auto &p : get_counts(selection_1)) ASSERT_EQ(64u, p.second);
+  // the selection only depends on the hash
+  ASSERT_EQ(selection_1, get_selection());
+
+  // only the flows mapped to port 3 are remapped when it goes down
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_port_status(3, false));
+  const auto selection_2 = get_selection();
+  for (size_t i = 0; i < selection_1.size(); i++) {
+    if (selection_1[i] == 3) {
+      ASSERT_NE(3u, selection_2[i]);
+    } else {
+      ASSERT_EQ(selection_1[i], selection_2[i]);
+    }
+  }
+  for (const auto &p : get_counts(selection_2)) {
+    ASSERT_LE(85u, p.second);
+    ASSERT_GE(86u, p.second);
+  }
+
+  // when the port comes back up, it takes back its share from other members,
+  // and the other flows are not remapped
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_port_status(3, true));
+  const auto selection_3 = get_selection();
+  size_t remapped = 0;
+  for (size_t i = 0; i < selection_2.size(); i++) {
+    if (selection_2[i] == selection_3[i]) continue;
+    ASSERT_EQ(3u, selection_3[i]);
+    remapped++;
+  }
+  ASSERT_EQ(64u, remapped);
+  for (const auto &p : get_counts(selection_3)) ASSERT_EQ(64u, p.second);
+
+  // same thing when a member is removed from the LAG
+  members[2] = 0;
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_lag_membership(0, members));
+  const auto selection_4 = get_selection();
+  ASSERT_EQ(3u, get_counts(selection_4).size());
+  for (size_t i = 0; i < selection_3.size(); i++) {
+    if (selection_3[i] == 2) continue;
+    ASSERT_EQ(selection_3[i], selection_4[i]);
+  }
+
+  // no copy if all the members are down
+  for (auto port : {1, 3, 4})
+    ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_port_status(port, false));
+  ASSERT_EQ(0u, pre.replicate({1}).size());
+  ASSERT_EQ(McSimplePre::SUCCESS, pre.mc_set_port_status(4, true));
+  auto mc_out = pre.replicate({1});
+  ASSERT_EQ(1u, mc_out.size());
+  ASSERT_EQ(4u, mc_out[0].egress_port);
+}
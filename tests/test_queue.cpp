@@ -83,6 +83,26 @@ TEST_P(QueueTest, ProducerConsumer) {
 }
 
 
+TEST(Queue, TryPushFront) {
+  Queue<unique_ptr<int> > queue(2);
+  for (int i = 0; i < 2; i++)
+    ASSERT_TRUE(queue.try_push_front(unique_ptr<int>(new int(i))));
+  unique_ptr<int> item(new int(2));
+  ASSERT_FALSE(queue.try_push_front(std::move(item)));
+  // the item was not moved from
+  ASSERT_NE(nullptr, item);
+  ASSERT_EQ(2u, queue.size());
+  unique_ptr<int> value;
+  queue.pop_back(&value);
+  ASSERT_EQ(0, *value);
+  ASSERT_TRUE(queue.try_push_front(std::move(item)));
+  ASSERT_EQ(nullptr, item);
+  queue.pop_back(&value);
+  ASSERT_EQ(1, *value);
+  queue.pop_back(&value);
+  ASSERT_EQ(2, *value);
+}
+
 INSTANTIATE_TEST_CASE_P(TestParameters,
                         QueueTest,
                         Combine(Values(16, 1024, 20000),
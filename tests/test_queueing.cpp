@@ -321,3 +321,51 @@ TEST_F(QueueingPriRLTest, PriRateLimiter) {
 
   ASSERT_LT(diff, std::max(priority_0, priority_1) * 0.1);
 }
+
+TEST_F(QueueingRLTest, TryPopBack) {
+  using clock = QueueingLogicRL<T, WorkerMapper>::clock;
+  size_t queue_id;
+  unique_ptr<int> v;
+  clock::time_point next;
+
+  ASSERT_EQ(0, queue.try_pop_back(0u, &queue_id, &v, &next));
+  ASSERT_EQ(clock::time_point::max(), next);
+
+  // elements are released by the rate limiter every 1 / pps seconds
+  queue.push_front(0u, unique_ptr<int>(new int(1)));
+  queue.push_front(0u, unique_ptr<int>(new int(2)));
+  clock::time_point released[2];
+  for (int i = 0; i < 2; i++) {
+    while (queue.try_pop_back(0u, &queue_id, &v, &next) == 0) {
+      ASSERT_NE(clock::time_point::max(), next);
+      std::this_thread::sleep_until(next);
+    }
+    released[i] = clock::now();
+    ASSERT_EQ(0u, queue_id);
+    ASSERT_EQ(i + 1, *v);
+  }
+  ASSERT_GE(released[1] - released[0],
+            std::chrono::milliseconds(1000 / pps) / 2);
+  ASSERT_EQ(0u, queue.size(0u));
+}
+
+TEST_F(QueueingPriRLTest, TryPopBack) {
+  using clock = QueueingLogicPriRL<T, WorkerMapper>::clock;
+  size_t queue_id, priority;
+  unique_ptr<int> v;
+  clock::time_point next;
+
+  ASSERT_EQ(0, queue.try_pop_back(0u, &queue_id, &priority, &v, &next));
+  ASSERT_EQ(clock::time_point::max(), next);
+
+  queue.push_front(0u, 1u, unique_ptr<int>(new int(1)));
+  queue.push_front(0u, 0u, unique_ptr<int>(new int(0)));
+  ASSERT_EQ(1, queue.try_pop_back(0u, &queue_id, &priority, &v, &next));
+  ASSERT_EQ(0u, priority);
+  ASSERT_EQ(0, *v);
+  ASSERT_EQ(1, queue.try_pop_back(0u, &queue_id, &priority, &v, &next));
+  ASSERT_EQ(1u, priority);
+  ASSERT_EQ(1, *v);
+  ASSERT_EQ(0, queue.try_pop_back(0u, &queue_id, &priority, &v, &next));
+  ASSERT_EQ(0u, queue.size(0u));
+}
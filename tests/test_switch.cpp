@@ -20,8 +20,13 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 #include <vector>
 #include <string>
 
@@ -172,3 +177,186 @@ TEST(Switch, ForceArithHeader) {
   ASSERT_TRUE(pkt.get_phv()->get_field("hdr.f2").get_arith_flag());
   ASSERT_TRUE(pkt.get_phv()->get_field("hdr.f3").get_arith_flag());
 }
+
+class SwitchWContextsTest : public SwitchWContexts {
+ public:
+  SwitchWContextsTest()
+      : SwitchWContexts(2u) { }
+
+  int receive(int port_num, const char *buffer, int len) override {
+    (void) port_num; (void) buffer; (void) len;
+    return 0;
+  }
+
+  void start_and_return() override {
+  }
+};
+
+TEST(Switch, ContextWorkers) {
+  fs::path config_path = fs::path(TESTDATADIR) / fs::path("one_header.json");
+  const size_t nb_packets = 1000;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<const char *> buffers(nb_packets);
+  std::vector<packet_id_t> received;
+  bool wrong_context = false;
+  bool copied = false;
+  // declared last, so that the workers are stopped first
+  SwitchWContextsTest sw;
+  sw.init_objects(config_path.string(), 0, nullptr);
+
+  ASSERT_EQ(1, sw.start_context_workers(2u, 1u, nb_packets, nullptr));
+  // the last stage records the packets
+  ASSERT_EQ(0, sw.start_context_workers(
+      1u, 1u, nb_packets, [&](std::unique_ptr<Packet> packet) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (packet->get_context() != 1u) wrong_context = true;
+        if (packet->data() != buffers[packet->get_packet_id()]) copied = true;
+        received.push_back(packet->get_packet_id());
+        cv.notify_one();
+      }));
+  // the first stage hands the packets off to the second one
+  ASSERT_EQ(0, sw.start_context_workers(
+      0u, 1u, nb_packets, [&sw](std::unique_ptr<Packet> packet) {
+        sw.hand_off_to_context(1u, std::move(packet));
+      }));
+  ASSERT_EQ(1, sw.start_context_workers(0u, 1u, nb_packets, nullptr));
+
+  for (packet_id_t id = 0; id < nb_packets; id++) {
+    auto packet = sw.new_packet_ptr(0u, 0, id, 64, PacketBuffer(128));
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      buffers[id] = packet->data();
+    }
+    ASSERT_EQ(0, sw.hand_off_to_context(0u, std::move(packet)));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  ASSERT_TRUE(cv.wait_for(lock, std::chrono::seconds(5), [&] {
+        return received.size() == nb_packets; }));
+  ASSERT_FALSE(wrong_context);
+  ASSERT_FALSE(copied);
+  // with a single worker per context, the order is preserved
+  for (packet_id_t id = 0; id < nb_packets; id++)
+    ASSERT_EQ(id, received[id]);
+}
+
+TEST(Switch, ContextWorkersNotStarted) {
+  fs::path config_path = fs::path(TESTDATADIR) / fs::path("one_header.json");
+  SwitchWContextsTest sw;
+  sw.init_objects(config_path.string(), 0, nullptr);
+  // the packet is dropped instead of being handed off to missing workers
+  ASSERT_EQ(1, sw.hand_off_to_context(
+      1u, sw.new_packet_ptr(0u, 0, 0, 64, PacketBuffer(128))));
+  ASSERT_EQ(1, sw.hand_off_to_context(
+      2u, sw.new_packet_ptr(0u, 0, 1, 64, PacketBuffer(128))));
+  ASSERT_EQ(0, sw.start_context_workers(
+      1u, 1u, 4u, [](std::unique_ptr<Packet>) { }));
+  ASSERT_EQ(0, sw.hand_off_to_context(
+      1u, sw.new_packet_ptr(0u, 0, 2, 64, PacketBuffer(128))));
+}
+
+TEST(Switch, ContextWorkersFull) {
+  fs::path config_path = fs::path(TESTDATADIR) / fs::path("one_header.json");
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool release = false;
+  SwitchWContextsTest sw;
+  sw.init_objects(config_path.string(), 0, nullptr);
+
+  // the worker is blocked until we release it, so the queue fills up
+  ASSERT_EQ(0, sw.start_context_workers(
+      0u, 1u, 4u, [&](std::unique_ptr<Packet> packet) {
+        (void) packet;
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&release] { return release; });
+      }));
+  size_t accepted = 0;
+  for (packet_id_t id = 0; id < 16; id++) {
+    if (sw.hand_off_to_context(
+            0u, sw.new_packet_ptr(0u, 0, id, 64, PacketBuffer(128))) == 0)
+      accepted++;
+  }
+  // 4 queued packets, and possibly 1 being processed
+  ASSERT_LE(4u, accepted);
+  ASSERT_GE(5u, accepted);
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    release = true;
+  }
+  cv.notify_all();
+}
+
+namespace {
+
+struct WorkersState {
+  std::atomic<bool> started{false};
+  bool destroyed{false};
+  bool used_after_destroy{false};
+};
+
+// the handler uses a member of the derived class, like a real target would
+class SwitchWContextsWorkers : public SwitchWContextsTest {
+ public:
+  explicit SwitchWContextsWorkers(WorkersState *state)
+      : state(state) {
+    start_context_workers(0u, 1u, 1024u, [this](std::unique_ptr<Packet>) {
+        this->state->started = true;
+        // long enough for the switch to be destroyed in the meantime
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (this->state->destroyed) this->state->used_after_destroy = true;
+        processed++;
+      });
+  }
+
+  ~SwitchWContextsWorkers() {
+    stop_context_workers();
+    state->destroyed = true;
+  }
+
+  size_t get_processed() const { return processed; }
+
+ private:
+  WorkersState *state;
+  std::atomic<size_t> processed{0};
+};
+
+}  // namespace
+
+TEST(Switch, ContextWorkersStop) {
+  fs::path config_path = fs::path(TESTDATADIR) / fs::path("one_header.json");
+  const size_t nb_packets = 100;
+  WorkersState state;
+  SwitchWContextsWorkers sw(&state);
+  sw.init_objects(config_path.string(), 0, nullptr);
+  for (packet_id_t id = 0; id < nb_packets; id++) {
+    ASSERT_EQ(0, sw.hand_off_to_context(
+        0u, sw.new_packet_ptr(0u, 0, id, 64, PacketBuffer(128))));
+  }
+  sw.stop_context_workers();
+  const size_t processed = sw.get_processed();
+  // the remaining packets were discarded
+  ASSERT_GT(nb_packets, processed);
+  ASSERT_EQ(1, sw.hand_off_to_context(
+      0u, sw.new_packet_ptr(0u, 0, 0, 64, PacketBuffer(128))));
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  ASSERT_EQ(processed, sw.get_processed());
+}
+
+// the switch is destroyed while a packet is being processed and others are
+// still queued
+TEST(Switch, ContextWorkersDestroy) {
+  fs::path config_path = fs::path(TESTDATADIR) / fs::path("one_header.json");
+  WorkersState state;
+  {
+    SwitchWContextsWorkers sw(&state);
+    sw.init_objects(config_path.string(), 0, nullptr);
+    for (packet_id_t id = 0; id < 100; id++) {
+      ASSERT_EQ(0, sw.hand_off_to_context(
+          0u, sw.new_packet_ptr(0u, 0, id, 64, PacketBuffer(128))));
+    }
+    while (!state.started) std::this_thread::yield();
+  }
+  ASSERT_TRUE(state.destroyed);
+  ASSERT_FALSE(state.used_after_destroy);
+}
@@ -25,8 +25,11 @@
 #include <thread>
 #include <future>
 #include <limits>
+#include <vector>
 #include <bm/bm_sim/tables.h>
 
+#include "utils.h"
+
 using namespace bm;
 
 using testing::Types;
@@ -353,6 +356,20 @@ TYPED_TEST(TableSizeTwo, DeleteEntryHandleUpdate) {
   ASSERT_EQ(MatchErrorCode::EXPIRED_HANDLE, rc);
 }
 
+// the version in the handle wraps around
+TYPED_TEST(TableSizeTwo, DeleteEntryHandleReuse) {
+  std::string key_ = "\xaa\xaa";
+  entry_handle_t handle;
+  MatchErrorCode rc;
+
+  for (int i = 0; i < 300; i++) {
+    rc = this->add_entry(key_, &handle);
+    ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+    rc = this->table->delete_entry(handle);
+    ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  }
+}
+
 TYPED_TEST(TableSizeTwo, LookupEntry) {
   std::string key_ = "\x0a\xba";
   ByteContainer key("0x0aba");
@@ -804,6 +821,141 @@ TYPED_TEST(TableSizeTwo, GetEntries) {
   }
 }
 
+TYPED_TEST(TableSizeTwo, GetEntriesSince) {
+  MatchErrorCode rc;
+  entry_handle_t handle_1, handle_2;
+  typename MatchTable::Changes changes;
+
+  const auto seq_0 = this->table->get_change_seq();
+  ASSERT_EQ(0u, seq_0);
+  rc = this->table->get_entries_since(seq_0, &changes);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  ASSERT_TRUE(changes.entries.empty());
+  ASSERT_EQ(seq_0, changes.last_seq);
+
+  rc = this->add_entry("\x0a\xba", &handle_1);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = this->add_entry("\x12\x34", &handle_2);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  const auto seq_1 = this->table->get_change_seq();
+  ASSERT_EQ(2u, seq_1);
+
+  ActionData action_data;
+  action_data.push_back_action_data(0xaba);
+  rc = this->table->modify_entry(handle_1, &this->action_fn,
+                                 std::move(action_data));
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = this->table->delete_entry(handle_2);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = this->table->set_default_action(&this->action_fn, ActionData());
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  // failed operations are not recorded
+  rc = this->table->delete_entry(handle_2);
+  ASSERT_NE(MatchErrorCode::SUCCESS, rc);
+
+  // from the beginning: handle_2 was added and deleted, so it only appears as
+  // deleted
+  changes = {};
+  rc = this->table->get_entries_since(seq_0, &changes);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  ASSERT_EQ(1u, changes.entries.size());
+  ASSERT_EQ(handle_1, changes.entries[0].handle);
+  ASSERT_EQ(1u, changes.entries[0].action_data.size());
+  ASSERT_EQ(std::vector<entry_handle_t>({handle_2}), changes.deleted);
+  ASSERT_TRUE(changes.default_entry_changed);
+  ASSERT_EQ(5u, changes.last_seq);
+
+  changes = {};
+  rc = this->table->get_entries_since(seq_1, &changes);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  ASSERT_EQ(1u, changes.entries.size());
+  ASSERT_EQ(1u, changes.deleted.size());
+
+  // in the future
+  rc = this->table->get_entries_since(6u, &changes);
+  ASSERT_EQ(MatchErrorCode::CHANGES_UNAVAILABLE, rc);
+
+  // up-to-date
+  changes = {};
+  rc = this->table->get_entries_since(5u, &changes);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  ASSERT_TRUE(changes.entries.empty());
+  ASSERT_TRUE(changes.deleted.empty());
+  ASSERT_FALSE(changes.default_entry_changed);
+  ASSERT_EQ(5u, changes.last_seq);
+
+  // sequence numbers keep increasing after a reset, but the client has to
+  // resynchronize
+  this->table->reset_state();
+  ASSERT_EQ(5u, this->table->get_change_seq());
+  rc = this->table->get_entries_since(seq_1, &changes);
+  ASSERT_EQ(MatchErrorCode::CHANGES_UNAVAILABLE, rc);
+  rc = this->add_entry("\x0a\xba", &handle_1);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  changes = {};
+  rc = this->table->get_entries_since(5u, &changes);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  ASSERT_EQ(1u, changes.entries.size());
+  ASSERT_EQ(6u, changes.last_seq);
+}
+
+TEST(TableChangeLog, Ring) {
+  typedef TableChangeLog::ChangeType ChangeType;
+  TableChangeLog log(4);
+  std::vector<TableChangeLog::Record> records;
+
+  ASSERT_TRUE(log.get_since(0, &records));
+  ASSERT_TRUE(records.empty());
+  // in the future
+  ASSERT_FALSE(log.get_since(1, &records));
+
+  for (entry_handle_t h = 0; h < 6; h++)
+    ASSERT_EQ(h + 1, log.log(ChangeType::ADD, h));
+  ASSERT_EQ(6u, log.get_last_seq());
+
+  // the first 2 changes have been overwritten
+  ASSERT_FALSE(log.get_since(0, &records));
+  ASSERT_FALSE(log.get_since(1, &records));
+  ASSERT_TRUE(records.empty());
+  ASSERT_TRUE(log.get_since(2, &records));
+  ASSERT_EQ(4u, records.size());
+  for (size_t i = 0; i < records.size(); i++) {
+    ASSERT_EQ(i + 3, records[i].seq);
+    ASSERT_EQ(i + 2, records[i].handle);
+  }
+
+  log.reset();
+  records.clear();
+  ASSERT_FALSE(log.get_since(5, &records));
+  ASSERT_TRUE(log.get_since(6, &records));
+  ASSERT_TRUE(records.empty());
+}
+
+TEST(TableChangeLog, Notifications) {
+  typedef TableChangeLog::ChangeType ChangeType;
+  std::shared_ptr<MemoryAccessor> writer(new MemoryAccessor(1024));
+  TableChangeLog log;
+  log.set_notifications(writer, 1, 2, 3);
+  // one notification per change, MemoryAccessor can only hold one
+  std::thread logger([&log] {
+    log.log(ChangeType::ADD, 11);
+    log.log(ChangeType::DELETE, 11);
+  });
+
+  TableChangeLog::msg_hdr_t msg_hdr;
+  for (uint64_t seq = 1; seq <= 2; seq++) {
+    writer->read(reinterpret_cast<char *>(&msg_hdr), sizeof(msg_hdr));
+    ASSERT_EQ(0, memcmp("TBL|", msg_hdr.sub_topic, 4));
+    ASSERT_EQ(1, msg_hdr.switch_id);
+    ASSERT_EQ(2, msg_hdr.cxt_id);
+    ASSERT_EQ(3, msg_hdr.table_id);
+    ASSERT_EQ(seq, msg_hdr.seq);
+    ASSERT_EQ(11u, msg_hdr.handle);
+  }
+  ASSERT_EQ(static_cast<unsigned int>(ChangeType::DELETE), msg_hdr.type);
+  logger.join();
+}
+
 
 class TableIndirect : public ::testing::Test {
  protected:
@@ -1200,6 +1352,52 @@ TEST_F(TableIndirect, GetEntries) {
   }
 }
 
+TEST_F(TableIndirect, GetEntriesPage) {
+  MatchErrorCode rc;
+  std::vector<mbr_hdl_t> mbrs;
+  std::vector<entry_handle_t> handles;
+
+  size_t num_mbrs = 16;
+  for (size_t m = 0; m < num_mbrs; m++) {
+    mbrs.push_back(0);
+    rc = add_member(m, &mbrs.back());
+    ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  }
+
+  size_t num_entries = 64;
+  for (size_t e = 0; e < num_entries; e++) {
+    handles.push_back(0);
+    rc = add_entry(std::string(2, static_cast<char>(e + 1)),
+                   mbrs[e % num_mbrs], &handles.back());
+    ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  }
+  // deleting an entry after its page was retrieved does not affect the dump
+  std::vector<MatchTableIndirect::Entry> entries;
+  size_t cursor = table->get_entries_page(0, 10, &entries);
+  ASSERT_EQ(10u, entries.size());
+  rc = table->delete_entry(handles[0]);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  size_t nb_pages = 1;
+  while (cursor != 0) {
+    cursor = table->get_entries_page(cursor, 10, &entries);
+    nb_pages++;
+  }
+  ASSERT_EQ(7u, nb_pages);
+  ASSERT_EQ(num_entries, entries.size());
+  for (size_t i = 0; i < num_entries; i++) {
+    ASSERT_EQ(handles[i], entries[i].handle);
+    ASSERT_EQ(mbrs[i % num_mbrs], entries[i].mbr);
+  }
+
+  std::vector<MatchTableIndirect::Member> members;
+  cursor = 0;
+  do {
+    cursor = table->get_members_page(cursor, 5, &members);
+  } while (cursor != 0);
+  ASSERT_EQ(num_mbrs, members.size());
+  for (size_t i = 0; i < num_mbrs; i++) ASSERT_EQ(mbrs[i], members[i].mbr);
+}
+
 
 class TableIndirectWS : public ::testing::Test {
  protected:
@@ -1394,6 +1592,43 @@ TEST_F(TableIndirectWS, EntryWS) {
   ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
 }
 
+TEST_F(TableIndirectWS, GetEntriesSince) {
+  MatchErrorCode rc;
+  grp_hdl_t grp;
+  mbr_hdl_t mbr;
+  entry_handle_t handle_1, handle_2;
+  MatchTableIndirectWS::Changes changes;
+
+  rc = add_member(666u, &mbr);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = table->create_group(&grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = table->add_member_to_group(mbr, grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  // changes to members and groups are not recorded
+  ASSERT_EQ(0u, table->get_change_seq());
+
+  rc = add_entry("\x0a\xba", mbr, &handle_1);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  const auto seq = table->get_change_seq();
+  rc = add_entry_ws("\x0a\xbb", grp, &handle_2);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = table->modify_entry_ws(handle_1, grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  rc = table->set_default_group(grp);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+
+  rc = table->get_entries_since(seq, &changes);
+  ASSERT_EQ(MatchErrorCode::SUCCESS, rc);
+  ASSERT_EQ(2u, changes.entries.size());
+  ASSERT_EQ(handle_2, changes.entries[0].handle);
+  ASSERT_EQ(handle_1, changes.entries[1].handle);
+  for (const auto &e : changes.entries) ASSERT_EQ(grp, e.grp);
+  ASSERT_TRUE(changes.deleted.empty());
+  ASSERT_TRUE(changes.default_entry_changed);
+  ASSERT_EQ(4u, changes.last_seq);
+}
+
 TEST_F(TableIndirectWS, LookupEntryWS) {
   MatchErrorCode rc;
   grp_hdl_t grp;
@@ -2684,3 +2919,127 @@ TEST_F(TableRangeMatch, TwoRanges) {
   check_one(1, 1, false);
   // TODO(antonin): more checks?
 }
+
+namespace {
+
+class LookupStructureFactoryTest : public LookupStructureFactory {
+ public:
+  using LookupStructureFactory::use_direct_lookup;
+};
+
+}  // namespace
+
+TEST(LookupStructures, DirectIndexedMinSize) {
+  LookupStructureFactoryTest factory;
+  const size_t min_fill = LookupStructureFactory::direct_min_fill;
+  // a small table does not get 2^bits slots
+  ASSERT_FALSE(factory.use_direct_lookup(1u, 2u));
+  ASSERT_FALSE(factory.use_direct_lookup((1u << 16) / min_fill - 1, 2u));
+  ASSERT_TRUE(factory.use_direct_lookup((1u << 16) / min_fill, 2u));
+  ASSERT_FALSE(factory.use_direct_lookup((1u << 8) / min_fill - 1, 1u));
+  ASSERT_TRUE(factory.use_direct_lookup((1u << 8) / min_fill, 1u));
+  // tables without a key
+  ASSERT_TRUE(factory.use_direct_lookup(1u, 0u));
+  // the key width is checked first
+  ASSERT_FALSE(factory.use_direct_lookup(1u << 24, 3u));
+}
+
+// compares the direct-indexed lookup structures used for small keys with the
+// generic ones
+TEST(LookupStructures, DirectIndexed) {
+  // the smallest table for which a 16-bit key uses the direct structures
+  const size_t t_size = (1u << 16) / LookupStructureFactory::direct_min_fill;
+  // only the first handles are used, so that we run out of free handles
+  const size_t nb_handles = 64u;
+  const size_t nbytes_key = 2u;
+  LookupStructureFactoryTest direct_factory;
+  LookupStructureFactory generic_factory;
+  generic_factory.set_direct_max_bits(0);
+  ASSERT_TRUE(direct_factory.use_direct_lookup(t_size, nbytes_key));
+
+  auto ternary_direct = direct_factory.create_for_ternary(t_size, nbytes_key);
+  auto ternary_generic = generic_factory.create_for_ternary(t_size, nbytes_key);
+  auto exact_direct = direct_factory.create_for_exact(t_size, nbytes_key);
+  auto exact_generic = generic_factory.create_for_exact(t_size, nbytes_key);
+
+  auto to_bytes = [](uint16_t v) {
+    const char bytes[2] = {static_cast<char>(v >> 8), static_cast<char>(v)};
+    return ByteContainer(bytes, sizeof(bytes));
+  };
+
+  // the lookup structures may keep pointers to the keys
+  std::vector<TernaryMatchKey> ternary_keys(nb_handles);
+  std::vector<ExactMatchKey> exact_keys(nb_handles);
+  std::vector<bool> used(nb_handles, false);
+
+  auto check_all = [&]() {
+    for (uint32_t v = 0; v < (1u << 16); v++) {
+      const ByteContainer key = to_bytes(v);
+      internal_handle_t h_direct, h_generic;
+      bool found_direct = ternary_direct->lookup(key, &h_direct);
+      bool found_generic = ternary_generic->lookup(key, &h_generic);
+      ASSERT_EQ(found_generic, found_direct);
+      if (found_generic) ASSERT_EQ(h_generic, h_direct);
+      found_direct = exact_direct->lookup(key, &h_direct);
+      found_generic = exact_generic->lookup(key, &h_generic);
+      ASSERT_EQ(found_generic, found_direct);
+      if (found_generic) ASSERT_EQ(h_generic, h_direct);
+    }
+  };
+
+  std::mt19937 gen(0);
+  // few distinct priorities, to test that ties are handled the same way
+  std::uniform_int_distribution<int> priority_dis(0, 3);
+  std::uniform_int_distribution<uint16_t> value_dis;
+  // few distinct masks, to have plenty of overlapping entries
+  const std::vector<uint16_t> masks = {0xffff, 0xff00, 0xf0f0, 0x00ff, 0x0000};
+  std::uniform_int_distribution<size_t> mask_dis(0, masks.size() - 1);
+
+  for (int round = 0; round < 8; round++) {
+    for (size_t i = 0; i < 32; i++) {
+      // match units always use the lowest free handle
+      size_t handle = 0;
+      while (handle < nb_handles && used[handle]) handle++;
+      if (handle == nb_handles) break;
+      const uint16_t mask = masks[mask_dis(gen)];
+      TernaryMatchKey ternary_key(to_bytes(value_dis(gen) & mask),
+                                  to_bytes(mask), priority_dis(gen), 0);
+      ExactMatchKey exact_key;
+      exact_key.data = to_bytes(value_dis(gen));
+      if (ternary_generic->entry_exists(ternary_key) ||
+          exact_generic->entry_exists(exact_key)) {
+        continue;
+      }
+      ASSERT_FALSE(ternary_direct->entry_exists(ternary_key));
+      ASSERT_FALSE(exact_direct->entry_exists(exact_key));
+      ternary_keys[handle] = std::move(ternary_key);
+      exact_keys[handle] = std::move(exact_key);
+      used[handle] = true;
+      ternary_direct->add_entry(ternary_keys[handle], handle);
+      ternary_generic->add_entry(ternary_keys[handle], handle);
+      exact_direct->add_entry(exact_keys[handle], handle);
+      exact_generic->add_entry(exact_keys[handle], handle);
+      ASSERT_TRUE(ternary_direct->entry_exists(ternary_keys[handle]));
+      ASSERT_TRUE(exact_direct->entry_exists(exact_keys[handle]));
+    }
+    check_all();
+
+    for (size_t handle = 0; handle < nb_handles; handle++) {
+      if (!used[handle] || (value_dis(gen) % 2 == 0)) continue;
+      used[handle] = false;
+      ternary_direct->delete_entry(ternary_keys[handle]);
+      ternary_generic->delete_entry(ternary_keys[handle]);
+      exact_direct->delete_entry(exact_keys[handle]);
+      exact_generic->delete_entry(exact_keys[handle]);
+      ASSERT_FALSE(ternary_direct->entry_exists(ternary_keys[handle]));
+      ASSERT_FALSE(exact_direct->entry_exists(exact_keys[handle]));
+    }
+    check_all();
+  }
+
+  ternary_direct->clear();
+  ternary_generic->clear();
+  exact_direct->clear();
+  exact_generic->clear();
+  check_all();
+}
@@ -0,0 +1,172 @@
+/* Copyright 2013-present Barefoot Networks, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <bm/bm_sim/thread_pool.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using bm::ThreadPool;
+
+namespace {
+
+// counts down to zero and lets the test wait for it
+class Latch {
+ public:
+  explicit Latch(int count)
+      : count(count) { }
+
+  void count_down() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (--count == 0) cv.notify_all();
+  }
+
+  bool wait(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, timeout, [this] { return count == 0; });
+  }
+
+ private:
+  int count;
+  std::mutex mutex{};
+  std::condition_variable cv{};
+};
+
+const std::chrono::milliseconds timeout(5000);
+
+}  // namespace
+
+TEST(ThreadPool, ManyTasks) {
+  ThreadPool pool(4);
+  ASSERT_EQ(4u, pool.get_nb_threads());
+  const int nb_tasks = 100000;
+  std::atomic<int> sum{0};
+  Latch latch(nb_tasks);
+  for (int i = 0; i < nb_tasks; i++) {
+    pool.post([i, &sum, &latch] {
+      sum += i % 7;
+      latch.count_down();
+    });
+  }
+  ASSERT_TRUE(latch.wait(timeout));
+  int expected = 0;
+  for (int i = 0; i < nb_tasks; i++) expected += i % 7;
+  ASSERT_EQ(expected, sum.load());
+}
+
+TEST(ThreadPool, TasksPostingTasks) {
+  const int depth = 10000;
+  Latch latch(1);
+  std::function<void(int)> chain;
+  // destroyed first, so that no task can outlive chain
+  ThreadPool pool(3);
+  chain = [&pool, &latch, &chain](int remaining) {
+    if (remaining == 0) {
+      latch.count_down();
+      return;
+    }
+    pool.post([&chain, remaining] { chain(remaining - 1); });
+  };
+  pool.post([&chain] { chain(depth); });
+  ASSERT_TRUE(latch.wait(timeout));
+}
+
+TEST(ThreadPool, Strands) {
+  const int nb_strands = 8;
+  const int nb_tasks = 10000;
+
+  struct StrandState {
+    explicit StrandState(ThreadPool *pool)
+        : strand(pool) { }
+
+    ThreadPool::Strand strand;
+    // only accessed from the strand, so no synchronization is needed
+    std::vector<int> values{};
+    std::atomic<int> running{0};
+    bool overlap{false};
+  };
+
+  std::vector<std::unique_ptr<StrandState> > states;
+  Latch latch(nb_strands * nb_tasks);
+  // destroyed first, a strand may still be running after its last task
+  ThreadPool pool(4);
+  for (int i = 0; i < nb_strands; i++)
+    states.emplace_back(new StrandState(&pool));
+
+  for (int v = 0; v < nb_tasks; v++) {
+    for (auto &state : states) {
+      auto *s = state.get();
+      s->strand.post([s, v, &latch] {
+        if (s->running.fetch_add(1) != 0) s->overlap = true;
+        s->values.push_back(v);
+        s->running.fetch_sub(1);
+        latch.count_down();
+      });
+    }
+  }
+  ASSERT_TRUE(latch.wait(timeout));
+
+  for (auto &state : states) {
+    ASSERT_FALSE(state->overlap);
+    ASSERT_EQ(static_cast<size_t>(nb_tasks), state->values.size());
+    for (int v = 0; v < nb_tasks; v++) ASSERT_EQ(v, state->values[v]);
+  }
+}
+
+TEST(ThreadPool, PostAfter) {
+  ThreadPool pool(2);
+  using clock = ThreadPool::clock;
+  const auto start = clock::now();
+  std::vector<clock::time_point> fired(3);
+  Latch latch(3);
+  // posted out of order on purpose
+  const int delays_ms[] = {50, 10, 30};
+  for (int i = 0; i < 3; i++) {
+    pool.post_after(std::chrono::milliseconds(delays_ms[i]),
+                    [i, &fired, &latch] {
+      fired[i] = clock::now();
+      latch.count_down();
+    });
+  }
+  ASSERT_TRUE(latch.wait(timeout));
+  for (int i = 0; i < 3; i++)
+    ASSERT_GE(fired[i] - start, std::chrono::milliseconds(delays_ms[i]));
+  ASSERT_LT(fired[1], fired[2]);
+  ASSERT_LT(fired[2], fired[0]);
+}
+
+TEST(ThreadPool, PostAfterWhileBusy) {
+  // the timer must fire even though the only worker never goes idle
+  std::atomic<bool> fired{false};
+  Latch latch(1);
+  std::function<void()> spin;
+  ThreadPool pool(1);
+  spin = [&pool, &fired, &spin] {
+    if (!fired) pool.post(spin);
+  };
+  pool.post(spin);
+  pool.post_after(std::chrono::milliseconds(10), [&fired, &latch] {
+    fired = true;
+    latch.count_down();
+  });
+  ASSERT_TRUE(latch.wait(timeout));
+}
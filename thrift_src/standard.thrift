@@ -113,6 +113,7 @@ enum TableOperationErrorCode {
   DEFAULT_ENTRY_IS_CONST = 21,
   NO_DEFAULT_ENTRY = 22,
   ERROR = 23,
+  CHANGES_UNAVAILABLE = 24,
 }
 
 exception InvalidTableOperation {
@@ -205,6 +206,17 @@ struct BmCrc32Config {
   5:bool remainder_reflected;
 }
 
+struct BmPacketTracingFieldMatch {
+  1:string field_name;
+  2:binary value;
+}
+
+struct BmPacketTracingConfig {
+  1:list<i32> ports;
+  2:i32 sampling_rate;
+  3:list<BmPacketTracingFieldMatch> field_matches;
+}
+
 enum CrcErrorCode {
   INVALID_CALCULATION_NAME = 1,
   WRONG_TYPE_CALCULATION = 2,
@@ -215,6 +227,34 @@ exception InvalidCrcOperation {
  1:CrcErrorCode code
 }
 
+enum PerfCountersErrorCode {
+  NOT_SUPPORTED = 1  // e.g. no PMU, or not allowed by perf_event_paranoid
+}
+
+exception InvalidPerfCountersOperation {
+ 1:PerfCountersErrorCode code,
+ 2:string info
+}
+
+enum BmPerfCountersObjectType {
+  PARSER = 0,
+  TABLE = 1,
+  CONDITIONAL = 2,
+  DEPARSER = 3
+}
+
+struct BmPerfCountersEntry {
+  1:i32 cxt_id;
+  2:BmPerfCountersObjectType type;
+  3:i32 id;
+  4:string name;
+  5:i64 samples;
+  6:i64 cycles;
+  7:i64 instructions;
+  8:i64 llc_misses;
+  9:i64 branch_misses;
+}
+
 enum BmActionEntryType {
   NONE = 0,  // used when querying default entry, if none configured
   ACTION_DATA = 1,
@@ -237,6 +277,15 @@ struct BmMtEntry {
  4:BmActionEntry action_entry
 }
 
+// changes made to a table since a given sequence number, see
+// bm_mt_get_entries_since
+struct BmMtChanges {
+ 1:list<BmMtEntry> entries,
+ 2:list<BmEntryHandle> deleted,
+ 3:bool default_entry_changed,
+ 4:i64 last_seq
+}
+
 struct BmMtIndirectMember {
  1:BmMemberHandle mbr_handle,
  2:string action_name,
@@ -248,6 +297,23 @@ struct BmMtIndirectWsGroup {
  2:list<BmMemberHandle> mbr_handles
 }
 
+// one page of a paginated dump, next_cursor is the cursor to provide to get the
+// next page, or 0 once the dump is complete
+struct BmMtEntriesPage {
+ 1:list<BmMtEntry> entries,
+ 2:i64 next_cursor
+}
+
+struct BmMtIndirectMembersPage {
+ 1:list<BmMtIndirectMember> members,
+ 2:i64 next_cursor
+}
+
+struct BmMtIndirectWsGroupsPage {
+ 1:list<BmMtIndirectWsGroup> groups,
+ 2:i64 next_cursor
+}
+
 struct BmConfig {
  1:i32 device_id,
  2:i32 thrift_port,
@@ -432,12 +498,38 @@ service Standard {
     2:string table_name
   ) throws (1:InvalidTableOperation ouch),
 
+  // paginated version of bm_mt_get_entries, for large tables: start with
+  // cursor 0 and call again with the returned next_cursor until it is 0; the
+  // table is only locked for the duration of each call
+  BmMtEntriesPage bm_mt_get_entries_page(
+    1:i32 cxt_id,
+    2:string table_name,
+    3:i64 cursor,
+    4:i32 max_entries
+  ) throws (1:InvalidTableOperation ouch),
+
   BmMtEntry bm_mt_get_entry(
     1:i32 cxt_id,
     2:string table_name,
     3:BmEntryHandle entry_handle
   ) throws (1:InvalidTableOperation ouch),
 
+  // sequence number of the last change made to the table entries; to mirror a
+  // table, read it before dumping the entries with bm_mt_get_entries, then
+  // poll bm_mt_get_entries_since (or listen to the "TBL|" notifications)
+  i64 bm_mt_get_change_seq(
+    1:i32 cxt_id,
+    2:string table_name
+  ) throws (1:InvalidTableOperation ouch),
+
+  // raises CHANGES_UNAVAILABLE if too many changes were made since seq, in
+  // which case the table needs to be dumped again
+  BmMtChanges bm_mt_get_entries_since(
+    1:i32 cxt_id,
+    2:string table_name,
+    3:i64 seq
+  ) throws (1:InvalidTableOperation ouch),
+
   BmActionEntry bm_mt_get_default_entry(
     1:i32 cxt_id,
     2:string table_name
@@ -448,6 +540,13 @@ service Standard {
     2:string table_name
   ) throws (1:InvalidTableOperation ouch),
 
+  BmMtIndirectMembersPage bm_mt_indirect_get_members_page(
+    1:i32 cxt_id,
+    2:string table_name,
+    3:i64 cursor,
+    4:i32 max_members
+  ) throws (1:InvalidTableOperation ouch),
+
   BmMtIndirectMember bm_mt_indirect_get_member(
     1:i32 cxt_id,
     2:string table_name,
@@ -459,6 +558,13 @@ service Standard {
     2:string table_name
   ) throws (1:InvalidTableOperation ouch),
 
+  BmMtIndirectWsGroupsPage bm_mt_indirect_ws_get_groups_page(
+    1:i32 cxt_id,
+    2:string table_name,
+    3:i64 cursor,
+    4:i32 max_groups
+  ) throws (1:InvalidTableOperation ouch),
+
   BmMtIndirectWsGroup bm_mt_indirect_ws_get_group(
     1:i32 cxt_id,
     2:string table_name,
@@ -598,6 +704,26 @@ service Standard {
 
   void bm_reset_state()
 
+  // only packets matching all the criteria in the config are traced; this is
+  // only useful if bmv2 was compiled without per-packet debug logging
+  void bm_enable_packet_tracing(
+    1:BmPacketTracingConfig config
+  )
+
+  void bm_disable_packet_tracing()
+
+  // hardware performance counters are read before and after each parser,
+  // table, conditional and deparser, for one in every sampling_rate packets
+  void bm_enable_perf_counters(
+    1:i32 sampling_rate
+  ) throws (1:InvalidPerfCountersOperation ouch)
+
+  void bm_disable_perf_counters()
+
+  void bm_reset_perf_counters()
+
+  list<BmPerfCountersEntry> bm_get_perf_counters()
+
   string bm_get_config()
   string bm_get_config_md5()
 
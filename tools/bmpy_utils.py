@@ -27,6 +27,7 @@ from thrift import Thrift
 from thrift.transport import TSocket
 from thrift.transport import TTransport
 from thrift.protocol import TBinaryProtocol
+from thrift.protocol import TCompactProtocol
 from thrift.protocol import TMultiplexedProtocol
 
 def check_JSON_md5(client, json_src, out=sys.stdout):
@@ -77,16 +78,28 @@ def get_json_config(standard_client=None, json_path=None, out=sys.stdout):
         return json_cfg
 
 # services is [(service_name, client_class), ...]
-def thrift_connect(thrift_ip, thrift_port, services, out=sys.stdout):
+# transport and protocol need to match the ones used by the switch: 'framed'
+# for a switch started with '--thrift-server nonblocking', and 'compact' for a
+# switch started with '--thrift-protocol compact'
+def thrift_connect(thrift_ip, thrift_port, services, out=sys.stdout,
+                   transport='buffered', protocol='binary'):
     def my_print(s):
         out.write(s)
 
+    transport_type, protocol_type = transport, protocol
+
     # Make socket
     transport = TSocket.TSocket(thrift_ip, thrift_port)
     # Buffering is critical. Raw sockets are very slow
-    transport = TTransport.TBufferedTransport(transport)
+    if transport_type == 'framed':
+        transport = TTransport.TFramedTransport(transport)
+    else:
+        transport = TTransport.TBufferedTransport(transport)
     # Wrap in a protocol
-    bprotocol = TBinaryProtocol.TBinaryProtocol(transport)
+    if protocol_type == 'compact':
+        bprotocol = TCompactProtocol.TCompactProtocol(transport)
+    else:
+        bprotocol = TBinaryProtocol.TBinaryProtocol(transport)
 
     clients = []
 
@@ -93,6 +93,17 @@ def get_parser():
     parser.add_argument('--pre', help='Packet Replication Engine used by target',
                         type=str, choices=['None', 'SimplePre', 'SimplePreLAG'],
                         default=PreType.SimplePre, action=ActionToPreType)
+
+    parser.add_argument('--thrift-transport',
+                        help='Thrift transport, use framed when the switch '
+                        'runs the nonblocking Thrift server',
+                        type=str, choices=['buffered', 'framed'],
+                        default='buffered', action="store")
+
+    parser.add_argument('--thrift-protocol',
+                        help='Thrift protocol, must match the switch',
+                        type=str, choices=['binary', 'compact'],
+                        default='binary', action="store")
     
     return parser
 
@@ -536,8 +547,10 @@ BmMatchParamValid.to_str = BmMatchParamValid_to_str
 BmMatchParamRange.to_str = BmMatchParamRange_to_str
 
 # services is [(service_name, client_class), ...]
-def thrift_connect(thrift_ip, thrift_port, services):
-    return utils.thrift_connect(thrift_ip, thrift_port, services)
+def thrift_connect(thrift_ip, thrift_port, services,
+                   transport='buffered', protocol='binary'):
+    return utils.thrift_connect(thrift_ip, thrift_port, services,
+                                transport=transport, protocol=protocol)
 
 def handle_bad_input(f):
     @wraps(f)
@@ -574,6 +587,9 @@ def handle_bad_input(f):
         except InvalidCrcOperation as e:
             error = CrcErrorCode._VALUES_TO_NAMES[e.code]
             print "Invalid crc operation (%s)" % error
+        except InvalidPerfCountersOperation as e:
+            error = PerfCountersErrorCode._VALUES_TO_NAMES[e.code]
+            print "Invalid perf counters operation (%s): %s" % (error, e.info)
     return handle
 
 # thrift does not support unsigned integers
@@ -610,6 +626,23 @@ def parse_bool(s):
         pass
     raise UIn_Error("Invalid bool parameter")
 
+# number of entries (or members, groups) retrieved per Thrift call when dumping
+# a table: large tables are streamed one page at a time instead of being
+# retrieved all at once
+DUMP_PAGE_SIZE = 1024
+
+# get_page(cursor) is one of the bm_*_page Thrift calls, items is the name of
+# the list in the returned page
+def iter_pages(get_page, items):
+    cursor = 0
+    while True:
+        page = get_page(cursor)
+        for item in getattr(page, items):
+            yield item
+        cursor = page.next_cursor
+        if cursor == 0:
+            break
+
 class RuntimeAPI(cmd.Cmd):
     prompt = 'RuntimeCmd: '
     intro = "Control utility for runtime P4 table manipulation"
@@ -1768,7 +1801,10 @@ class RuntimeAPI(cmd.Cmd):
         self.exactly_n_args(args, 1)
         table_name = args[0]
         table = self.get_res("table", table_name, TABLES)
-        entries = self.client.bm_mt_get_entries(0, table_name)
+        entries = iter_pages(
+            lambda cursor: self.client.bm_mt_get_entries_page(
+                0, table_name, cursor, DUMP_PAGE_SIZE),
+            "entries")
 
         print "=========="
         print "TABLE ENTRIES"
@@ -1779,13 +1815,19 @@ class RuntimeAPI(cmd.Cmd):
 
         if table.type_ == TableType.indirect or\
            table.type_ == TableType.indirect_ws:
-            members = self.client.bm_mt_indirect_get_members(0, table_name)
+            members = iter_pages(
+                lambda cursor: self.client.bm_mt_indirect_get_members_page(
+                    0, table_name, cursor, DUMP_PAGE_SIZE),
+                "members")
             print "=========="
             print "MEMBERS"
             self.dump_members(members)
 
         if table.type_ == TableType.indirect_ws:
-            groups = self.client.bm_mt_indirect_ws_get_groups(0, table_name)
+            groups = iter_pages(
+                lambda cursor: self.client.bm_mt_indirect_ws_get_groups_page(
+                    0, table_name, cursor, DUMP_PAGE_SIZE),
+                "groups")
             print "=========="
             print "GROUPS"
             self.dump_groups(groups)
@@ -1870,6 +1912,82 @@ class RuntimeAPI(cmd.Cmd):
         self.exactly_n_args(line.split(), 0)
         self.client.bm_reset_state()
 
+    @handle_bad_input
+    def do_trace_packets(self, line):
+        "Select packets to trace (only needed if bmv2 was compiled without per-packet logging), packets need to match all criteria: trace_packets [port=<port>]* [sample=<1-in-N>] [<header.field>=<value>]* | trace_packets off"
+        args = line.split()
+        if args == ["off"]:
+            self.client.bm_disable_packet_tracing()
+            return
+        config = BmPacketTracingConfig(ports=[], sampling_rate=1,
+                                       field_matches=[])
+        for arg in args:
+            try:
+                name, value = arg.split("=")
+                value = int(value, 0)
+            except ValueError:
+                raise UIn_Error(
+                    "Invalid criterion '{}', expected <name>=<value>".format(arg))
+            if name == "port":
+                config.ports.append(value)
+            elif name == "sample":
+                config.sampling_rate = value
+            else:
+                nbytes = (max(value.bit_length(), 1) + 7) / 8
+                config.field_matches.append(BmPacketTracingFieldMatch(
+                    field_name=name,
+                    value=bytes_to_string(int_to_bytes(value, nbytes))))
+        self.client.bm_enable_packet_tracing(config)
+
+    @handle_bad_input
+    def do_perf_counters(self, line):
+        "Sample hardware performance counters for each parser, table, conditional and deparser: perf_counters on [sample=<1-in-N>] | perf_counters off | perf_counters reset"
+        args = line.split()
+        if not args or args[0] not in ["on", "off", "reset"]:
+            raise UIn_Error("Expected 'on', 'off' or 'reset'")
+        if args[0] != "on":
+            self.exactly_n_args(args, 1)
+            if args[0] == "off":
+                self.client.bm_disable_perf_counters()
+            else:
+                self.client.bm_reset_perf_counters()
+            return
+        sampling_rate = 1
+        for arg in args[1:]:
+            try:
+                name, value = arg.split("=")
+                value = int(value, 0)
+            except ValueError:
+                name = None
+            if name != "sample":
+                raise UIn_Error(
+                    "Invalid option '{}', expected sample=<1-in-N>".format(arg))
+            sampling_rate = value
+        self.client.bm_enable_perf_counters(sampling_rate)
+
+    def complete_perf_counters(self, text, line, start_index, end_index):
+        return [c for c in ["on", "off", "reset"] if c.startswith(text)]
+
+    @handle_bad_input
+    def do_show_perf_counters(self, line):
+        "Show the hardware performance counters sampled for each P4 object, per sample and sorted by cycles: show_perf_counters"
+        self.exactly_n_args(line.split(), 0)
+        entries = self.client.bm_get_perf_counters()
+        if not entries:
+            print "No samples"
+            return
+        entries.sort(key=lambda e: e.cycles, reverse=True)
+        fmt = "{:<8}{:<12}{:<30}{:>10}{:>12}{:>14}{:>12}{:>14}"
+        print fmt.format("context", "type", "name", "samples", "cycles",
+                         "instructions", "LLC misses", "branch misses")
+        for e in entries:
+            per_sample = lambda v: "{:.1f}".format(float(v) / e.samples)
+            print fmt.format(
+                e.cxt_id, BmPerfCountersObjectType._VALUES_TO_NAMES[e.type],
+                e.name, e.samples, per_sample(e.cycles),
+                per_sample(e.instructions), per_sample(e.llc_misses),
+                per_sample(e.branch_misses))
+
     @handle_bad_input
     def do_write_config_to_file(self, line):
         "Retrieves the JSON config currently used by the switch and dumps it to user-specified file"
@@ -1936,7 +2054,8 @@ def main():
 
     standard_client, mc_client = thrift_connect(
         args.thrift_ip, args.thrift_port,
-        RuntimeAPI.get_thrift_services(args.pre)
+        RuntimeAPI.get_thrift_services(args.pre),
+        transport=args.thrift_transport, protocol=args.thrift_protocol
     )
 
     load_json_config(standard_client, args.json)